@@ -153,6 +153,13 @@ enum cfs_hash_tag {
          * change on hash table is non-blocking
          */
         CFS_HASH_NBLK_CHANGE    = 1 << 13,
+        /**
+         * items are linked with RCU list primitives, so bucket chains can
+         * be walked under rcu_read_lock() by cfs_hash_bd_peek_rcu(); the
+         * user must free items only after a grace period. Can't be used
+         * with CFS_HASH_REHASH or CFS_HASH_ADD_TAIL.
+         */
+        CFS_HASH_RCU            = 1 << 14,
         /** NB, we typed hs_flags as  __u16, please change it
          * if you need to extend >=16 flags */
 };
@@ -414,6 +421,12 @@ cfs_hash_with_depth(struct cfs_hash *hs)
         return (hs->hs_flags & CFS_HASH_DEPTH) != 0;
 }
 
+static inline int
+cfs_hash_with_rcu(struct cfs_hash *hs)
+{
+	return (hs->hs_flags & CFS_HASH_RCU) != 0;
+}
+
 static inline int
 cfs_hash_with_nblk_change(struct cfs_hash *hs)
 {
@@ -631,6 +644,9 @@ struct hlist_node *
 cfs_hash_bd_peek_locked(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 			const void *key);
 struct hlist_node *
+cfs_hash_bd_peek_rcu(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+		     const void *key);
+struct hlist_node *
 cfs_hash_bd_findadd_locked(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 			   const void *key, struct hlist_node *hnode,
 			   int insist_add);
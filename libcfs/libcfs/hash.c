@@ -104,6 +104,7 @@
  */
 #include <linux/seq_file.h>
 #include <linux/log2.h>
+#include <linux/rculist.h>
 
 #include <libcfs/linux/linux-list.h>
 #include <libcfs/libcfs.h>
@@ -260,7 +261,10 @@ static int
 cfs_hash_hh_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_add_head(hnode, cfs_hash_hh_hhead(hs, bd));
+	if (cfs_hash_with_rcu(hs))
+		hlist_add_head_rcu(hnode, cfs_hash_hh_hhead(hs, bd));
+	else
+		hlist_add_head(hnode, cfs_hash_hh_hhead(hs, bd));
 	return -1; /* unknown depth */
 }
 
@@ -268,7 +272,10 @@ static int
 cfs_hash_hh_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 		      struct hlist_node *hnode)
 {
-	hlist_del_init(hnode);
+	if (cfs_hash_with_rcu(hs))
+		hlist_del_init_rcu(hnode);
+	else
+		hlist_del_init(hnode);
 	return -1; /* unknown depth */
 }
 
@@ -304,7 +311,10 @@ cfs_hash_hd_hnode_add(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_add_head(hnode, &hh->hd_head);
+	if (cfs_hash_with_rcu(hs))
+		hlist_add_head_rcu(hnode, &hh->hd_head);
+	else
+		hlist_add_head(hnode, &hh->hd_head);
 	return ++hh->hd_depth;
 }
 
@@ -316,7 +326,10 @@ cfs_hash_hd_hnode_del(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 
 	hh = container_of(cfs_hash_hd_hhead(hs, bd),
 			  struct cfs_hash_head_dep, hd_head);
-	hlist_del_init(hnode);
+	if (cfs_hash_with_rcu(hs))
+		hlist_del_init_rcu(hnode);
+	else
+		hlist_del_init(hnode);
 	return --hh->hd_depth;
 }
 
@@ -679,6 +692,32 @@ cfs_hash_bd_peek_locked(struct cfs_hash *hs, struct cfs_hash_bd *bd,
 }
 EXPORT_SYMBOL(cfs_hash_bd_peek_locked);
 
+/**
+ * Lockless variant of cfs_hash_bd_peek_locked() for CFS_HASH_RCU hashes.
+ * Caller must hold rcu_read_lock(), and the returned item may be concurrently
+ * removed from the hash, so the caller has to validate it (e.g. by taking a
+ * reference only if it is not being freed). A concurrent removal can make the
+ * walk miss an item, so a NULL return has to be confirmed under the bucket
+ * lock.
+ */
+struct hlist_node *
+cfs_hash_bd_peek_rcu(struct cfs_hash *hs, struct cfs_hash_bd *bd,
+		     const void *key)
+{
+	struct hlist_head *hhead = cfs_hash_bd_hhead(hs, bd);
+	struct hlist_node *hnode;
+
+	LASSERT(cfs_hash_with_rcu(hs));
+
+	for (hnode = rcu_dereference(hhead->first); hnode != NULL;
+	     hnode = rcu_dereference(hnode->next)) {
+		if (cfs_hash_keycmp(hs, key, hnode))
+			return hnode;
+	}
+	return NULL;
+}
+EXPORT_SYMBOL(cfs_hash_bd_peek_rcu);
+
 static void
 cfs_hash_multi_bd_lock(struct cfs_hash *hs, struct cfs_hash_bd *bds,
                        unsigned n, int excl)
@@ -1024,6 +1063,8 @@ cfs_hash_create(char *name, unsigned cur_bits, unsigned max_bits,
         LASSERT(ergo((flags & CFS_HASH_REHASH) == 0, cur_bits == max_bits));
         LASSERT(ergo((flags & CFS_HASH_REHASH) != 0,
                      (flags & CFS_HASH_NO_LOCK) == 0));
+	LASSERT(ergo((flags & CFS_HASH_RCU) != 0,
+		     (flags & (CFS_HASH_REHASH | CFS_HASH_ADD_TAIL)) == 0));
         LASSERT(ergo((flags & CFS_HASH_REHASH_KEY) != 0,
                       ops->hs_keycpy != NULL));
 
@@ -163,6 +163,16 @@ struct lnet_ioctl_element_stats {
 	__u32 iel_drop_count;
 };
 
+/* health of a local or peer NI, looked up by hs_nid */
+struct lnet_ioctl_element_hstats {
+	struct libcfs_ioctl_hdr hs_hdr;
+	lnet_nid_t hs_nid;
+	__u32 hs_health_value;
+	__u32 hs_fail_count;
+	__u32 hs_resend_count;
+	__u32 hs_pad;
+};
+
 struct lnet_ioctl_element_msg_stats {
 	struct libcfs_ioctl_hdr im_hdr;
 	__u32 im_idx;
@@ -230,6 +240,31 @@ struct lnet_ioctl_peer_cfg {
 	void __user *prcfg_bulk;
 };
 
+/* what a selection rule applies a priority to */
+#define LNET_SEL_RULE_LOCAL_NI	0	/* local NIs matching sr_nid */
+#define LNET_SEL_RULE_PEER_NI	1	/* peer NIs matching sr_nid */
+#define LNET_SEL_RULE_NET	2	/* sr_net of peers matching sr_nid */
+#define LNET_SEL_RULE_ROUTER	3	/* gateways matching sr_nid */
+#define LNET_SEL_RULE_MAX	LNET_SEL_RULE_ROUTER
+
+/* priority of anything no rule matches, lower values are preferred */
+#define LNET_SEL_PRIO_DEFAULT	0xffffffff
+/* sr_idx of IOC_LIBCFS_DEL_SEL_RULE that deletes all rules */
+#define LNET_SEL_RULE_IDX_ALL	0xffffffff
+
+/*
+ * NI/peer selection rule. sr_nid is a NID, LNET_NID_ANY, or a NID with
+ * the address part of LNET_NID_ANY to match all NIDs of a network.
+ */
+struct lnet_ioctl_sel_rule {
+	struct libcfs_ioctl_hdr sr_hdr;
+	__u32 sr_idx;
+	__u32 sr_type;
+	__u32 sr_priority;
+	__u32 sr_net;
+	lnet_nid_t sr_nid;
+};
+
 struct lnet_ioctl_numa_range {
 	struct libcfs_ioctl_hdr nr_hdr;
 	__u32 nr_range;
@@ -182,6 +182,11 @@ lnet_net_lock_current(void)
 extern struct kmem_cache *lnet_mes_cachep;	 /* MEs kmem_cache */
 extern struct kmem_cache *lnet_small_mds_cachep; /* <= LNET_SMALL_MD_SIZE bytes
 						  * MDs kmem_cache */
+extern struct kmem_cache *lnet_msgs_cachep;	 /* messages kmem_cache */
+extern unsigned int lnet_desc_cache_max;
+
+void *lnet_desc_alloc(enum lnet_desc_type type);
+void lnet_desc_free(enum lnet_desc_type type, void *desc);
 
 static inline struct lnet_eq *
 lnet_eq_alloc (void)
@@ -215,8 +220,7 @@ lnet_md_alloc(struct lnet_md *umd)
 	}
 
 	if (size <= LNET_SMALL_MD_SIZE) {
-		md = kmem_cache_alloc(lnet_small_mds_cachep,
-				      GFP_NOFS | __GFP_ZERO);
+		md = lnet_desc_alloc(LNET_DESC_MD);
 		if (md) {
 			CDEBUG(D_MALLOC, "slab-alloced 'md' of size %u at "
 			       "%p.\n", size, md);
@@ -251,7 +255,7 @@ lnet_md_free(struct lnet_libmd *md)
 
 	if (size <= LNET_SMALL_MD_SIZE) {
 		CDEBUG(D_MALLOC, "slab-freed 'md' at %p.\n", md);
-		kmem_cache_free(lnet_small_mds_cachep, md);
+		lnet_desc_free(LNET_DESC_MD, md);
 	} else {
 		LIBCFS_FREE(md, size);
 	}
@@ -262,7 +266,7 @@ lnet_me_alloc (void)
 {
 	struct lnet_me *me;
 
-	me = kmem_cache_alloc(lnet_mes_cachep, GFP_NOFS | __GFP_ZERO);
+	me = lnet_desc_alloc(LNET_DESC_ME);
 
 	if (me)
 		CDEBUG(D_MALLOC, "slab-alloced 'me' at %p.\n", me);
@@ -276,7 +280,7 @@ static inline void
 lnet_me_free(struct lnet_me *me)
 {
 	CDEBUG(D_MALLOC, "slab-freed 'me' at %p.\n", me);
-	kmem_cache_free(lnet_mes_cachep, me);
+	lnet_desc_free(LNET_DESC_ME, me);
 }
 
 struct lnet_libhandle *lnet_res_lh_lookup(struct lnet_res_container *rec,
@@ -439,19 +443,15 @@ lnet_ni_decref(struct lnet_ni *ni)
 static inline struct lnet_msg *
 lnet_msg_alloc(void)
 {
-	struct lnet_msg *msg;
-
-	LIBCFS_ALLOC(msg, sizeof(*msg));
-
-	/* no need to zero, LIBCFS_ALLOC does for us */
-	return (msg);
+	/* no need to zero, lnet_desc_alloc does for us */
+	return lnet_desc_alloc(LNET_DESC_MSG);
 }
 
 static inline void
 lnet_msg_free(struct lnet_msg *msg)
 {
 	LASSERT(!msg->msg_onactivelist);
-	LIBCFS_FREE(msg, sizeof(*msg));
+	lnet_desc_free(LNET_DESC_MSG, msg);
 }
 
 void lnet_ni_free(struct lnet_ni *ni);
@@ -498,6 +498,10 @@ int lnet_lib_init(void);
 void lnet_lib_exit(void);
 
 extern unsigned int lnet_numa_range;
+extern unsigned int lnet_health_sensitivity;
+extern unsigned int lnet_health_recovery;
+extern unsigned int lnet_retry_count;
+extern unsigned int lnet_peer_discovery_disabled;
 extern int portal_rotor;
 
 int lnet_notify(struct lnet_ni *ni, lnet_nid_t peer, int alive,
@@ -604,6 +608,10 @@ lnet_ptl_unsetopt(struct lnet_portal *ptl, int opt)
 /* match-table functions */
 struct list_head *lnet_mt_match_head(struct lnet_match_table *mtable,
 			       struct lnet_process_id id, __u64 mbits);
+void lnet_mt_mask_create(struct lnet_match_table *mtable, __u64 ignore_bits);
+void lnet_mt_attach_me(struct lnet_match_table *mtable, struct lnet_me *me,
+		       struct lnet_me *current_me, enum lnet_ins_pos pos);
+void lnet_mt_detach_me(struct lnet_me *me);
 struct lnet_match_table *lnet_mt_of_attach(unsigned int index,
 					   struct lnet_process_id id,
 					   __u64 mbits, __u64 ignore_bits,
@@ -661,7 +669,7 @@ int lnet_fault_ctl(int cmd, struct libcfs_ioctl_data *data);
 int lnet_fault_init(void);
 void lnet_fault_fini(void);
 
-bool lnet_drop_rule_match(struct lnet_hdr *hdr);
+bool lnet_drop_rule_match(struct lnet_hdr *hdr, bool send);
 
 int lnet_delay_rule_add(struct lnet_fault_attr *attr);
 int lnet_delay_rule_del(lnet_nid_t src, lnet_nid_t dst, bool shutdown);
@@ -818,9 +826,20 @@ bool lnet_peer_is_ni_pref_locked(struct lnet_peer_ni *lpni,
 int lnet_add_peer_ni_to_peer(lnet_nid_t key_nid, lnet_nid_t nid, bool mr);
 int lnet_del_peer_ni_from_peer(lnet_nid_t key_nid, lnet_nid_t nid);
 int lnet_get_peer_info(__u32 idx, lnet_nid_t *primary_nid, lnet_nid_t *nid,
-		       bool *mr,
+		       bool *mr, __u32 *state,
 		       struct lnet_peer_ni_credit_info __user *peer_ni_info,
 		       struct lnet_ioctl_element_stats __user *peer_ni_stats);
+int lnet_get_peer_ni_hstats(struct lnet_ioctl_element_hstats *hstats);
+__u32 lnet_sel_priority(__u32 type, __u32 net, lnet_nid_t nid);
+void lnet_sel_apply_peer_locked(struct lnet_peer *lp);
+int lnet_sel_rule_add(struct lnet_ioctl_sel_rule *cfg);
+int lnet_sel_rule_del(__u32 idx);
+int lnet_sel_rule_get(struct lnet_ioctl_sel_rule *cfg);
+void lnet_sel_rules_cleanup(void);
+int lnet_peer_discovery_start(void);
+void lnet_peer_discovery_stop(void);
+void lnet_peer_discovery_push(void);
+void lnet_peer_queue_discovery_locked(struct lnet_peer *lp, lnet_nid_t nid);
 int lnet_get_peer_ni_info(__u32 peer_index, __u64 *nid,
 			  char alivness[LNET_MAX_STR_LEN],
 			  __u32 *cpt_iter, __u32 *refcount,
@@ -856,6 +875,39 @@ lnet_set_peer_ni_health_locked(struct lnet_peer_ni *lpni, bool health)
 	lpni->lpni_healthy = health;
 }
 
+/*
+ * Health values are only written when a send fails; the time based
+ * recovery since then is applied whenever the value is read.
+ */
+static inline int
+lnet_healthv_current(int healthv, time64_t stamp)
+{
+	time64_t elapsed;
+
+	if (healthv >= LNET_MAX_HEALTH_VALUE)
+		return LNET_MAX_HEALTH_VALUE;
+
+	elapsed = ktime_get_seconds() - stamp;
+	if (elapsed <= 0)
+		return healthv;
+
+	return min_t(time64_t, LNET_MAX_HEALTH_VALUE,
+		     healthv + elapsed * lnet_health_recovery);
+}
+
+static inline int
+lnet_ni_healthv(struct lnet_ni *ni)
+{
+	return lnet_healthv_current(ni->ni_healthv, ni->ni_health_stamp);
+}
+
+static inline int
+lnet_peer_ni_healthv(struct lnet_peer_ni *lpni)
+{
+	return lnet_healthv_current(lpni->lpni_healthv,
+				    lpni->lpni_health_stamp);
+}
+
 static inline bool
 lnet_is_peer_net_healthy_locked(struct lnet_peer_net *peer_net)
 {
@@ -102,6 +102,12 @@ typedef struct lnet_msg {
 	unsigned int          msg_onactivelist:1; /* on the activelist */
 	unsigned int	      msg_rdma_get:1;
 
+	/* # times this message has been resent after a failed send */
+	unsigned int		msg_retry_count;
+	/* source and router NIDs passed to lnet_send(), kept for resends */
+	lnet_nid_t		msg_src_nid_param;
+	lnet_nid_t		msg_rtr_nid_param;
+
 	struct lnet_peer_ni  *msg_txpeer;         /* peer I'm sending to */
 	struct lnet_peer_ni  *msg_rxpeer;         /* peer I received from */
 
@@ -151,6 +157,8 @@ typedef struct lnet_me {
 	__u64			me_ignore_bits;
 	enum lnet_unlink	me_unlink;
 	struct lnet_libmd      *me_md;
+	/* mask group this ME is hashed on, NULL if not indexed by mask */
+	struct lnet_mt_mask    *me_mask;
 } lnet_me_t;
 
 typedef struct lnet_libmd {
@@ -296,8 +304,19 @@ struct lnet_element_stats {
 	atomic_t	send_count;
 	atomic_t	recv_count;
 	atomic_t	drop_count;
+	/* sends that failed over this element */
+	atomic_t	fail_count;
+	/* failed sends which were resent on another path */
+	atomic_t	resend_count;
 };
 
+/*
+ * Health of a local or peer NI ranges from 0 to LNET_MAX_HEALTH_VALUE.
+ * It drops by lnet_health_sensitivity on every failed send and recovers
+ * by lnet_health_recovery every second afterwards.
+ */
+#define LNET_MAX_HEALTH_VALUE	1000
+
 struct lnet_net {
 	/* chain on the ln_nets */
 	struct list_head	net_list;
@@ -393,6 +412,15 @@ typedef struct lnet_ni {
 	/* NI statistics */
 	struct lnet_element_stats ni_stats;
 
+	/* health value as of ni_health_stamp, protected by ni_lock */
+	int			ni_healthv;
+
+	/* when ni_healthv last dropped */
+	time64_t		ni_health_stamp;
+
+	/* priority given by selection rules, lower is preferred */
+	__u32			ni_sel_priority;
+
 	/* physical device CPT */
 	int			ni_dev_cpt;
 
@@ -415,6 +443,8 @@ typedef struct lnet_ni {
 #define LNET_PING_FEAT_BASE		(1 << 0)	/* just a ping */
 #define LNET_PING_FEAT_NI_STATUS	(1 << 1)	/* return NI status */
 #define LNET_PING_FEAT_RTE_DISABLED	(1 << 2)	/* Routing enabled */
+#define LNET_PING_FEAT_MULTI_RAIL	(1 << 3)	/* Multi-Rail aware */
+#define LNET_PING_FEAT_DISCOVERY	(1 << 4)	/* accepts pushes */
 
 #define LNET_PING_FEAT_MASK		(LNET_PING_FEAT_BASE | \
 					 LNET_PING_FEAT_NI_STATUS)
@@ -505,6 +535,13 @@ struct lnet_peer_ni {
 	__u32			lpni_gw_seq;
 	/* health flag */
 	bool			lpni_healthy;
+	/* health value as of lpni_health_stamp, protected by lpni_lock */
+	int			lpni_healthv;
+	/* when lpni_healthv last dropped */
+	time64_t		lpni_health_stamp;
+	/* priorities given by selection rules, lower is preferred */
+	__u32			lpni_sel_priority;
+	__u32			lpni_gw_sel_priority;
 	/* returned RC ping features. Protected with lpni_lock */
 	unsigned int		lpni_ping_feats;
 	/* routes on this peer */
@@ -515,8 +552,23 @@ struct lnet_peer_ni {
 	__u32			lpni_pref_nnids;
 	/* router checker state */
 	struct lnet_rc_data	*lpni_rcd;
+	/* chain on the_lnet.ln_dc_request, holds a reference */
+	struct list_head	lpni_dc_list;
 };
 
+/* peer was added or modified through DLC, discovery leaves it alone */
+#define LNET_PEER_CONFIGURED	(1 << 0)
+/* queued for or undergoing discovery */
+#define LNET_PEER_DISCOVERING	(1 << 1)
+/* NID list learned from the peer's ping buffer */
+#define LNET_PEER_DISCOVERED	(1 << 2)
+/* last discovery attempt failed, retry after LNET_DC_RETRY_INTERVAL */
+#define LNET_PEER_DC_ERROR	(1 << 3)
+/* peer accepts push notifications */
+#define LNET_PEER_PUSH		(1 << 4)
+/* our NIDs changed and the peer has not been told yet */
+#define LNET_PEER_PUSH_PENDING	(1 << 5)
+
 struct lnet_peer {
 	/* chain on global peer list */
 	struct list_head	lp_on_lnet_peer_list;
@@ -529,6 +581,12 @@ struct lnet_peer {
 
 	/* peer is Multi-Rail enabled peer */
 	bool			lp_multi_rail;
+
+	/* LNET_PEER_* discovery state, protected by ln_dc_lock */
+	__u32			lp_state;
+
+	/* when discovery of this peer last failed */
+	time64_t		lp_dc_stamp;
 };
 
 struct lnet_peer_net {
@@ -543,6 +601,9 @@ struct lnet_peer_net {
 
 	/* Net ID */
 	__u32			lpn_net_id;
+
+	/* priority given by selection rules, lower is preferred */
+	__u32			lpn_sel_priority;
 };
 
 /* peer hash size */
@@ -577,6 +638,15 @@ typedef struct lnet_route {
 	unsigned int		lr_priority;	/* route priority */
 } lnet_route_t;
 
+/* NI/peer selection rule, see struct lnet_ioctl_sel_rule */
+struct lnet_sel_rule {
+	struct list_head	sr_list;	/* chain on ln_sel_rules */
+	__u32			sr_type;	/* LNET_SEL_RULE_* */
+	__u32			sr_priority;	/* lower is preferred */
+	__u32			sr_net;		/* net of NET rules */
+	lnet_nid_t		sr_nid;		/* NID pattern to match */
+};
+
 #define LNET_REMOTE_NETS_HASH_DEFAULT	(1U << 7)
 #define LNET_REMOTE_NETS_HASH_MAX	(1U << 16)
 #define LNET_REMOTE_NETS_HASH_SIZE	(1 << the_lnet.ln_remote_nets_hbits)
@@ -610,6 +680,13 @@ typedef struct lnet_rtrbufpool {
 	int			rbp_credits;
 	/* low water mark */
 	int			rbp_mincredits;
+	/* low water mark since the last auto-sizing pass */
+	int			rbp_win_mincredits;
+	/* # messages that had to wait for a buffer */
+	__u64			rbp_nblocked;
+	/* # times auto-sizing grew / shrank the pool */
+	unsigned int		rbp_ngrown;
+	unsigned int		rbp_nshrunk;
 } lnet_rtrbufpool_t;
 
 typedef struct lnet_rtrbuf {
@@ -662,6 +739,20 @@ struct lnet_match_info {
 #define LNET_MT_BITS_U64		6	/* 2^6 bits */
 #define LNET_MT_EXHAUSTED_BITS		(LNET_MT_HASH_BITS - LNET_MT_BITS_U64)
 #define LNET_MT_EXHAUSTED_BMAP		((1 << LNET_MT_EXHAUSTED_BITS) + 1)
+/* max # distinct ignore-bits masks indexed for each match table, MEs with
+ * any other mask go on the scan list mt_mhash[LNET_MT_HASH_IGNORE] */
+#define LNET_MT_MASKS_MAX		8
+
+/* MEs of a wildcard match table sharing the same ignore-bits, hashed by
+ * the match-bits they don't ignore. They count as part of the ignore-bits
+ * position LNET_MT_HASH_IGNORE of the exhausted bitmap. */
+struct lnet_mt_mask {
+	struct list_head	mm_list;	/* chain on mt_masks */
+	__u64			mm_ignore_bits;
+	unsigned int		mm_nme;		/* # MEs hashed here */
+	unsigned int		mm_nmd;		/* # unexhausted MDs of them */
+	struct list_head	mm_mhash[LNET_MT_HASH_SIZE];
+};
 
 /* portal match table */
 struct lnet_match_table {
@@ -674,6 +765,9 @@ struct lnet_match_table {
 	/* bitmap to flag whether MEs on mt_hash are exhausted or not */
 	__u64			mt_exhausted[LNET_MT_EXHAUSTED_BMAP];
 	struct list_head	*mt_mhash;	/* matching hash */
+	/* mask groups of MEs with ignore-bits, kept until portal cleanup */
+	struct list_head	mt_masks;
+	unsigned int		mt_nmasks;
 };
 
 /* these are only useful for wildcard portal */
@@ -729,11 +823,42 @@ struct lnet_msg_container {
 	void			**msc_finalizers;
 };
 
+enum lnet_desc_type {
+	LNET_DESC_MSG = 0,
+	LNET_DESC_MD,		/* MDs of up to LNET_SMALL_MD_SIZE bytes */
+	LNET_DESC_ME,
+	LNET_DESC_NTYPES,
+};
+
+/* per-CPT cache of free descriptors of one type */
+struct lnet_desc_cache {
+	spinlock_t		dc_lock;
+	struct list_head	dc_free;	/* free descriptors */
+	unsigned int		dc_nfree;	/* # on dc_free */
+	__u64			dc_nalloc;	/* # allocations */
+	__u64			dc_nhit;	/* # allocations from dc_free */
+	__u64			dc_nrelease;	/* # frees */
+};
+
 /* Router Checker states */
 #define LNET_RC_STATE_SHUTDOWN		0	/* not started */
 #define LNET_RC_STATE_RUNNING		1	/* started up OK */
 #define LNET_RC_STATE_STOPPING		2	/* telling thread to stop */
 
+/* peer discovery thread states */
+#define LNET_DC_STATE_SHUTDOWN		0	/* not started */
+#define LNET_DC_STATE_RUNNING		1	/* started up OK */
+#define LNET_DC_STATE_STOPPING		2	/* telling thread to stop */
+
+/* most NIDs learned from one peer */
+#define LNET_DC_MAX_NIS			64
+/* # of push notifications buffered for the discovery thread */
+#define LNET_DC_PUSH_SLOTS		64
+/* seconds to wait for a discovery ping */
+#define LNET_DC_PING_TIMEOUT		20
+/* seconds before retrying a failed discovery */
+#define LNET_DC_RETRY_INTERVAL		60
+
 /* LNet states */
 #define LNET_STATE_SHUTDOWN		0	/* not started */
 #define LNET_STATE_RUNNING		1	/* started up OK */
@@ -769,6 +894,8 @@ typedef struct lnet {
 	/* percpt message containers for active/finalizing/freed message */
 	struct lnet_msg_container	**ln_msg_containers;
 	struct lnet_counters		**ln_counters;
+	/* percpt caches of free descriptors, LNET_DESC_NTYPES per CPT */
+	struct lnet_desc_cache		**ln_desc_caches;
 	struct lnet_peer_table		**ln_peer_tables;
 	/* list of configured or discovered peers */
 	struct list_head		ln_peers;
@@ -778,6 +905,8 @@ typedef struct lnet {
 	struct list_head		ln_test_peers;
 	struct list_head		ln_drop_rules;
 	struct list_head		ln_delay_rules;
+	/* NI/peer selection rules, see lnet_sel_priority() */
+	struct list_head		ln_sel_rules;
 	/* LND instances */
 	struct list_head		ln_nets;
 	/* the loopback NI */
@@ -811,6 +940,35 @@ typedef struct lnet {
 	/* serialise startup/shutdown */
 	struct semaphore		ln_rc_signal;
 
+	/* peer discovery thread startup/shutdown state */
+	int				ln_dc_state;
+	/* protects the discovery lists, push slots and lnet_peer::lp_state */
+	spinlock_t			ln_dc_lock;
+	/* peer NIs waiting to be discovered */
+	struct list_head		ln_dc_request;
+	/* discovery pings on the wire */
+	struct list_head		ln_dc_working;
+	/* discovery pings whose MD has been unlinked */
+	struct list_head		ln_dc_done;
+	/* discovery thread sleeps here */
+	wait_queue_head_t		ln_dc_waitq;
+	/* serialise discovery startup/shutdown */
+	struct semaphore		ln_dc_signal;
+	/* event queue of discovery pings */
+	struct lnet_handle_eq		ln_dc_eqh;
+	/* push target, receives notifications of peer NI changes */
+	struct lnet_handle_md		ln_push_target_md;
+	struct lnet_handle_eq		ln_push_target_eq;
+	/* set until the push target MD is unlinked */
+	bool				ln_push_target_busy;
+	/* local NIs changed, notify discovered peers */
+	bool				ln_dc_push_all;
+	/* pushes were dropped, rediscover all peers */
+	bool				ln_dc_push_overflow;
+	/* source NIDs of pushes not yet handled */
+	int				ln_dc_push_count;
+	lnet_nid_t			ln_dc_push_nids[LNET_DC_PUSH_SLOTS];
+
 	struct mutex			ln_api_mutex;
 	struct mutex			ln_lnd_mutex;
 	/* Have I called LNetNIInit myself? */
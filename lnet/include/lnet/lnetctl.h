@@ -43,6 +43,19 @@ enum {
 #define LNET_GET_BIT		(1 << 2)
 #define LNET_REPLY_BIT		(1 << 3)
 
+/** distribution of the jitter of a delay rule, see lnet_fault_attr */
+enum {
+	/** uniform in [-la_jitter, la_jitter] */
+	LNET_FAULT_JITTER_UNIFORM	= 0,
+	/** normal, with la_jitter as standard deviation */
+	LNET_FAULT_JITTER_NORMAL	= 1,
+	/** Pareto (shape 2), always positive, la_jitter on average */
+	LNET_FAULT_JITTER_PARETO	= 2,
+};
+
+/** largest la_jitter of a delay rule, in milliseconds */
+#define LNET_FAULT_JITTER_MAX		60000
+
 /** ioctl parameter for LNet fault simulation */
 struct lnet_fault_attr {
 	/**
@@ -80,6 +93,12 @@ struct lnet_fault_attr {
 			 * with da_rate
 			 */
 			__u32			da_interval;
+			/**
+			 * fail the matched sends of this node with a network
+			 * error, rather than dropping the matched messages
+			 * on receipt
+			 */
+			__u32			da_send_error;
 		} drop;
 		/** message latency simulation */
 		struct {
@@ -89,8 +108,22 @@ struct lnet_fault_attr {
 			 * with la_rate
 			 */
 			__u32			la_interval;
-			/** latency to delay */
+			/** latency to delay, in seconds */
 			__u32			la_latency;
+			/** latency to delay, in milliseconds, added to
+			 * la_latency */
+			__u32			la_latency_ms;
+			/** jitter of the latency, in milliseconds */
+			__u32			la_jitter;
+			/** LNET_FAULT_JITTER_* */
+			__u32			la_jitter_dist;
+			/**
+			 * bandwidth limit in KiB/s of the delayed messages,
+			 * shared by all the NID pairs the rule matches
+			 */
+			__u32			la_bandwidth;
+			/** burst allowed above la_bandwidth, in KiB */
+			__u32			la_burst;
 		} delay;
 		__u64			space[8];
 	} u;
@@ -117,6 +150,8 @@ struct lnet_fault_stat {
 		struct {
 			/** total # delayed messages */
 			__u64			ls_delayed;
+			/** # messages held back by the bandwidth limit */
+			__u64			ls_throttled;
 		} delay;
 		__u64			space[8];
 	} u;
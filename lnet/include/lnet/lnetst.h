@@ -39,9 +39,11 @@
 
 #define LST_FEAT_NONE		(0)
 #define LST_FEAT_BULK_LEN	(1 << 0)	/* enable variable page size */
+#define LST_FEAT_LAT_HIST	(1 << 1)	/* RPC latency histograms */
 
 #define LST_FEATS_EMPTY		(LST_FEAT_NONE)
-#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN)
+#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN | \
+				 LST_FEAT_LAT_HIST)
 
 #define LST_NAME_SIZE		32		/* max name buffer length */
 
@@ -427,8 +429,36 @@ struct lstio_stat_args {
 	struct lnet_process_id __user *lstio_sta_idsp;
 	/* OUT: list head of result buffer */
 	struct list_head __user *lstio_sta_resultp;
+	/* IN: what to query, enum lst_stat_type */
+	int			lstio_sta_type;
 };
 
+enum lst_stat_type {
+	/* sfw, srpc and lnet counters */
+	LST_STAT_COUNTERS	= 0,
+	/* latency histogram of brw test RPCs */
+	LST_STAT_LAT_BRW	= 1,
+	/* latency histogram of ping test RPCs */
+	LST_STAT_LAT_PING	= 2,
+};
+
+/* # of buckets in a latency histogram, see lst_lat_bucket_usec() */
+#define LST_LAT_BUCKETS		64
+
+/**
+ * Lower bound, in microseconds, of bucket \a idx of a latency histogram.
+ * Buckets 0 and 1 hold 0 and 1 usec; above that every power of two is
+ * split in two halves, so a bucket is at most 50% wider than its bound.
+ */
+static inline __u64
+lst_lat_bucket_usec(int idx)
+{
+	if (idx < 2)
+		return idx;
+
+	return (1ULL << (idx / 2)) | ((__u64)(idx & 1) << (idx / 2 - 1));
+}
+
 enum lst_test_type {
 	LST_TEST_BULK	= 1,
 	LST_TEST_PING	= 2
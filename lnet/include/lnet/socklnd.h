@@ -79,6 +79,19 @@ struct ksock_msg {
 	} WIRE_ATTR ksm_u;
 } WIRE_ATTR;
 
+/*
+ * Per-connection counters returned through ioc_pbuf1 of
+ * IOC_LIBCFS_GET_CONN, when ioc_plen1 is large enough.
+ */
+struct ksock_conn_stats {
+	__u64			kcs_tx_msgs;	/* # messages sent */
+	__u64			kcs_tx_bytes;	/* # bytes sent */
+	__u64			kcs_rx_msgs;	/* # LNet messages received */
+	__u64			kcs_rx_bytes;	/* # bytes received */
+	__u32			kcs_tx_queued;	/* # bytes queued for sending */
+	__u32			kcs_sched;	/* scheduler index in the CPT */
+};
+
 #define KSOCK_MSG_NOOP		0xc0		/* ksm_u empty */
 #define KSOCK_MSG_LNET		0xc1		/* lnet msg */
 
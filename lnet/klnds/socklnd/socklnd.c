@@ -81,6 +81,9 @@ ksocknal_create_route (__u32 ipaddr, int port)
         route->ksnr_deleted = 0;
         route->ksnr_conn_count = 0;
         route->ksnr_share_count = 0;
+	route->ksnr_blki_conn_count = 0;
+	route->ksnr_blko_conn_count = 0;
+	route->ksnr_stripes_refused = 0;
 
         return (route);
 }
@@ -357,6 +360,10 @@ ksocknal_associate_route_conn_locked(ksock_route_t *route, ksock_conn_t *conn)
 
         route->ksnr_connected |= (1<<type);
         route->ksnr_conn_count++;
+	if (type == SOCKLND_CONN_BULK_IN)
+		route->ksnr_blki_conn_count++;
+	else if (type == SOCKLND_CONN_BULK_OUT)
+		route->ksnr_blko_conn_count++;
 
         /* Successful connection => further attempts can
          * proceed immediately */
@@ -663,11 +670,28 @@ ksocknal_get_conn_by_idx(struct lnet_ni *ni, int index)
 	return NULL;
 }
 
+/* # of @peer_ni's connections served by @sched */
+static int
+ksocknal_sched_peer_conns_locked(ksock_sched_t *sched,
+				 ksock_peer_ni_t *peer_ni)
+{
+	ksock_conn_t *conn;
+	int	      nconns = 0;
+
+	list_for_each_entry(conn, &peer_ni->ksnp_conns, ksnc_list) {
+		if (conn->ksnc_scheduler == sched)
+			nconns++;
+	}
+
+	return nconns;
+}
+
 static ksock_sched_t *
-ksocknal_choose_scheduler_locked(unsigned int cpt)
+ksocknal_choose_scheduler_locked(unsigned int cpt, ksock_peer_ni_t *peer_ni)
 {
 	struct ksock_sched_info	*info = ksocknal_data.ksnd_sched_info[cpt];
 	ksock_sched_t		*sched;
+	int			npeer;
 	int			i;
 
 	if (info->ksi_nthreads == 0) {
@@ -683,14 +707,25 @@ ksocknal_choose_scheduler_locked(unsigned int cpt)
 
 select_sched:
 	sched = &info->ksi_scheds[0];
+	npeer = ksocknal_sched_peer_conns_locked(sched, peer_ni);
 	/*
 	 * NB: it's safe so far, but info->ksi_nthreads could be changed
 	 * at runtime when we have dynamic LNet configuration, then we
 	 * need to take care of this.
+	 *
+	 * Spread the connections of one peer_ni over the schedulers first,
+	 * so the receive side of striped bulk conns runs on several
+	 * threads, then balance the total load.
 	 */
 	for (i = 1; i < info->ksi_nthreads; i++) {
-		if (sched->kss_nconns > info->ksi_scheds[i].kss_nconns)
-			sched = &info->ksi_scheds[i];
+		ksock_sched_t *s = &info->ksi_scheds[i];
+		int n = ksocknal_sched_peer_conns_locked(s, peer_ni);
+
+		if (n < npeer ||
+		    (n == npeer && sched->kss_nconns > s->kss_nconns)) {
+			sched = s;
+			npeer = n;
+		}
 	}
 
 	return sched;
@@ -1221,8 +1256,18 @@ ksocknal_create_conn(struct lnet_ni *ni, ksock_route_t *route,
         }
 
 	/* Refuse to duplicate an existing connection, unless this is a
-	 * loopback connection */
+	 * loopback connection or one more stripe of a bulk connection.
+	 * The active side decides how many stripes it wants; the passive
+	 * side only enforces the hard limit. */
 	if (conn->ksnc_ipaddr != conn->ksnc_myipaddr) {
+		int nstripes = 0;
+		int max_stripes = 1;
+
+		if (conn->ksnc_type == SOCKLND_CONN_BULK_IN ||
+		    conn->ksnc_type == SOCKLND_CONN_BULK_OUT)
+			max_stripes = active ? ksocknal_conns_per_peer() :
+					       SOCKNAL_CONNS_PER_PEER_MAX;
+
 		list_for_each(tmp, &peer_ni->ksnp_conns) {
 			conn2 = list_entry(tmp, ksock_conn_t, ksnc_list);
 
@@ -1231,6 +1276,9 @@ ksocknal_create_conn(struct lnet_ni *ni, ksock_route_t *route,
                             conn2->ksnc_type != conn->ksnc_type)
                                 continue;
 
+			if (++nstripes < max_stripes)
+				continue;
+
                         /* Reply on a passive connection attempt so the peer_ni
                          * realises we're connected. */
                         LASSERT (rc == 0);
@@ -1272,7 +1320,7 @@ ksocknal_create_conn(struct lnet_ni *ni, ksock_route_t *route,
 	peer_ni->ksnp_send_keepalive = 0;
 	peer_ni->ksnp_error = 0;
 
-	sched = ksocknal_choose_scheduler_locked(cpt);
+	sched = ksocknal_choose_scheduler_locked(cpt, peer_ni);
 	if (!sched) {
 		CERROR("no schedulers available. node is unhealthy\n");
 		goto failed_2;
@@ -1454,6 +1502,11 @@ ksocknal_close_conn_locked (ksock_conn_t *conn, int error)
 		LASSERT(!route->ksnr_deleted);
 		LASSERT((route->ksnr_connected & (1 << conn->ksnc_type)) != 0);
 
+		if (conn->ksnc_type == SOCKLND_CONN_BULK_IN)
+			route->ksnr_blki_conn_count--;
+		else if (conn->ksnc_type == SOCKLND_CONN_BULK_OUT)
+			route->ksnr_blko_conn_count--;
+
 		conn2 = NULL;
 		list_for_each(tmp, &peer_ni->ksnp_conns) {
 			conn2 = list_entry(tmp, ksock_conn_t, ksnc_list);
@@ -1464,8 +1517,11 @@ ksocknal_close_conn_locked (ksock_conn_t *conn, int error)
 
 			conn2 = NULL;
 		}
-		if (conn2 == NULL)
+		if (conn2 == NULL) {
 			route->ksnr_connected &= ~(1 << conn->ksnc_type);
+			/* let the peer be asked for stripes again */
+			route->ksnr_stripes_refused = 0;
+		}
 
 		conn->ksnc_route = NULL;
 
@@ -2199,6 +2255,7 @@ ksocknal_ctl(struct lnet_ni *ni, unsigned int cmd, void *arg)
                         return -ENOENT;
 
                 ksocknal_lib_get_conn_tunables(conn, &txmem, &rxmem, &nagle);
+		rc = 0;
 
                 data->ioc_count  = txmem;
                 data->ioc_nid    = conn->ksnc_peer->ksnp_id.nid;
@@ -2210,8 +2267,27 @@ ksocknal_ctl(struct lnet_ni *ni, unsigned int cmd, void *arg)
 		data->ioc_u32[4] = conn->ksnc_scheduler->kss_info->ksi_cpt;
                 data->ioc_u32[5] = rxmem;
                 data->ioc_u32[6] = conn->ksnc_peer->ksnp_id.pid;
+
+		/* per-connection counters, if the caller asked for them */
+		if (data->ioc_pbuf1 != NULL &&
+		    data->ioc_plen1 >= sizeof(struct ksock_conn_stats)) {
+			struct ksock_conn_stats stats;
+
+			memset(&stats, 0, sizeof(stats));
+			stats.kcs_tx_msgs = conn->ksnc_tx_msgs;
+			stats.kcs_tx_bytes = conn->ksnc_tx_bytes;
+			stats.kcs_rx_msgs = conn->ksnc_rx_msgs;
+			stats.kcs_rx_bytes = conn->ksnc_rx_bytes;
+			stats.kcs_tx_queued = atomic_read(&conn->ksnc_tx_nob);
+			stats.kcs_sched = conn->ksnc_scheduler -
+				&conn->ksnc_scheduler->kss_info->ksi_scheds[0];
+
+			if (copy_to_user(data->ioc_pbuf1, &stats,
+					 sizeof(stats)))
+				rc = -EFAULT;
+		}
                 ksocknal_conn_decref(conn);
-                return 0;
+                return rc;
         }
 
         case IOC_LIBCFS_CLOSE_CONNECTION:
@@ -75,6 +75,8 @@
 #define SOCKNAL_RESCHED         100             /* # scheduler loops before reschedule */
 #define SOCKNAL_INSANITY_RECONN 5000            /* connd is trying on reconn infinitely */
 #define SOCKNAL_ENOMEM_RETRY    1		/* seconds between retries */
+#define SOCKNAL_CONNS_PER_PEER_MAX 16		/* max bulk conns of a type */
+#define SOCKNAL_BUSY_POLL_MAX	1000		/* max busy_poll (usecs) */
 
 #define SOCKNAL_SINGLE_FRAG_TX      0           /* disable multi-fragment sends */
 #define SOCKNAL_SINGLE_FRAG_RX      0           /* disable multi-fragment receives */
@@ -144,6 +146,9 @@ typedef struct
         int              *ksnd_max_reconnectms; /* ...exponentially increasing to this */
         int              *ksnd_eager_ack;       /* make TCP ack eagerly? */
         int              *ksnd_typed_conns;     /* drive sockets by type? */
+	int		 *ksnd_conns_per_peer;	/* # bulk conns of each type */
+	/* usecs an idle scheduler polls for work before sleeping */
+	int		 *ksnd_busy_poll;
         int              *ksnd_min_bulk;        /* smallest "large" message */
         int              *ksnd_tx_buffer_size;  /* socket tx buffer size */
         int              *ksnd_rx_buffer_size;  /* socket rx buffer size */
@@ -384,6 +389,12 @@ typedef struct ksock_conn
 	int			ksnc_tx_scheduled;
 	/* time stamp of the last posted TX */
 	time64_t		ksnc_tx_last_post;
+
+	/* -- STATS, updated by the scheduler only -- */
+	__u64			ksnc_tx_msgs;	/* # messages sent */
+	__u64			ksnc_tx_bytes;	/* # bytes sent */
+	__u64			ksnc_rx_msgs;	/* # LNet messages received */
+	__u64			ksnc_rx_bytes;	/* # bytes received */
 } ksock_conn_t;
 
 typedef struct ksock_route
@@ -403,6 +414,11 @@ typedef struct ksock_route
         unsigned int          ksnr_deleted:1;   /* been removed from peer_ni? */
         unsigned int          ksnr_share_count; /* created explicitly? */
         int                   ksnr_conn_count;  /* # conns established by this route */
+	/* # BULK_IN/BULK_OUT conns currently bound to this route */
+	int		      ksnr_blki_conn_count;
+	int		      ksnr_blko_conn_count;
+	/* peer refused extra bulk conns; only connect one of each type */
+	unsigned int	      ksnr_stripes_refused:1;
 } ksock_route_t;
 
 #define SOCKNAL_KEEPALIVE_PING          1       /* cookie for keepalive ping */
@@ -502,6 +518,32 @@ ksocknal_route_mask(void)
                 (1 << SOCKLND_CONN_BULK_OUT));
 }
 
+static inline int
+ksocknal_conns_per_peer(void)
+{
+	return clamp(*ksocknal_tunables.ksnd_conns_per_peer, 1,
+		     SOCKNAL_CONNS_PER_PEER_MAX);
+}
+
+/* connection types @route still has to establish */
+static inline int
+ksocknal_route_wanted(ksock_route_t *route)
+{
+	int wanted = ksocknal_route_mask() & ~route->ksnr_connected;
+
+	if (!*ksocknal_tunables.ksnd_typed_conns ||
+	    route->ksnr_stripes_refused)
+		return wanted;
+
+	/* bulk traffic is striped over several conns of each bulk type */
+	if (route->ksnr_blki_conn_count < ksocknal_conns_per_peer())
+		wanted |= 1 << SOCKLND_CONN_BULK_IN;
+	if (route->ksnr_blko_conn_count < ksocknal_conns_per_peer())
+		wanted |= 1 << SOCKLND_CONN_BULK_OUT;
+
+	return wanted;
+}
+
 static inline struct list_head *
 ksocknal_nid2peerlist (lnet_nid_t nid)
 {
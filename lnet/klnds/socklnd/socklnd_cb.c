@@ -215,8 +215,10 @@ ksocknal_transmit(ksock_conn_t *conn, ksock_tx_t *tx)
                 }
 
 		bufnob = conn->ksnc_sock->sk->sk_wmem_queued;
-                if (rc > 0)                     /* sent something? */
-                        conn->ksnc_tx_bufnob += rc; /* account it */
+		if (rc > 0) {			/* sent something? */
+			conn->ksnc_tx_bufnob += rc; /* account it */
+			conn->ksnc_tx_bytes += rc;
+		}
 
 		if (bufnob < conn->ksnc_tx_bufnob) {
 			/* allocated send buffer bytes < computed; infer
@@ -277,6 +279,7 @@ ksocknal_recv_iov (ksock_conn_t *conn)
 
 	conn->ksnc_rx_nob_wanted -= nob;
 	conn->ksnc_rx_nob_left -= nob;
+	conn->ksnc_rx_bytes += nob;
 
         do {
                 LASSERT (conn->ksnc_rx_niov > 0);
@@ -321,6 +324,7 @@ ksocknal_recv_kiov (ksock_conn_t *conn)
 
 	conn->ksnc_rx_nob_wanted -= nob;
 	conn->ksnc_rx_nob_left -= nob;
+	conn->ksnc_rx_bytes += nob;
 
         do {
                 LASSERT (conn->ksnc_rx_nkiov > 0);
@@ -519,6 +523,7 @@ ksocknal_process_transmit (ksock_conn_t *conn, ksock_tx_t *tx)
         if (tx->tx_resid == 0) {
                 /* Sent everything OK */
                 LASSERT (rc == 0);
+		conn->ksnc_tx_msgs++;
 
                 return (0);
         }
@@ -589,7 +594,7 @@ ksocknal_launch_connection_locked (ksock_route_t *route)
 
         LASSERT (!route->ksnr_scheduled);
         LASSERT (!route->ksnr_connecting);
-        LASSERT ((ksocknal_route_mask() & ~route->ksnr_connected) != 0);
+	LASSERT(ksocknal_route_wanted(route) != 0);
 
         route->ksnr_scheduled = 1;              /* scheduling conn for connd */
         ksocknal_route_addref(route);           /* extra ref for connd */
@@ -789,9 +794,9 @@ ksocknal_find_connectable_route_locked (ksock_peer_ni_t *peer_ni)
                 if (route->ksnr_scheduled)      /* connections being established */
                         continue;
 
-                /* all route types connected ? */
-                if ((ksocknal_route_mask() & ~route->ksnr_connected) == 0)
-                        continue;
+		/* all route types and bulk stripes connected ? */
+		if (ksocknal_route_wanted(route) == 0)
+			continue;
 
                 if (!(route->ksnr_retry_interval == 0 || /* first attempt */
 		      now >= route->ksnr_timeout)) {
@@ -1245,6 +1250,7 @@ ksocknal_process_receive (ksock_conn_t *conn)
                 }
 
                 conn->ksnc_rx_state = SOCKNAL_RX_PARSE;
+		conn->ksnc_rx_msgs++;
                 ksocknal_conn_addref(conn);     /* ++ref while parsing */
 
                 rc = lnet_parse(conn->ksnc_peer->ksnp_ni,
@@ -1391,6 +1397,39 @@ ksocknal_sched_cansleep(ksock_sched_t *sched)
 	return rc;
 }
 
+/*
+ * Spin for up to busy_poll usecs waiting for work before the scheduler
+ * goes to sleep, so a message arriving soon after the last one doesn't
+ * pay for a wakeup and context switch. Returns 1 if work showed up.
+ */
+static int
+ksocknal_sched_busy_poll(ksock_sched_t *sched)
+{
+	int	budget = min(*ksocknal_tunables.ksnd_busy_poll,
+			     SOCKNAL_BUSY_POLL_MAX);
+	ktime_t	start;
+
+	if (budget <= 0)
+		return 0;
+
+	start = ktime_get();
+	do {
+		/* lockless peek, the caller rechecks under kss_lock */
+		if (ksocknal_data.ksnd_shuttingdown ||
+		    !list_empty_careful(&sched->kss_rx_conns) ||
+		    !list_empty_careful(&sched->kss_tx_conns)) {
+			return 1;
+		}
+
+		if (need_resched())
+			break;
+
+		cpu_relax();
+	} while (ktime_to_us(ktime_sub(ktime_get(), start)) < budget);
+
+	return 0;
+}
+
 int ksocknal_scheduler(void *arg)
 {
 	struct ksock_sched_info	*info;
@@ -1540,13 +1579,14 @@ int ksocknal_scheduler(void *arg)
 
                         nloops = 0;
 
-                        if (!did_something) {   /* wait for something to do */
+			if (did_something) {	/* hogging CPU */
+				cond_resched();
+			} else if (!ksocknal_sched_busy_poll(sched)) {
+				/* wait for something to do */
 				rc = wait_event_interruptible_exclusive(
 					sched->kss_waitq,
 					!ksocknal_sched_cansleep(sched));
 				LASSERT (rc == 0);
-			} else {
-				cond_resched();
 			}
 
 			spin_lock_bh(&sched->kss_lock);
@@ -1852,6 +1892,7 @@ ksocknal_connect (ksock_route_t *route)
         ksock_peer_ni_t     *peer_ni = route->ksnr_peer;
         int               type;
         int               wanted;
+	int		  stripe;
 	struct socket     *sock;
 	time64_t deadline;
         int               retry_later = 0;
@@ -1867,7 +1908,7 @@ ksocknal_connect (ksock_route_t *route)
         route->ksnr_connecting = 1;
 
         for (;;) {
-                wanted = ksocknal_route_mask() & ~route->ksnr_connected;
+		wanted = ksocknal_route_wanted(route);
 
                 /* stop connecting if peer_ni/route got closed under me, or
                  * route got connected while queued */
@@ -1892,13 +1933,20 @@ ksocknal_connect (ksock_route_t *route)
                         type = SOCKLND_CONN_ANY;
                 } else if ((wanted & (1 << SOCKLND_CONN_CONTROL)) != 0) {
                         type = SOCKLND_CONN_CONTROL;
-                } else if ((wanted & (1 << SOCKLND_CONN_BULK_IN)) != 0) {
+		} else if ((wanted & (1 << SOCKLND_CONN_BULK_IN)) != 0 &&
+			   ((wanted & (1 << SOCKLND_CONN_BULK_OUT)) == 0 ||
+			    route->ksnr_blki_conn_count <=
+			    route->ksnr_blko_conn_count)) {
+			/* alternate bulk types while adding stripes */
                         type = SOCKLND_CONN_BULK_IN;
                 } else {
                         LASSERT ((wanted & (1 << SOCKLND_CONN_BULK_OUT)) != 0);
                         type = SOCKLND_CONN_BULK_OUT;
                 }
 
+		/* one more conn of a type the route already has? */
+		stripe = (route->ksnr_connected & (1 << type)) != 0;
+
 		write_unlock_bh(&ksocknal_data.ksnd_global_lock);
 
 		if (ktime_get_seconds() >= deadline) {
@@ -1923,6 +1971,18 @@ ksocknal_connect (ksock_route_t *route)
                         goto failed;
                 }
 
+		if (rc == EALREADY && stripe) {
+			/* the peer_ni answered the hello with CONN_NONE: it
+			 * doesn't take more bulk stripes, e.g. it predates
+			 * them; carry on with what we have.  EPROTO and
+			 * ESTALE still mean renegotiate and retry below. */
+			CDEBUG(D_NET, "peer_ni %s refused bulk stripe\n",
+			       libcfs_nid2str(peer_ni->ksnp_id.nid));
+			write_lock_bh(&ksocknal_data.ksnd_global_lock);
+			route->ksnr_stripes_refused = 1;
+			continue;
+		}
+
                 /* A +ve RC means I have to retry because I lost the connection
                  * race or I have to renegotiate protocol version */
                 retry_later = (rc != 0);
@@ -504,6 +504,19 @@ ksocknal_lib_setup_sock (struct socket *sock)
                 return (rc);
         }
 
+#ifdef SO_BUSY_POLL
+	if (*ksocknal_tunables.ksnd_busy_poll > 0) {
+		/* let the stack poll the device queue on receive too */
+		option = min(*ksocknal_tunables.ksnd_busy_poll,
+			     SOCKNAL_BUSY_POLL_MAX);
+
+		rc = kernel_setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL,
+				       (char *)&option, sizeof(option));
+		if (rc != 0)
+			CWARN("Can't set SO_BUSY_POLL %d: %d\n", option, rc);
+	}
+#endif
+
 /* TCP_BACKOFF_* sockopt tunables unsupported in stock kernels */
 #ifdef SOCKNAL_BACKOFF
         if (*ksocknal_tunables.ksnd_backoff_init > 0) {
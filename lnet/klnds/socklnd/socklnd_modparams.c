@@ -71,6 +71,14 @@ static int typed_conns = 1;
 module_param(typed_conns, int, 0444);
 MODULE_PARM_DESC(typed_conns, "use different sockets for bulk");
 
+static int conns_per_peer = 1;
+module_param(conns_per_peer, int, 0644);
+MODULE_PARM_DESC(conns_per_peer, "# BULK_IN and BULK_OUT sockets per peer route (1-16)");
+
+static int busy_poll;
+module_param(busy_poll, int, 0644);
+MODULE_PARM_DESC(busy_poll, "usecs idle schedulers poll before sleeping (0 to disable)");
+
 static int min_bulk = (1<<10);
 module_param(min_bulk, int, 0644);
 MODULE_PARM_DESC(min_bulk, "smallest 'large' message");
@@ -169,6 +177,8 @@ int ksocknal_tunables_init(void)
         ksocknal_tunables.ksnd_max_reconnectms    = &max_reconnectms;
         ksocknal_tunables.ksnd_eager_ack          = &eager_ack;
         ksocknal_tunables.ksnd_typed_conns        = &typed_conns;
+	ksocknal_tunables.ksnd_conns_per_peer	  = &conns_per_peer;
+	ksocknal_tunables.ksnd_busy_poll	  = &busy_poll;
         ksocknal_tunables.ksnd_min_bulk           = &min_bulk;
         ksocknal_tunables.ksnd_tx_buffer_size     = &tx_buffer_size;
         ksocknal_tunables.ksnd_rx_buffer_size     = &rx_buffer_size;
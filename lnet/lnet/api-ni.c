@@ -67,6 +67,31 @@ module_param(lnet_numa_range, uint, 0444);
 MODULE_PARM_DESC(lnet_numa_range,
 		"NUMA range to consider during Multi-Rail selection");
 
+unsigned int lnet_health_sensitivity = 100;
+module_param(lnet_health_sensitivity, uint, 0644);
+MODULE_PARM_DESC(lnet_health_sensitivity,
+		 "Health value lost by an interface on a failed send (0 disables)");
+
+unsigned int lnet_health_recovery = 10;
+module_param(lnet_health_recovery, uint, 0644);
+MODULE_PARM_DESC(lnet_health_recovery,
+		 "Health value regained by an interface every second");
+
+unsigned int lnet_retry_count = 2;
+module_param(lnet_retry_count, uint, 0644);
+MODULE_PARM_DESC(lnet_retry_count,
+		 "Number of times LNet resends a message after a failed send");
+
+unsigned int lnet_peer_discovery_disabled;
+module_param(lnet_peer_discovery_disabled, uint, 0644);
+MODULE_PARM_DESC(lnet_peer_discovery_disabled,
+		 "Set to 1 to disable dynamic discovery of Multi-Rail peers");
+
+unsigned int lnet_desc_cache_max = 256;
+module_param(lnet_desc_cache_max, uint, 0644);
+MODULE_PARM_DESC(lnet_desc_cache_max,
+		 "Max # of free messages, small MDs and MEs cached per CPT");
+
 /*
  * This sequence number keeps track of how many times DLC was used to
  * update the local NIs. It is incremented when a NI is added or
@@ -114,6 +139,8 @@ lnet_init_locks(void)
 	spin_lock_init(&the_lnet.ln_eq_wait_lock);
 	init_waitqueue_head(&the_lnet.ln_eq_waitq);
 	init_waitqueue_head(&the_lnet.ln_rc_waitq);
+	spin_lock_init(&the_lnet.ln_dc_lock);
+	init_waitqueue_head(&the_lnet.ln_dc_waitq);
 	mutex_init(&the_lnet.ln_lnd_mutex);
 	mutex_init(&the_lnet.ln_api_mutex);
 }
@@ -126,6 +153,164 @@ lnet_fini_locks(void)
 struct kmem_cache *lnet_mes_cachep;	   /* MEs kmem_cache */
 struct kmem_cache *lnet_small_mds_cachep;  /* <= LNET_SMALL_MD_SIZE bytes
 					    *  MDs kmem_cache */
+struct kmem_cache *lnet_msgs_cachep;	   /* messages kmem_cache */
+
+static struct kmem_cache *
+lnet_desc_slab(enum lnet_desc_type type)
+{
+	switch (type) {
+	case LNET_DESC_MSG:
+		return lnet_msgs_cachep;
+	case LNET_DESC_MD:
+		return lnet_small_mds_cachep;
+	case LNET_DESC_ME:
+		return lnet_mes_cachep;
+	default:
+		LBUG();
+		return NULL;
+	}
+}
+
+static size_t
+lnet_desc_size(enum lnet_desc_type type)
+{
+	switch (type) {
+	case LNET_DESC_MSG:
+		return sizeof(struct lnet_msg);
+	case LNET_DESC_MD:
+		return LNET_SMALL_MD_SIZE;
+	case LNET_DESC_ME:
+		return sizeof(struct lnet_me);
+	default:
+		LBUG();
+		return 0;
+	}
+}
+
+/**
+ * Allocates a zeroed descriptor of \a type, from the free cache of the
+ * current CPT if it has one, from the slab otherwise.
+ *
+ * Free descriptors are chained through their first bytes, so caching
+ * costs no space in the descriptors themselves.
+ */
+void *
+lnet_desc_alloc(enum lnet_desc_type type)
+{
+	struct lnet_desc_cache	*dc;
+	struct list_head	*e = NULL;
+
+	if (the_lnet.ln_desc_caches != NULL) {
+		dc = &the_lnet.ln_desc_caches[lnet_cpt_current()][type];
+
+		spin_lock(&dc->dc_lock);
+		dc->dc_nalloc++;
+		if (!list_empty(&dc->dc_free)) {
+			e = dc->dc_free.next;
+			list_del(e);
+			dc->dc_nfree--;
+			dc->dc_nhit++;
+		}
+		spin_unlock(&dc->dc_lock);
+	}
+
+	if (e == NULL)
+		return kmem_cache_alloc(lnet_desc_slab(type),
+					GFP_NOFS | __GFP_ZERO);
+
+	memset(e, 0, lnet_desc_size(type));
+	return e;
+}
+
+/**
+ * Frees \a desc to the cache of the current CPT, or to the slab if that
+ * cache holds lnet_desc_cache_max descriptors already.
+ */
+void
+lnet_desc_free(enum lnet_desc_type type, void *desc)
+{
+	struct lnet_desc_cache	*dc;
+	bool			cached = false;
+
+	if (the_lnet.ln_desc_caches != NULL) {
+		dc = &the_lnet.ln_desc_caches[lnet_cpt_current()][type];
+
+		spin_lock(&dc->dc_lock);
+		dc->dc_nrelease++;
+		if (dc->dc_nfree < lnet_desc_cache_max) {
+			list_add((struct list_head *)desc, &dc->dc_free);
+			dc->dc_nfree++;
+			cached = true;
+		}
+		spin_unlock(&dc->dc_lock);
+	}
+
+	if (!cached)
+		kmem_cache_free(lnet_desc_slab(type), desc);
+}
+
+static void
+lnet_desc_caches_destroy(void)
+{
+	struct lnet_desc_cache	*dcs;
+	struct list_head	*e;
+	int			type;
+	int			i;
+
+	if (the_lnet.ln_desc_caches == NULL)
+		return;
+
+	cfs_percpt_for_each(dcs, i, the_lnet.ln_desc_caches) {
+		for (type = 0; type < LNET_DESC_NTYPES; type++) {
+			while (!list_empty(&dcs[type].dc_free)) {
+				e = dcs[type].dc_free.next;
+				list_del(e);
+				kmem_cache_free(lnet_desc_slab(type), e);
+			}
+		}
+	}
+
+	cfs_percpt_free(the_lnet.ln_desc_caches);
+	the_lnet.ln_desc_caches = NULL;
+}
+
+/* per-CPT free caches, filled on the memory node of each CPT */
+static int
+lnet_desc_caches_create(void)
+{
+	struct lnet_desc_cache	*dcs;
+	struct list_head	*e;
+	unsigned int		j;
+	int			type;
+	int			node;
+	int			i;
+
+	the_lnet.ln_desc_caches = cfs_percpt_alloc(lnet_cpt_table(),
+					LNET_DESC_NTYPES * sizeof(*dcs));
+	if (the_lnet.ln_desc_caches == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(dcs, i, the_lnet.ln_desc_caches) {
+		node = cfs_cpt_spread_node(lnet_cpt_table(), i);
+
+		for (type = 0; type < LNET_DESC_NTYPES; type++) {
+			spin_lock_init(&dcs[type].dc_lock);
+			INIT_LIST_HEAD(&dcs[type].dc_free);
+
+			for (j = 0; j < lnet_desc_cache_max; j++) {
+				e = kmem_cache_alloc_node(lnet_desc_slab(type),
+							  GFP_NOFS, node);
+				if (e == NULL)
+					break;
+
+				list_add(e, &dcs[type].dc_free);
+				dcs[type].dc_nfree++;
+			}
+		}
+	}
+
+	return 0;
+}
 
 static int
 lnet_descriptor_setup(void)
@@ -144,12 +329,24 @@ lnet_descriptor_setup(void)
 	if (!lnet_small_mds_cachep)
 		return -ENOMEM;
 
-	return 0;
+	lnet_msgs_cachep = kmem_cache_create("lnet_MSGs",
+					     sizeof(struct lnet_msg),
+					     0, SLAB_HWCACHE_ALIGN, NULL);
+	if (!lnet_msgs_cachep)
+		return -ENOMEM;
+
+	return lnet_desc_caches_create();
 }
 
 static void
 lnet_descriptor_cleanup(void)
 {
+	lnet_desc_caches_destroy();
+
+	if (lnet_msgs_cachep) {
+		kmem_cache_destroy(lnet_msgs_cachep);
+		lnet_msgs_cachep = NULL;
+	}
 
 	if (lnet_small_mds_cachep) {
 		kmem_cache_destroy(lnet_small_mds_cachep);
@@ -610,6 +807,7 @@ lnet_prepare(lnet_pid_t requested_pid)
 	INIT_LIST_HEAD(&the_lnet.ln_routers);
 	INIT_LIST_HEAD(&the_lnet.ln_drop_rules);
 	INIT_LIST_HEAD(&the_lnet.ln_delay_rules);
+	INIT_LIST_HEAD(&the_lnet.ln_sel_rules);
 
 	rc = lnet_descriptor_setup();
 	if (rc != 0)
@@ -948,6 +1146,9 @@ lnet_ping_info_create(int num_ni)
 	ping_info->pi_pid = the_lnet.ln_pid;
 	ping_info->pi_magic = LNET_PROTO_PING_MAGIC;
 	ping_info->pi_features = LNET_PING_FEAT_NI_STATUS;
+	if (!use_tcp_bonding)
+		ping_info->pi_features |= LNET_PING_FEAT_MULTI_RAIL |
+					  LNET_PING_FEAT_DISCOVERY;
 
 	return ping_info;
 }
@@ -1178,6 +1379,9 @@ lnet_ping_target_update(struct lnet_ping_info *pinfo,
 		/* unlink the old ping info */
 		lnet_ping_md_unlink(old_pinfo, &old_md);
 		lnet_ping_info_free(old_pinfo);
+
+		/* tell discovered peers our NID list changed */
+		lnet_peer_discovery_push();
 	}
 }
 
@@ -1454,6 +1658,10 @@ lnet_startup_lndni(struct lnet_ni *ni, struct lnet_lnd_tunables *tun)
 	atomic_set(&ni->ni_tx_credits,
 		   lnet_ni_tq_credits(ni) * ni->ni_ncpts);
 
+	/* the NID is known now that the LND is up */
+	ni->ni_sel_priority = lnet_sel_priority(LNET_SEL_RULE_LOCAL_NI, 0,
+						ni->ni_nid);
+
 	CDEBUG(D_LNI, "Added LNI %s [%d/%d/%d/%d]\n",
 		libcfs_nid2str(ni->ni_nid),
 		ni->ni_net->net_tunables.lct_peer_tx_credits,
@@ -1731,6 +1939,12 @@ int lnet_lib_init(void)
 	INIT_LIST_HEAD(&the_lnet.ln_net_zombie);
 	INIT_LIST_HEAD(&the_lnet.ln_rcd_zombie);
 	INIT_LIST_HEAD(&the_lnet.ln_rcd_deathrow);
+	INIT_LIST_HEAD(&the_lnet.ln_dc_request);
+	INIT_LIST_HEAD(&the_lnet.ln_dc_working);
+	INIT_LIST_HEAD(&the_lnet.ln_dc_done);
+	LNetInvalidateEQHandle(&the_lnet.ln_dc_eqh);
+	LNetInvalidateEQHandle(&the_lnet.ln_push_target_eq);
+	LNetInvalidateMDHandle(&the_lnet.ln_push_target_md);
 
 	/* The hash table size is the number of bits it takes to express the set
 	 * ln_num_routes, minus 1 (better to under estimate than over so we
@@ -1872,6 +2086,10 @@ LNetNIInit(lnet_pid_t requested_pid)
 	if (rc != 0)
 		goto err_stop_ping;
 
+	rc = lnet_peer_discovery_start();
+	if (rc != 0)
+		goto err_stop_router_checker;
+
 	lnet_fault_init();
 	lnet_proc_init();
 
@@ -1879,6 +2097,8 @@ LNetNIInit(lnet_pid_t requested_pid)
 
 	return 0;
 
+err_stop_router_checker:
+	lnet_router_checker_stop();
 err_stop_ping:
 	lnet_ping_target_fini();
 err_acceptor_stop:
@@ -1928,6 +2148,7 @@ LNetNIFini()
 		lnet_fault_fini();
 
 		lnet_proc_fini();
+		lnet_peer_discovery_stop();
 		lnet_router_checker_stop();
 		lnet_ping_target_fini();
 
@@ -1936,6 +2157,7 @@ LNetNIFini()
 
 		lnet_acceptor_stop();
 		lnet_destroy_routes();
+		lnet_sel_rules_cleanup();
 		lnet_shutdown_lndnets();
 		lnet_unprepare();
 	}
@@ -2208,6 +2430,28 @@ lnet_get_ni_config(struct lnet_ioctl_config_ni *cfg_ni,
 	return rc;
 }
 
+static int
+lnet_get_ni_hstats(struct lnet_ioctl_element_hstats *hstats)
+{
+	struct lnet_ni *ni;
+	int cpt;
+	int rc = -ENOENT;
+
+	cpt = lnet_net_lock_current();
+
+	ni = lnet_nid2ni_locked(hstats->hs_nid, cpt);
+	if (ni) {
+		hstats->hs_health_value = lnet_ni_healthv(ni);
+		hstats->hs_fail_count = atomic_read(&ni->ni_stats.fail_count);
+		hstats->hs_resend_count =
+			atomic_read(&ni->ni_stats.resend_count);
+		rc = 0;
+	}
+
+	lnet_net_unlock(cpt);
+	return rc;
+}
+
 static int lnet_add_net_common(struct lnet_net *net,
 			       struct lnet_ioctl_config_lnd_tunables *tun)
 {
@@ -2693,6 +2937,49 @@ LNetCtl(unsigned int cmd, void *arg)
 		return rc;
 	}
 
+	case IOC_LIBCFS_GET_LOCAL_HSTATS: {
+		struct lnet_ioctl_element_hstats *hstats = arg;
+
+		if (hstats->hs_hdr.ioc_len < sizeof(*hstats))
+			return -EINVAL;
+
+		mutex_lock(&the_lnet.ln_api_mutex);
+		rc = lnet_get_ni_hstats(hstats);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return rc;
+	}
+
+	case IOC_LIBCFS_GET_PEER_HSTATS: {
+		struct lnet_ioctl_element_hstats *hstats = arg;
+
+		if (hstats->hs_hdr.ioc_len < sizeof(*hstats))
+			return -EINVAL;
+
+		mutex_lock(&the_lnet.ln_api_mutex);
+		rc = lnet_get_peer_ni_hstats(hstats);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return rc;
+	}
+
+	case IOC_LIBCFS_ADD_SEL_RULE:
+	case IOC_LIBCFS_DEL_SEL_RULE:
+	case IOC_LIBCFS_GET_SEL_RULE: {
+		struct lnet_ioctl_sel_rule *rule = arg;
+
+		if (rule->sr_hdr.ioc_len < sizeof(*rule))
+			return -EINVAL;
+
+		mutex_lock(&the_lnet.ln_api_mutex);
+		if (cmd == IOC_LIBCFS_ADD_SEL_RULE)
+			rc = lnet_sel_rule_add(rule);
+		else if (cmd == IOC_LIBCFS_DEL_SEL_RULE)
+			rc = lnet_sel_rule_del(rule->sr_idx);
+		else
+			rc = lnet_sel_rule_get(rule);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return rc;
+	}
+
 	case IOC_LIBCFS_GET_NET: {
 		size_t total = sizeof(*config) +
 			       sizeof(struct lnet_ioctl_net_config);
@@ -2854,7 +3141,8 @@ LNetCtl(unsigned int cmd, void *arg)
 		mutex_lock(&the_lnet.ln_api_mutex);
 		rc = lnet_get_peer_info(cfg->prcfg_count, &cfg->prcfg_prim_nid,
 					&cfg->prcfg_cfg_nid, &cfg->prcfg_mr,
-					lpni_cri, lpni_stats);
+					&cfg->prcfg_state, lpni_cri,
+					lpni_stats);
 		mutex_unlock(&the_lnet.ln_api_mutex);
 		return rc;
 	}
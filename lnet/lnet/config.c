@@ -481,6 +481,8 @@ lnet_ni_alloc_common(struct lnet_net *net, char *iface)
 
 	ni->ni_last_alive = ktime_get_real_seconds();
 	ni->ni_state = LNET_NI_STATE_INIT;
+	ni->ni_healthv = LNET_MAX_HEALTH_VALUE;
+	ni->ni_sel_priority = LNET_SEL_PRIO_DEFAULT;
 	list_add_tail(&ni->ni_netlist, &net->net_ni_added);
 
 	/*
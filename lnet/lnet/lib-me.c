@@ -64,6 +64,14 @@
  * object is saved here. This handle can be used later in LNetMEInsert(),
  * LNetMEUnlink(), or LNetMDAttach() functions.
  *
+ * \a pos only orders the new ME among the MEs on the same list. MEs with
+ * the same ignore-bits share a hashed mask group, the other MEs with
+ * ignore-bits go on a scan list, and MEs without ignore-bits are hashed by
+ * their match criteria. A message is matched against its list in each
+ * mask group, then the scan list, then its list of MEs without
+ * ignore-bits, so MEs on different lists are not matched in the order
+ * they were attached.
+ *
  * \retval 0	   On success.
  * \retval -EINVAL If \a portal is invalid.
  * \retval -ENOMEM If new ME object cannot be allocated.
@@ -77,7 +85,6 @@ LNetMEAttach(unsigned int portal,
 {
 	struct lnet_match_table *mtable;
 	struct lnet_me		*me;
-	struct list_head	*head;
 
 	LASSERT(the_lnet.ln_refcount > 0);
 
@@ -93,6 +100,8 @@ LNetMEAttach(unsigned int portal,
 	if (me == NULL)
 		return -ENOMEM;
 
+	lnet_mt_mask_create(mtable, ignore_bits);
+
 	lnet_res_lock(mtable->mt_cpt);
 
 	me->me_portal = portal;
@@ -104,16 +113,7 @@ LNetMEAttach(unsigned int portal,
 
 	lnet_res_lh_initialize(the_lnet.ln_me_containers[mtable->mt_cpt],
 			       &me->me_lh);
-	if (ignore_bits != 0)
-		head = &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
-	else
-		head = lnet_mt_match_head(mtable, match_id, match_bits);
-
-	me->me_pos = head - &mtable->mt_mhash[0];
-	if (pos == LNET_INS_AFTER || pos == LNET_INS_LOCAL)
-		list_add_tail(&me->me_list, head);
-	else
-		list_add(&me->me_list, head);
+	lnet_mt_attach_me(mtable, me, NULL, pos);
 
 	lnet_me2handle(handle, me);
 
@@ -130,6 +130,12 @@ EXPORT_SYMBOL(LNetMEAttach);
  * This function is identical to LNetMEAttach() except for the position
  * where the new ME is inserted.
  *
+ * The new ME is only kept next to \a current_meh if it belongs on the
+ * same list, or if \a current_meh is on the scan list, which matches any
+ * ME. Otherwise it goes at the head or tail of the scan list, depending on
+ * \a pos, and isn't matched in order with \a current_meh; see
+ * LNetMEAttach() for the lists.
+ *
  * \param current_meh A handle for a ME. The new ME will be inserted
  * immediately before or immediately after this ME.
  * \param match_id,match_bits,ignore_bits,unlink,pos,handle See the discussion
@@ -182,7 +188,6 @@ LNetMEInsert(struct lnet_handle_me current_meh,
 		return -EPERM;
 	}
 
-	new_me->me_pos = current_me->me_pos;
 	new_me->me_portal = current_me->me_portal;
 	new_me->me_match_id = match_id;
 	new_me->me_match_bits = match_bits;
@@ -192,10 +197,9 @@ LNetMEInsert(struct lnet_handle_me current_meh,
 
 	lnet_res_lh_initialize(the_lnet.ln_me_containers[cpt], &new_me->me_lh);
 
-	if (pos == LNET_INS_AFTER)
-		list_add(&new_me->me_list, &current_me->me_list);
-	else
-		list_add_tail(&new_me->me_list, &current_me->me_list);
+	/* NB: no new mask group is created here, the new ME goes on the
+	 * scan list if there isn't one for its ignore-bits already */
+	lnet_mt_attach_me(ptl->ptl_mtables[cpt], new_me, current_me, pos);
 
 	lnet_me2handle(handle, new_me);
 
@@ -258,7 +262,7 @@ EXPORT_SYMBOL(LNetMEUnlink);
 void
 lnet_me_unlink(struct lnet_me *me)
 {
-	list_del(&me->me_list);
+	lnet_mt_detach_me(me);
 
 	if (me->me_md != NULL) {
 		struct lnet_libmd *md = me->me_md;
@@ -646,6 +646,18 @@ lnet_ni_send(struct lnet_ni *ni, struct lnet_msg *msg)
 	LASSERT (LNET_NETTYP(LNET_NIDNET(ni->ni_nid)) == LOLND ||
 		 (msg->msg_txcredit && msg->msg_peertxcredit));
 
+	if (!list_empty(&the_lnet.ln_drop_rules) &&
+	    lnet_drop_rule_match(&msg->msg_hdr, true)) {
+		CDEBUG(D_NET, "%s, dst %s: Failing %s to simulate a network "
+			      "error\n", libcfs_nid2str(ni->ni_nid),
+		       libcfs_nid2str(msg->msg_txpeer != NULL ?
+				      msg->msg_txpeer->lpni_nid :
+				      LNET_NID_ANY),
+		       lnet_msgtyp2str(msg->msg_type));
+		lnet_finalize(msg, -EHOSTUNREACH);
+		return;
+	}
+
 	rc = (ni->ni_net->net_lnd->lnd_send)(ni, priv, msg);
 	if (rc < 0)
 		lnet_finalize(msg, rc);
@@ -966,10 +978,13 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		rbp->rbp_credits--;
 		if (rbp->rbp_credits < rbp->rbp_mincredits)
 			rbp->rbp_mincredits = rbp->rbp_credits;
+		if (rbp->rbp_credits < rbp->rbp_win_mincredits)
+			rbp->rbp_win_mincredits = rbp->rbp_credits;
 
 		if (rbp->rbp_credits < 0) {
 			/* must have checked eager_recv before here */
 			LASSERT(msg->msg_rx_ready_delay);
+			rbp->rbp_nblocked++;
 			msg->msg_rx_delayed = 1;
 			list_add_tail(&msg->msg_list, &rbp->rbp_msgs);
 			return LNET_CREDIT_WAIT;
@@ -1083,13 +1098,8 @@ lnet_return_tx_credits_locked(struct lnet_msg *msg)
 
 	if (txpeer != NULL) {
 		/*
-		 * TODO:
-		 * Once the patch for the health comes in we need to set
-		 * the health of the peer ni to bad when we fail to send
-		 * a message.
-		 * int status = msg->msg_ev.status;
-		 * if (status != 0)
-		 *	lnet_set_peer_ni_health_locked(txpeer, false)
+		 * The health of the peer ni was already lowered by
+		 * lnet_health_check() if this send failed.
 		 */
 		msg->msg_txpeer = NULL;
 		lnet_peer_ni_decref_locked(txpeer);
@@ -1245,6 +1255,13 @@ lnet_compare_routes(struct lnet_route *r1, struct lnet_route *r2)
 	int r2_hops = (r2->lr_hops == LNET_UNDEFINED_HOPS) ? 1 : r2->lr_hops;
 	int rc;
 
+	/* a user selection rule on the gateway outranks the route priority */
+	if (p1->lpni_gw_sel_priority < p2->lpni_gw_sel_priority)
+		return 1;
+
+	if (p1->lpni_gw_sel_priority > p2->lpni_gw_sel_priority)
+		return -1;
+
 	if (r1->lr_priority < r2->lr_priority)
 		return 1;
 
@@ -1333,24 +1350,32 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 	struct lnet_ni *ni = NULL, *best_ni = cur_ni;
 	unsigned int shortest_distance;
 	int best_credits;
+	int best_healthv;
+	__u32 best_prio;
 
 	if (best_ni == NULL) {
 		shortest_distance = UINT_MAX;
 		best_credits = INT_MIN;
+		best_healthv = -1;
+		best_prio = LNET_SEL_PRIO_DEFAULT;
 	} else {
 		shortest_distance = cfs_cpt_distance(lnet_cpt_table(), md_cpt,
 						     best_ni->ni_dev_cpt);
 		best_credits = atomic_read(&best_ni->ni_tx_credits);
+		best_healthv = lnet_ni_healthv(best_ni);
+		best_prio = best_ni->ni_sel_priority;
 	}
 
 	while ((ni = lnet_get_next_ni_locked(local_net, ni))) {
 		unsigned int distance;
 		int ni_credits;
+		int ni_healthv;
 
 		if (!lnet_is_ni_healthy_locked(ni))
 			continue;
 
 		ni_credits = atomic_read(&ni->ni_tx_credits);
+		ni_healthv = lnet_ni_healthv(ni);
 
 		/*
 		 * calculate the distance from the CPT on which
@@ -1369,10 +1394,22 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 			distance = lnet_numa_range;
 
 		/*
-		 * Select on shorter distance, then available
-		 * credits, then round-robin.
+		 * Select on health, then user priority (lower wins), then
+		 * shorter distance, then available credits, then
+		 * round-robin.
 		 */
-		if (distance > shortest_distance) {
+		if (ni_healthv < best_healthv) {
+			continue;
+		} else if (ni_healthv > best_healthv) {
+			best_healthv = ni_healthv;
+			best_prio = ni->ni_sel_priority;
+			shortest_distance = distance;
+		} else if (ni->ni_sel_priority > best_prio) {
+			continue;
+		} else if (ni->ni_sel_priority < best_prio) {
+			best_prio = ni->ni_sel_priority;
+			shortest_distance = distance;
+		} else if (distance > shortest_distance) {
 			continue;
 		} else if (distance < shortest_distance) {
 			shortest_distance = distance;
@@ -1389,6 +1426,30 @@ lnet_get_best_ni(struct lnet_net *local_net, struct lnet_ni *cur_ni,
 	return best_ni;
 }
 
+/*
+ * Lowest selection priority among the healthy networks of \a peer that
+ * can be reached directly or, unless \a routing, through a router.
+ */
+static __u32
+lnet_peer_best_net_prio_locked(struct lnet_peer *peer, bool routing)
+{
+	struct lnet_peer_net *peer_net;
+	__u32 best_prio = LNET_SEL_PRIO_DEFAULT;
+
+	list_for_each_entry(peer_net, &peer->lp_peer_nets, lpn_on_peer_list) {
+		if (!lnet_is_peer_net_healthy_locked(peer_net))
+			continue;
+		if (peer_net->lpn_sel_priority >= best_prio)
+			continue;
+		if (!lnet_get_net_locked(peer_net->lpn_net_id) &&
+		    (routing || !lnet_find_rnet_locked(peer_net->lpn_net_id)))
+			continue;
+		best_prio = peer_net->lpn_sel_priority;
+	}
+
+	return best_prio;
+}
+
 static int
 lnet_select_pathway(lnet_nid_t src_nid, lnet_nid_t dst_nid,
 		    struct lnet_msg *msg, lnet_nid_t rtr_nid)
@@ -1409,6 +1470,9 @@ lnet_select_pathway(lnet_nid_t src_nid, lnet_nid_t dst_nid,
 	bool			preferred;
 	bool			local_found;
 	int			best_lpni_credits;
+	int			best_lpni_healthv;
+	__u32			best_lpni_prio;
+	__u32			best_net_prio;
 	int			md_cpt;
 
 	/*
@@ -1455,6 +1519,14 @@ again:
 		return -EHOSTUNREACH;
 	}
 
+	/*
+	 * Learn the NIDs of a peer on first contact. This doesn't wait
+	 * for the outcome: until discovery is done the NIDs already known
+	 * are used.
+	 */
+	if (msg->msg_type == LNET_MSG_PUT || msg->msg_type == LNET_MSG_GET)
+		lnet_peer_queue_discovery_locked(peer, dst_nid);
+
 	if (!peer->lp_multi_rail && lnet_get_num_peer_nis(peer) > 1) {
 		lnet_net_unlock(cpt);
 		CERROR("peer %s is declared to be non MR capable, "
@@ -1594,12 +1666,17 @@ again:
 	 * Locally connected networks will always be preferred over
 	 * a routed network. If there are only routed paths to the peer,
 	 * then the best route is chosen. If all routes are equal then
-	 * they are used in round robin.
+	 * they are used in round robin. Networks given a worse priority
+	 * by a selection rule than another reachable one are not used.
 	 */
+	best_net_prio = lnet_peer_best_net_prio_locked(peer, routing);
 	list_for_each_entry(peer_net, &peer->lp_peer_nets, lpn_on_peer_list) {
 		if (!lnet_is_peer_net_healthy_locked(peer_net))
 			continue;
 
+		if (peer_net->lpn_sel_priority > best_net_prio)
+			continue;
+
 		local_net = lnet_get_net_locked(peer_net->lpn_net_id);
 		if (!local_net && !routing && !local_found) {
 			struct lnet_peer_ni *net_gw;
@@ -1614,7 +1691,13 @@ again:
 			if (!net_gw)
 				continue;
 
-			if (best_gw) {
+			/* a selection rule can rank gateways across nets */
+			if (best_gw && net_gw->lpni_gw_sel_priority >
+				       best_gw->lpni_gw_sel_priority)
+				continue;
+
+			if (best_gw && net_gw->lpni_gw_sel_priority ==
+				       best_gw->lpni_gw_sel_priority) {
 				/*
 				 * lnet_find_route_locked() call
 				 * will return the best_Gw on the
@@ -1748,7 +1831,9 @@ pick_peer:
 
 	/*
 	 * Look at the peer NIs for the destination peer that connect
-	 * to the chosen net. If a peer_ni is preferred when using the
+	 * to the chosen net. The healthiest peer_ni is used, then the one
+	 * with the best selection rule priority; among equally ranked
+	 * ones, if a peer_ni is preferred when using the
 	 * best_ni to communicate, we use that one. If there is no
 	 * preferred peer_ni, or there are multiple preferred peer_ni,
 	 * the available transmit credits are used. If the transmit
@@ -1756,9 +1841,13 @@ pick_peer:
 	 */
 	lpni = NULL;
 	best_lpni_credits = INT_MIN;
+	best_lpni_healthv = -1;
+	best_lpni_prio = LNET_SEL_PRIO_DEFAULT;
 	preferred = false;
 	best_lpni = NULL;
 	while ((lpni = lnet_get_next_peer_ni_locked(peer, peer_net, lpni))) {
+		int lpni_healthv;
+
 		/*
 		 * if this peer ni is not healthy just skip it, no point in
 		 * examining it further
@@ -1766,9 +1855,23 @@ pick_peer:
 		if (!lnet_is_peer_ni_healthy_locked(lpni))
 			continue;
 		ni_is_pref = lnet_peer_is_ni_pref_locked(lpni, best_ni);
+		lpni_healthv = lnet_peer_ni_healthv(lpni);
 
-		/* if this is a preferred peer use it */
-		if (!preferred && ni_is_pref) {
+		if (lpni_healthv < best_lpni_healthv) {
+			continue;
+		} else if (lpni_healthv > best_lpni_healthv) {
+			/* a healthier peer ni wins over everything else */
+			best_lpni_healthv = lpni_healthv;
+			best_lpni_prio = lpni->lpni_sel_priority;
+			preferred = ni_is_pref;
+		} else if (lpni->lpni_sel_priority > best_lpni_prio) {
+			/* a selection rule ranks this peer ni lower */
+			continue;
+		} else if (lpni->lpni_sel_priority < best_lpni_prio) {
+			best_lpni_prio = lpni->lpni_sel_priority;
+			preferred = ni_is_pref;
+		} else if (!preferred && ni_is_pref) {
+			/* if this is a preferred peer use it */
 			preferred = true;
 		} else if (preferred && !ni_is_pref) {
 			/*
@@ -1952,6 +2055,8 @@ lnet_send(lnet_nid_t src_nid, struct lnet_msg *msg, lnet_nid_t rtr_nid)
 	LASSERT (!msg->msg_receiving);
 
 	msg->msg_sending = 1;
+	msg->msg_src_nid_param = src_nid;
+	msg->msg_rtr_nid_param = rtr_nid;
 
 	LASSERT(!msg->msg_tx_committed);
 
@@ -2513,7 +2618,7 @@ lnet_parse(struct lnet_ni *ni, struct lnet_hdr *hdr, lnet_nid_t from_nid,
 	}
 
 	if (!list_empty(&the_lnet.ln_drop_rules) &&
-	    lnet_drop_rule_match(hdr)) {
+	    lnet_drop_rule_match(hdr, false)) {
 		CDEBUG(D_NET, "%s, src %s, dst %s: Dropping %s to simulate"
 			      "silent message loss\n",
 		       libcfs_nid2str(from_nid), libcfs_nid2str(src_nid),
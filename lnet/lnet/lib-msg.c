@@ -448,6 +448,117 @@ lnet_complete_msg_locked(struct lnet_msg *msg, int cpt)
 	return 0;
 }
 
+static bool
+lnet_health_error(int status)
+{
+	switch (status) {
+	case -EIO:
+	case -ETIMEDOUT:
+	case -EHOSTUNREACH:
+	case -ENETUNREACH:
+	case -ENETDOWN:
+	case -ECONNREFUSED:
+	case -ECONNRESET:
+	case -ECONNABORTED:
+	case -ENOTCONN:
+	case -EPROTO:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void
+lnet_ni_health_fail(struct lnet_ni *ni)
+{
+	atomic_inc(&ni->ni_stats.fail_count);
+	if (lnet_health_sensitivity == 0)
+		return;
+
+	lnet_ni_lock(ni);
+	ni->ni_healthv = max_t(int, 0, lnet_ni_healthv(ni) -
+				       lnet_health_sensitivity);
+	ni->ni_health_stamp = ktime_get_seconds();
+	lnet_ni_unlock(ni);
+}
+
+static void
+lnet_peer_ni_health_fail(struct lnet_peer_ni *lpni)
+{
+	atomic_inc(&lpni->lpni_stats.fail_count);
+	if (lnet_health_sensitivity == 0)
+		return;
+
+	spin_lock(&lpni->lpni_lock);
+	lpni->lpni_healthv = max_t(int, 0, lnet_peer_ni_healthv(lpni) -
+					   lnet_health_sensitivity);
+	lpni->lpni_health_stamp = ktime_get_seconds();
+	spin_unlock(&lpni->lpni_lock);
+}
+
+/**
+ * Account a failed send against the local and peer NI it went over and,
+ * if allowed, send the message again. Since both NIs just lost health,
+ * lnet_select_pathway() will favour another path if there is one.
+ *
+ * \retval 0 if \a msg was handed back to lnet_send()
+ * \retval the status \a msg should be finalized with otherwise
+ */
+static int
+lnet_health_check(struct lnet_msg *msg, int status)
+{
+	struct lnet_ni *ni = msg->msg_txni;
+	struct lnet_peer_ni *lpni = msg->msg_txpeer;
+	int cpt = msg->msg_tx_cpt;
+	int rc;
+
+	LASSERT(msg->msg_tx_committed);
+
+	if (!lnet_health_error(status))
+		return status;
+
+	if (ni != NULL && ni != the_lnet.ln_loni)
+		lnet_ni_health_fail(ni);
+	if (lpni != NULL)
+		lnet_peer_ni_health_fail(lpni);
+
+	/* only resend what we originated and whose MD is still usable */
+	if (msg->msg_routing || msg->msg_rx_committed ||
+	    msg->msg_retry_count >= lnet_retry_count ||
+	    (msg->msg_type != LNET_MSG_PUT && msg->msg_type != LNET_MSG_GET) ||
+	    msg->msg_md == NULL ||
+	    (msg->msg_md->md_flags & LNET_MD_FLAG_ABORTED) != 0)
+		return status;
+
+	if (ni != NULL)
+		atomic_inc(&ni->ni_stats.resend_count);
+	if (lpni != NULL)
+		atomic_inc(&lpni->lpni_stats.resend_count);
+
+	/* give back credits and references taken by the failed send */
+	lnet_net_lock(cpt);
+	lnet_msg_decommit(msg, cpt, status);
+	lnet_net_unlock(cpt);
+
+	msg->msg_retry_count++;
+	msg->msg_sending = 0;
+	msg->msg_tx_delayed = 0;
+	msg->msg_target_is_router = 0;
+	/* msg_target may name the router or peer NI picked last time */
+	msg->msg_target.nid = le64_to_cpu(msg->msg_hdr.dest_nid);
+
+	CDEBUG(D_NET, "resending %s to %s after %d, retry %u\n",
+	       lnet_msgtyp2str(msg->msg_type),
+	       libcfs_id2str(msg->msg_target), status, msg->msg_retry_count);
+
+	rc = lnet_send(msg->msg_src_nid_param, msg, msg->msg_rtr_nid_param);
+	if (rc != 0)
+		CNETERR("Error resending %s to %s: %d\n",
+			lnet_msgtyp2str(msg->msg_type),
+			libcfs_id2str(msg->msg_target), rc);
+	return rc;
+}
+
 void
 lnet_finalize(struct lnet_msg *msg, int status)
 {
@@ -462,6 +573,12 @@ lnet_finalize(struct lnet_msg *msg, int status)
 	if (msg == NULL)
 		return;
 
+	if (status != 0 && msg->msg_tx_committed) {
+		status = lnet_health_check(msg, status);
+		if (status == 0)
+			return;
+	}
+
 	msg->msg_ev.status = status;
 
 	if (msg->msg_md != NULL) {
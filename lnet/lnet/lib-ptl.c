@@ -135,6 +135,23 @@ lnet_ptl_disable_mt(struct lnet_portal *ptl, int cpt)
 	}
 }
 
+/* an MD of a ME hashed on a mask group became usable, or stopped being so */
+static inline void
+lnet_mt_mask_md_live(struct lnet_me *me, bool live)
+{
+	struct lnet_mt_mask *mask = me->me_mask;
+
+	if (mask == NULL)
+		return;
+
+	if (live) {
+		mask->mm_nmd++;
+	} else {
+		LASSERT(mask->mm_nmd > 0);
+		mask->mm_nmd--;
+	}
+}
+
 static int
 lnet_try_match_md(struct lnet_libmd *md,
 		  struct lnet_match_info *info, struct lnet_msg *msg)
@@ -205,6 +222,8 @@ lnet_try_match_md(struct lnet_libmd *md,
 	if (!lnet_md_exhausted(md))
 		return LNET_MATCHMD_OK;
 
+	lnet_mt_mask_md_live(me, false);
+
 	/* Auto-unlink NOW, so the ME gets unlinked if required.
 	 * We bumped md->md_refcount above so the MD just gets flagged
 	 * for unlink when it is finalized. */
@@ -371,25 +390,168 @@ lnet_mt_match_head(struct lnet_match_table *mtable,
 	}
 }
 
-int
-lnet_mt_match_md(struct lnet_match_table *mtable,
-		 struct lnet_match_info *info, struct lnet_msg *msg)
+static inline struct list_head *
+lnet_mt_mask_head(struct lnet_mt_mask *mask, __u64 mbits)
 {
-	struct list_head	*head;
-	struct lnet_me		*me;
-	struct lnet_me		*tmp;
-	int			exhausted = 0;
-	int			rc;
+	return &mask->mm_mhash[hash_64(mbits & ~mask->mm_ignore_bits,
+				       LNET_MT_HASH_BITS)];
+}
+
+/* called with lnet_res_lock held */
+static struct lnet_mt_mask *
+lnet_mt_mask_find(struct lnet_match_table *mtable, __u64 ignore_bits)
+{
+	struct lnet_mt_mask *mask;
+
+	list_for_each_entry(mask, &mtable->mt_masks, mm_list) {
+		if (mask->mm_ignore_bits == ignore_bits)
+			return mask;
+	}
+	return NULL;
+}
+
+/**
+ * Make sure MEs with \a ignore_bits get a mask group on \a mtable, so
+ * they are hashed by the match-bits they don't ignore instead of going on
+ * the scan list. Nothing is needed without ignore-bits or when all bits
+ * are ignored, since true wildcards can only be scanned.
+ *
+ * This is only an optimization: if the group can't be allocated, or the
+ * table has LNET_MT_MASKS_MAX groups already, MEs go on the scan list.
+ *
+ * Called w/o lock, may sleep.
+ */
+void
+lnet_mt_mask_create(struct lnet_match_table *mtable, __u64 ignore_bits)
+{
+	struct lnet_mt_mask	*mask;
+	bool			skip;
+	int			i;
+
+	if (ignore_bits == 0 || ignore_bits == ~0ULL)
+		return;
+
+	lnet_res_lock(mtable->mt_cpt);
+	skip = lnet_mt_mask_find(mtable, ignore_bits) != NULL ||
+	       mtable->mt_nmasks >= LNET_MT_MASKS_MAX;
+	lnet_res_unlock(mtable->mt_cpt);
+
+	if (skip)
+		return;
+
+	LIBCFS_CPT_ALLOC(mask, lnet_cpt_table(), mtable->mt_cpt,
+			 sizeof(*mask));
+	if (mask == NULL)
+		return;
+
+	mask->mm_ignore_bits = ignore_bits;
+	for (i = 0; i < LNET_MT_HASH_SIZE; i++)
+		INIT_LIST_HEAD(&mask->mm_mhash[i]);
+
+	lnet_res_lock(mtable->mt_cpt);
+	/* check again with lock */
+	if (lnet_mt_mask_find(mtable, ignore_bits) == NULL &&
+	    mtable->mt_nmasks < LNET_MT_MASKS_MAX) {
+		list_add_tail(&mask->mm_list, &mtable->mt_masks);
+		mtable->mt_nmasks++;
+		mask = NULL;
+	}
+	lnet_res_unlock(mtable->mt_cpt);
+
+	if (mask != NULL)
+		LIBCFS_FREE(mask, sizeof(*mask));
+}
 
-	/* any ME with ignore bits? */
-	if (!list_empty(&mtable->mt_mhash[LNET_MT_HASH_IGNORE]))
+/* list @me belongs on, called with lnet_res_lock held */
+static struct list_head *
+lnet_mt_me_head(struct lnet_match_table *mtable, struct lnet_me *me)
+{
+	if (me->me_mask != NULL)
+		return lnet_mt_mask_head(me->me_mask, me->me_match_bits);
+
+	if (me->me_ignore_bits != 0)
+		return &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
+
+	return lnet_mt_match_head(mtable, me->me_match_id, me->me_match_bits);
+}
+
+/**
+ * Link \a me on \a mtable, at the head or tail of its list depending on
+ * \a pos, or next to \a current_me if it's not NULL.
+ *
+ * The scan list matches any ME, so an ME inserted next to one on it stays
+ * there whatever its bits. Otherwise a message only looks up the list its
+ * own bits hash to, so \a me can only be kept next to \a current_me if
+ * it hashes to the same list. If it doesn't, it goes at the head or tail
+ * of the scan list instead, and is matched in the order of that list.
+ *
+ * Called with lnet_res_lock held.
+ */
+void
+lnet_mt_attach_me(struct lnet_match_table *mtable, struct lnet_me *me,
+		  struct lnet_me *current_me, enum lnet_ins_pos pos)
+{
+	struct list_head *head;
+
+	if (current_me != NULL && current_me->me_mask == NULL &&
+	    current_me->me_pos == LNET_MT_HASH_IGNORE) {
+		me->me_mask = NULL;
 		head = &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
-	else
-		head = lnet_mt_match_head(mtable, info->mi_id, info->mi_mbits);
- again:
-	/* NB: only wildcard portal needs to return LNET_MATCHMD_EXHAUSTED */
-	if (lnet_ptl_is_wildcard(the_lnet.ln_portals[mtable->mt_portal]))
-		exhausted = LNET_MATCHMD_EXHAUSTED;
+	} else {
+		me->me_mask = me->me_ignore_bits == 0 ? NULL :
+			      lnet_mt_mask_find(mtable, me->me_ignore_bits);
+		head = lnet_mt_me_head(mtable, me);
+		if (current_me != NULL &&
+		    lnet_mt_me_head(mtable, current_me) != head) {
+			me->me_mask = NULL;
+			head = &mtable->mt_mhash[LNET_MT_HASH_IGNORE];
+			current_me = NULL;
+		}
+	}
+
+	if (me->me_mask != NULL) {
+		me->me_mask->mm_nme++;
+		me->me_pos = LNET_MT_HASH_IGNORE;
+	} else {
+		me->me_pos = head - &mtable->mt_mhash[0];
+	}
+
+	if (current_me != NULL) {
+		if (pos == LNET_INS_AFTER)
+			list_add(&me->me_list, &current_me->me_list);
+		else
+			list_add_tail(&me->me_list, &current_me->me_list);
+	} else if (pos == LNET_INS_AFTER || pos == LNET_INS_LOCAL) {
+		list_add_tail(&me->me_list, head);
+	} else {
+		list_add(&me->me_list, head);
+	}
+}
+
+/* called with lnet_res_lock held */
+void
+lnet_mt_detach_me(struct lnet_me *me)
+{
+	list_del(&me->me_list);
+
+	if (me->me_md != NULL && !lnet_md_exhausted(me->me_md))
+		lnet_mt_mask_md_live(me, false);
+
+	if (me->me_mask != NULL) {
+		LASSERT(me->me_mask->mm_nme > 0);
+		me->me_mask->mm_nme--;
+		me->me_mask = NULL;
+	}
+}
+
+static int
+lnet_mt_match_list(struct list_head *head,
+		   struct lnet_match_info *info, struct lnet_msg *msg)
+{
+	struct lnet_me	*me;
+	struct lnet_me	*tmp;
+	int		exhausted = LNET_MATCHMD_EXHAUSTED;
+	int		rc;
 
 	list_for_each_entry_safe(me, tmp, head, me_list) {
 		/* ME attached but MD not attached yet */
@@ -402,24 +564,80 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 		if ((rc & LNET_MATCHMD_EXHAUSTED) == 0)
 			exhausted = 0; /* mlist is not empty */
 
-		if ((rc & LNET_MATCHMD_FINISH) != 0) {
-			/* don't return EXHAUSTED bit because we don't know
-			 * whether the mlist is empty or not */
-			return rc & ~LNET_MATCHMD_EXHAUSTED;
-		}
+		if ((rc & LNET_MATCHMD_FINISH) != 0)
+			return rc;
 	}
 
-	if (exhausted == LNET_MATCHMD_EXHAUSTED) { /* @head is exhausted */
-		lnet_mt_set_exhausted(mtable, head - mtable->mt_mhash, 1);
-		if (!lnet_mt_test_exhausted(mtable, -1))
-			exhausted = 0;
+	return LNET_MATCHMD_NONE | exhausted;
+}
+
+/* are all MDs of the MEs hashed on mask groups exhausted? */
+static bool
+lnet_mt_masks_exhausted(struct lnet_match_table *mtable)
+{
+	struct lnet_mt_mask *mask;
+
+	list_for_each_entry(mask, &mtable->mt_masks, mm_list) {
+		if (mask->mm_nmd != 0)
+			return false;
+	}
+	return true;
+}
+
+int
+lnet_mt_match_md(struct lnet_match_table *mtable,
+		 struct lnet_match_info *info, struct lnet_msg *msg)
+{
+	struct lnet_portal	*ptl = the_lnet.ln_portals[mtable->mt_portal];
+	struct lnet_mt_mask	*mask;
+	struct list_head	*head;
+	int			exhausted = 0;
+	int			rc;
+
+	/* MEs with ignore bits first: one hashed lookup for each mask group,
+	 * then the scan list of true wildcards and unindexed masks */
+	list_for_each_entry(mask, &mtable->mt_masks, mm_list) {
+		if (mask->mm_nme == 0)
+			continue;
+
+		head = lnet_mt_mask_head(mask, info->mi_mbits);
+		rc = lnet_mt_match_list(head, info, msg);
+		/* don't return EXHAUSTED bit because we don't know
+		 * whether the mlist is empty or not */
+		if ((rc & LNET_MATCHMD_FINISH) != 0)
+			return rc & ~LNET_MATCHMD_EXHAUSTED;
 	}
 
-	if (exhausted == 0 && head == &mtable->mt_mhash[LNET_MT_HASH_IGNORE]) {
-		head = lnet_mt_match_head(mtable, info->mi_id, info->mi_mbits);
-		goto again; /* re-check MEs w/o ignore-bits */
+	rc = lnet_mt_match_list(&mtable->mt_mhash[LNET_MT_HASH_IGNORE],
+				info, msg);
+	if ((rc & LNET_MATCHMD_FINISH) != 0)
+		return rc & ~LNET_MATCHMD_EXHAUSTED;
+
+	/* NB: only wildcard portal needs to return LNET_MATCHMD_EXHAUSTED.
+	 * This is the slow path, it walks the mask groups to find out if
+	 * the ignore-bits position is exhausted */
+	if (lnet_ptl_is_wildcard(ptl) && (rc & LNET_MATCHMD_EXHAUSTED) != 0 &&
+	    lnet_mt_masks_exhausted(mtable)) {
+		lnet_mt_set_exhausted(mtable, LNET_MT_HASH_IGNORE, 1);
+		if (lnet_mt_test_exhausted(mtable, -1)) {
+			exhausted = LNET_MATCHMD_EXHAUSTED;
+			goto out;
+		}
 	}
 
+	/* re-check MEs w/o ignore-bits */
+	head = lnet_mt_match_head(mtable, info->mi_id, info->mi_mbits);
+	rc = lnet_mt_match_list(head, info, msg);
+	if ((rc & LNET_MATCHMD_FINISH) != 0)
+		return rc & ~LNET_MATCHMD_EXHAUSTED;
+
+	if (lnet_ptl_is_wildcard(ptl) && (rc & LNET_MATCHMD_EXHAUSTED) != 0) {
+		/* @head is exhausted */
+		lnet_mt_set_exhausted(mtable, head - mtable->mt_mhash, 1);
+		if (lnet_mt_test_exhausted(mtable, -1))
+			exhausted = LNET_MATCHMD_EXHAUSTED;
+	}
+ out:
 	if (info->mi_opc == LNET_MD_OP_GET ||
 	    !lnet_ptl_is_lazy(the_lnet.ln_portals[info->mi_portal]))
 		return LNET_MATCHMD_DROP | exhausted;
@@ -641,6 +859,9 @@ lnet_ptl_detach_md(struct lnet_me *me, struct lnet_libmd *md)
 {
 	LASSERT(me->me_md == md && md->md_me == me);
 
+	if (!lnet_md_exhausted(md))
+		lnet_mt_mask_md_live(me, false);
+
 	me->me_md = NULL;
 	md->md_me = NULL;
 }
@@ -663,6 +884,9 @@ lnet_ptl_attach_md(struct lnet_me *me, struct lnet_libmd *md,
 	me->me_md = md;
 	md->md_me = me;
 
+	if (!lnet_md_exhausted(md))
+		lnet_mt_mask_md_live(me, true);
+
 	cpt = lnet_cpt_of_cookie(md->md_lh.lh_cookie);
 	mtable = ptl->ptl_mtables[cpt];
 
@@ -741,6 +965,22 @@ lnet_ptl_attach_md(struct lnet_me *me, struct lnet_libmd *md,
 	lnet_ptl_unlock(ptl);
 }
 
+static void
+lnet_mt_cleanup_mes(struct list_head *mhash, int size)
+{
+	struct lnet_me	*me;
+	int		i;
+
+	for (i = 0; i < size; i++) {
+		while (!list_empty(&mhash[i])) {
+			me = list_entry(mhash[i].next, struct lnet_me, me_list);
+			CERROR("Active ME %p on exit\n", me);
+			list_del(&me->me_list);
+			lnet_me_free(me);
+		}
+	}
+}
+
 static void
 lnet_ptl_cleanup(struct lnet_portal *ptl)
 {
@@ -753,24 +993,23 @@ lnet_ptl_cleanup(struct lnet_portal *ptl)
 	LASSERT(list_empty(&ptl->ptl_msg_delayed));
 	LASSERT(list_empty(&ptl->ptl_msg_stealing));
 	cfs_percpt_for_each(mtable, i, ptl->ptl_mtables) {
-		struct list_head *mhash;
-		struct lnet_me	 *me;
-		int		  j;
+		struct list_head    *mhash;
+		struct lnet_mt_mask *mask;
 
 		if (mtable->mt_mhash == NULL) /* uninitialized match-table */
 			continue;
 
+		while (!list_empty(&mtable->mt_masks)) {
+			mask = list_entry(mtable->mt_masks.next,
+					  struct lnet_mt_mask, mm_list);
+			lnet_mt_cleanup_mes(mask->mm_mhash, LNET_MT_HASH_SIZE);
+			list_del(&mask->mm_list);
+			LIBCFS_FREE(mask, sizeof(*mask));
+		}
+
 		mhash = mtable->mt_mhash;
 		/* cleanup ME */
-		for (j = 0; j < LNET_MT_HASH_SIZE + 1; j++) {
-			while (!list_empty(&mhash[j])) {
-				me = list_entry(mhash[j].next,
-						struct lnet_me, me_list);
-				CERROR("Active ME %p on exit\n", me);
-				list_del(&me->me_list);
-				lnet_me_free(me);
-			}
-		}
+		lnet_mt_cleanup_mes(mhash, LNET_MT_HASH_SIZE + 1);
 		/* the extra entry is for MEs with ignore bits */
 		LIBCFS_FREE(mhash, sizeof(*mhash) * (LNET_MT_HASH_SIZE + 1));
 	}
@@ -815,6 +1054,7 @@ lnet_ptl_setup(struct lnet_portal *ptl, int index)
 		for (j = 0; j < LNET_MT_HASH_SIZE + 1; j++)
 			INIT_LIST_HEAD(&mhash[j]);
 
+		INIT_LIST_HEAD(&mtable->mt_masks);
 		mtable->mt_portal = index;
 		mtable->mt_cpt = i;
 	}
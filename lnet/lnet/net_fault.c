@@ -181,9 +181,11 @@ lnet_drop_rule_add(struct lnet_fault_attr *attr)
 	list_add(&rule->dr_link, &the_lnet.ln_drop_rules);
 	lnet_net_unlock(LNET_LOCK_EX);
 
-	CDEBUG(D_NET, "Added drop rule: src %s, dst %s, rate %d, interval %d\n",
-	       libcfs_nid2str(attr->fa_src), libcfs_nid2str(attr->fa_src),
-	       attr->u.drop.da_rate, attr->u.drop.da_interval);
+	CDEBUG(D_NET, "Added drop rule: src %s, dst %s, rate %d, interval %d"
+	       "%s\n", libcfs_nid2str(attr->fa_src),
+	       libcfs_nid2str(attr->fa_src), attr->u.drop.da_rate,
+	       attr->u.drop.da_interval,
+	       attr->u.drop.da_send_error ? ", send error" : "");
 	RETURN(0);
 }
 
@@ -356,10 +358,12 @@ drop_rule_match(struct lnet_drop_rule *rule, lnet_nid_t src,
 }
 
 /**
- * Check if message from \a src to \a dst can match any existed drop rule
+ * Check if message from \a src to \a dst can match any existed drop rule,
+ * only looking at the rules which fail sends if \a send is true, and at
+ * the other ones otherwise.
  */
 bool
-lnet_drop_rule_match(struct lnet_hdr *hdr)
+lnet_drop_rule_match(struct lnet_hdr *hdr, bool send)
 {
 	struct lnet_drop_rule	*rule;
 	lnet_nid_t		 src = le64_to_cpu(hdr->src_nid);
@@ -378,6 +382,9 @@ lnet_drop_rule_match(struct lnet_hdr *hdr)
 
 	cpt = lnet_net_lock_current();
 	list_for_each_entry(rule, &the_lnet.ln_drop_rules, dr_link) {
+		if (!rule->dr_attr.u.drop.da_send_error != !send)
+			continue;
+
 		drop = drop_rule_match(rule, src, dst, typ, ptl);
 		if (drop)
 			break;
@@ -417,6 +424,11 @@ struct lnet_delay_rule {
 	cfs_time_t		dl_time_base;
 	/** jiffies to send the next delayed message */
 	unsigned long		dl_msg_send;
+	/**
+	 * nanoseconds at which the bandwidth limit lets the next byte
+	 * through, it can be ahead of now by the burst of the rule
+	 */
+	s64			dl_bw_tat;
 	/** delayed message list */
 	struct list_head	dl_msg_list;
 	/** statistic of delayed messages */
@@ -451,6 +463,94 @@ round_timeout(cfs_time_t timeout)
 			cfs_duration_sec(cfs_time_sub(timeout, 0)) + 1);
 }
 
+/** does the rule do more than delaying by whole seconds */
+static bool
+delay_rule_shaping(struct lnet_fault_attr *attr)
+{
+	return attr->u.delay.la_latency_ms != 0 ||
+	       attr->u.delay.la_jitter != 0 ||
+	       attr->u.delay.la_bandwidth != 0;
+}
+
+/** random jitter in microseconds, following la_jitter_dist */
+static s64
+delay_rule_jitter(struct lnet_fault_attr *attr)
+{
+	s64		jitter = (s64)attr->u.delay.la_jitter * USEC_PER_MSEC;
+	s64		sum = 0;
+	unsigned int	r;
+	int		i;
+
+	switch (attr->u.delay.la_jitter_dist) {
+	case LNET_FAULT_JITTER_UNIFORM:
+		r = cfs_rand() & 0xffff;
+		return div_s64(jitter * ((s64)r * 2 - 0xffff), 0xffff);
+
+	case LNET_FAULT_JITTER_NORMAL:
+		/* sum of 12 uniforms in [0, 1) less 6 is close enough to a
+		 * standard normal distribution */
+		for (i = 0; i < 12; i++)
+			sum += cfs_rand() & 0xffff;
+		return div_s64(jitter * (sum - 6 * 0x10000), 0x10000);
+
+	case LNET_FAULT_JITTER_PARETO:
+		/* inverse CDF jitter / sqrt(U) of Pareto with shape 2 and
+		 * scale jitter, less the scale so the mean is jitter */
+		r = cfs_rand() % 0xffff + 1;
+		return div_s64(jitter << 16, int_sqrt((unsigned long)r << 16)) -
+		       jitter;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * jiffies at which a message of \a nob bytes delayed by \a rule should be
+ * received: once the bandwidth limit lets all its bytes through, plus the
+ * latency and jitter of the rule.
+ * Called with dl_lock held.
+ */
+static unsigned long
+delay_rule_send_time(struct lnet_delay_rule *rule, unsigned int nob)
+{
+	struct lnet_fault_attr	*attr = &rule->dl_attr;
+	s64			 now;
+	s64			 send;
+	s64			 cost;
+	s64			 burst;
+
+	if (!delay_rule_shaping(attr))
+		return round_timeout(cfs_time_shift(attr->u.delay.la_latency));
+
+	now = ktime_to_ns(ktime_get());
+	send = now;
+
+	if (attr->u.delay.la_bandwidth != 0) {
+		/* token bucket of la_burst KiB filled at la_bandwidth KiB/s,
+		 * kept as the time at which it has room for the next byte */
+		cost = div64_u64((u64)nob * NSEC_PER_SEC,
+				 (u64)attr->u.delay.la_bandwidth * 1024);
+		burst = div_u64((u64)attr->u.delay.la_burst * NSEC_PER_SEC,
+				attr->u.delay.la_bandwidth);
+
+		rule->dl_bw_tat = max(rule->dl_bw_tat, now) + cost;
+		if (rule->dl_bw_tat - burst > now) {
+			send = rule->dl_bw_tat - burst;
+			rule->dl_stat.u.delay.ls_throttled++;
+		}
+	}
+
+	send += ((s64)attr->u.delay.la_latency * MSEC_PER_SEC +
+		 attr->u.delay.la_latency_ms) * NSEC_PER_MSEC;
+	if (attr->u.delay.la_jitter != 0)
+		send += delay_rule_jitter(attr) * NSEC_PER_USEC;
+
+	if (send <= now)
+		return jiffies;
+
+	return jiffies + usecs_to_jiffies(div_s64(send - now, NSEC_PER_USEC));
+}
+
 static void
 delay_rule_decref(struct lnet_delay_rule *rule)
 {
@@ -470,9 +570,10 @@ delay_rule_decref(struct lnet_delay_rule *rule)
 static bool
 delay_rule_match(struct lnet_delay_rule *rule, lnet_nid_t src,
 		lnet_nid_t dst, unsigned int type, unsigned int portal,
-		struct lnet_msg *msg)
+		unsigned int nob, struct lnet_msg *msg)
 {
 	struct lnet_fault_attr	*attr = &rule->dl_attr;
+	struct lnet_msg		*tmp;
 	bool			 delay;
 
 	if (!lnet_fault_attr_match(attr, src, dst, type, portal))
@@ -525,10 +626,17 @@ delay_rule_match(struct lnet_delay_rule *rule, lnet_nid_t src,
 	lnet_fault_stat_inc(&rule->dl_stat, type);
 	rule->dl_stat.u.delay.ls_delayed++;
 
-	list_add_tail(&msg->msg_list, &rule->dl_msg_list);
-	msg->msg_delay_send = round_timeout(
-			cfs_time_shift(attr->u.delay.la_latency));
-	if (rule->dl_msg_send == -1) {
+	msg->msg_delay_send = delay_rule_send_time(rule, nob);
+
+	/* jitter can reorder messages, keep the list sorted by send time */
+	list_for_each_entry_reverse(tmp, &rule->dl_msg_list, msg_list) {
+		if (cfs_time_beforeq((cfs_time_t)tmp->msg_delay_send,
+				     (cfs_time_t)msg->msg_delay_send))
+			break;
+	}
+	list_add(&msg->msg_list, &tmp->msg_list);
+
+	if (rule->dl_msg_list.next == &msg->msg_list) {
 		rule->dl_msg_send = msg->msg_delay_send;
 		mod_timer(&rule->dl_timer, rule->dl_msg_send);
 	}
@@ -549,6 +657,7 @@ lnet_delay_rule_match_locked(struct lnet_hdr *hdr, struct lnet_msg *msg)
 	lnet_nid_t		 dst = le64_to_cpu(hdr->dest_nid);
 	unsigned int		 typ = le32_to_cpu(hdr->type);
 	unsigned int		 ptl = -1;
+	unsigned int		 nob;
 
 	/* NB: called with hold of lnet_net_lock */
 
@@ -559,8 +668,11 @@ lnet_delay_rule_match_locked(struct lnet_hdr *hdr, struct lnet_msg *msg)
 	else if (typ == LNET_MSG_GET)
 		ptl = le32_to_cpu(hdr->msg.get.ptl_index);
 
+	/* bytes on the wire, for the bandwidth limit */
+	nob = sizeof(*hdr) + le32_to_cpu(hdr->payload_length);
+
 	list_for_each_entry(rule, &the_lnet.ln_delay_rules, dl_link) {
-		if (delay_rule_match(rule, src, dst, typ, ptl, msg))
+		if (delay_rule_match(rule, src, dst, typ, ptl, nob, msg))
 			return true;
 	}
 
@@ -741,11 +853,23 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 		RETURN(-EINVAL);
 	}
 
-	if (attr->u.delay.la_latency == 0) {
+	if (attr->u.delay.la_latency == 0 && !delay_rule_shaping(attr)) {
 		CDEBUG(D_NET, "delay latency cannot be zero\n");
 		RETURN(-EINVAL);
 	}
 
+	if (attr->u.delay.la_jitter_dist > LNET_FAULT_JITTER_PARETO) {
+		CDEBUG(D_NET, "unknown jitter distribution %u\n",
+		       attr->u.delay.la_jitter_dist);
+		RETURN(-EINVAL);
+	}
+
+	if (attr->u.delay.la_jitter > LNET_FAULT_JITTER_MAX) {
+		CDEBUG(D_NET, "delay jitter %u ms is above %u ms\n",
+		       attr->u.delay.la_jitter, LNET_FAULT_JITTER_MAX);
+		RETURN(-EINVAL);
+	}
+
 	if (lnet_fault_attr_validate(attr) != 0)
 		RETURN(-EINVAL);
 
@@ -796,9 +920,13 @@ lnet_delay_rule_add(struct lnet_fault_attr *attr)
 	list_add(&rule->dl_link, &the_lnet.ln_delay_rules);
 	lnet_net_unlock(LNET_LOCK_EX);
 
-	CDEBUG(D_NET, "Added delay rule: src %s, dst %s, rate %d\n",
+	CDEBUG(D_NET, "Added delay rule: src %s, dst %s, rate %d, "
+	       "latency %us+%ums, jitter %ums/%u, bandwidth %uKiB/s+%uKiB\n",
 	       libcfs_nid2str(attr->fa_src), libcfs_nid2str(attr->fa_src),
-	       attr->u.delay.la_rate);
+	       attr->u.delay.la_rate, attr->u.delay.la_latency,
+	       attr->u.delay.la_latency_ms, attr->u.delay.la_jitter,
+	       attr->u.delay.la_jitter_dist, attr->u.delay.la_bandwidth,
+	       attr->u.delay.la_burst);
 
 	mutex_unlock(&delay_dd.dd_mutex);
 	RETURN(0);
@@ -932,6 +1060,7 @@ lnet_delay_rule_reset(void)
 		spin_lock(&rule->dl_lock);
 
 		memset(&rule->dl_stat, 0, sizeof(rule->dl_stat));
+		rule->dl_bw_tat = 0;
 		if (attr->u.delay.la_rate != 0) {
 			rule->dl_delay_at = cfs_rand() % attr->u.delay.la_rate;
 		} else {
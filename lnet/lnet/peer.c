@@ -154,6 +154,7 @@ lnet_peer_ni_alloc(lnet_nid_t nid)
 	INIT_LIST_HEAD(&lpni->lpni_hashlist);
 	INIT_LIST_HEAD(&lpni->lpni_on_peer_net_list);
 	INIT_LIST_HEAD(&lpni->lpni_on_remote_peer_ni_list);
+	INIT_LIST_HEAD(&lpni->lpni_dc_list);
 
 	spin_lock_init(&lpni->lpni_lock);
 
@@ -163,6 +164,11 @@ lnet_peer_ni_alloc(lnet_nid_t nid)
 	lpni->lpni_nid = nid;
 	lpni->lpni_cpt = cpt;
 	lnet_set_peer_ni_health_locked(lpni, true);
+	lpni->lpni_healthv = LNET_MAX_HEALTH_VALUE;
+	lpni->lpni_sel_priority = lnet_sel_priority(LNET_SEL_RULE_PEER_NI, 0,
+						    nid);
+	lpni->lpni_gw_sel_priority = lnet_sel_priority(LNET_SEL_RULE_ROUTER,
+						       0, nid);
 
 	net = lnet_get_net_locked(LNET_NIDNET(nid));
 	lpni->lpni_net = net;
@@ -201,6 +207,7 @@ lnet_peer_net_alloc(__u32 net_id)
 	INIT_LIST_HEAD(&lpn->lpn_on_peer_list);
 	INIT_LIST_HEAD(&lpn->lpn_peer_nis);
 	lpn->lpn_net_id = net_id;
+	lpn->lpn_sel_priority = LNET_SEL_PRIO_DEFAULT;
 
 	return lpn;
 }
@@ -692,6 +699,9 @@ lnet_peer_setup_hierarchy(struct lnet_peer *lp, struct lnet_peer_ni *lpni,
 	/* Add peer_net to peer */
 	if (!lpn->lpn_peer) {
 		lpn->lpn_peer = lp;
+		lpn->lpn_sel_priority =
+			lnet_sel_priority(LNET_SEL_RULE_NET, net_id,
+					  lp->lp_primary_nid);
 		list_add_tail(&lpn->lpn_on_peer_list, &lp->lp_peer_nets);
 	}
 
@@ -884,6 +894,26 @@ lnet_peer_ni_add_non_mr(lnet_nid_t nid)
 	return lnet_peer_setup_hierarchy(NULL, NULL, nid);
 }
 
+/*
+ * Peers set up through DLC are authoritative: stop discovery from
+ * changing them behind the administrator's back.
+ */
+static void
+lnet_peer_set_configured(lnet_nid_t nid)
+{
+	struct lnet_peer_ni *lpni;
+
+	lpni = lnet_find_peer_ni_locked(nid);
+	if (!lpni)
+		return;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+	lpni->lpni_peer_net->lpn_peer->lp_state |= LNET_PEER_CONFIGURED;
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	lnet_peer_ni_decref_locked(lpni);
+}
+
 /*
  * This API handles the following combinations:
  *	Create a primary NI if only the prim_nid is provided
@@ -894,6 +924,8 @@ lnet_peer_ni_add_non_mr(lnet_nid_t nid)
 int
 lnet_add_peer_ni_to_peer(lnet_nid_t prim_nid, lnet_nid_t nid, bool mr)
 {
+	int rc = 0;
+
 	/*
 	 * Caller trying to setup an MR like peer hierarchy but
 	 * specifying it to be non-MR. This is not allowed.
@@ -905,22 +937,26 @@ lnet_add_peer_ni_to_peer(lnet_nid_t prim_nid, lnet_nid_t nid, bool mr)
 	/* Add the primary NID of a peer */
 	if (prim_nid != LNET_NID_ANY &&
 	    nid == LNET_NID_ANY && mr)
-		return lnet_add_prim_lpni(prim_nid);
+		rc = lnet_add_prim_lpni(prim_nid);
 
 	/* Add a NID to an existing peer */
-	if (prim_nid != LNET_NID_ANY &&
-	    nid != LNET_NID_ANY && mr)
-		return lnet_add_peer_ni_to_prim_lpni(prim_nid, nid);
+	else if (prim_nid != LNET_NID_ANY &&
+		 nid != LNET_NID_ANY && mr)
+		rc = lnet_add_peer_ni_to_prim_lpni(prim_nid, nid);
 
 	/* Add a non-MR peer NI */
-	if (((prim_nid != LNET_NID_ANY &&
-	      nid == LNET_NID_ANY) ||
-	     (prim_nid == LNET_NID_ANY &&
-	      nid != LNET_NID_ANY)) && !mr)
-		return lnet_peer_ni_add_non_mr(prim_nid != LNET_NID_ANY ?
+	else if (((prim_nid != LNET_NID_ANY &&
+		   nid == LNET_NID_ANY) ||
+		  (prim_nid == LNET_NID_ANY &&
+		   nid != LNET_NID_ANY)) && !mr)
+		rc = lnet_peer_ni_add_non_mr(prim_nid != LNET_NID_ANY ?
 							 prim_nid : nid);
 
-	return 0;
+	if (rc == 0)
+		lnet_peer_set_configured(prim_nid != LNET_NID_ANY ?
+					 prim_nid : nid);
+
+	return rc;
 }
 
 int
@@ -1170,7 +1206,7 @@ int lnet_get_peer_ni_info(__u32 peer_index, __u64 *nid,
 }
 
 int lnet_get_peer_info(__u32 idx, lnet_nid_t *primary_nid, lnet_nid_t *nid,
-		       bool *mr,
+		       bool *mr, __u32 *state,
 		       struct lnet_peer_ni_credit_info __user *peer_ni_info,
 		       struct lnet_ioctl_element_stats __user *peer_ni_stats)
 {
@@ -1188,6 +1224,7 @@ int lnet_get_peer_info(__u32 idx, lnet_nid_t *primary_nid, lnet_nid_t *nid,
 
 	*primary_nid = lp->lp_primary_nid;
 	*mr = lp->lp_multi_rail;
+	*state = lp->lp_state;
 	*nid = lpni->lpni_nid;
 	snprintf(ni_info.cr_aliveness, LNET_MAX_STR_LEN, "NA");
 	if (lnet_isrouter(lpni) ||
@@ -1222,3 +1259,953 @@ int lnet_get_peer_info(__u32 idx, lnet_nid_t *primary_nid, lnet_nid_t *nid,
 copy_failed:
 	return rc;
 }
+
+int lnet_get_peer_ni_hstats(struct lnet_ioctl_element_hstats *hstats)
+{
+	struct lnet_peer_ni *lpni;
+	int cpt;
+	int rc = -ENOENT;
+
+	cpt = lnet_net_lock_current();
+
+	lpni = lnet_find_peer_ni_locked(hstats->hs_nid);
+	if (lpni) {
+		hstats->hs_health_value = lnet_peer_ni_healthv(lpni);
+		hstats->hs_fail_count =
+			atomic_read(&lpni->lpni_stats.fail_count);
+		hstats->hs_resend_count =
+			atomic_read(&lpni->lpni_stats.resend_count);
+		lnet_peer_ni_decref_locked(lpni);
+		rc = 0;
+	}
+
+	lnet_net_unlock(cpt);
+	return rc;
+}
+
+/*
+ * Dynamic peer discovery.
+ *
+ * The first PUT or GET sent to a peer queues one of its peer NIs on
+ * the_lnet.ln_dc_request. The discovery thread pings it, and if the
+ * reply says the peer is Multi-Rail, the NIDs listed in its ping buffer
+ * are added to the peer. Sends are never held up waiting for this: until
+ * discovery completes the peer is used through the NIDs already known.
+ *
+ * When our own NIDs change, peers that advertised LNET_PING_FEAT_DISCOVERY
+ * receive an empty PUT on the ping portal. A node receiving such a push
+ * forgets what it learned about the sender, so the next message to it
+ * triggers a fresh ping.
+ */
+struct lnet_dc_ping {
+	/* chain on the_lnet.ln_dc_working or ln_dc_done */
+	struct list_head	 dp_list;
+	/* peer NI being pinged, holds a reference */
+	struct lnet_peer_ni	*dp_lpni;
+	struct lnet_handle_md	 dp_mdh;
+	/* when to give up waiting for the reply */
+	time64_t		 dp_deadline;
+	/* first error reported by an event */
+	int			 dp_status;
+	/* # bytes of the reply */
+	int			 dp_nob;
+	bool			 dp_replied;
+	/* LNetMDUnlink() has been called on dp_mdh */
+	bool			 dp_unlinking;
+	struct lnet_ping_info	*dp_info;
+};
+
+#define LNET_DC_INFO_SIZE	offsetof(struct lnet_ping_info, \
+					 pi_ni[LNET_DC_MAX_NIS])
+
+static inline bool
+lnet_peer_needs_discovery(struct lnet_peer *lp)
+{
+	if (lp->lp_state & (LNET_PEER_CONFIGURED | LNET_PEER_DISCOVERING |
+			    LNET_PEER_DISCOVERED))
+		return false;
+
+	if (lp->lp_state & LNET_PEER_DC_ERROR)
+		return ktime_get_seconds() >=
+		       lp->lp_dc_stamp + LNET_DC_RETRY_INTERVAL;
+
+	return true;
+}
+
+/*
+ * Queue \a lp for discovery through the peer NI \a nid, unless it has
+ * already been discovered or configured. Called with a CPT of
+ * lnet_net_lock held.
+ */
+void
+lnet_peer_queue_discovery_locked(struct lnet_peer *lp, lnet_nid_t nid)
+{
+	struct lnet_peer_ni *lpni;
+	bool queued = false;
+
+	/* unlocked check, keeps the common case cheap */
+	if (lnet_peer_discovery_disabled || !lnet_peer_needs_discovery(lp))
+		return;
+
+	lpni = lnet_find_peer_ni_locked(nid);
+	if (!lpni)
+		return;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+	if (the_lnet.ln_dc_state == LNET_DC_STATE_RUNNING &&
+	    lnet_peer_needs_discovery(lp) &&
+	    list_empty(&lpni->lpni_dc_list)) {
+		lp->lp_state |= LNET_PEER_DISCOVERING;
+		/* the queue keeps the reference */
+		list_add_tail(&lpni->lpni_dc_list, &the_lnet.ln_dc_request);
+		queued = true;
+	}
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	if (queued)
+		wake_up(&the_lnet.ln_dc_waitq);
+	else
+		lnet_peer_ni_decref_locked(lpni);
+}
+
+/* Our NIDs changed: tell the peers that asked to be told. */
+void
+lnet_peer_discovery_push(void)
+{
+	spin_lock(&the_lnet.ln_dc_lock);
+	the_lnet.ln_dc_push_all = true;
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	wake_up(&the_lnet.ln_dc_waitq);
+}
+
+static void
+lnet_peer_dc_event(struct lnet_event *event)
+{
+	struct lnet_dc_ping *dp = event->md.user_ptr;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+
+	if (event->status != 0) {
+		if (dp->dp_status == 0)
+			dp->dp_status = event->status;
+	} else if (event->type == LNET_EVENT_REPLY) {
+		dp->dp_nob = event->mlength;
+		dp->dp_replied = true;
+	}
+
+	if (event->unlinked) {
+		LNetInvalidateMDHandle(&dp->dp_mdh);
+		list_move_tail(&dp->dp_list, &the_lnet.ln_dc_done);
+	}
+
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	if (event->unlinked)
+		wake_up(&the_lnet.ln_dc_waitq);
+}
+
+static void
+lnet_push_target_event(struct lnet_event *event)
+{
+	spin_lock(&the_lnet.ln_dc_lock);
+
+	if (event->type == LNET_EVENT_PUT && event->status == 0) {
+		if (the_lnet.ln_dc_push_count < LNET_DC_PUSH_SLOTS)
+			the_lnet.ln_dc_push_nids[the_lnet.ln_dc_push_count++] =
+				event->initiator.nid;
+		else
+			the_lnet.ln_dc_push_overflow = true;
+	}
+
+	if (event->unlinked)
+		the_lnet.ln_push_target_busy = false;
+
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	wake_up(&the_lnet.ln_dc_waitq);
+}
+
+/*
+ * Record the outcome of discovering the peer \a lpni belongs to. The
+ * peer may have gone away in the meantime, in which case there is
+ * nothing to update.
+ */
+static void
+lnet_peer_dc_complete(struct lnet_peer_ni *lpni, int status, __u32 features)
+{
+	struct lnet_peer *lp;
+	int cpt = lpni->lpni_cpt;
+
+	lnet_net_lock(cpt);
+	spin_lock(&the_lnet.ln_dc_lock);
+
+	if (lpni->lpni_peer_net && lpni->lpni_peer_net->lpn_peer) {
+		lp = lpni->lpni_peer_net->lpn_peer;
+		lp->lp_state &= ~(LNET_PEER_DISCOVERING | LNET_PEER_DC_ERROR |
+				  LNET_PEER_PUSH);
+		if (status != 0) {
+			lp->lp_state |= LNET_PEER_DC_ERROR;
+			lp->lp_dc_stamp = ktime_get_seconds();
+		} else {
+			lp->lp_state |= LNET_PEER_DISCOVERED;
+			if (features & LNET_PING_FEAT_DISCOVERY)
+				lp->lp_state |= LNET_PEER_PUSH;
+		}
+	}
+
+	spin_unlock(&the_lnet.ln_dc_lock);
+	lnet_peer_ni_decref_locked(lpni);
+	lnet_net_unlock(cpt);
+}
+
+/* Start unlinking the MD of \a dp, the unlink event moves it to ln_dc_done */
+static void
+lnet_peer_dc_unlink(struct lnet_dc_ping *dp)
+{
+	struct lnet_handle_md mdh;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+	if (dp->dp_unlinking || LNetMDHandleIsInvalid(dp->dp_mdh)) {
+		spin_unlock(&the_lnet.ln_dc_lock);
+		return;
+	}
+	dp->dp_unlinking = true;
+	mdh = dp->dp_mdh;
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	/* No assertion (racing with network) */
+	LNetMDUnlink(mdh);
+}
+
+static void
+lnet_peer_dc_ping(struct lnet_peer_ni *lpni)
+{
+	struct lnet_process_id id;
+	struct lnet_dc_ping *dp;
+	struct lnet_md md = { NULL };
+	bool local;
+	int cpt;
+	int rc;
+
+	id.nid = lpni->lpni_nid;
+	id.pid = LNET_PID_LUSTRE;
+
+	/* nothing to learn about ourselves */
+	cpt = lnet_net_lock_current();
+	local = lnet_nid2ni_locked(id.nid, cpt) != NULL;
+	lnet_net_unlock(cpt);
+	if (local) {
+		lnet_peer_dc_complete(lpni, 0, 0);
+		return;
+	}
+
+	LIBCFS_ALLOC(dp, sizeof(*dp));
+	if (dp == NULL) {
+		rc = -ENOMEM;
+		goto failed;
+	}
+
+	LIBCFS_ALLOC(dp->dp_info, LNET_DC_INFO_SIZE);
+	if (dp->dp_info == NULL) {
+		LIBCFS_FREE(dp, sizeof(*dp));
+		rc = -ENOMEM;
+		goto failed;
+	}
+
+	dp->dp_lpni = lpni;
+	dp->dp_deadline = ktime_get_seconds() + LNET_DC_PING_TIMEOUT;
+
+	md.start     = dp->dp_info;
+	md.length    = LNET_DC_INFO_SIZE;
+	md.threshold = 2; /* GET/REPLY */
+	md.max_size  = 0;
+	md.options   = LNET_MD_TRUNCATE;
+	md.user_ptr  = dp;
+	md.eq_handle = the_lnet.ln_dc_eqh;
+
+	/* on the working list before any event can move it off */
+	spin_lock(&the_lnet.ln_dc_lock);
+	list_add_tail(&dp->dp_list, &the_lnet.ln_dc_working);
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	rc = LNetMDBind(md, LNET_UNLINK, &dp->dp_mdh);
+	if (rc != 0) {
+		CERROR("Can't bind discovery MD for %s: %d\n",
+		       libcfs_nid2str(id.nid), rc);
+		spin_lock(&the_lnet.ln_dc_lock);
+		list_del(&dp->dp_list);
+		spin_unlock(&the_lnet.ln_dc_lock);
+		LIBCFS_FREE(dp->dp_info, LNET_DC_INFO_SIZE);
+		LIBCFS_FREE(dp, sizeof(*dp));
+		goto failed;
+	}
+
+	rc = LNetGet(LNET_NID_ANY, dp->dp_mdh, id, LNET_RESERVED_PORTAL,
+		     LNET_PROTO_PING_MATCHBITS, 0);
+	if (rc != 0) {
+		CDEBUG(D_NET, "Discovery ping of %s failed: %d\n",
+		       libcfs_nid2str(id.nid), rc);
+		spin_lock(&the_lnet.ln_dc_lock);
+		dp->dp_status = rc;
+		spin_unlock(&the_lnet.ln_dc_lock);
+		/* the unlink event hands dp over to the done list */
+		lnet_peer_dc_unlink(dp);
+	}
+	return;
+
+failed:
+	lnet_peer_dc_complete(lpni, rc, 0);
+}
+
+/*
+ * Check the reply to a discovery ping. Returns the number of NIs
+ * available in the ping buffer or a negative error number.
+ */
+static int
+lnet_peer_dc_parse(struct lnet_dc_ping *dp)
+{
+	struct lnet_ping_info *info = dp->dp_info;
+	lnet_nid_t nid = dp->dp_lpni->lpni_nid;
+	int nob = dp->dp_nob;
+	int nnis;
+	int i;
+
+	if (nob < 8) {
+		CDEBUG(D_NET, "%s: ping info too short %d\n",
+		       libcfs_nid2str(nid), nob);
+		return -EPROTO;
+	}
+
+	if (info->pi_magic == __swab32(LNET_PROTO_PING_MAGIC)) {
+		lnet_swap_pinginfo(info);
+		/* lnet_swap_pinginfo() stops at LNET_MAX_RTR_NIS */
+		for (i = LNET_MAX_RTR_NIS;
+		     i < info->pi_nnis && i < LNET_DC_MAX_NIS; i++) {
+			__swab64s(&info->pi_ni[i].ns_nid);
+			__swab32s(&info->pi_ni[i].ns_status);
+		}
+	} else if (info->pi_magic != LNET_PROTO_PING_MAGIC) {
+		CDEBUG(D_NET, "%s: unexpected magic %08x\n",
+		       libcfs_nid2str(nid), info->pi_magic);
+		return -EPROTO;
+	}
+
+	if ((info->pi_features & LNET_PING_FEAT_NI_STATUS) == 0) {
+		CDEBUG(D_NET, "%s: ping w/o NI status: 0x%x\n",
+		       libcfs_nid2str(nid), info->pi_features);
+		return -EPROTO;
+	}
+
+	nnis = min_t(int, info->pi_nnis, LNET_DC_MAX_NIS);
+	if (nob < offsetof(struct lnet_ping_info, pi_ni[nnis])) {
+		CDEBUG(D_NET, "%s: short reply %d(%d expected)\n",
+		       libcfs_nid2str(nid), nob,
+		       (int)offsetof(struct lnet_ping_info, pi_ni[nnis]));
+		return -EPROTO;
+	}
+
+	return nnis;
+}
+
+static bool
+lnet_peer_dc_nid_listed(struct lnet_ping_info *info, int nnis,
+			lnet_nid_t nid)
+{
+	int i;
+
+	for (i = 0; i < nnis; i++) {
+		if (info->pi_ni[i].ns_nid == nid)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Make the peer \a lpni belongs to match the NID list in \a info. NIDs
+ * owned by another Multi-Rail peer are left alone, NIDs the peer no
+ * longer lists are removed unless they are gateways.
+ *
+ * The primary NID is kept as long as the peer still lists it, since
+ * upper layers identify the peer by it. Called with ln_api_mutex held.
+ */
+static int
+lnet_peer_dc_merge(struct lnet_peer_ni *lpni, struct lnet_ping_info *info,
+		   int nnis)
+{
+	struct lnet_peer *lp;
+	struct lnet_peer *owner;
+	struct lnet_peer_ni *cur;
+	struct lnet_peer_ni *next;
+	lnet_nid_t nid;
+	bool configured;
+	int rc;
+	int i;
+
+	if (!lpni->lpni_peer_net || !lpni->lpni_peer_net->lpn_peer)
+		return -ENOENT;
+	lp = lpni->lpni_peer_net->lpn_peer;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+	configured = lp->lp_state & LNET_PEER_CONFIGURED;
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	if (configured || !(info->pi_features & LNET_PING_FEAT_MULTI_RAIL))
+		return 0;
+
+	/* a non-MR peer with several NIDs can't be sent to */
+	lnet_net_lock(LNET_LOCK_EX);
+	lp->lp_multi_rail = true;
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	for (i = 0; i < nnis; i++) {
+		nid = info->pi_ni[i].ns_nid;
+		if (LNET_NETTYP(LNET_NIDNET(nid)) == LOLND)
+			continue;
+
+		/* lnet_net_lock is not needed here because ln_api_lock
+		 * is held */
+		cur = lnet_find_peer_ni_locked(nid);
+		if (cur) {
+			lnet_peer_ni_decref_locked(cur);
+
+			owner = cur->lpni_peer_net->lpn_peer;
+			if (owner == lp)
+				continue;
+			if (owner->lp_multi_rail) {
+				CDEBUG(D_NET, "%s: NID %s owned by peer %s\n",
+				       libcfs_nid2str(lp->lp_primary_nid),
+				       libcfs_nid2str(nid),
+				       libcfs_nid2str(owner->lp_primary_nid));
+				continue;
+			}
+		}
+
+		rc = lnet_peer_setup_hierarchy(lp, cur, nid);
+		if (rc != 0)
+			return rc;
+	}
+
+	lnet_net_lock(LNET_LOCK_EX);
+
+	if (!lnet_peer_dc_nid_listed(info, nnis, lp->lp_primary_nid)) {
+		for (i = 0; i < nnis; i++) {
+			nid = info->pi_ni[i].ns_nid;
+			if (LNET_NETTYP(LNET_NIDNET(nid)) == LOLND)
+				continue;
+			cur = lnet_find_peer_ni_locked(nid);
+			if (!cur)
+				continue;
+			lnet_peer_ni_decref_locked(cur);
+			if (cur->lpni_peer_net->lpn_peer == lp) {
+				lp->lp_primary_nid = nid;
+				/* net rules are keyed by the primary NID */
+				lnet_sel_apply_peer_locked(lp);
+				break;
+			}
+		}
+	}
+
+	/* only prune when the whole NID list fitted in the buffer */
+	if (nnis == info->pi_nnis &&
+	    lnet_peer_dc_nid_listed(info, nnis, lp->lp_primary_nid)) {
+		cur = lnet_get_next_peer_ni_locked(lp, NULL, NULL);
+		while (cur != NULL) {
+			next = lnet_get_next_peer_ni_locked(lp, NULL, cur);
+			if (cur->lpni_rtr_refcount == 0 &&
+			    !lnet_peer_dc_nid_listed(info, nnis,
+						     cur->lpni_nid))
+				lnet_peer_ni_del_locked(cur);
+			cur = next;
+		}
+	}
+
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	CDEBUG(D_NET, "discovered peer %s with %d NIs\n",
+	       libcfs_nid2str(lp->lp_primary_nid), nnis);
+
+	return 0;
+}
+
+/*
+ * ln_api_mutex serialises changes to the peer tables with DLC, but
+ * LNetNIFini() holds it while waiting for this thread to exit.
+ */
+static int
+lnet_peer_dc_api_lock(void)
+{
+	while (!mutex_trylock(&the_lnet.ln_api_mutex)) {
+		if (the_lnet.ln_dc_state != LNET_DC_STATE_RUNNING)
+			return -ESHUTDOWN;
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_timeout(cfs_time_seconds(1) / 10);
+	}
+
+	if (the_lnet.ln_dc_state != LNET_DC_STATE_RUNNING) {
+		mutex_unlock(&the_lnet.ln_api_mutex);
+		return -ESHUTDOWN;
+	}
+	return 0;
+}
+
+static void
+lnet_peer_dc_reply(struct lnet_dc_ping *dp)
+{
+	__u32 features = 0;
+	int rc = dp->dp_status;
+	int nnis = 0;
+
+	if (rc == 0 && !dp->dp_replied)
+		rc = -EIO;
+
+	if (rc == 0) {
+		nnis = lnet_peer_dc_parse(dp);
+		if (nnis < 0)
+			rc = nnis;
+	}
+
+	if (rc == 0) {
+		features = dp->dp_info->pi_features;
+		rc = lnet_peer_dc_api_lock();
+	}
+
+	if (rc == 0) {
+		rc = lnet_peer_dc_merge(dp->dp_lpni, dp->dp_info, nnis);
+		mutex_unlock(&the_lnet.ln_api_mutex);
+	}
+
+	if (rc != 0)
+		CDEBUG(D_NET, "discovery of %s failed: %d\n",
+		       libcfs_nid2str(dp->dp_lpni->lpni_nid), rc);
+
+	lnet_peer_dc_complete(dp->dp_lpni, rc, features);
+	LIBCFS_FREE(dp->dp_info, LNET_DC_INFO_SIZE);
+	LIBCFS_FREE(dp, sizeof(*dp));
+}
+
+/* Send an empty PUT to the ping portal of \a nid, see lnet_push_target_event */
+static void
+lnet_peer_dc_push(lnet_nid_t nid)
+{
+	struct lnet_process_id id;
+	struct lnet_handle_md mdh;
+	struct lnet_md md = { NULL };
+	int rc;
+
+	id.nid = nid;
+	id.pid = LNET_PID_LUSTRE;
+
+	md.start     = NULL;
+	md.length    = 0;
+	md.threshold = 1; /* PUT */
+	md.max_size  = 0;
+	md.options   = 0;
+	md.user_ptr  = NULL;
+	LNetInvalidateEQHandle(&md.eq_handle);
+
+	rc = LNetMDBind(md, LNET_UNLINK, &mdh);
+	if (rc != 0) {
+		CERROR("Can't bind push MD for %s: %d\n",
+		       libcfs_nid2str(nid), rc);
+		return;
+	}
+
+	rc = LNetPut(LNET_NID_ANY, mdh, LNET_NOACK_REQ, id,
+		     LNET_RESERVED_PORTAL, LNET_PROTO_PING_MATCHBITS, 0, 0);
+	if (rc != 0) {
+		CDEBUG(D_NET, "Push to %s failed: %d\n",
+		       libcfs_nid2str(nid), rc);
+		LNetMDUnlink(mdh);
+	}
+}
+
+#define LNET_DC_PUSH_BATCH	16
+
+/* Push to every discovered peer that accepts pushes */
+static void
+lnet_peer_dc_push_all(void)
+{
+	lnet_nid_t nids[LNET_DC_PUSH_BATCH];
+	struct lnet_peer *lp;
+	int count;
+	int cpt;
+	int i;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+	if (!the_lnet.ln_dc_push_all) {
+		spin_unlock(&the_lnet.ln_dc_lock);
+		return;
+	}
+	the_lnet.ln_dc_push_all = false;
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	cpt = lnet_net_lock_current();
+	spin_lock(&the_lnet.ln_dc_lock);
+	list_for_each_entry(lp, &the_lnet.ln_peers, lp_on_lnet_peer_list) {
+		if ((lp->lp_state & (LNET_PEER_DISCOVERED | LNET_PEER_PUSH)) ==
+		    (LNET_PEER_DISCOVERED | LNET_PEER_PUSH))
+			lp->lp_state |= LNET_PEER_PUSH_PENDING;
+	}
+	spin_unlock(&the_lnet.ln_dc_lock);
+	lnet_net_unlock(cpt);
+
+	/* don't hold the locks over LNetPut() */
+	do {
+		count = 0;
+
+		cpt = lnet_net_lock_current();
+		spin_lock(&the_lnet.ln_dc_lock);
+		list_for_each_entry(lp, &the_lnet.ln_peers,
+				    lp_on_lnet_peer_list) {
+			if (!(lp->lp_state & LNET_PEER_PUSH_PENDING))
+				continue;
+			lp->lp_state &= ~LNET_PEER_PUSH_PENDING;
+			nids[count++] = lp->lp_primary_nid;
+			if (count == LNET_DC_PUSH_BATCH)
+				break;
+		}
+		spin_unlock(&the_lnet.ln_dc_lock);
+		lnet_net_unlock(cpt);
+
+		for (i = 0; i < count; i++)
+			lnet_peer_dc_push(nids[i]);
+	} while (count == LNET_DC_PUSH_BATCH &&
+		 the_lnet.ln_dc_state == LNET_DC_STATE_RUNNING);
+}
+
+/*
+ * Forget what was discovered about peers that pushed to us, so the next
+ * message sent to them pings them again.
+ */
+static void
+lnet_peer_dc_handle_pushes(void)
+{
+	lnet_nid_t nids[LNET_DC_PUSH_SLOTS];
+	struct lnet_peer_ni *lpni;
+	struct lnet_peer *lp;
+	bool overflow;
+	int count;
+	int cpt;
+	int i;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+	count = the_lnet.ln_dc_push_count;
+	memcpy(nids, the_lnet.ln_dc_push_nids, count * sizeof(nids[0]));
+	the_lnet.ln_dc_push_count = 0;
+	overflow = the_lnet.ln_dc_push_overflow;
+	the_lnet.ln_dc_push_overflow = false;
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	if (count == 0 && !overflow)
+		return;
+
+	cpt = lnet_net_lock_current();
+
+	if (overflow) {
+		/* too many pushes to tell who sent them, forget them all */
+		spin_lock(&the_lnet.ln_dc_lock);
+		list_for_each_entry(lp, &the_lnet.ln_peers,
+				    lp_on_lnet_peer_list)
+			lp->lp_state &= ~LNET_PEER_DISCOVERED;
+		spin_unlock(&the_lnet.ln_dc_lock);
+		count = 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		CDEBUG(D_NET, "push from %s\n", libcfs_nid2str(nids[i]));
+
+		lpni = lnet_find_peer_ni_locked(nids[i]);
+		if (!lpni)
+			continue;
+
+		spin_lock(&the_lnet.ln_dc_lock);
+		lp = lpni->lpni_peer_net->lpn_peer;
+		lp->lp_state &= ~LNET_PEER_DISCOVERED;
+		spin_unlock(&the_lnet.ln_dc_lock);
+
+		lnet_peer_ni_decref_locked(lpni);
+	}
+
+	lnet_net_unlock(cpt);
+}
+
+/* Unlink the pings that failed, timed out or must stop for shutdown */
+static void
+lnet_peer_dc_check_working(void)
+{
+	struct lnet_dc_ping *dp;
+	time64_t now = ktime_get_seconds();
+
+again:
+	spin_lock(&the_lnet.ln_dc_lock);
+	list_for_each_entry(dp, &the_lnet.ln_dc_working, dp_list) {
+		if (dp->dp_unlinking)
+			continue;
+
+		if (dp->dp_status == 0 && now < dp->dp_deadline &&
+		    the_lnet.ln_dc_state == LNET_DC_STATE_RUNNING)
+			continue;
+
+		if (dp->dp_status == 0 && !dp->dp_replied)
+			dp->dp_status = -ETIMEDOUT;
+		spin_unlock(&the_lnet.ln_dc_lock);
+
+		/* dp is only freed by this thread, so it stays valid */
+		lnet_peer_dc_unlink(dp);
+		goto again;
+	}
+	spin_unlock(&the_lnet.ln_dc_lock);
+}
+
+/* Handle the pings that came back, returns true if ln_dc_working is empty */
+static bool
+lnet_peer_dc_reap(void)
+{
+	struct lnet_dc_ping *dp;
+	bool idle;
+
+	spin_lock(&the_lnet.ln_dc_lock);
+	while (!list_empty(&the_lnet.ln_dc_done)) {
+		dp = list_entry(the_lnet.ln_dc_done.next,
+				struct lnet_dc_ping, dp_list);
+		list_del_init(&dp->dp_list);
+		spin_unlock(&the_lnet.ln_dc_lock);
+
+		lnet_peer_dc_reply(dp);
+
+		spin_lock(&the_lnet.ln_dc_lock);
+	}
+	idle = list_empty(&the_lnet.ln_dc_working);
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	return idle;
+}
+
+static inline bool
+lnet_peer_dc_work_pending(void)
+{
+	return the_lnet.ln_dc_state != LNET_DC_STATE_RUNNING ||
+	       !list_empty(&the_lnet.ln_dc_request) ||
+	       !list_empty(&the_lnet.ln_dc_done) ||
+	       the_lnet.ln_dc_push_all ||
+	       the_lnet.ln_dc_push_count > 0 ||
+	       the_lnet.ln_dc_push_overflow;
+}
+
+static int
+lnet_peer_discovery(void *arg)
+{
+	struct lnet_peer_ni *lpni;
+	struct list_head head;
+	bool idle;
+	int i = 2;
+
+	cfs_block_allsigs();
+
+	while (the_lnet.ln_dc_state == LNET_DC_STATE_RUNNING) {
+		spin_lock(&the_lnet.ln_dc_lock);
+		while (!list_empty(&the_lnet.ln_dc_request)) {
+			lpni = list_entry(the_lnet.ln_dc_request.next,
+					  struct lnet_peer_ni, lpni_dc_list);
+			list_del_init(&lpni->lpni_dc_list);
+			spin_unlock(&the_lnet.ln_dc_lock);
+
+			lnet_peer_dc_ping(lpni);
+
+			spin_lock(&the_lnet.ln_dc_lock);
+		}
+		spin_unlock(&the_lnet.ln_dc_lock);
+
+		lnet_peer_dc_check_working();
+		idle = lnet_peer_dc_reap();
+		lnet_peer_dc_handle_pushes();
+		lnet_peer_dc_push_all();
+
+		/* wake up every second while pings are outstanding to
+		 * time them out */
+		if (idle)
+			wait_event_interruptible(the_lnet.ln_dc_waitq,
+						 lnet_peer_dc_work_pending());
+		else
+			wait_event_interruptible_timeout(the_lnet.ln_dc_waitq,
+						lnet_peer_dc_work_pending(),
+						cfs_time_seconds(1));
+	}
+
+	/* nothing can be queued once the state is not RUNNING */
+	INIT_LIST_HEAD(&head);
+	spin_lock(&the_lnet.ln_dc_lock);
+	list_splice_init(&the_lnet.ln_dc_request, &head);
+	spin_unlock(&the_lnet.ln_dc_lock);
+
+	while (!list_empty(&head)) {
+		lpni = list_entry(head.next, struct lnet_peer_ni,
+				  lpni_dc_list);
+		list_del_init(&lpni->lpni_dc_list);
+		lnet_peer_dc_complete(lpni, -ESHUTDOWN, 0);
+	}
+
+	/* unlink the pings on the wire and wait for them to finish */
+	while (1) {
+		lnet_peer_dc_check_working();
+		if (lnet_peer_dc_reap())
+			break;
+
+		i++;
+		CDEBUG(((i & (-i)) == i) ? D_WARNING : D_NET,
+		       "Waiting for discovery pings to unlink\n");
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_timeout(cfs_time_seconds(1) / 4);
+	}
+
+	the_lnet.ln_dc_state = LNET_DC_STATE_SHUTDOWN;
+	up(&the_lnet.ln_dc_signal);
+	return 0;
+}
+
+static void
+lnet_push_target_fini(void)
+{
+	sigset_t blocked = cfs_block_allsigs();
+	int rc;
+
+	LNetMDUnlink(the_lnet.ln_push_target_md);
+	LNetInvalidateMDHandle(&the_lnet.ln_push_target_md);
+
+	/* NB md could be busy; this just starts the unlink */
+	while (the_lnet.ln_push_target_busy) {
+		CDEBUG(D_NET, "Still waiting for push MD to unlink\n");
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_timeout(cfs_time_seconds(1));
+	}
+
+	cfs_restore_sigs(blocked);
+
+	rc = LNetEQFree(the_lnet.ln_push_target_eq);
+	LASSERT(rc == 0);
+	LNetInvalidateEQHandle(&the_lnet.ln_push_target_eq);
+}
+
+static int
+lnet_push_target_init(void)
+{
+	struct lnet_process_id id = {
+		.nid = LNET_NID_ANY,
+		.pid = LNET_PID_ANY
+	};
+	struct lnet_handle_me me_handle;
+	struct lnet_md md = { NULL };
+	int rc, rc2;
+
+	rc = LNetEQAlloc(0, lnet_push_target_event,
+			 &the_lnet.ln_push_target_eq);
+	if (rc != 0) {
+		CERROR("Can't allocate push EQ: %d\n", rc);
+		return rc;
+	}
+
+	rc = LNetMEAttach(LNET_RESERVED_PORTAL, id,
+			  LNET_PROTO_PING_MATCHBITS, 0,
+			  LNET_UNLINK, LNET_INS_AFTER,
+			  &me_handle);
+	if (rc != 0) {
+		CERROR("Can't create push ME: %d\n", rc);
+		goto failed_0;
+	}
+
+	/* pushes carry no data, only the initiator matters */
+	md.start     = NULL;
+	md.length    = 0;
+	md.threshold = LNET_MD_THRESH_INF;
+	md.max_size  = 0;
+	md.options   = LNET_MD_OP_PUT | LNET_MD_TRUNCATE;
+	md.user_ptr  = NULL;
+	md.eq_handle = the_lnet.ln_push_target_eq;
+
+	the_lnet.ln_push_target_busy = true;
+	rc = LNetMDAttach(me_handle, md, LNET_RETAIN,
+			  &the_lnet.ln_push_target_md);
+	if (rc != 0) {
+		CERROR("Can't attach push MD: %d\n", rc);
+		the_lnet.ln_push_target_busy = false;
+		goto failed_1;
+	}
+
+	return 0;
+
+failed_1:
+	rc2 = LNetMEUnlink(me_handle);
+	LASSERT(rc2 == 0);
+failed_0:
+	LNetEQFree(the_lnet.ln_push_target_eq);
+	LNetInvalidateEQHandle(&the_lnet.ln_push_target_eq);
+	return rc;
+}
+
+int
+lnet_peer_discovery_start(void)
+{
+	struct task_struct *task;
+	int rc;
+
+	LASSERT(the_lnet.ln_dc_state == LNET_DC_STATE_SHUTDOWN);
+
+	sema_init(&the_lnet.ln_dc_signal, 0);
+	the_lnet.ln_dc_push_all = false;
+	the_lnet.ln_dc_push_count = 0;
+	the_lnet.ln_dc_push_overflow = false;
+
+	rc = LNetEQAlloc(0, lnet_peer_dc_event, &the_lnet.ln_dc_eqh);
+	if (rc != 0) {
+		CERROR("Can't allocate discovery EQ: %d\n", rc);
+		return rc;
+	}
+
+	rc = lnet_push_target_init();
+	if (rc != 0)
+		goto failed;
+
+	the_lnet.ln_dc_state = LNET_DC_STATE_RUNNING;
+	task = kthread_run(lnet_peer_discovery, NULL, "lnet_discovery");
+	if (IS_ERR(task)) {
+		rc = PTR_ERR(task);
+		CERROR("Can't start peer discovery thread: %d\n", rc);
+		the_lnet.ln_dc_state = LNET_DC_STATE_SHUTDOWN;
+		lnet_push_target_fini();
+		goto failed;
+	}
+
+	return 0;
+
+failed:
+	LNetEQFree(the_lnet.ln_dc_eqh);
+	LNetInvalidateEQHandle(&the_lnet.ln_dc_eqh);
+	return rc;
+}
+
+void
+lnet_peer_discovery_stop(void)
+{
+	int rc;
+
+	if (the_lnet.ln_dc_state == LNET_DC_STATE_SHUTDOWN)
+		return;
+
+	LASSERT(the_lnet.ln_dc_state == LNET_DC_STATE_RUNNING);
+	spin_lock(&the_lnet.ln_dc_lock);
+	the_lnet.ln_dc_state = LNET_DC_STATE_STOPPING;
+	spin_unlock(&the_lnet.ln_dc_lock);
+	/* wakeup the discovery thread if it's sleeping */
+	wake_up(&the_lnet.ln_dc_waitq);
+
+	/* block until the thread signals exit */
+	down(&the_lnet.ln_dc_signal);
+	LASSERT(the_lnet.ln_dc_state == LNET_DC_STATE_SHUTDOWN);
+
+	lnet_push_target_fini();
+
+	rc = LNetEQFree(the_lnet.ln_dc_eqh);
+	LASSERT(rc == 0);
+	LNetInvalidateEQHandle(&the_lnet.ln_dc_eqh);
+}
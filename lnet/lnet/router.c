@@ -32,6 +32,8 @@
 #define LNET_NRB_LARGE		(LNET_NRB_LARGE_MIN * 4)
 #define LNET_NRB_LARGE_PAGES	((LNET_MTU + PAGE_SIZE - 1) >> \
 				  PAGE_SHIFT)
+/* seconds between two auto-sizing passes over the router buffer pools */
+#define LNET_NRB_AUTO_INTERVAL	10
 
 static char *forwarding = "";
 module_param(forwarding, charp, 0444);
@@ -46,6 +48,12 @@ MODULE_PARM_DESC(small_router_buffers, "# of small (1 page) messages to buffer i
 static int large_router_buffers;
 module_param(large_router_buffers, int, 0444);
 MODULE_PARM_DESC(large_router_buffers, "# of large messages to buffer in the router");
+static int router_buffers_auto = 1;
+module_param(router_buffers_auto, int, 0644);
+MODULE_PARM_DESC(router_buffers_auto, "Size router buffer pools not set explicitly from demand");
+static int router_buffers_max_mb;
+module_param(router_buffers_max_mb, int, 0644);
+MODULE_PARM_DESC(router_buffers_max_mb, "Memory limit for growing router buffer pools in MB (0 for 1/8 of RAM)");
 static int peer_buffer_credits;
 module_param(peer_buffer_credits, int, 0444);
 MODULE_PARM_DESC(peer_buffer_credits, "# router buffer credits per peer");
@@ -70,6 +78,7 @@ lnet_peer_buffer_credits(struct lnet_net *net)
 
 /* forward ref's */
 static int lnet_router_checker(void *);
+static void lnet_rtrpools_autosize(void);
 
 static int check_routers_before_use;
 module_param(check_routers_before_use, int, 0444);
@@ -1276,6 +1285,7 @@ lnet_router_checker(void *arg)
 {
 	struct lnet_peer_ni *rtr;
 	struct list_head *entry;
+	cfs_time_t autosize_time = cfs_time_shift(LNET_NRB_AUTO_INTERVAL);
 
 	cfs_block_allsigs();
 
@@ -1284,6 +1294,11 @@ lnet_router_checker(void *arg)
 		int	cpt;
 		int	cpt2;
 
+		if (cfs_time_aftereq(cfs_time_current(), autosize_time)) {
+			lnet_rtrpools_autosize();
+			autosize_time = cfs_time_shift(LNET_NRB_AUTO_INTERVAL);
+		}
+
 		cpt = lnet_net_lock_current();
 rescan:
 		version = the_lnet.ln_routers_version;
@@ -1405,6 +1420,7 @@ lnet_rtrpool_free_bufs(struct lnet_rtrbufpool *rbp, int cpt)
 	rbp->rbp_req_nbuffers = 0;
 	rbp->rbp_nbuffers = rbp->rbp_credits = 0;
 	rbp->rbp_mincredits = 0;
+	rbp->rbp_win_mincredits = 0;
 	lnet_net_unlock(cpt);
 
 	/* Free buffers on the free list. */
@@ -1436,7 +1452,29 @@ lnet_rtrpool_adjust_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
 	num_rb = nbufs - rbp->rbp_nbuffers;
 	if (nbufs <= rbp->rbp_req_nbuffers || num_rb <= 0) {
 		rbp->rbp_req_nbuffers = nbufs;
+
+		/* Free buffers above the new size are released now, so an
+		 * idle pool really shrinks. */
+		INIT_LIST_HEAD(&rb_list);
+		while (rbp->rbp_nbuffers > nbufs && rbp->rbp_credits > 0) {
+			rb = list_entry(rbp->rbp_bufs.next,
+					struct lnet_rtrbuf, rb_list);
+			list_move(&rb->rb_list, &rb_list);
+			rbp->rbp_nbuffers--;
+			rbp->rbp_credits--;
+		}
+		rbp->rbp_mincredits = min(rbp->rbp_mincredits,
+					  rbp->rbp_credits);
+		rbp->rbp_win_mincredits = min(rbp->rbp_win_mincredits,
+					      rbp->rbp_credits);
 		lnet_net_unlock(cpt);
+
+		while (!list_empty(&rb_list)) {
+			rb = list_entry(rb_list.next, struct lnet_rtrbuf,
+					rb_list);
+			list_del(&rb->rb_list);
+			lnet_destroy_rtrbuf(rb, npages);
+		}
 		return 0;
 	}
 	/* store the older value of rbp_req_nbuffers and then set it to
@@ -1474,6 +1512,7 @@ lnet_rtrpool_adjust_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
 	rbp->rbp_nbuffers += num_buffers;
 	rbp->rbp_credits += num_buffers;
 	rbp->rbp_mincredits = rbp->rbp_credits;
+	rbp->rbp_win_mincredits = rbp->rbp_credits;
 	/* We need to schedule blocked msg using the newly
 	 * added buffers. */
 	while (!list_empty(&rbp->rbp_bufs) &&
@@ -1494,6 +1533,123 @@ failed:
 	return -ENOMEM;
 }
 
+/* is the size of pool \a idx left to lnet_rtrpools_autosize()? */
+static bool
+lnet_rtrpool_is_auto(int idx)
+{
+	if (!router_buffers_auto)
+		return false;
+
+	switch (idx) {
+	case LNET_TINY_BUF_IDX:
+		return tiny_router_buffers == 0;
+	case LNET_SMALL_BUF_IDX:
+		return small_router_buffers == 0;
+	default:
+		return large_router_buffers == 0;
+	}
+}
+
+/**
+ * Resizes \a rbp from the lowest number of credits it had since the last
+ * pass. Messages that had to wait for a buffer make the pool grow by the
+ * deficit, and by at least a quarter, as long as the pages of all pools
+ * stay within \a limit. A pool that kept over half of its buffers idle
+ * the whole time gives back half of the idle ones, down to \a nmin.
+ */
+static void
+lnet_rtrpool_autosize(struct lnet_rtrbufpool *rbp, int nmin, int cpt,
+		      long limit, long *used)
+{
+	long	room;
+	int	nbufs;
+	int	low;
+	int	want;
+	int	rc;
+
+	lnet_net_lock(cpt);
+	nbufs = rbp->rbp_req_nbuffers;
+	low = rbp->rbp_win_mincredits;
+	rbp->rbp_win_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	if (low < 0) {
+		want = nbufs + max(-low, nbufs / 4);
+		if (rbp->rbp_npages > 0) {
+			room = max(0L, (limit - *used) / rbp->rbp_npages);
+			want = min_t(long, want, nbufs + room);
+		}
+	} else if (low > nbufs / 2) {
+		want = max(nbufs - low / 2, nmin);
+	} else {
+		return;
+	}
+
+	if (want == nbufs)
+		return;
+
+	rc = lnet_rtrpool_adjust_bufs(rbp, want, cpt);
+	if (rc != 0)
+		return;
+
+	CDEBUG(D_NET, "CPT %d: %d-page router buffers %d -> %d (low %d)\n",
+	       cpt, rbp->rbp_npages, nbufs, want, low);
+
+	*used += (long)(want - nbufs) * rbp->rbp_npages;
+	if (want > nbufs)
+		rbp->rbp_ngrown++;
+	else
+		rbp->rbp_nshrunk++;
+}
+
+/* called by the router checker, every LNET_NRB_AUTO_INTERVAL seconds */
+static void
+lnet_rtrpools_autosize(void)
+{
+	static const int	nmin[LNET_NRBPOOLS] = {
+		[LNET_TINY_BUF_IDX]	= LNET_NRB_TINY_MIN,
+		[LNET_SMALL_BUF_IDX]	= LNET_NRB_SMALL_MIN,
+		[LNET_LARGE_BUF_IDX]	= LNET_NRB_LARGE_MIN,
+	};
+	struct lnet_rtrbufpool	*rtrp;
+	long			limit;
+	long			used = 0;
+	int			idx;
+	int			i;
+
+	if (!router_buffers_auto || !the_lnet.ln_routing)
+		return;
+
+	/* don't race with the pools being reconfigured or freed; NB LNet
+	 * shutdown holds ln_api_mutex while waiting for this thread */
+	if (!mutex_trylock(&the_lnet.ln_api_mutex))
+		return;
+
+	if (!the_lnet.ln_routing || the_lnet.ln_rtrpools == NULL)
+		goto out;
+
+	if (router_buffers_max_mb > 0)
+		limit = (long)router_buffers_max_mb << (20 - PAGE_SHIFT);
+	else
+		limit = totalram_pages / 8;
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (idx = 0; idx < LNET_NRBPOOLS; idx++)
+			used += (long)rtrp[idx].rbp_nbuffers *
+				rtrp[idx].rbp_npages;
+	}
+
+	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
+		for (idx = 0; idx < LNET_NRBPOOLS; idx++) {
+			if (lnet_rtrpool_is_auto(idx))
+				lnet_rtrpool_autosize(&rtrp[idx], nmin[idx], i,
+						      limit, &used);
+		}
+	}
+ out:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+}
+
 static void
 lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 {
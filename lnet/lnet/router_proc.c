@@ -604,8 +604,8 @@ static int __proc_lnet_buffers(void *data, int write,
 
 	LASSERT(!write);
 
-	/* (4 %d) * 4 * LNET_CPT_NUMBER */
-	tmpsiz = 64 * (LNET_NRBPOOLS + 1) * LNET_CPT_NUMBER;
+	/* (4 %d, %llu, 2 %u) * 4 * LNET_CPT_NUMBER */
+	tmpsiz = 96 * (LNET_NRBPOOLS + 1) * LNET_CPT_NUMBER;
 	LIBCFS_ALLOC(tmpstr, tmpsiz);
 	if (tmpstr == NULL)
 		return -ENOMEM;
@@ -613,8 +613,9 @@ static int __proc_lnet_buffers(void *data, int write,
 	s = tmpstr; /* points to current position in tmpstr[] */
 
 	s += snprintf(s, tmpstr + tmpsiz - s,
-		      "%5s %5s %7s %7s\n",
-		      "pages", "count", "credits", "min");
+		      "%5s %5s %7s %7s %10s %6s %6s\n",
+		      "pages", "count", "credits", "min",
+		      "blocked", "grown", "shrunk");
 	LASSERT(tmpstr + tmpsiz - s > 0);
 
 	if (the_lnet.ln_rtrpools == NULL)
@@ -626,11 +627,14 @@ static int __proc_lnet_buffers(void *data, int write,
 		lnet_net_lock(LNET_LOCK_EX);
 		cfs_percpt_for_each(rbp, i, the_lnet.ln_rtrpools) {
 			s += snprintf(s, tmpstr + tmpsiz - s,
-				      "%5d %5d %7d %7d\n",
+				      "%5d %5d %7d %7d %10llu %6u %6u\n",
 				      rbp[idx].rbp_npages,
 				      rbp[idx].rbp_nbuffers,
 				      rbp[idx].rbp_credits,
-				      rbp[idx].rbp_mincredits);
+				      rbp[idx].rbp_mincredits,
+				      rbp[idx].rbp_nblocked,
+				      rbp[idx].rbp_ngrown,
+				      rbp[idx].rbp_nshrunk);
 			LASSERT(tmpstr + tmpsiz - s > 0);
 		}
 		lnet_net_unlock(LNET_LOCK_EX);
@@ -657,6 +661,77 @@ proc_lnet_buffers(struct ctl_table *table, int write, void __user *buffer,
 				    __proc_lnet_buffers);
 }
 
+static int __proc_lnet_descriptors(void *data, int write,
+				   loff_t pos, void __user *buffer, int nob)
+{
+	static const char *names[LNET_DESC_NTYPES] = {
+		[LNET_DESC_MSG]	= "msg",
+		[LNET_DESC_MD]	= "md",
+		[LNET_DESC_ME]	= "me",
+	};
+	struct lnet_desc_cache	*dcs;
+	char			*s;
+	char			*tmpstr;
+	int			tmpsiz;
+	int			type;
+	int			len;
+	int			rc;
+	int			i;
+
+	LASSERT(!write);
+
+	tmpsiz = 64 * (LNET_DESC_NTYPES * LNET_CPT_NUMBER + 1);
+	LIBCFS_ALLOC(tmpstr, tmpsiz);
+	if (tmpstr == NULL)
+		return -ENOMEM;
+
+	s = tmpstr; /* points to current position in tmpstr[] */
+
+	s += snprintf(s, tmpstr + tmpsiz - s,
+		      "%3s %4s %6s %12s %12s %12s\n",
+		      "cpt", "type", "cached", "allocs", "hits", "frees");
+	LASSERT(tmpstr + tmpsiz - s > 0);
+
+	/* ln_api_mutex keeps LNet from shutting down under us */
+	mutex_lock(&the_lnet.ln_api_mutex);
+	if (the_lnet.ln_desc_caches == NULL)
+		goto out_unlock;
+
+	cfs_percpt_for_each(dcs, i, the_lnet.ln_desc_caches) {
+		for (type = 0; type < LNET_DESC_NTYPES; type++) {
+			spin_lock(&dcs[type].dc_lock);
+			s += snprintf(s, tmpstr + tmpsiz - s,
+				      "%3d %4s %6u %12llu %12llu %12llu\n",
+				      i, names[type], dcs[type].dc_nfree,
+				      dcs[type].dc_nalloc, dcs[type].dc_nhit,
+				      dcs[type].dc_nrelease);
+			spin_unlock(&dcs[type].dc_lock);
+			LASSERT(tmpstr + tmpsiz - s > 0);
+		}
+	}
+
+ out_unlock:
+	mutex_unlock(&the_lnet.ln_api_mutex);
+	len = s - tmpstr;
+
+	if (pos >= min_t(int, len, strlen(tmpstr)))
+		rc = 0;
+	else
+		rc = cfs_trace_copyout_string(buffer, nob,
+					      tmpstr + pos, NULL);
+
+	LIBCFS_FREE(tmpstr, tmpsiz);
+	return rc;
+}
+
+static int
+proc_lnet_descriptors(struct ctl_table *table, int write,
+		      void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	return lprocfs_call_handler(table->data, write, ppos, buffer, lenp,
+				    __proc_lnet_descriptors);
+}
+
 static int
 proc_lnet_nis(struct ctl_table *table, int write, void __user *buffer,
 	      size_t *lenp, loff_t *ppos)
@@ -940,6 +1015,12 @@ static struct ctl_table lnet_table[] = {
 		.mode		= 0444,
 		.proc_handler	= &proc_lnet_buffers,
 	},
+	{
+		INIT_CTL_NAME
+		.procname	= "descriptors",
+		.mode		= 0444,
+		.proc_handler	= &proc_lnet_descriptors,
+	},
 	{
 		INIT_CTL_NAME
 		.procname	= "nis",
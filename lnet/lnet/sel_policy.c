@@ -0,0 +1,225 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lnet/lnet/sel_policy.c
+ *
+ * User-defined NI/peer selection rules.
+ *
+ * A rule gives a priority to the local NIs, peer NIs, peer networks or
+ * gateways whose NID matches it; the first matching rule wins. Priorities
+ * are worked out when a rule or an object is added and cached in the
+ * object, so lnet_select_pathway() only compares integers.
+ *
+ * The rule list is changed with both ln_api_mutex and the exclusive
+ * lnet_net_lock held, so holding either is enough to walk it.
+ */
+
+#define DEBUG_SUBSYSTEM S_LNET
+
+#include <lnet/lib-lnet.h>
+
+static bool
+lnet_sel_nid_match(lnet_nid_t pattern, lnet_nid_t nid)
+{
+	if (pattern == nid || pattern == LNET_NID_ANY)
+		return true;
+
+	if (LNET_NIDNET(pattern) != LNET_NIDNET(nid))
+		return false;
+
+	/* 255.255.255.255@net is wildcard for all addresses in a network */
+	return LNET_NIDADDR(pattern) == LNET_NIDADDR(LNET_NID_ANY);
+}
+
+/**
+ * Priority of the first rule of \a type matching \a nid, or
+ * LNET_SEL_PRIO_DEFAULT. For LNET_SEL_RULE_NET rules \a nid is the
+ * primary NID of the peer and \a net the peer network.
+ */
+__u32
+lnet_sel_priority(__u32 type, __u32 net, lnet_nid_t nid)
+{
+	struct lnet_sel_rule *rule;
+
+	list_for_each_entry(rule, &the_lnet.ln_sel_rules, sr_list) {
+		if (rule->sr_type != type)
+			continue;
+		if (type == LNET_SEL_RULE_NET && rule->sr_net != net)
+			continue;
+		if (lnet_sel_nid_match(rule->sr_nid, nid))
+			return rule->sr_priority;
+	}
+
+	return LNET_SEL_PRIO_DEFAULT;
+}
+
+/* called with lnet_net_lock LNET_LOCK_EX held */
+void
+lnet_sel_apply_peer_locked(struct lnet_peer *lp)
+{
+	struct lnet_peer_net *lpn;
+	struct lnet_peer_ni *lpni;
+
+	list_for_each_entry(lpn, &lp->lp_peer_nets, lpn_on_peer_list) {
+		lpn->lpn_sel_priority =
+			lnet_sel_priority(LNET_SEL_RULE_NET, lpn->lpn_net_id,
+					  lp->lp_primary_nid);
+
+		list_for_each_entry(lpni, &lpn->lpn_peer_nis,
+				    lpni_on_peer_net_list) {
+			lpni->lpni_sel_priority =
+				lnet_sel_priority(LNET_SEL_RULE_PEER_NI, 0,
+						  lpni->lpni_nid);
+			lpni->lpni_gw_sel_priority =
+				lnet_sel_priority(LNET_SEL_RULE_ROUTER, 0,
+						  lpni->lpni_nid);
+		}
+	}
+}
+
+/* called with lnet_net_lock LNET_LOCK_EX held */
+static void
+lnet_sel_apply_locked(void)
+{
+	struct lnet_net *net;
+	struct lnet_ni *ni;
+	struct lnet_peer *lp;
+
+	list_for_each_entry(net, &the_lnet.ln_nets, net_list) {
+		list_for_each_entry(ni, &net->net_ni_list, ni_netlist)
+			ni->ni_sel_priority =
+				lnet_sel_priority(LNET_SEL_RULE_LOCAL_NI, 0,
+						  ni->ni_nid);
+	}
+
+	list_for_each_entry(lp, &the_lnet.ln_peers, lp_on_lnet_peer_list)
+		lnet_sel_apply_peer_locked(lp);
+}
+
+/* called with ln_api_mutex held */
+int
+lnet_sel_rule_add(struct lnet_ioctl_sel_rule *cfg)
+{
+	struct lnet_sel_rule *rule;
+
+	if (cfg->sr_type > LNET_SEL_RULE_MAX)
+		return -EINVAL;
+
+	if (cfg->sr_type == LNET_SEL_RULE_NET &&
+	    cfg->sr_net == LNET_NIDNET(LNET_NID_ANY))
+		return -EINVAL;
+
+	/* reserved for NIs and peer NIs no rule matches */
+	if (cfg->sr_priority >= LNET_SEL_PRIO_DEFAULT)
+		return -EINVAL;
+
+	LIBCFS_ALLOC(rule, sizeof(*rule));
+	if (rule == NULL)
+		return -ENOMEM;
+
+	rule->sr_type = cfg->sr_type;
+	rule->sr_priority = cfg->sr_priority;
+	rule->sr_net = cfg->sr_net;
+	rule->sr_nid = cfg->sr_nid;
+
+	lnet_net_lock(LNET_LOCK_EX);
+	list_add_tail(&rule->sr_list, &the_lnet.ln_sel_rules);
+	lnet_sel_apply_locked();
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	CDEBUG(D_NET, "added selection rule type %u %s net %s priority %u\n",
+	       rule->sr_type, libcfs_nid2str(rule->sr_nid),
+	       libcfs_net2str(rule->sr_net), rule->sr_priority);
+
+	return 0;
+}
+
+/* called with ln_api_mutex held */
+int
+lnet_sel_rule_del(__u32 idx)
+{
+	struct lnet_sel_rule *rule;
+	struct lnet_sel_rule *tmp;
+	struct list_head zombies;
+	__u32 i = 0;
+
+	INIT_LIST_HEAD(&zombies);
+
+	lnet_net_lock(LNET_LOCK_EX);
+	list_for_each_entry_safe(rule, tmp, &the_lnet.ln_sel_rules, sr_list) {
+		if (idx == LNET_SEL_RULE_IDX_ALL || idx == i)
+			list_move(&rule->sr_list, &zombies);
+		i++;
+	}
+	if (!list_empty(&zombies))
+		lnet_sel_apply_locked();
+	lnet_net_unlock(LNET_LOCK_EX);
+
+	if (list_empty(&zombies))
+		return idx == LNET_SEL_RULE_IDX_ALL ? 0 : -ENOENT;
+
+	while (!list_empty(&zombies)) {
+		rule = list_entry(zombies.next, struct lnet_sel_rule, sr_list);
+		list_del(&rule->sr_list);
+		LIBCFS_FREE(rule, sizeof(*rule));
+	}
+
+	return 0;
+}
+
+/* called with ln_api_mutex held */
+int
+lnet_sel_rule_get(struct lnet_ioctl_sel_rule *cfg)
+{
+	struct lnet_sel_rule *rule;
+	__u32 i = 0;
+
+	list_for_each_entry(rule, &the_lnet.ln_sel_rules, sr_list) {
+		if (i++ != cfg->sr_idx)
+			continue;
+
+		cfg->sr_type = rule->sr_type;
+		cfg->sr_priority = rule->sr_priority;
+		cfg->sr_net = rule->sr_net;
+		cfg->sr_nid = rule->sr_nid;
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+/* rules go away with the networks, like routes do */
+void
+lnet_sel_rules_cleanup(void)
+{
+	struct lnet_sel_rule *rule;
+
+	while (!list_empty(&the_lnet.ln_sel_rules)) {
+		rule = list_entry(the_lnet.ln_sel_rules.next,
+				  struct lnet_sel_rule, sr_list);
+		list_del(&rule->sr_list);
+		LIBCFS_FREE(rule, sizeof(*rule));
+	}
+}
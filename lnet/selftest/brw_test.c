@@ -362,6 +362,8 @@ brw_client_done_rpc(sfw_test_unit_t *tsu, srpc_client_rpc_t *rpc)
 		return;
 	}
 
+	sfw_lat_record(sn->sn_brw_lat, rpc);
+
 	if (reqst->brw_rw == LST_BRW_WRITE)
 		return;
 
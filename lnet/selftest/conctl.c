@@ -663,10 +663,18 @@ lst_batch_info_ioctl(struct lstio_batch_info_args *args)
 }
 
 static int
-lst_stat_query_ioctl(struct lstio_stat_args *args)
+lst_stat_query_ioctl(struct lstio_stat_args *args, int len)
 {
         int             rc;
 	char           *name = NULL;
+	int		type = LST_STAT_COUNTERS;
+
+	/* tools built before lstio_sta_type pass the shorter struct and
+	 * only know about counters */
+	if (len < offsetof(struct lstio_stat_args, lstio_sta_type))
+		return -EINVAL;
+	if (len >= sizeof(*args))
+		type = args->lstio_sta_type;
 
         /* TODO: not finished */
         if (args->lstio_sta_key != console_session.ses_key)
@@ -681,6 +689,7 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 
 		rc = lstcon_nodes_stat(args->lstio_sta_count,
                                        args->lstio_sta_idsp,
+				       type,
                                        args->lstio_sta_timeout,
                                        args->lstio_sta_resultp);
 	} else if (args->lstio_sta_namep != NULL) {
@@ -695,7 +704,8 @@ lst_stat_query_ioctl(struct lstio_stat_args *args)
 		rc = copy_from_user(name, args->lstio_sta_namep,
 				    args->lstio_sta_nmlen);
 		if (rc == 0)
-			rc = lstcon_group_stat(name, args->lstio_sta_timeout,
+			rc = lstcon_group_stat(name, type,
+					       args->lstio_sta_timeout,
 					       args->lstio_sta_resultp);
 		else
 			rc = -EFAULT;
@@ -906,7 +916,8 @@ lstcon_ioctl_entry(unsigned int cmd, struct libcfs_ioctl_hdr *hdr)
 		rc = lst_test_add_ioctl((struct lstio_test_args *)buf);
 		break;
 	case LSTIO_STAT_QUERY:
-		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf);
+		rc = lst_stat_query_ioctl((struct lstio_stat_args *)buf,
+					  data->ioc_plen1);
 		break;
 	default:
 		rc = -EINVAL;
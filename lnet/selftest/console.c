@@ -1488,17 +1488,52 @@ lstcon_statrpc_readent(int transop, srpc_msg_t *msg,
 }
 
 static int
-lstcon_ndlist_stat(struct list_head *ndlist,
+lstcon_latrpc_readent(int transop, srpc_msg_t *msg,
+		      struct lstcon_rpc_ent __user *ent_up)
+{
+	srpc_lat_reply_t *rep = &msg->msg_body.lat_reply;
+	__u32		  hist[LST_LAT_BUCKETS];
+	int		  i;
+
+	if (rep->lat_status != 0)
+		return 0;
+
+	if (rep->lat_first > LST_LAT_BUCKETS - SRPC_LAT_WIRE_BUCKETS)
+		return -EPROTO;
+
+	memset(hist, 0, sizeof(hist));
+	for (i = 0; i < SRPC_LAT_WIRE_BUCKETS; i++)
+		hist[rep->lat_first + i] = rep->lat_buckets[i];
+
+	if (copy_to_user(&ent_up->rpe_payload[0], hist, sizeof(hist)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int
+lstcon_ndlist_stat(struct list_head *ndlist, int type,
 		   int timeout, struct list_head __user *result_up)
 {
 	struct list_head    head;
 	lstcon_rpc_trans_t *trans;
+	int		    transop = LST_TRANS_STATQRY;
 	int		    rc;
 
+	if (type != LST_STAT_COUNTERS) {
+		if ((console_session.ses_features & LST_FEAT_LAT_HIST) == 0)
+			return -EOPNOTSUPP;
+
+		if (type != LST_STAT_LAT_BRW && type != LST_STAT_LAT_PING)
+			return -EINVAL;
+
+		transop = LST_TRANS_LATQRY;
+	}
+
 	INIT_LIST_HEAD(&head);
 
-        rc = lstcon_rpc_trans_ndlist(ndlist, &head,
-                                     LST_TRANS_STATQRY, NULL, NULL, &trans);
+	rc = lstcon_rpc_trans_ndlist(ndlist, &head,
+				     transop, &type, NULL, &trans);
         if (rc != 0) {
                 CERROR("Can't create transaction: %d\n", rc);
                 return rc;
@@ -1506,15 +1541,17 @@ lstcon_ndlist_stat(struct list_head *ndlist,
 
         lstcon_rpc_trans_postwait(trans, LST_VALIDATE_TIMEOUT(timeout));
 
-        rc = lstcon_rpc_trans_interpreter(trans, result_up,
-                                          lstcon_statrpc_readent);
+	rc = lstcon_rpc_trans_interpreter(trans, result_up,
+					  transop == LST_TRANS_STATQRY ?
+					  lstcon_statrpc_readent :
+					  lstcon_latrpc_readent);
         lstcon_rpc_trans_destroy(trans);
 
         return rc;
 }
 
 int
-lstcon_group_stat(char *grp_name, int timeout,
+lstcon_group_stat(char *grp_name, int type, int timeout,
 		  struct list_head __user *result_up)
 {
         lstcon_group_t     *grp;
@@ -1526,7 +1563,7 @@ lstcon_group_stat(char *grp_name, int timeout,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&grp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&grp->grp_ndl_list, type, timeout, result_up);
 
 	lstcon_group_decref(grp);
 
@@ -1535,7 +1572,7 @@ lstcon_group_stat(char *grp_name, int timeout,
 
 int
 lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
-		  int timeout, struct list_head __user *result_up)
+		  int type, int timeout, struct list_head __user *result_up)
 {
         lstcon_ndlink_t         *ndl;
         lstcon_group_t          *tmp;
@@ -1570,7 +1607,7 @@ lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, type, timeout, result_up);
 
 	lstcon_group_decref(tmp);
 
@@ -409,6 +409,80 @@ sfw_get_stats (srpc_stat_reqst_t *request, srpc_stat_reply_t *reply)
 	return 0;
 }
 
+static int
+sfw_lat_bucket(s64 usec)
+{
+	int msb;
+
+	if (usec < 2)
+		return usec < 0 ? 0 : usec;
+
+	msb = fls64(usec) - 1;
+	return min(2 * msb + (int)((usec >> (msb - 1)) & 1),
+		   LST_LAT_BUCKETS - 1);
+}
+
+void
+sfw_lat_record(atomic_t *hist, srpc_client_rpc_t *rpc)
+{
+	s64 usec = ktime_us_delta(ktime_get(), rpc->crpc_start);
+
+	atomic_inc(&hist[sfw_lat_bucket(usec)]);
+}
+
+static int
+sfw_get_latency(srpc_lat_reqst_t *request, srpc_lat_reply_t *reply)
+{
+	sfw_session_t	*sn = sfw_data.fw_session;
+	atomic_t	*hist;
+	__u32		 counts[LST_LAT_BUCKETS];
+	int		 first = 0;
+	int		 last = 0;
+	int		 i;
+
+	reply->lat_sid = (sn == NULL) ? LST_INVALID_SID : sn->sn_id;
+
+	if (request->lat_sid.ses_nid == LNET_NID_ANY) {
+		reply->lat_status = EINVAL;
+		return 0;
+	}
+
+	if (sn == NULL || !sfw_sid_equal(request->lat_sid, sn->sn_id)) {
+		reply->lat_status = ESRCH;
+		return 0;
+	}
+
+	switch (request->lat_type) {
+	case LST_STAT_LAT_BRW:
+		hist = sn->sn_brw_lat;
+		break;
+	case LST_STAT_LAT_PING:
+		hist = sn->sn_ping_lat;
+		break;
+	default:
+		reply->lat_status = EINVAL;
+		return 0;
+	}
+
+	for (i = 0; i < LST_LAT_BUCKETS; i++) {
+		counts[i] = atomic_read(&hist[i]);
+		if (counts[i] != 0)
+			last = i;
+	}
+
+	/* keep the tail, fold anything further below into the first bucket */
+	if (last >= SRPC_LAT_WIRE_BUCKETS)
+		first = last - SRPC_LAT_WIRE_BUCKETS + 1;
+
+	memset(reply->lat_buckets, 0, sizeof(reply->lat_buckets));
+	for (i = 0; i < LST_LAT_BUCKETS; i++)
+		reply->lat_buckets[max(i, first) - first] += counts[i];
+
+	reply->lat_first  = first;
+	reply->lat_status = 0;
+	return 0;
+}
+
 int
 sfw_make_session(srpc_mksn_reqst_t *request, srpc_mksn_reply_t *reply)
 {
@@ -1310,6 +1384,11 @@ sfw_handle_server_rpc(struct srpc_server_rpc *rpc)
                                    &reply->msg_body.stat_reply);
                 break;
 
+        case SRPC_SERVICE_QUERY_LAT:
+                rc = sfw_get_latency(&request->msg_body.lat_reqst,
+                                     &reply->msg_body.lat_reply);
+                break;
+
         case SRPC_SERVICE_DEBUG:
                 rc = sfw_debug_session(&request->msg_body.dbg_reqst,
                                        &reply->msg_body.dbg_reply);
@@ -1455,6 +1534,27 @@ sfw_unpack_message (srpc_msg_t *msg)
                 return;
         }
 
+        if (msg->msg_type == SRPC_MSG_LAT_REQST) {
+                srpc_lat_reqst_t *req = &msg->msg_body.lat_reqst;
+
+                __swab32s(&req->lat_type);
+                __swab64s(&req->lat_rpyid);
+                sfw_unpack_sid(req->lat_sid);
+                return;
+        }
+
+        if (msg->msg_type == SRPC_MSG_LAT_REPLY) {
+                srpc_lat_reply_t *rep = &msg->msg_body.lat_reply;
+                int               i;
+
+                __swab32s(&rep->lat_status);
+                __swab32s(&rep->lat_first);
+                sfw_unpack_sid(rep->lat_sid);
+                for (i = 0; i < SRPC_LAT_WIRE_BUCKETS; i++)
+                        __swab32s(&rep->lat_buckets[i]);
+                return;
+        }
+
         if (msg->msg_type == SRPC_MSG_MKSN_REQST) {
                 srpc_mksn_reqst_t *req = &msg->msg_body.mksn_reqst;
 
@@ -1611,6 +1711,11 @@ static srpc_service_t sfw_services[] =
                 /* sv_name */  "query stats",
                 0
         },
+        {
+                /* sv_id */    SRPC_SERVICE_QUERY_LAT,
+                /* sv_name */  "query latency",
+                0
+        },
         {
                 /* sv_id */    SRPC_SERVICE_MAKE_SESSION,
                 /* sv_name */  "make session",
@@ -93,6 +93,7 @@ lnet_selftest_structure_assertion(void)
         CLASSERT(offsetof(srpc_msg_t, msg_body.tes_reqst.tsr_ndest) == 78);
         CLASSERT(sizeof(srpc_stat_reply_t) == 136);
         CLASSERT(sizeof(srpc_stat_reqst_t) == 28);
+        CLASSERT(sizeof(srpc_lat_reply_t) == 136);
 }
 
 static int __init
@@ -157,6 +157,8 @@ ping_client_done_rpc (sfw_test_unit_t *tsu, srpc_client_rpc_t *rpc)
                 return;
         }
 
+	sfw_lat_record(sn->sn_ping_lat, rpc);
+
 	ktime_get_real_ts64(&ts);
 	CDEBUG(D_NET, "%d reply in %llu nsec\n", reply->pnr_seq,
 	       (u64)((ts.tv_sec - reqst->pnr_time_sec) * NSEC_PER_SEC +
@@ -59,6 +59,8 @@ typedef enum {
         SRPC_MSG_PING_REPLY     = 15,
         SRPC_MSG_JOIN_REQST     = 16,
         SRPC_MSG_JOIN_REPLY     = 17,
+        SRPC_MSG_LAT_REQST      = 18,
+        SRPC_MSG_LAT_REPLY      = 19,
 } srpc_msg_type_t;
 
 /* CAVEAT EMPTOR:
@@ -164,6 +166,25 @@ typedef struct {
 	struct lnet_counters	str_lnet;
 } WIRE_ATTR srpc_stat_reply_t;
 
+typedef struct {
+	__u64			lat_rpyid;	/* reply buffer matchbits */
+	struct lst_sid		lat_sid;	/* session id */
+	__u32			lat_type;	/* enum lst_stat_type */
+} WIRE_ATTR srpc_lat_reqst_t;
+
+/* # of latency buckets that fit in a reply, see srpc_lat_reply_t */
+#define SRPC_LAT_WIRE_BUCKETS	28
+
+/* A window of the node's latency histogram, ending at the highest
+ * non-empty bucket; samples below the window are counted in its first
+ * bucket. */
+typedef struct {
+	__u32			lat_status;
+	struct lst_sid		lat_sid;
+	__u32			lat_first;	/* index of lat_buckets[0] */
+	__u32			lat_buckets[SRPC_LAT_WIRE_BUCKETS];
+} WIRE_ATTR srpc_lat_reply_t;
+
 typedef struct {
         __u32                   blk_opc;        /* bulk operation code */
         __u32                   blk_npg;        /* # of pages */
@@ -266,6 +287,8 @@ typedef struct srpc_msg {
                 srpc_batch_reply_t   bat_reply;
                 srpc_stat_reqst_t    stat_reqst;
                 srpc_stat_reply_t    stat_reply;
+                srpc_lat_reqst_t     lat_reqst;
+                srpc_lat_reply_t     lat_reply;
                 srpc_test_reqst_t    tes_reqst;
                 srpc_test_reply_t    tes_reply;
                 srpc_join_reqst_t    join_reqst;
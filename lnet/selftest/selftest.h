@@ -77,6 +77,7 @@ struct sfw_test_instance;
 #define SRPC_SERVICE_TEST               4
 #define SRPC_SERVICE_QUERY_STAT         5
 #define SRPC_SERVICE_JOIN               6
+#define SRPC_SERVICE_QUERY_LAT          7
 #define SRPC_FRAMEWORK_SERVICE_MAX_ID   10
 /* other services start from SRPC_FRAMEWORK_SERVICE_MAX_ID+1 */
 #define SRPC_SERVICE_BRW                11
@@ -121,6 +122,9 @@ srpc_service2request (int service)
 
         case SRPC_SERVICE_JOIN:
                 return SRPC_MSG_JOIN_REQST;
+
+        case SRPC_SERVICE_QUERY_LAT:
+                return SRPC_MSG_LAT_REQST;
         }
 }
 
@@ -211,6 +215,7 @@ typedef struct srpc_client_rpc {
         void               (*crpc_fini)(struct srpc_client_rpc *);
         int                  crpc_status;    /* completion status */
         void                *crpc_priv;      /* caller data */
+	ktime_t			crpc_start;	/* when it was posted */
 
         /* state flags */
         unsigned int         crpc_aborted:1; /* being given up */
@@ -333,6 +338,9 @@ typedef struct {
 	atomic_t		sn_brw_errors;
 	atomic_t		sn_ping_errors;
 	cfs_time_t		sn_started;
+	/* latency histograms of test RPCs, see lst_lat_bucket_usec() */
+	atomic_t		sn_brw_lat[LST_LAT_BUCKETS];
+	atomic_t		sn_ping_lat[LST_LAT_BUCKETS];
 } sfw_session_t;
 
 #define sfw_sid_equal(sid0, sid1)     ((sid0).ses_nid == (sid1).ses_nid && \
@@ -417,6 +425,7 @@ void sfw_abort_rpc(srpc_client_rpc_t *rpc);
 void sfw_post_rpc(srpc_client_rpc_t *rpc);
 void sfw_client_rpc_done(srpc_client_rpc_t *rpc);
 void sfw_unpack_message(srpc_msg_t *msg);
+void sfw_lat_record(atomic_t *hist, srpc_client_rpc_t *rpc);
 void sfw_free_pages(srpc_server_rpc_t *rpc);
 void sfw_add_bulk_page(srpc_bulk_t *bk, struct page *pg, int i);
 int sfw_alloc_pages(srpc_server_rpc_t *rpc, int cpt, int npages, int len,
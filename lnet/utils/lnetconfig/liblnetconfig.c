@@ -1503,6 +1503,7 @@ int lustre_lnet_show_net(char *nw, int detail, int seq_no,
 	struct lnet_ioctl_config_ni *ni_data;
 	struct lnet_ioctl_config_lnd_tunables *lnd;
 	struct lnet_ioctl_element_stats *stats;
+	struct lnet_ioctl_element_hstats hstats;
 	__u32 net = LNET_NIDNET(LNET_NID_ANY);
 	__u32 prev_net = LNET_NIDNET(LNET_NID_ANY);
 	int rc = LUSTRE_CFG_RC_OUT_OF_MEM, i, j;
@@ -1510,7 +1511,7 @@ int lustre_lnet_show_net(char *nw, int detail, int seq_no,
 	struct cYAML *root = NULL, *tunables = NULL,
 		*net_node = NULL, *interfaces = NULL,
 		*item = NULL, *first_seq = NULL,
-		*tmp = NULL, *statistics = NULL;
+		*tmp = NULL, *statistics = NULL, *health = NULL;
 	int str_buf_len = LNET_MAX_SHOW_NUM_CPT * 2;
 	char str_buf[str_buf_len];
 	char *pos;
@@ -1659,6 +1660,29 @@ int lustre_lnet_show_net(char *nw, int detail, int seq_no,
 							== NULL)
 				goto out;
 
+			memset(&hstats, 0, sizeof(hstats));
+			LIBCFS_IOC_INIT_V2(hstats, hs_hdr);
+			hstats.hs_nid = ni_data->lic_nid;
+			if (l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_LOCAL_HSTATS,
+				    &hstats) == 0) {
+				health = cYAML_create_object(item,
+							     "health stats");
+				if (health == NULL)
+					goto out;
+
+				if (cYAML_create_number(health, "health value",
+						hstats.hs_health_value) == NULL)
+					goto out;
+
+				if (cYAML_create_number(health, "fail_count",
+						hstats.hs_fail_count) == NULL)
+					goto out;
+
+				if (cYAML_create_number(health, "resend_count",
+						hstats.hs_resend_count) == NULL)
+					goto out;
+			}
+
 			tunables = cYAML_create_object(item, "tunables");
 			if (!tunables)
 				goto out;
@@ -2013,6 +2037,7 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 	struct lnet_ioctl_peer_cfg peer_info;
 	struct lnet_peer_ni_credit_info *lpni_cri;
 	struct lnet_ioctl_element_stats *lpni_stats;
+	struct lnet_ioctl_element_hstats hstats;
 	int rc = LUSTRE_CFG_RC_OUT_OF_MEM, ncpt = 0, i = 0, j = 0;
 	int l_errno = 0;
 	struct cYAML *root = NULL, *peer = NULL, *peer_ni = NULL,
@@ -2085,6 +2110,11 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 							"True" : "False")
 				    == NULL)
 					goto out;
+				if (detail &&
+				    cYAML_create_number(peer, "peer state",
+							peer_info.prcfg_state)
+				    == NULL)
+					goto out;
 				tmp = cYAML_create_seq(peer, "peer ni");
 				if (tmp == NULL)
 					goto out;
@@ -2157,6 +2187,29 @@ int lustre_lnet_show_peer(char *knid, int detail, int seq_no,
 			    == NULL)
 				goto out;
 
+			memset(&hstats, 0, sizeof(hstats));
+			LIBCFS_IOC_INIT_V2(hstats, hs_hdr);
+			hstats.hs_nid = peer_info.prcfg_cfg_nid;
+			if (l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_PEER_HSTATS,
+				    &hstats) == 0) {
+				if (cYAML_create_number(peer_ni,
+						"health value",
+						hstats.hs_health_value)
+				    == NULL)
+					goto out;
+
+				if (cYAML_create_number(peer_ni, "fail_count",
+							hstats.hs_fail_count)
+				    == NULL)
+					goto out;
+
+				if (cYAML_create_number(peer_ni,
+						"resend_count",
+						hstats.hs_resend_count)
+				    == NULL)
+					goto out;
+			}
+
 			if (cYAML_create_number(peer_ni, "refcount",
 						lpni_cri->cr_refcount) == NULL)
 				goto out;
@@ -2271,6 +2324,213 @@ out:
 	return rc;
 }
 
+static const char *sel_rule_types[] = {
+	[LNET_SEL_RULE_LOCAL_NI] = "local_ni",
+	[LNET_SEL_RULE_PEER_NI] = "peer_ni",
+	[LNET_SEL_RULE_NET] = "net",
+	[LNET_SEL_RULE_ROUTER] = "router",
+};
+
+int lustre_lnet_add_sel_rule(char *type, char *nid, char *net, long prio,
+			     int seq_no, struct cYAML **err_rc)
+{
+	struct lnet_ioctl_sel_rule data;
+	int rc = LUSTRE_CFG_RC_NO_ERR;
+	char err_str[LNET_MAX_STR_LEN];
+	char *at;
+	int i;
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+
+	LIBCFS_IOC_INIT_V2(data, sr_hdr);
+	data.sr_type = LNET_SEL_RULE_MAX + 1;
+	for (i = 0; type != NULL && i <= LNET_SEL_RULE_MAX; i++) {
+		if (strcmp(type, sel_rule_types[i]) == 0)
+			data.sr_type = i;
+	}
+	if (data.sr_type > LNET_SEL_RULE_MAX) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"type must be local_ni, peer_ni, net or router\"");
+		rc = LUSTRE_CFG_RC_BAD_PARAM;
+		goto out;
+	}
+
+	/* LNET_SEL_PRIO_DEFAULT is what objects no rule matches get */
+	if (prio < 0 || prio >= LNET_SEL_PRIO_DEFAULT) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"priority must be >= 0 and < %u\"",
+			 LNET_SEL_PRIO_DEFAULT);
+		rc = LUSTRE_CFG_RC_OUT_OF_RANGE_PARAM;
+		goto out;
+	}
+	data.sr_priority = prio;
+
+	data.sr_net = LNET_NIDNET(LNET_NID_ANY);
+	if (net != NULL) {
+		data.sr_net = libcfs_str2net(net);
+		if (data.sr_net == LNET_NIDNET(LNET_NID_ANY)) {
+			snprintf(err_str, sizeof(err_str),
+				 "\"cannot parse net %s\"", net);
+			rc = LUSTRE_CFG_RC_BAD_PARAM;
+			goto out;
+		}
+	} else if (data.sr_type == LNET_SEL_RULE_NET) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"net rules need a net\"");
+		rc = LUSTRE_CFG_RC_MISSING_PARAM;
+		goto out;
+	}
+
+	/* "*" matches every NID, "*@net" every NID on a network */
+	data.sr_nid = LNET_NID_ANY;
+	if (nid != NULL && strcmp(nid, "*") != 0) {
+		at = strchr(nid, '@');
+		if (at != NULL && at - nid == 1 && nid[0] == '*') {
+			__u32 nid_net = libcfs_str2net(at + 1);
+
+			if (nid_net != LNET_NIDNET(LNET_NID_ANY))
+				data.sr_nid = LNET_MKNID(nid_net,
+					LNET_NIDADDR(LNET_NID_ANY));
+		} else {
+			data.sr_nid = libcfs_str2nid(nid);
+		}
+
+		if (data.sr_nid == LNET_NID_ANY) {
+			snprintf(err_str, sizeof(err_str),
+				 "\"cannot parse nid %s\"", nid);
+			rc = LUSTRE_CFG_RC_BAD_PARAM;
+			goto out;
+		}
+	}
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_ADD_SEL_RULE, &data);
+	if (rc != 0) {
+		rc = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot add selection rule: %s\"", strerror(errno));
+		goto out;
+	}
+
+out:
+	cYAML_build_error(rc, seq_no, ADD_CMD, "selection", err_str, err_rc);
+
+	return rc;
+}
+
+int lustre_lnet_del_sel_rule(int idx, int seq_no, struct cYAML **err_rc)
+{
+	struct lnet_ioctl_sel_rule data;
+	int rc = LUSTRE_CFG_RC_NO_ERR;
+	char err_str[LNET_MAX_STR_LEN];
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+
+	LIBCFS_IOC_INIT_V2(data, sr_hdr);
+	data.sr_idx = idx < 0 ? LNET_SEL_RULE_IDX_ALL : idx;
+
+	rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_DEL_SEL_RULE, &data);
+	if (rc != 0) {
+		rc = -errno;
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot delete selection rule: %s\"",
+			 strerror(errno));
+		goto out;
+	}
+
+out:
+	cYAML_build_error(rc, seq_no, DEL_CMD, "selection", err_str, err_rc);
+
+	return rc;
+}
+
+int lustre_lnet_show_sel_rules(int seq_no, struct cYAML **show_rc,
+			       struct cYAML **err_rc)
+{
+	struct lnet_ioctl_sel_rule data;
+	int rc = LUSTRE_CFG_RC_OUT_OF_MEM;
+	int l_errno = 0;
+	char err_str[LNET_MAX_STR_LEN];
+	struct cYAML *root = NULL, *rules = NULL, *item;
+	const char *type;
+	const char *nid;
+	int i;
+
+	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
+
+	root = cYAML_create_object(NULL, NULL);
+	if (root == NULL)
+		goto out;
+
+	rules = cYAML_create_seq(root, "selection");
+	if (rules == NULL)
+		goto out;
+
+	for (i = 0;; i++) {
+		LIBCFS_IOC_INIT_V2(data, sr_hdr);
+		data.sr_idx = i;
+
+		if (l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_SEL_RULE,
+			    &data) != 0) {
+			l_errno = errno;
+			break;
+		}
+
+		item = cYAML_create_seq_item(rules);
+		if (item == NULL)
+			goto out;
+
+		if (cYAML_create_number(item, "idx", i) == NULL)
+			goto out;
+
+		type = data.sr_type <= LNET_SEL_RULE_MAX ?
+		       sel_rule_types[data.sr_type] : "unknown";
+		if (cYAML_create_string(item, "type", (char *)type) == NULL)
+			goto out;
+
+		nid = data.sr_nid == LNET_NID_ANY ? "*" :
+		      libcfs_nid2str(data.sr_nid);
+		if (cYAML_create_string(item, "nid", (char *)nid) == NULL)
+			goto out;
+
+		if (data.sr_net != LNET_NIDNET(LNET_NID_ANY) &&
+		    cYAML_create_string(item, "net",
+					libcfs_net2str(data.sr_net)) == NULL)
+			goto out;
+
+		if (cYAML_create_number(item, "priority",
+					data.sr_priority) == NULL)
+			goto out;
+	}
+
+	if (l_errno != ENOENT) {
+		snprintf(err_str, sizeof(err_str),
+			 "\"cannot get selection rules: %s\"",
+			 strerror(l_errno));
+		rc = -l_errno;
+		goto out;
+	}
+
+	if (show_rc == NULL)
+		cYAML_print_tree(root);
+
+	snprintf(err_str, sizeof(err_str), "\"success\"");
+	rc = LUSTRE_CFG_RC_NO_ERR;
+out:
+	if (show_rc == NULL || rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_free_tree(root);
+	} else if (show_rc != NULL && *show_rc != NULL) {
+		cYAML_insert_sibling((*show_rc)->cy_child,
+					root->cy_child);
+		free(root);
+	} else {
+		*show_rc = root;
+	}
+
+	cYAML_build_error(rc, seq_no, SHOW_CMD, "selection", err_str, err_rc);
+
+	return rc;
+}
+
 int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 			   struct cYAML **err_rc)
 {
@@ -3065,6 +3325,52 @@ static int handle_yaml_show_numa(struct cYAML *tree, struct cYAML **show_rc,
 					   show_rc, err_rc);
 }
 
+static int handle_yaml_config_selection(struct cYAML *tree,
+					struct cYAML **show_rc,
+					struct cYAML **err_rc)
+{
+	struct cYAML *seq_no, *type, *nid, *net, *prio;
+
+	seq_no = cYAML_get_object_item(tree, "seq_no");
+	type = cYAML_get_object_item(tree, "type");
+	nid = cYAML_get_object_item(tree, "nid");
+	net = cYAML_get_object_item(tree, "net");
+	prio = cYAML_get_object_item(tree, "priority");
+
+	return lustre_lnet_add_sel_rule(type ? type->cy_valuestring : NULL,
+					nid ? nid->cy_valuestring : NULL,
+					net ? net->cy_valuestring : NULL,
+					prio ? prio->cy_valueint : -1,
+					seq_no ? seq_no->cy_valueint : -1,
+					err_rc);
+}
+
+static int handle_yaml_del_selection(struct cYAML *tree,
+				     struct cYAML **show_rc,
+				     struct cYAML **err_rc)
+{
+	struct cYAML *seq_no, *idx;
+
+	seq_no = cYAML_get_object_item(tree, "seq_no");
+	idx = cYAML_get_object_item(tree, "idx");
+
+	return lustre_lnet_del_sel_rule(idx ? idx->cy_valueint : -1,
+					seq_no ? seq_no->cy_valueint : -1,
+					err_rc);
+}
+
+static int handle_yaml_show_selection(struct cYAML *tree,
+				      struct cYAML **show_rc,
+				      struct cYAML **err_rc)
+{
+	struct cYAML *seq_no;
+
+	seq_no = cYAML_get_object_item(tree, "seq_no");
+
+	return lustre_lnet_show_sel_rules(seq_no ? seq_no->cy_valueint : -1,
+					  show_rc, err_rc);
+}
+
 struct lookup_cmd_hdlr_tbl {
 	char *name;
 	cmd_handler_t cb;
@@ -3078,6 +3384,7 @@ static struct lookup_cmd_hdlr_tbl lookup_config_tbl[] = {
 	{ .name = "routing",	.cb = handle_yaml_config_routing },
 	{ .name = "buffers",	.cb = handle_yaml_config_buffers },
 	{ .name = "numa",	.cb = handle_yaml_config_numa },
+	{ .name = "selection",	.cb = handle_yaml_config_selection },
 	{ .name = NULL } };
 
 static struct lookup_cmd_hdlr_tbl lookup_del_tbl[] = {
@@ -3086,6 +3393,7 @@ static struct lookup_cmd_hdlr_tbl lookup_del_tbl[] = {
 	{ .name = "peer",	.cb = handle_yaml_del_peer },
 	{ .name = "routing",	.cb = handle_yaml_del_routing },
 	{ .name = "numa",	.cb = handle_yaml_del_numa },
+	{ .name = "selection",	.cb = handle_yaml_del_selection },
 	{ .name = NULL } };
 
 static struct lookup_cmd_hdlr_tbl lookup_show_tbl[] = {
@@ -3096,6 +3404,7 @@ static struct lookup_cmd_hdlr_tbl lookup_show_tbl[] = {
 	{ .name = "peer",	.cb = handle_yaml_show_peers },
 	{ .name = "statistics",	.cb = handle_yaml_show_stats },
 	{ .name = "numa",	.cb = handle_yaml_show_numa },
+	{ .name = "selection",	.cb = handle_yaml_show_selection },
 	{ .name = NULL } };
 
 static cmd_handler_t lookup_fn(char *key,
@@ -217,6 +217,46 @@ int lustre_lnet_config_numa_range(int range, int seq_no,
 int lustre_lnet_show_numa_range(int seq_no, struct cYAML **show_rc,
 				struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_add_sel_rule
+ *   Add a rule giving a selection priority to the local NIs, peer NIs,
+ *   peer networks or routers matching a NID. Lower priorities are
+ *   preferred, and the first matching rule applies.
+ *
+ *   type - local_ni, peer_ni, net or router
+ *   nid - NID to match: "*", "*@net" or a single NID
+ *   net - peer network, needed by net rules
+ *   prio - priority of the matching objects, below LNET_SEL_PRIO_DEFAULT
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_add_sel_rule(char *type, char *nid, char *net, long prio,
+			     int seq_no, struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_del_sel_rule
+ *   Delete a selection rule by index, or all of them
+ *
+ *   idx - index of the rule as shown, or -1 for all rules
+ *   seq_no - sequence number of the request
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_del_sel_rule(int idx, int seq_no, struct cYAML **err_rc);
+
+/*
+ * lustre_lnet_show_sel_rules
+ *   Show the selection rules in the order they are matched
+ *
+ *   seq_no - sequence number of the request
+ *   show_rc - [OUT] struct cYAML tree containing the rules
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by
+ *   caller
+ */
+int lustre_lnet_show_sel_rules(int seq_no, struct cYAML **show_rc,
+			       struct cYAML **err_rc);
+
 /*
  * lustre_lnet_config_buffers
  *   Send down an IOCTL to configure routing buffer sizes.  A value of 0 means
@@ -57,6 +57,9 @@ static int jt_set_large(int argc, char **argv);
 static int jt_set_numa(int argc, char **argv);
 static int jt_add_peer_nid(int argc, char **argv);
 static int jt_del_peer_nid(int argc, char **argv);
+static int jt_add_selection(int argc, char **argv);
+static int jt_del_selection(int argc, char **argv);
+static int jt_show_selection(int argc, char **argv);
 /*static int jt_show_peer(int argc, char **argv);*/
 static int lnetctl_list_commands(int argc, char **argv);
 
@@ -119,6 +122,18 @@ command_t numa_cmds[] = {
 	{ 0, 0, 0, NULL }
 };
 
+command_t selection_cmds[] = {
+	{"add", jt_add_selection, 0, "add an NI/peer selection rule\n"
+	 "\t--type: local_ni, peer_ni, net or router\n"
+	 "\t--nid: NID to match (e.g. 10.1.1.2@tcp, *@o2ib1 or *)\n"
+	 "\t--net: peer net name (e.g. o2ib1), required by net rules\n"
+	 "\t--priority: priority of the matches (0 - highest prio)\n"},
+	{"del", jt_del_selection, 0, "delete selection rules\n"
+	 "\t--idx: index of the rule to delete, all rules if omitted\n"},
+	{"show", jt_show_selection, 0, "show selection rules\n"},
+	{ 0, 0, 0, NULL }
+};
+
 command_t set_cmds[] = {
 	{"tiny_buffers", jt_set_tiny, 0, "set tiny routing buffers\n"
 	 "\tVALUE must be greater than 0\n"},
@@ -842,6 +857,125 @@ static int jt_show_numa(int argc, char **argv)
 	return rc;
 }
 
+static int jt_add_selection(int argc, char **argv)
+{
+	char *type = NULL, *nid = NULL, *network = NULL;
+	long int prio = -1;
+	struct cYAML *err_rc = NULL;
+	int rc, opt;
+
+	const char *const short_options = "t:i:n:p:h";
+	static const struct option long_options[] = {
+	{ .name = "type",     .has_arg = required_argument, .val = 't' },
+	{ .name = "nid",      .has_arg = required_argument, .val = 'i' },
+	{ .name = "net",      .has_arg = required_argument, .val = 'n' },
+	{ .name = "priority", .has_arg = required_argument, .val = 'p' },
+	{ .name = "help",     .has_arg = no_argument,	    .val = 'h' },
+	{ .name = NULL } };
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 't':
+			type = optarg;
+			break;
+		case 'i':
+			nid = optarg;
+			break;
+		case 'n':
+			network = optarg;
+			break;
+		case 'p':
+			rc = parse_long(optarg, &prio);
+			if (rc != 0) {
+				/* ignore option */
+				prio = -1;
+				continue;
+			}
+			break;
+		case 'h':
+			print_help(selection_cmds, "selection", "add");
+			return 0;
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_add_sel_rule(type, nid, network, prio, -1, &err_rc);
+
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
+static int jt_del_selection(int argc, char **argv)
+{
+	long int idx = -1;
+	struct cYAML *err_rc = NULL;
+	int rc, opt;
+
+	const char *const short_options = "x:h";
+	static const struct option long_options[] = {
+		{ .name = "idx",  .has_arg = required_argument, .val = 'x' },
+		{ .name = "help", .has_arg = no_argument,	.val = 'h' },
+		{ .name = NULL } };
+
+	while ((opt = getopt_long(argc, argv, short_options,
+				   long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'x':
+			rc = parse_long(optarg, &idx);
+			if (rc != 0 || idx < 0) {
+				cYAML_build_error(-1, -1, "parser", "selection",
+						  "cannot parse idx value",
+						  &err_rc);
+				cYAML_print_tree2file(stderr, err_rc);
+				cYAML_free_tree(err_rc);
+				return -1;
+			}
+			break;
+		case 'h':
+			print_help(selection_cmds, "selection", "del");
+			return 0;
+		default:
+			return 0;
+		}
+	}
+
+	rc = lustre_lnet_del_sel_rule(idx, -1, &err_rc);
+
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
+static int jt_show_selection(int argc, char **argv)
+{
+	int rc;
+	struct cYAML *show_rc = NULL, *err_rc = NULL;
+
+	if (handle_help(selection_cmds, "selection", "show", argc, argv) == 0)
+		return 0;
+
+	rc = lustre_lnet_show_sel_rules(-1, &show_rc, &err_rc);
+
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+	else if (show_rc)
+		cYAML_print_tree(show_rc);
+
+	cYAML_free_tree(err_rc);
+	cYAML_free_tree(show_rc);
+
+	return rc;
+}
+
 static inline int jt_lnet(int argc, char **argv)
 {
 	if (argc < 2)
@@ -914,6 +1048,18 @@ static inline int jt_numa(int argc, char **argv)
 	return Parser_execarg(argc - 1, &argv[1], numa_cmds);
 }
 
+static inline int jt_selection(int argc, char **argv)
+{
+	if (argc < 2)
+		return CMD_HELP;
+
+	if (argc == 2 &&
+	    handle_help(selection_cmds, "selection", NULL, argc, argv) == 0)
+		return 0;
+
+	return Parser_execarg(argc - 1, &argv[1], selection_cmds);
+}
+
 static inline int jt_peers(int argc, char **argv)
 {
 	if (argc < 2)
@@ -1068,6 +1214,12 @@ static int jt_export(int argc, char **argv)
 		cYAML_free_tree(err_rc);
 	}
 
+	rc = lustre_lnet_show_sel_rules(-1, &show_rc, &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(stderr, err_rc);
+		cYAML_free_tree(err_rc);
+	}
+
 	if (show_rc != NULL) {
 		cYAML_print_tree2file(f, show_rc);
 		cYAML_free_tree(show_rc);
@@ -1253,6 +1405,7 @@ command_t list[] = {
 	{"stats", jt_stats, 0, "stats {show | help}"},
 	{"numa", jt_numa, 0, "numa {show | help}"},
 	{"peer", jt_peers, 0, "peer {add | del | show | help}"},
+	{"selection", jt_selection, 0, "selection {add | del | show | help}"},
 	{"help", Parser_help, 0, "help"},
 	{"exit", Parser_quit, 0, "quit"},
 	{"quit", Parser_quit, 0, "quit"},
@@ -58,7 +58,8 @@ static struct lst_sid session_id;
 static int                 session_key;
 static int lst_list_commands(int argc, char **argv);
 
-/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN */
+/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN,
+ * nodes without LST_FEAT_LAT_HIST need LST_FEATURES=1 */
 static unsigned		session_features = LST_FEATS_MASK;
 static struct lstcon_trans_stat	trans_stat;
 
@@ -1486,11 +1487,12 @@ jt_lst_list_group(int argc, char **argv)
 
 int
 lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
-	       int timeout, struct list_head *resultp)
+	       int type, int timeout, struct list_head *resultp)
 {
 	struct lstio_stat_args args = { 0 };
 
 	args.lstio_sta_key     = session_key;
+	args.lstio_sta_type    = type;
 	args.lstio_sta_timeout = timeout;
 	args.lstio_sta_nmlen   = strlen(name);
 	args.lstio_sta_namep   = name;
@@ -1501,21 +1503,34 @@ lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
 	return lst_ioctl(LSTIO_STAT_QUERY, &args, sizeof(args));
 }
 
+/* latency histograms queried by "lst stat", see lst_print_lat_stat() */
+#define LST_LAT_TYPES	2
+
+static const int lst_lat_types[LST_LAT_TYPES] = {
+	LST_STAT_LAT_BRW, LST_STAT_LAT_PING
+};
+
 typedef struct {
 	struct list_head              srp_link;
         int                     srp_count;
         char                   *srp_name;
 	struct lnet_process_id      *srp_ids;
 	struct list_head              srp_result[2];
+	/* brw and ping latency histograms */
+	struct list_head	srp_lat[LST_LAT_TYPES][2];
 } lst_stat_req_param_t;
 
 static void
 lst_stat_req_param_free(lst_stat_req_param_t *srp)
 {
         int     i;
+	int	j;
 
-        for (i = 0; i < 2; i++)
+        for (i = 0; i < 2; i++) {
                 lst_free_rpcent(&srp->srp_result[i]);
+		for (j = 0; j < LST_LAT_TYPES; j++)
+			lst_free_rpcent(&srp->srp_lat[j][i]);
+	}
 
         if (srp->srp_ids != NULL)
                 free(srp->srp_ids);
@@ -1530,14 +1545,18 @@ lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
         int                   count = save_old ? 2 : 1;
         int                   rc;
         int                   i;
+	int		      j;
 
         srp = malloc(sizeof(*srp));
         if (srp == NULL)
                 return -ENOMEM;
 
         memset(srp, 0, sizeof(*srp));
-	INIT_LIST_HEAD(&srp->srp_result[0]);
-	INIT_LIST_HEAD(&srp->srp_result[1]);
+	for (i = 0; i < 2; i++) {
+		INIT_LIST_HEAD(&srp->srp_result[i]);
+		for (j = 0; j < LST_LAT_TYPES; j++)
+			INIT_LIST_HEAD(&srp->srp_lat[j][i]);
+	}
 
         rc = lst_get_node_count(LST_OPC_GROUP, name,
                                 &srp->srp_count, NULL);
@@ -1566,6 +1585,19 @@ lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
                         fprintf(stderr, "Out of memory\n");
                         break;
                 }
+
+		/* latency is only shown as the delta of two queries */
+		if (!save_old)
+			continue;
+
+		for (j = 0; j < LST_LAT_TYPES && rc == 0; j++)
+			rc = lst_alloc_rpcent(&srp->srp_lat[j][i],
+					      srp->srp_count,
+					      sizeof(__u32) * LST_LAT_BUCKETS);
+		if (rc != 0) {
+			fprintf(stderr, "Out of memory\n");
+			break;
+		}
         }
 
         if (rc == 0) {
@@ -1870,6 +1902,82 @@ lst_print_stat(char *name, struct list_head *resultp,
 	lst_print_lnet_stat(name, bwrt, rdwr, type, mbs);
 }
 
+/* interpolate percentile \a pct within the bucket it falls into */
+static double
+lst_lat_percentile(long long *hist, long long total, double pct)
+{
+	double	  target = total * pct / 100;
+	long long cum = 0;
+	double	  lo;
+	double	  hi;
+	int	  i;
+
+	for (i = 0; i < LST_LAT_BUCKETS; i++) {
+		cum += hist[i];
+		if (hist[i] <= 0 || cum < target)
+			continue;
+
+		lo = lst_lat_bucket_usec(i);
+		hi = i + 1 < LST_LAT_BUCKETS ?
+		     lst_lat_bucket_usec(i + 1) : lo * 1.5;
+
+		return hi - (hi - lo) * (cum - target) / hist[i];
+	}
+
+	return lst_lat_bucket_usec(LST_LAT_BUCKETS - 1);
+}
+
+static void
+lst_print_lat_stat(char *name, int lat, struct list_head *resultp, int idx)
+{
+	struct list_head      *pos = resultp[1 - idx].next;
+	struct lstcon_rpc_ent *new;
+	struct lstcon_rpc_ent *old;
+	__u32		      *cnt_new;
+	__u32		      *cnt_old;
+	long long	       hist[LST_LAT_BUCKETS] = { 0 };
+	long long	       total = 0;
+	int		       i;
+
+	/* both lists hold the same nodes in the same order */
+	list_for_each_entry(new, &resultp[idx], rpe_link) {
+		if (pos == &resultp[1 - idx])
+			break;
+
+		old = list_entry(pos, struct lstcon_rpc_ent, rpe_link);
+		pos = pos->next;
+
+		if (new->rpe_peer.nid == LNET_NID_ANY ||
+		    new->rpe_peer.nid != old->rpe_peer.nid ||
+		    new->rpe_peer.pid != old->rpe_peer.pid ||
+		    new->rpe_rpc_errno != 0 || new->rpe_fwk_errno != 0 ||
+		    old->rpe_rpc_errno != 0 || old->rpe_fwk_errno != 0)
+			continue;
+
+		cnt_new = (__u32 *)&new->rpe_payload[0];
+		cnt_old = (__u32 *)&old->rpe_payload[0];
+
+		/* nodes fold their lowest buckets together as the tail
+		 * grows, so a delta can be negative; the running sum the
+		 * percentiles are taken from stays exact */
+		for (i = 0; i < LST_LAT_BUCKETS; i++) {
+			hist[i] += (int)(cnt_new[i] - cnt_old[i]);
+			total += (int)(cnt_new[i] - cnt_old[i]);
+		}
+	}
+
+	if (total <= 0)
+		return;
+
+	fprintf(stdout, "[%s latency of %s]\n",
+		lat == LST_STAT_LAT_BRW ? "BRW" : "Ping", name);
+	fprintf(stdout, "p50: %-8.0f p99: %-8.0f p99.9: %-8.0f usec "
+		"(%lld RPCs)\n",
+		lst_lat_percentile(hist, total, 50),
+		lst_lat_percentile(hist, total, 99),
+		lst_lat_percentile(hist, total, 99.9), total);
+}
+
 int
 jt_lst_stat(int argc, char **argv)
 {
@@ -1888,6 +1996,8 @@ jt_lst_stat(int argc, char **argv)
 	int		      rc;
 	int		      c;
 	int		      mbs     = 0; /* report as MB/s */
+	int		      lat     = 1; /* latency percentiles */
+	int		      i;
 
 	static const struct option stat_opts[] = {
 		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
@@ -2018,7 +2128,8 @@ jt_lst_stat(int argc, char **argv)
 		list_for_each_entry(srp, &head, srp_link) {
                         rc = lst_stat_ioctl(srp->srp_name,
                                             srp->srp_count, srp->srp_ids,
-                                            timeout, &srp->srp_result[idx]);
+					    LST_STAT_COUNTERS, timeout,
+					    &srp->srp_result[idx]);
                         if (rc == -1) {
                                 lst_print_error("stat", "Failed to stat %s: %s\n",
                                                 srp->srp_name, strerror(errno));
@@ -2029,6 +2140,33 @@ jt_lst_stat(int argc, char **argv)
 				       idx, lnet, bwrt, rdwr, type, mbs);
 
 			lst_reset_rpcent(&srp->srp_result[1 - idx]);
+
+			for (i = 0; lat && i < LST_LAT_TYPES; i++) {
+				rc = lst_stat_ioctl(srp->srp_name,
+						    srp->srp_count,
+						    srp->srp_ids,
+						    lst_lat_types[i], timeout,
+						    &srp->srp_lat[i][idx]);
+				/* session without LST_FEAT_LAT_HIST */
+				if (rc == -1 && errno == EOPNOTSUPP) {
+					lat = 0;
+					break;
+				}
+
+				if (rc == -1) {
+					lst_print_error("stat", "Failed to "
+							"stat %s: %s\n",
+							srp->srp_name,
+							strerror(errno));
+					goto out;
+				}
+
+				lst_print_lat_stat(srp->srp_name,
+						   lst_lat_types[i],
+						   srp->srp_lat[i], idx);
+				lst_reset_rpcent(&srp->srp_lat[i][1 - idx]);
+			}
+			rc = 0;
 		}
 
                 idx = 1 - idx;
@@ -2106,7 +2244,8 @@ jt_lst_show_error(int argc, char **argv)
 
 	list_for_each_entry(srp, &head, srp_link) {
                 rc = lst_stat_ioctl(srp->srp_name, srp->srp_count,
-                                    srp->srp_ids, 10, &srp->srp_result[0]);
+				    srp->srp_ids, LST_STAT_COUNTERS, 10,
+				    &srp->srp_result[0]);
 
                 if (rc == -1) {
                         lst_print_error(srp->srp_name, "Failed to show errors of %s: %s\n",
@@ -768,6 +768,7 @@ jt_ptl_print_connections (int argc, char **argv)
 {
         struct libcfs_ioctl_data data;
 	struct lnet_process_id        id;
+	struct ksock_conn_stats	 stats;
 	char                     buffer[2][HOST_NAME_MAX + 1];
         int                      index;
         int                      rc;
@@ -779,6 +780,11 @@ jt_ptl_print_connections (int argc, char **argv)
                 LIBCFS_IOC_INIT(data);
                 data.ioc_net     = g_net;
                 data.ioc_count   = index;
+		if (g_net_is_compatible(NULL, SOCKLND, 0)) {
+			memset(&stats, 0, sizeof(stats));
+			data.ioc_pbuf1 = &stats;
+			data.ioc_plen1 = sizeof(stats);
+		}
 
                 rc = l_ioctl(LNET_DEV_ID, IOC_LIBCFS_GET_CONN, &data);
                 if (rc != 0)
@@ -787,13 +793,15 @@ jt_ptl_print_connections (int argc, char **argv)
 		if (g_net_is_compatible(NULL, SOCKLND, 0)) {
 			id.nid = data.ioc_nid;
 			id.pid = data.ioc_u32[6];
-			printf("%-20s %s[%d]%s->%s:%d %d/%d %s\n",
+			printf("%-20s %s[%d:%u]%s->%s:%d %d/%d %s "
+			       "tx %ju/%ju rx %ju/%ju q %u\n",
 			       libcfs_id2str(id),
 			       (data.ioc_u32[3] == SOCKLND_CONN_ANY) ? "A" :
 			       (data.ioc_u32[3] == SOCKLND_CONN_CONTROL) ? "C" :
 			       (data.ioc_u32[3] == SOCKLND_CONN_BULK_IN) ? "I" :
 			 (data.ioc_u32[3] == SOCKLND_CONN_BULK_OUT) ? "O" : "?",
-			       data.ioc_u32[4], /* scheduler */
+			       data.ioc_u32[4], /* scheduler CPT */
+			       stats.kcs_sched, /* scheduler in CPT */
 			       /* local IP addr */
 			       ptl_ipaddr_2_str(data.ioc_u32[2], buffer[0],
 						sizeof(buffer[0]), 1),
@@ -803,7 +811,13 @@ jt_ptl_print_connections (int argc, char **argv)
 			       data.ioc_u32[1],         /* remote port */
 			       data.ioc_count, /* tx buffer size */
 			       data.ioc_u32[5], /* rx buffer size */
-			       data.ioc_flags ? "nagle" : "nonagle");
+			       data.ioc_flags ? "nagle" : "nonagle",
+			       /* messages/bytes sent and received */
+			       (uintmax_t)stats.kcs_tx_msgs,
+			       (uintmax_t)stats.kcs_tx_bytes,
+			       (uintmax_t)stats.kcs_rx_msgs,
+			       (uintmax_t)stats.kcs_rx_bytes,
+			       stats.kcs_tx_queued);
 		} else if (g_net_is_compatible(NULL, O2IBLND, 0)) {
 			printf("%s mtu %d\n",
 			       libcfs_nid2str(data.ioc_nid),
@@ -1313,6 +1327,102 @@ fault_attr_ptl_parse(char *ptl_str, __u64 *mask_p)
 	return 0;
 }
 
+static int
+fault_attr_jitter_parse(char *dist_str, __u32 *dist_p)
+{
+	if (!strcasecmp(dist_str, "uniform")) {
+		*dist_p = LNET_FAULT_JITTER_UNIFORM;
+		return 0;
+
+	} else if (!strcasecmp(dist_str, "normal")) {
+		*dist_p = LNET_FAULT_JITTER_NORMAL;
+		return 0;
+
+	} else if (!strcasecmp(dist_str, "pareto")) {
+		*dist_p = LNET_FAULT_JITTER_PARETO;
+		return 0;
+	}
+
+	fprintf(stderr, "unknown jitter distribution %s\n", dist_str);
+	return -1;
+}
+
+/* latency in seconds, or in milliseconds with a "ms" suffix */
+static int
+fault_attr_latency_parse(char *lat_str, struct lnet_fault_attr *attr)
+{
+	unsigned long	 val;
+	char		*end;
+
+	val = strtoul(lat_str, &end, 0);
+	if (*end == '\0' || !strcasecmp(end, "s")) {
+		attr->u.delay.la_latency = val;
+		return 0;
+
+	} else if (!strcasecmp(end, "ms")) {
+		attr->u.delay.la_latency = val / 1000;
+		attr->u.delay.la_latency_ms = val % 1000;
+		return 0;
+	}
+
+	fprintf(stderr, "invalid latency: %s\n", lat_str);
+	return -1;
+}
+
+/* jitter in milliseconds, with an optional "ms" suffix */
+static int
+fault_attr_jitter_ms_parse(char *jit_str, __u32 *jitter_p)
+{
+	unsigned long	 val;
+	char		*end;
+
+	val = strtoul(jit_str, &end, 0);
+	if (end == jit_str || (*end != '\0' && strcasecmp(end, "ms")) ||
+	    val > LNET_FAULT_JITTER_MAX) {
+		fprintf(stderr, "invalid jitter: %s, at most %u ms\n",
+			jit_str, LNET_FAULT_JITTER_MAX);
+		return -1;
+	}
+
+	*jitter_p = val;
+	return 0;
+}
+
+/* number of bytes with an optional K/M/G suffix, returned in KiB and
+ * rounded up, so any non-zero size is at least 1 KiB */
+static int
+fault_attr_kib_parse(char *size_str, __u32 *kib_p)
+{
+	unsigned long long	 val;
+	char			*end;
+	int			 shift = 0;
+
+	val = strtoull(size_str, &end, 0);
+	switch (*end) {
+	case 'G': case 'g':
+		shift += 10;
+		/* fallthrough */
+	case 'M': case 'm':
+		shift += 10;
+		/* fallthrough */
+	case 'K': case 'k':
+		end++;
+		break;
+	default:
+		val = (val >> 10) + ((val & 1023) != 0);
+		break;
+	}
+
+	if (end == size_str || *end != '\0' || val == 0 ||
+	    val > (UINT_MAX >> shift)) {
+		fprintf(stderr, "invalid size: %s\n", size_str);
+		return -1;
+	}
+
+	*kib_p = val << shift;
+	return 0;
+}
+
 static int
 fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 {
@@ -1329,6 +1439,11 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 	{ .name = "latency",  .has_arg = required_argument, .val = 'l' },
 	{ .name = "portal",   .has_arg = required_argument, .val = 'p' },
 	{ .name = "message",  .has_arg = required_argument, .val = 'm' },
+	{ .name = "jitter",   .has_arg = required_argument, .val = 'j' },
+	{ .name = "jitter_type", .has_arg = required_argument, .val = 't' },
+	{ .name = "bandwidth", .has_arg = required_argument, .val = 'b' },
+	{ .name = "burst",    .has_arg = required_argument, .val = 'B' },
+	{ .name = "error",    .has_arg = no_argument,	    .val = 'e' },
 	{ .name = NULL } };
 
 	if (argc == 1) {
@@ -1337,7 +1452,8 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 		return -1;
 	}
 
-	optstr = opc == LNET_CTL_DROP_ADD ? "s:d:r:i:p:m:" : "s:d:r:l:p:m:";
+	optstr = opc == LNET_CTL_DROP_ADD ? "s:d:r:i:p:m:e" :
+					    "s:d:r:i:l:p:m:j:t:b:B:";
 	memset(&attr, 0, sizeof(attr));
 	while (1) {
 		char c = getopt_long(argc, argv, optstr, opts, NULL);
@@ -1374,8 +1490,38 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 								   NULL, 0);
 			break;
 
-		case 'l': /* seconds to wait before activating rule */
-			attr.u.delay.la_latency = strtoul(optarg, NULL, 0);
+		case 'l': /* time to delay matched messages */
+			rc = fault_attr_latency_parse(optarg, &attr);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'j': /* jitter of the delay, in milliseconds */
+			rc = fault_attr_jitter_ms_parse(optarg,
+					&attr.u.delay.la_jitter);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 't': /* distribution of the jitter */
+			rc = fault_attr_jitter_parse(optarg,
+					&attr.u.delay.la_jitter_dist);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'b': /* bandwidth limit, bytes per second */
+			rc = fault_attr_kib_parse(optarg,
+						  &attr.u.delay.la_bandwidth);
+			if (rc != 0)
+				goto getopt_failed;
+			break;
+
+		case 'B': /* burst above the bandwidth limit, bytes */
+			rc = fault_attr_kib_parse(optarg,
+						  &attr.u.delay.la_burst);
+			if (rc != 0)
+				goto getopt_failed;
 			break;
 
 		case 'p': /* portal to filter */
@@ -1390,6 +1536,10 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 				goto getopt_failed;
 			break;
 
+		case 'e': /* fail sends of this node instead of dropping */
+			attr.u.drop.da_send_error = 1;
+			break;
+
 		default:
 			fprintf(stderr, "error: %s: option '%s' "
 				"unrecognized\n", argv[0], argv[optind - 1]);
@@ -1416,8 +1566,12 @@ fault_simul_rule_add(__u32 opc, char *name, int argc, char **argv)
 			return -1;
 		}
 
-		if (attr.u.delay.la_latency == 0) {
-			fprintf(stderr, "latency cannot be zero\n");
+		if (attr.u.delay.la_latency == 0 &&
+		    attr.u.delay.la_latency_ms == 0 &&
+		    attr.u.delay.la_jitter == 0 &&
+		    attr.u.delay.la_bandwidth == 0) {
+			fprintf(stderr, "please provide latency, jitter or "
+					"bandwidth of the delay rule\n");
 			return -1;
 		}
 	}
@@ -1619,12 +1773,13 @@ fault_simul_rule_list(__u32 opc, char *name, int argc, char **argv)
 		libcfs_ioctl_unpack(&data, ioc_buf);
 
 		if (opc == LNET_CTL_DROP_LIST) {
-			printf("%s->%s (1/%d | %d) ptl %#jx, msg %x, "
+			printf("%s->%s (1/%d | %d%s) ptl %#jx, msg %x, "
 			       "%ju/%ju, PUT %ju, ACK %ju, GET "
 			       "%ju, REP %ju\n",
 			       libcfs_nid2str(attr.fa_src),
 			       libcfs_nid2str(attr.fa_dst),
 			       attr.u.drop.da_rate, attr.u.drop.da_interval,
+			       attr.u.drop.da_send_error ? ", send error" : "",
 			       (uintmax_t)attr.fa_ptl_mask, attr.fa_msg_mask,
 			       (uintmax_t)stat.u.drop.ds_dropped,
 			       (uintmax_t)stat.fs_count,
@@ -1634,15 +1789,22 @@ fault_simul_rule_list(__u32 opc, char *name, int argc, char **argv)
 			       (uintmax_t)stat.fs_reply);
 
 		} else if (opc == LNET_CTL_DELAY_LIST) {
-			printf("%s->%s (1/%d | %d, latency %d) ptl %#jx"
-			       ", msg %x, %ju/%ju, PUT %ju"
+			printf("%s->%s (1/%d | %d, latency %d.%03ds, jitter "
+			       "%dms/%d, bandwidth %dK/s+%dK) ptl %#jx"
+			       ", msg %x, %ju/%ju, throttled %ju, PUT %ju"
 			       ", ACK %ju, GET %ju, REP %ju\n",
 			       libcfs_nid2str(attr.fa_src),
 			       libcfs_nid2str(attr.fa_dst),
 			       attr.u.delay.la_rate, attr.u.delay.la_interval,
 			       attr.u.delay.la_latency,
+			       attr.u.delay.la_latency_ms,
+			       attr.u.delay.la_jitter,
+			       attr.u.delay.la_jitter_dist,
+			       attr.u.delay.la_bandwidth,
+			       attr.u.delay.la_burst,
 			       (uintmax_t)attr.fa_ptl_mask, attr.fa_msg_mask,
 			       (uintmax_t)stat.u.delay.ls_delayed,
+			       (uintmax_t)stat.u.delay.ls_throttled,
 			       (uintmax_t)stat.fs_count,
 			       (uintmax_t)stat.fs_put,
 			       (uintmax_t)stat.fs_ack,
@@ -370,6 +370,14 @@ struct obd_histogram;
 
 typedef void (*cntr_init_callback)(struct lprocfs_stats *stats);
 
+/* RPC latency counters appended to the job stats of every target, in usec */
+enum {
+	LPROC_JOB_RPC_REQIN	= 0,	/* arrival until NRS enqueue */
+	LPROC_JOB_RPC_NRS,		/* NRS queue wait */
+	LPROC_JOB_RPC_HANDLE,		/* handler time */
+	LPROC_JOB_RPC_LAST,
+};
+
 struct obd_job_stats {
 	struct cfs_hash	       *ojs_hash;	/* hash of jobids */
 	struct list_head	ojs_list;	/* list of job_stat structs */
@@ -597,6 +605,10 @@ extern int lprocfs_pinger_recov_seq_show(struct seq_file *m, void *data);
 extern ssize_t
 lprocfs_pinger_recov_seq_write(struct file *file, const char __user *buffer,
 			       size_t count, loff_t *off);
+extern int lprocfs_rpc_latency_seq_show(struct seq_file *m, void *data);
+extern ssize_t
+lprocfs_rpc_latency_seq_write(struct file *file, const char __user *buffer,
+			      size_t count, loff_t *off);
 
 /* Statfs helpers */
 extern int lprocfs_blksize_seq_show(struct seq_file *m, void *data);
@@ -757,6 +769,9 @@ extern void target_print_req(void *seq_file, struct ptlrpc_request *req);
 /* lprocfs_jobstats.c */
 int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 			  int event, long amount);
+int lprocfs_job_stats_log_rpc(struct obd_device *obd, char *jobid,
+			      __u32 reqin_time, __u32 nrs_time,
+			      __u32 handle_time);
 void lprocfs_job_stats_fini(struct obd_device *obd);
 int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 			   cntr_init_callback fn);
@@ -935,6 +950,13 @@ static inline ssize_t
 lprocfs_pinger_recov_seq_write(struct file *file, const char __user *buffer,
 			       size_t count, loff_t *off)
 { return 0; }
+static inline int
+lprocfs_rpc_latency_seq_show(struct seq_file *m, void *data)
+{ return 0; }
+static inline ssize_t
+lprocfs_rpc_latency_seq_write(struct file *file, const char __user *buffer,
+			      size_t count, loff_t *off)
+{ return 0; }
 
 /* Statfs helpers */
 static inline
@@ -988,6 +1010,11 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid, int event,
 			  long amount)
 { return 0; }
 static inline
+int lprocfs_job_stats_log_rpc(struct obd_device *obd, char *jobid,
+			      __u32 reqin_time, __u32 nrs_time,
+			      __u32 handle_time)
+{ return 0; }
+static inline
 void lprocfs_job_stats_fini(struct obd_device *obd)
 { return; }
 static inline
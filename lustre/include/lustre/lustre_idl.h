@@ -617,10 +617,13 @@ struct ptlrpc_body_v3 {
 	/* VBR: pre-versions */
 	__u64 pb_pre_versions[PTLRPC_NUM_VERSIONS];
 	__u64 pb_mbits;	/**< match bits for bulk request */
-	/* padding for future needs */
-	__u64 pb_padding64_0;
-	__u64 pb_padding64_1;
-	__u64 pb_padding64_2;
+	/* for rep, server-side latency breakdown in usec, 0 if unknown */
+	__u32 pb_reqin_time;	/* arrival until NRS enqueue */
+	__u32 pb_nrs_time;	/* NRS queue wait */
+	__u32 pb_handle_time;	/* handler start until reply */
+	__u32 pb_padding2;
+	/* for replay req, transno of the replay sent before it, 0 if none */
+	__u64 pb_replay_prev;
 	char  pb_jobid[LUSTRE_JOBID_SIZE];
 };
 #define ptlrpc_body     ptlrpc_body_v3
@@ -648,10 +651,11 @@ struct ptlrpc_body_v2 {
         /* VBR: pre-versions */
         __u64 pb_pre_versions[PTLRPC_NUM_VERSIONS];
 	__u64 pb_mbits;	/**< unused in V2 */
-        /* padding for future needs */
-	__u64 pb_padding64_0;
-	__u64 pb_padding64_1;
-	__u64 pb_padding64_2;
+	__u32 pb_reqin_time;
+	__u32 pb_nrs_time;
+	__u32 pb_handle_time;
+	__u32 pb_padding2;
+	__u64 pb_replay_prev;
 };
 
 /* message body offset for lustre_msg_v2 */
@@ -790,6 +794,15 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT_FLAGS2	 0x8000000000000000ULL /* second flags word */
 /* ocd_connect_flags2 flags */
 #define OBD_CONNECT2_FILE_SECCTX	0x1ULL /* set file security context at create */
+/* 0x2 - 0x8000000000 are reserved for flags assigned on the master branch */
+/** MDS_BATCH of metadata ops */
+#define OBD_CONNECT2_BATCH_RPC		0x10000000000ULL
+/** pipelined replay ordered by pb_replay_prev */
+#define OBD_CONNECT2_REPLAY_WINDOW	0x20000000000ULL
+/** OBD_PING for all targets of a server node */
+#define OBD_CONNECT2_PING_AGGR		0x40000000000ULL
+/** several locks in one LDLM_BL_CALLBACK */
+#define OBD_CONNECT2_BL_AST_BATCH	0x80000000000ULL
 
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
@@ -838,7 +851,11 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_SUBTREE | OBD_CONNECT_LARGE_ACL | \
 				OBD_CONNECT_FLAGS2)
 
-#define MDT_CONNECT_SUPPORTED2 OBD_CONNECT2_FILE_SECCTX
+#define MDT_CONNECT_SUPPORTED2 (OBD_CONNECT2_FILE_SECCTX | \
+				OBD_CONNECT2_BATCH_RPC | \
+				OBD_CONNECT2_REPLAY_WINDOW | \
+				OBD_CONNECT2_PING_AGGR | \
+				OBD_CONNECT2_BL_AST_BATCH)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -856,8 +873,10 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_LAYOUTLOCK | OBD_CONNECT_FID | \
 				OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK | \
 				OBD_CONNECT_BULK_MBITS | \
-				OBD_CONNECT_GRANT_PARAM)
-#define OST_CONNECT_SUPPORTED2 0
+				OBD_CONNECT_GRANT_PARAM | \
+				OBD_CONNECT_FLAGS2)
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_PING_AGGR | \
+				OBD_CONNECT2_BL_AST_BATCH)
 
 #define ECHO_CONNECT_SUPPORTED 0
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1530,6 +1549,7 @@ typedef enum {
 	MDS_HSM_CT_REGISTER	= 59,
 	MDS_HSM_CT_UNREGISTER	= 60,
 	MDS_SWAP_LAYOUTS	= 61,
+	MDS_BATCH		= 62,
 	MDS_LAST_OPC
 } mds_cmd_t;
 
@@ -2373,6 +2393,13 @@ struct ldlm_request {
         struct lustre_handle lock_handle[LDLM_LOCKREQ_HANDLES];
 };
 
+/**
+ * Maximum number of locks a batched LDLM_BL_CALLBACK may carry, see
+ * OBD_CONNECT2_BL_AST_BATCH. Each lock takes one struct ldlm_request, and
+ * the whole request has to fit into LDLM_MAXREQSIZE on the client.
+ */
+#define LDLM_BL_BATCH_MAX	32
+
 struct ldlm_reply {
         __u32 lock_flags;
         __u32 lock_padding;     /* also fix lustre_swab_ldlm_reply */
@@ -2500,6 +2527,12 @@ typedef enum {
 } obd_cmd_t;
 #define OBD_FIRST_OPC OBD_PING
 
+/**
+ * Maximum number of other targets an OBD_PING may carry the export handles
+ * of, see OBD_CONNECT2_PING_AGGR. The reply returns one status per handle.
+ */
+#define OBD_PING_AGGR_MAX	64
+
 /**
  * llog contexts indices.
  *
@@ -3353,6 +3386,45 @@ struct close_data {
 	__u64			cd_reserved[8];
 };
 
+/** sub-operation codes carried by an MDS_BATCH request */
+enum mdt_batch_opc {
+	MBOP_GETATTR		= 1, /* getattr by mbop_fid */
+	MBOP_GETATTR_NAME	= 2, /* lookup name under mbop_fid */
+};
+
+/** mdt_batch_op::mbop_flags */
+enum mdt_batch_op_flags {
+	/* grant a PR lock on the child to mbop_lockh if it can be granted
+	 * without waiting; only for MBOP_GETATTR_NAME */
+	MBOP_FL_LOCK		= 0x00000001,
+};
+
+/** maximum number of sub-operations packed in one MDS_BATCH request */
+#define MDT_BATCH_MAX_OPS	64
+
+/**
+ * One sub-operation of an MDS_BATCH request. The sub-operations are
+ * independent of each other and are not executed atomically; each gets its
+ * own struct mdt_batch_rep at the same index in the reply.
+ */
+struct mdt_batch_op {
+	__u32		mbop_opc;	/* enum mdt_batch_opc */
+	__u32		mbop_flags;	/* enum mdt_batch_op_flags */
+	struct lu_fid	mbop_fid;	/* target, or parent for names */
+	__u64		mbop_valid;	/* OBD_MD_* wanted in the reply */
+	__u32		mbop_name_off;	/* name offset in RMF_MDT_BATCH_NAMES */
+	__u32		mbop_name_len;	/* name length, without NUL */
+	struct lustre_handle mbop_lockh; /* client lock for MBOP_FL_LOCK */
+};
+
+struct mdt_batch_rep {
+	__s32		mbr_status;	/* per-op result, 0 or -errno */
+	__u32		mbr_padding;
+	struct lustre_handle mbr_lockh;	/* granted lock, or zero */
+	__u64		mbr_lock_bits;	/* inodebits of mbr_lockh */
+	struct mdt_body	mbr_body;
+};
+
 /* Update llog format */
 struct update_op {
 	struct lu_fid	uop_fid;
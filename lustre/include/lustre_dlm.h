@@ -65,6 +65,10 @@ extern struct kset *ldlm_svc_kset;
 #define LDLM_DEFAULT_MAX_ALIVE		3900	/* 3900 seconds ~65 min */
 #define LDLM_CTIME_AGE_LIMIT (10)
 #define LDLM_DEFAULT_PARALLEL_AST_LIMIT 1024
+/* Reuse count above which a lock is not deemed any hotter */
+#define LDLM_LRU_REUSE_MAX		15
+/* Most laps the cost-aware LRU policy gives a lock between two uses */
+#define LDLM_LRU_LAPS_MAX		4
 
 /**
  * LDLM non-error return states
@@ -274,6 +278,7 @@ typedef int (*ldlm_res_policy)(struct ldlm_namespace *, struct ldlm_lock **,
 			       __u64 flags, void *data);
 
 typedef int (*ldlm_cancel_cbt)(struct ldlm_lock *lock);
+typedef unsigned long (*ldlm_weigh_cbt)(struct ldlm_lock *lock);
 
 /**
  * LVB operations.
@@ -338,6 +343,34 @@ enum {
 	LDLM_NSS_LAST
 };
 
+/**
+ * How a client namespace picks the LRU locks to cancel.
+ * \see ldlm_prepare_lru_list()
+ */
+enum ldlm_lru_policy {
+	/** Least recently used locks first */
+	LDLM_LRU_POLICY_AGE	= 0,
+	/**
+	 * Least recently used locks first, but expensive locks are given
+	 * extra laps in the LRU so that cheaper ones go before them
+	 */
+	LDLM_LRU_POLICY_COST,
+	LDLM_LRU_POLICY_NR
+};
+
+/** Per-policy LRU stats, \see ldlm_namespace::ns_lru_stats */
+enum {
+	/** Locks taken back from the LRU for reuse */
+	LDLM_LRU_HIT_STAT	= 0,
+	/** Locks cancelled from the LRU, summing their cancel cost */
+	LDLM_LRU_CANCEL_STAT,
+	/** Laps given to expensive locks by the cost policy */
+	LDLM_LRU_KEPT_STAT,
+	LDLM_LRU_LAST_STAT
+};
+
+#define LDLM_LRU_STAT(policy, stat)	((policy) * LDLM_LRU_LAST_STAT + (stat))
+
 enum ldlm_ns_type {
 	LDLM_NS_TYPE_UNKNOWN = 0,	/**< invalid type */
 	LDLM_NS_TYPE_MDC,		/**< MDC namespace */
@@ -496,15 +529,34 @@ struct ldlm_namespace {
 	/** Limit of parallel AST RPC count. */
 	unsigned		ns_max_parallel_ast;
 
+	/**
+	 * Maximum number of locks of one export sent in a single blocking
+	 * AST RPC, 0 or 1 disables batching. See OBD_CONNECT2_BL_AST_BATCH.
+	 */
+	unsigned		ns_bl_batch_max;
+
 	/**
 	 * Callback to check if a lock is good to be canceled by ELC or
 	 * during recovery.
 	 */
 	ldlm_cancel_cbt		ns_cancel;
 
+	/**
+	 * Callback returning what it would cost to refetch the data cached
+	 * under a lock once it is cancelled, e.g. its number of pages.
+	 * Used by the cost-aware LRU policy.
+	 */
+	ldlm_weigh_cbt		ns_weigh;
+
+	/** How locks are picked for cancellation from the LRU */
+	enum ldlm_lru_policy	ns_lru_policy;
+
 	/** LDLM lock stats */
 	struct lprocfs_stats	*ns_stats;
 
+	/** LRU stats, for each LRU policy, \see LDLM_LRU_STAT() */
+	struct lprocfs_stats	*ns_lru_stats;
+
 	/**
 	 * Flag to indicate namespace is being freed. Used to determine if
 	 * recalculation of LDLM pool statistics should be skipped.
@@ -571,6 +623,13 @@ static inline void ns_register_cancel(struct ldlm_namespace *ns,
 	ns->ns_cancel = arg;
 }
 
+static inline void ns_register_weigh(struct ldlm_namespace *ns,
+				     ldlm_weigh_cbt arg)
+{
+	LASSERT(ns != NULL);
+	ns->ns_weigh = arg;
+}
+
 struct ldlm_lock;
 
 /** Type for blocking callback function of a lock. */
@@ -602,11 +661,18 @@ struct ldlm_cb_set_arg {
 	union ldlm_gl_desc		*gl_desc; /* glimpse AST descriptor */
 	ptlrpc_interpterer_t		 gl_interpret_reply;
 	void				*gl_interpret_data;
+	/* blocking ASTs waiting to be sent, one struct ldlm_bl_batch per
+	 * export; only used if bl_batch_max > 1 */
+	struct list_head		 bl_batches;
+	unsigned int			 bl_batch_max;
 };
 
+struct ldlm_bl_batch;
+
 struct ldlm_cb_async_args {
 	struct ldlm_cb_set_arg	*ca_set_arg;
 	struct ldlm_lock	*ca_lock;
+	struct ldlm_bl_batch	*ca_batch;
 };
 
 /** The ldlm_glimpse_work is allocated on the stack and should not be freed. */
@@ -617,14 +683,16 @@ struct ldlm_interval {
 	struct interval_node	li_node;  /* node for tree management */
 	struct list_head	li_group; /* the locks which have the same
 					   * policy - group of the policy */
+	__u64			li_seq;   /* position of a waiting lock in
+					   * the waiting queue, 0 if none */
 };
 #define to_ldlm_interval(n) container_of(n, struct ldlm_interval, li_node)
 
 /**
  * Interval tree for extent locks.
  * The interval tree must be accessed under the resource lock.
- * Interval trees are used for granted extent locks to speed up conflicts
- * lookup. See ldlm/interval_tree.c for more details.
+ * Interval trees are used for granted and waiting extent locks to speed up
+ * conflicts lookup. See ldlm/interval_tree.c for more details.
  */
 struct ldlm_interval_tree {
 	/** Tree size. */
@@ -633,9 +701,25 @@ struct ldlm_interval_tree {
 	struct interval_node	*lit_root; /* actual ldlm_interval */
 };
 
+/**
+ * Number of interval trees of an extent resource: one per mode for the
+ * granted locks, followed by one per mode for the waiting locks.
+ */
+#define LDLM_ITREE_NUM	(2 * LCK_MODE_NUM)
+
 /** Whether to track references to exports by LDLM locks. */
 #define LUSTRE_TRACKS_LOCK_EXP_REFS (0)
 
+/**
+ * Whether to keep the debug-only ldlm_lock fields (creator PID and blocking
+ * AST run count), which cost 8 bytes per lock.
+ */
+#ifdef CONFIG_LUSTRE_DEBUG_EXPENSIVE_CHECK
+#define LUSTRE_TRACKS_LOCK_DEBUG (1)
+#else
+#define LUSTRE_TRACKS_LOCK_DEBUG (0)
+#endif
+
 /** Cancel flags. */
 enum ldlm_cancel_flags {
 	LCF_ASYNC	= 0x1, /* Cancel locks asynchronously. */
@@ -728,19 +812,41 @@ struct ldlm_lock {
 	 */
 	struct list_head	l_res_link;
 	/**
-	 * Tree node for ldlm_extent.
+	 * Lock type specific members; the lock type is that of l_resource,
+	 * which never changes over the lock lifetime.
 	 */
-	struct ldlm_interval	*l_tree_node;
+	union {
+		/**
+		 * LDLM_PLAIN and LDLM_IBITS: linkage to the mode "skip list",
+		 * protected by lr_lock. l_sl_policy is the policy one.
+		 * For more explanations of skip lists see
+		 * ldlm/ldlm_inodebits.c
+		 */
+		struct list_head	l_sl_mode;
+		/** LDLM_EXTENT */
+		struct {
+			/** Tree node, l_sl_policy links its group. */
+			struct ldlm_interval	*l_tree_node;
+			/** Originally requested extent. */
+			struct ldlm_extent	l_req_extent;
+		};
+		/**
+		 * LDLM_FLOCK: per export hash of flock locks.
+		 * Protected by per-bucket exp->exp_flock_hash locks.
+		 */
+		struct hlist_node	l_exp_flock_hash;
+	};
+	/**
+	 * Linkage to the policy "skip list" for LDLM_PLAIN and LDLM_IBITS,
+	 * or to ldlm_interval::li_group for LDLM_EXTENT.
+	 * Protected by lr_lock.
+	 */
+	struct list_head	l_sl_policy;
 	/**
 	 * Per export hash of locks.
 	 * Protected by per-bucket exp->exp_lock_hash locks.
 	 */
 	struct hlist_node	l_exp_hash;
-	/**
-	 * Per export hash of flock locks.
-	 * Protected by per-bucket exp->exp_flock_hash locks.
-	 */
-	struct hlist_node	l_exp_flock_hash;
 	/**
 	 * Requested mode.
 	 * Protected by lr_lock.
@@ -825,9 +931,6 @@ struct ldlm_lock {
 	 */
 	ktime_t			l_last_used;
 
-	/** Originally requested extent for the extent lock. */
-	struct ldlm_extent	l_req_extent;
-
 	/*
 	 * Client-side-only members.
 	 */
@@ -839,6 +942,16 @@ struct ldlm_lock {
 	 * May be vmalloc'd, so needs to be freed with OBD_FREE_LARGE().
 	 */
 	__u32			l_lvb_len;
+	/**
+	 * Number of times the lock was taken back from the LRU for reuse,
+	 * saturating at LDLM_LRU_REUSE_MAX.
+	 */
+	__u16			l_lru_reuse;
+	/**
+	 * Laps in the LRU given by the cost-aware policy since the lock was
+	 * last used. Protected by ns_lock.
+	 */
+	__u16			l_lru_laps;
 	void			*l_lvb_data;
 
 	/** Private storage for lock user. Opaque to LDLM. */
@@ -873,6 +986,7 @@ struct ldlm_lock {
 	 */
 	cfs_time_t		l_callback_timeout;
 
+#if LUSTRE_TRACKS_LOCK_DEBUG
 	/** Local PID of process which created this lock. */
 	__u32			l_pid;
 
@@ -883,6 +997,7 @@ struct ldlm_lock {
 	 * hit. \see ldlm_work_bl_ast_lock
 	 */
 	int			l_bl_ast_run;
+#endif
 	/** List item ldlm_add_ast_work_item() for case of blocking ASTs. */
 	struct list_head	l_bl_ast;
 	/** List item ldlm_add_ast_work_item() for case of completion ASTs. */
@@ -896,13 +1011,6 @@ struct ldlm_lock {
 	 */
 	struct ldlm_lock	*l_blocking_lock;
 
-	/**
-	 * Protected by lr_lock, linkages to "skip lists".
-	 * For more explanations of skip lists see ldlm/ldlm_inodebits.c
-	 */
-	struct list_head	l_sl_mode;
-	struct list_head	l_sl_policy;
-
 	/** Reference tracking structure to debug leaked locks. */
 	struct lu_ref		l_reference;
 #if LUSTRE_TRACKS_LOCK_EXP_REFS
@@ -946,7 +1054,8 @@ struct ldlm_resource {
 
 	/**
 	 * List item for list in namespace hash.
-	 * protected by ns_lock
+	 * Changed under the hash bucket lock, walked under RCU by
+	 * ldlm_resource_get().
 	 */
 	struct hlist_node	lr_hash;
 
@@ -973,9 +1082,12 @@ struct ldlm_resource {
 	struct ldlm_res_id	lr_name;
 
 	/**
-	 * Interval trees (only for extent locks) for all modes of this resource
+	 * Interval trees (only for extent locks) for all modes of this
+	 * resource, granted locks first and then waiting locks.
 	 */
 	struct ldlm_interval_tree *lr_itree;
+	/** Last position given to an extent lock in lr_waiting */
+	__u64			lr_wait_seq;
 
 	union {
 		/**
@@ -1004,8 +1116,21 @@ struct ldlm_resource {
 
 	/** List of references to this resource. For debugging. */
 	struct lu_ref		lr_reference;
+
+	/** Delays freeing for lockless lookups still walking lr_hash */
+	struct rcu_head		lr_rcu;
 };
 
+/** PID of the process which created \a lock, 0 if not tracked. */
+static inline __u32 ldlm_lock_pid(const struct ldlm_lock *lock)
+{
+#if LUSTRE_TRACKS_LOCK_DEBUG
+	return lock->l_pid;
+#else
+	return 0;
+#endif
+}
+
 static inline bool ldlm_has_layout(struct ldlm_lock *lock)
 {
 	return lock->l_resource->lr_type == LDLM_IBITS &&
@@ -1550,6 +1675,17 @@ int ldlm_cli_enqueue_fini(struct obd_export *exp, struct ptlrpc_request *req,
 			  enum ldlm_mode mode, __u64 *flags, void *lvb,
 			  __u32 lvb_len,
 			  const struct lustre_handle *lockh, int rc);
+int ldlm_cli_enqueue_prep(struct obd_export *exp,
+			  struct ldlm_enqueue_info *einfo,
+			  const struct ldlm_res_id *res_id,
+			  union ldlm_policy_data const *policy,
+			  struct lustre_handle *lockh);
+int ldlm_cli_enqueue_grant(struct obd_export *exp,
+			   const struct lustre_handle *lockh,
+			   enum ldlm_mode mode,
+			   const struct ldlm_res_id *res_id,
+			   union ldlm_policy_data const *policy,
+			   const struct lustre_handle *remote, int rc);
 int ldlm_cli_enqueue_local(struct ldlm_namespace *ns,
 			   const struct ldlm_res_id *res_id,
 			   enum ldlm_type type, union ldlm_policy_data *policy,
@@ -242,6 +242,13 @@ struct obd_export {
 	cfs_time_t		exp_last_request_time;
 	/** On replay all requests waiting for replay are linked here */
 	struct list_head	exp_req_replay_queue;
+	/**
+	 * Last transno seen from this export while scanning the recovery
+	 * queue for gaps, and the scan it was seen in. Protected by
+	 * obd_recovery_task_lock.
+	 */
+	__u64			exp_replay_scan_last;
+	__u64			exp_replay_scan_gen;
 	/**
 	 * protects exp_flags, exp_outstanding_replies and the change
 	 * of exp_imp_reverse
@@ -318,6 +325,13 @@ static inline __u64 exp_connect_flags(struct obd_export *exp)
 	return *exp_connect_flags_ptr(exp);
 }
 
+static inline __u64 exp_connect_flags2(struct obd_export *exp)
+{
+	if (exp_connect_flags(exp) & OBD_CONNECT_FLAGS2)
+		return exp->exp_connect_data.ocd_connect_flags2;
+	return 0;
+}
+
 static inline int exp_max_brw_size(struct obd_export *exp)
 {
 	LASSERT(exp != NULL);
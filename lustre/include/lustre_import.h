@@ -45,6 +45,7 @@
 
 #include <lustre_handles.h>
 #include <lustre/lustre_idl.h>
+#include <lprocfs_status.h>
 
 
 /**
@@ -89,6 +90,34 @@ struct imp_at {
 
 /** @} */
 
+/**
+ * RPC latency breakdown
+ *
+ * Phases an RPC goes through, as seen by the client.  REQIN, NRS and HANDLE
+ * are measured by the server and returned in the reply.
+ *
+ * @{
+ */
+enum imp_rpc_lat_phase {
+	IMP_LAT_QUEUE	= 0,	/* queued on the client until sent */
+	IMP_LAT_SEND,		/* LNet send of the request */
+	IMP_LAT_REQIN,		/* server request-in until NRS enqueue */
+	IMP_LAT_NRS,		/* waiting in the server NRS queue */
+	IMP_LAT_HANDLE,		/* server handler until reply */
+	IMP_LAT_REPLY,		/* round trip less send and server time */
+	IMP_LAT_COMMIT,		/* reply until transno commit */
+	IMP_LAT_TOTAL,		/* queued until reply processed */
+	IMP_LAT_MAX
+};
+
+/** Per-opcode latency histograms of an import, values in usec */
+struct imp_rpc_latency {
+	struct list_head	irl_list;
+	__u32			irl_opc;
+	struct obd_histogram	irl_hist[IMP_LAT_MAX];
+};
+/** @} */
+
 /** Possible import states */
 enum lustre_imp_state {
         LUSTRE_IMP_CLOSED     = 1,
@@ -241,6 +270,18 @@ struct obd_import {
         int                       imp_last_generation_checked;
         /** Last tranno we replayed */
         __u64                     imp_last_replay_transno;
+	/**
+	 * Replay pipelining, protected by imp_lock:
+	 * highest transno sent for replay since the last reconnect,
+	 * highest transno possibly sent over a previous connection, and
+	 * pb_replay_prev of the lowest failed replay (~0ULL if none), which
+	 * is where replay resumes after a reconnect.
+	 * @{
+	 */
+	__u64			  imp_replay_sent_transno;
+	__u64			  imp_replay_resend_transno;
+	__u64			  imp_replay_rewind_transno;
+	/** @} */
         /** Last transno committed on remote side */
         __u64                     imp_peer_committed_transno;
         /**
@@ -322,6 +363,8 @@ struct obd_import {
 				  /* adaptive timeout data */
 	struct imp_at             imp_at;
 	time64_t		  imp_last_reply_time;	/* for health check */
+	/** per-opcode RPC latency, list of imp_rpc_latency, under imp_lock */
+	struct list_head	  imp_rpc_lat_list;
 };
 
 /* import.c */
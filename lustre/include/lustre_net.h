@@ -746,6 +746,13 @@ struct ptlrpc_request_pool {
 	int			prp_rq_size;
 	/** Function to allocate more requests for this pool */
 	int (*prp_populate)(struct ptlrpc_request_pool *, int);
+	/** # requests on prp_req_list, only counted for request caches */
+	int			prp_nr_free;
+	/**
+	 * This is a per-CPT request cache, see ptlrpc_rq_cache_get(); its
+	 * requests are taken first and their buffer may be resized.
+	 */
+	unsigned int		prp_cache:1;
 };
 
 struct lu_context;
@@ -787,8 +794,14 @@ struct ptlrpc_cli_req {
 	cfs_duration_t			 cr_delay_limit;
 	/** time request was first queued */
 	cfs_time_t			 cr_queued_time;
+	/** time request was first queued, for latency breakdown */
+	ktime_t				 cr_queued_ns;
 	/** request sent in nanoseconds */
 	ktime_t				 cr_sent_ns;
+	/** request-out callback in nanoseconds */
+	ktime_t				 cr_sent_out_ns;
+	/** reply-in callback in nanoseconds */
+	ktime_t				 cr_replied_ns;
 	/** time for request really sent out */
 	time64_t			 cr_sent_out;
 	/** when req reply unlink must finish. */
@@ -914,6 +927,10 @@ struct ptlrpc_srv_req {
 	/** @} nrs */
 	/** request arrival time */
 	struct timespec64		 sr_arrival_time;
+	/** time request was handed to NRS */
+	ktime_t				 sr_enqueued_ns;
+	/** time a service thread started handling the request */
+	ktime_t				 sr_started_ns;
 	/** server's half ctx */
 	struct ptlrpc_svc_ctx		*sr_svc_ctx;
 	/** (server side), pointed directly into req buffer */
@@ -1471,6 +1488,8 @@ struct ptlrpc_bulk_desc {
 	int			bd_md_max_brw;	/* max entries in bd_mds */
 	/** array of associated MDs */
 	struct lnet_handle_md	bd_mds[PTLRPC_BULK_OPS_COUNT];
+	/** CPU partition of the encryption page pool bd_enc_vec came from */
+	int			bd_enc_cpt;
 
 	union {
 		struct {
@@ -1622,6 +1641,8 @@ struct ptlrpc_request_buffer_desc {
 	int				rqbd_refcount;
 	/** The buffer itself */
 	char				*rqbd_buffer;
+	/** Size of rqbd_buffer, fixed when the buffer is allocated */
+	int				rqbd_buffer_size;
 	struct ptlrpc_cb_id		rqbd_cbid;
 	/**
 	 * This "embedded" request structure is only used for the
@@ -1793,6 +1814,27 @@ struct ptlrpc_service_part {
 	struct list_head		scp_req_incoming;
 	/** timeout before re-posting reqs, in tick */
 	cfs_duration_t			scp_rqbd_timeout;
+	/**
+	 * size of request buffers allocated from now on, adapted to the
+	 * observed request sizes, see ptlrpc_rqbd_adapt()
+	 */
+	int				scp_buf_size;
+	/** # request buffers to keep posted, adapted like scp_buf_size */
+	int				scp_nbuf_per_group;
+	/** # times all posted request buffers were in use */
+	__u64				scp_rqbd_busy;
+	/** # requests received since the last adaption */
+	int				scp_adapt_nreqs;
+	/** # times all buffers were in use since the last adaption */
+	int				scp_adapt_busy;
+	/** # consecutive adaption intervals without buffer shortage */
+	int				scp_adapt_idle;
+	/** total size of requests received since the last adaption */
+	__u64				scp_adapt_bytes;
+	/** time of the last adaption, in seconds */
+	time64_t			scp_adapt_time;
+	/** log2 histogram of incoming request sizes */
+	struct obd_histogram		scp_req_size_hist;
 	/**
 	 * all threads sleep on this. This wait-queue is signalled when new
 	 * incoming request arrives and when difficult reply has to be handled.
@@ -2299,6 +2341,8 @@ void ptlrpc_server_drop_request(struct ptlrpc_request *req);
 void ptlrpc_request_change_export(struct ptlrpc_request *req,
 				  struct obd_export *export);
 void ptlrpc_update_export_timer(struct obd_export *exp, long extra_delay);
+bool ptlrpc_server_times(struct ptlrpc_request *req, __u32 *reqin_time,
+			 __u32 *nrs_time, __u32 *handle_time);
 
 int ptlrpc_hr_init(void);
 void ptlrpc_hr_fini(void);
@@ -2378,6 +2422,7 @@ __u16 lustre_msg_get_tag(struct lustre_msg *msg);
 __u64 lustre_msg_get_last_committed(struct lustre_msg *msg);
 __u64 *lustre_msg_get_versions(struct lustre_msg *msg);
 __u64 lustre_msg_get_transno(struct lustre_msg *msg);
+__u64 lustre_msg_get_replay_prev(struct lustre_msg *msg);
 __u64 lustre_msg_get_slv(struct lustre_msg *msg);
 __u32 lustre_msg_get_limit(struct lustre_msg *msg);
 void lustre_msg_set_slv(struct lustre_msg *msg, __u64 slv);
@@ -2387,6 +2432,8 @@ __u32 lustre_msg_get_conn_cnt(struct lustre_msg *msg);
 __u32 lustre_msg_get_magic(struct lustre_msg *msg);
 __u32 lustre_msg_get_timeout(struct lustre_msg *msg);
 __u32 lustre_msg_get_service_time(struct lustre_msg *msg);
+void lustre_msg_get_server_times(struct lustre_msg *msg, __u32 *reqin_time,
+				 __u32 *nrs_time, __u32 *handle_time);
 char *lustre_msg_get_jobid(struct lustre_msg *msg);
 __u32 lustre_msg_get_cksum(struct lustre_msg *msg);
 __u64 lustre_msg_get_mbits(struct lustre_msg *msg);
@@ -2399,12 +2446,15 @@ void lustre_msg_set_tag(struct lustre_msg *msg, __u16 tag);
 void lustre_msg_set_last_committed(struct lustre_msg *msg,__u64 last_committed);
 void lustre_msg_set_versions(struct lustre_msg *msg, __u64 *versions);
 void lustre_msg_set_transno(struct lustre_msg *msg, __u64 transno);
+void lustre_msg_set_replay_prev(struct lustre_msg *msg, __u64 transno);
 void lustre_msg_set_status(struct lustre_msg *msg, __u32 status);
 void lustre_msg_set_conn_cnt(struct lustre_msg *msg, __u32 conn_cnt);
 void ptlrpc_req_set_repsize(struct ptlrpc_request *req, int count, __u32 *sizes);
 void ptlrpc_request_set_replen(struct ptlrpc_request *req);
 void lustre_msg_set_timeout(struct lustre_msg *msg, __u32 timeout);
 void lustre_msg_set_service_time(struct lustre_msg *msg, __u32 service_time);
+void lustre_msg_set_server_times(struct lustre_msg *msg, __u32 reqin_time,
+				 __u32 nrs_time, __u32 handle_time);
 void lustre_msg_set_jobid(struct lustre_msg *msg, char *jobid);
 void lustre_msg_set_cksum(struct lustre_msg *msg, __u32 cksum);
 void lustre_msg_set_mbits(struct lustre_msg *msg, __u64 mbits);
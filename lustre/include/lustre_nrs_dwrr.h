@@ -0,0 +1,200 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) Deficit Weighted Round Robin (DWRR) policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_DWRR_H
+#define _LUSTRE_NRS_DWRR_H
+
+/**
+ * \name DWRR
+ *
+ * DWRR, Deficit Weighted Round Robin over client NIDs or JobIDs
+ * @{
+ */
+
+/** Default number of bytes a weight-1 class may be served per round */
+#define NRS_DWRR_QUANTUM_DEFAULT	(1 << 20)
+/** Default fixed cost charged for every RPC, on top of its bulk bytes */
+#define NRS_DWRR_RPC_COST_DEFAULT	(16 << 10)
+/** Upper limit for the per-class weight */
+#define NRS_DWRR_WEIGHT_MAX		1024
+/** Maximum number of weight rules per policy instance */
+#define NRS_DWRR_RULES_MAX		16
+#define NRS_DWRR_NAME_LEN		16
+
+/**
+ * How DWRR classifies requests into scheduling classes.
+ */
+enum nrs_dwrr_type {
+	NRS_DWRR_TYPE_NID	= 0,
+	NRS_DWRR_TYPE_JOBID,
+};
+
+/**
+ * A weight rule, matching either a NID list or a JobID list.
+ *
+ * Rules are parsed once in process context and then shared by reference
+ * between the policy instances of all service partitions, so that no
+ * allocation is needed while holding ptlrpc_nrs::nrs_lock.
+ */
+struct nrs_dwrr_rule {
+	char				dr_name[NRS_DWRR_NAME_LEN];
+	enum nrs_dwrr_type		dr_type;
+	/** Original match string, for dumping the rule */
+	char			       *dr_match_str;
+	/** Parsed NID list or list of struct nrs_tbf_jobid */
+	struct list_head		dr_match;
+	__u32				dr_weight;
+	atomic_t			dr_ref;
+};
+
+/**
+ * Private data structure for DWRR NRS
+ */
+struct nrs_dwrr_head {
+	struct ptlrpc_nrs_resource	dh_res;
+	struct cfs_binheap	       *dh_binheap;
+	struct cfs_hash		       *dh_cli_hash;
+	enum nrs_dwrr_type		dh_type;
+	/**
+	 * Used when a new scheduling round commences, in order to synchronize
+	 * all classes with the new round number.
+	 */
+	__u64				dh_round;
+	/**
+	 * Determines the relevant ordering amongst request batches within a
+	 * scheduling round.
+	 */
+	__u64				dh_sequence;
+	/**
+	 * Number of bytes a class of weight 1 may be served in a single
+	 * scheduling round.
+	 */
+	__u32				dh_quantum;
+	/**
+	 * Fixed number of bytes every RPC is charged, in addition to the size
+	 * of its bulk transfer.
+	 */
+	__u32				dh_rpc_cost;
+	/** Bumped whenever the rule set changes, so classes re-match. */
+	__u64				dh_rule_gen;
+	/** Weight rules; the first matching rule wins. */
+	struct nrs_dwrr_rule	       *dh_rules[NRS_DWRR_RULES_MAX];
+};
+
+/**
+ * Key identifying a DWRR scheduling class; only the member selected by
+ * nrs_dwrr_head::dh_type is set, the rest is zeroed.
+ */
+struct nrs_dwrr_key {
+	lnet_nid_t			dk_nid;
+	char				dk_jobid[LUSTRE_JOBID_SIZE];
+};
+
+/**
+ * Object representing a DWRR scheduling class, as identified by either the
+ * client NID or the JobID.
+ */
+struct nrs_dwrr_client {
+	struct ptlrpc_nrs_resource	dc_res;
+	struct hlist_node		dc_hnode;
+	struct nrs_dwrr_key		dc_key;
+	/**
+	 * The round number against which this class is currently scheduling
+	 * requests.
+	 */
+	__u64				dc_round;
+	/**
+	 * The sequence number used for requests scheduled by this class during
+	 * the current round number.
+	 */
+	__u64				dc_sequence;
+	/**
+	 * Bytes this class may still be served in round nrs_dwrr_client::
+	 * dc_round; always positive between enqueues.
+	 */
+	__s64				dc_deficit;
+	/** nrs_dwrr_head::dh_rule_gen at the time dc_weight was computed */
+	__u64				dc_rule_gen;
+	atomic_t			dc_ref;
+	__u32				dc_weight;
+	/**
+	 * # of pending requests for this class, on all existing rounds
+	 */
+	__u32				dc_active;
+};
+
+/**
+ * DWRR NRS request definition
+ */
+struct nrs_dwrr_req {
+	/**
+	 * Round number for this request; shared with all other requests in the
+	 * same batch.
+	 */
+	__u64			dr_round;
+	/**
+	 * Sequence number for this request; shared with all other requests in
+	 * the same batch.
+	 */
+	__u64			dr_sequence;
+};
+
+/**
+ * DWRR policy operations.
+ */
+enum nrs_ctl_dwrr {
+	/**
+	 * Read the per-round byte quantum of a DWRR policy.
+	 */
+	NRS_CTL_DWRR_RD_QUANTUM = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	/**
+	 * Write the per-round byte quantum of a DWRR policy.
+	 */
+	NRS_CTL_DWRR_WR_QUANTUM,
+	/**
+	 * Read the fixed per-RPC cost of a DWRR policy.
+	 */
+	NRS_CTL_DWRR_RD_RPC_COST,
+	/**
+	 * Write the fixed per-RPC cost of a DWRR policy.
+	 */
+	NRS_CTL_DWRR_WR_RPC_COST,
+	/**
+	 * Dump the weight rules of a DWRR policy.
+	 */
+	NRS_CTL_DWRR_RD_RULE,
+	/**
+	 * Add a weight rule to a DWRR policy.
+	 */
+	NRS_CTL_DWRR_ADD_RULE,
+	/**
+	 * Remove a weight rule from a DWRR policy, by name.
+	 */
+	NRS_CTL_DWRR_DEL_RULE,
+};
+
+/** @} DWRR */
+#endif
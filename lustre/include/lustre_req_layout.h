@@ -112,6 +112,8 @@ __u32 req_capsule_msg_size(struct req_capsule *pill, enum req_location loc);
 __u32 req_capsule_fmt_size(__u32 magic, const struct req_format *fmt,
                          enum req_location loc);
 void req_capsule_extend(struct req_capsule *pill, const struct req_format *fmt);
+size_t req_capsule_fmt_count(void);
+size_t req_capsule_fmt_index(const struct req_format *fmt);
 
 int req_capsule_has_field(const struct req_capsule *pill,
                           const struct req_msg_field *field,
@@ -130,6 +132,7 @@ int  req_layout_init(void);
 void req_layout_fini(void);
 
 extern struct req_format RQF_OBD_PING;
+extern struct req_format RQF_OBD_PING_AGGR;
 extern struct req_format RQF_OBD_SET_INFO;
 extern struct req_format RQF_SEC_CTX;
 extern struct req_format RQF_OBD_IDX_READ;
@@ -175,6 +178,7 @@ extern struct req_format RQF_MDS_REINT_SETXATTR;
 extern struct req_format RQF_MDS_QUOTACTL;
 extern struct req_format RQF_QUOTA_DQACQ;
 extern struct req_format RQF_MDS_SWAP_LAYOUTS;
+extern struct req_format RQF_MDS_BATCH;
 extern struct req_format RQF_MDS_REINT_MIGRATE;
 /* MDS hsm formats */
 extern struct req_format RQF_MDS_HSM_STATE_GET;
@@ -222,6 +226,7 @@ extern struct req_format RQF_LDLM_CANCEL;
 extern struct req_format RQF_LDLM_CALLBACK;
 extern struct req_format RQF_LDLM_CP_CALLBACK;
 extern struct req_format RQF_LDLM_BL_CALLBACK;
+extern struct req_format RQF_LDLM_BL_CALLBACK_BATCH;
 extern struct req_format RQF_LDLM_GL_CALLBACK;
 extern struct req_format RQF_LDLM_GL_DESC_CALLBACK;
 /* LOG req_format */
@@ -254,6 +259,8 @@ extern struct req_msg_field RMF_GETINFO_VAL;
 extern struct req_msg_field RMF_GETINFO_VALLEN;
 extern struct req_msg_field RMF_GETINFO_KEY;
 extern struct req_msg_field RMF_IDX_INFO;
+extern struct req_msg_field RMF_OBD_PING_HANDLES;
+extern struct req_msg_field RMF_OBD_PING_STATUS;
 extern struct req_msg_field RMF_CLOSE_DATA;
 extern struct req_msg_field RMF_FILE_SECCTX_NAME;
 extern struct req_msg_field RMF_FILE_SECCTX;
@@ -264,6 +271,8 @@ extern struct req_msg_field RMF_FILE_SECCTX;
 extern struct req_msg_field RMF_CONN;
 extern struct req_msg_field RMF_CONNECT_DATA;
 extern struct req_msg_field RMF_DLM_REQ;
+extern struct req_msg_field RMF_DLM_BL_BATCH;
+extern struct req_msg_field RMF_DLM_BL_STATUS;
 extern struct req_msg_field RMF_DLM_REP;
 extern struct req_msg_field RMF_DLM_LVB;
 extern struct req_msg_field RMF_DLM_GL_DESC;
@@ -283,6 +292,9 @@ extern struct req_msg_field RMF_OBD_QUOTACTL;
 extern struct req_msg_field RMF_QUOTA_BODY;
 extern struct req_msg_field RMF_STRING;
 extern struct req_msg_field RMF_SWAP_LAYOUTS;
+extern struct req_msg_field RMF_MDT_BATCH_OPS;
+extern struct req_msg_field RMF_MDT_BATCH_NAMES;
+extern struct req_msg_field RMF_MDT_BATCH_REP;
 extern struct req_msg_field RMF_MDS_HSM_PROGRESS;
 extern struct req_msg_field RMF_MDS_HSM_REQUEST;
 extern struct req_msg_field RMF_MDS_HSM_USER_ITEM;
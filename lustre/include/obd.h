@@ -647,6 +647,8 @@ struct obd_device {
 	__u64			obd_next_recovery_transno;
 	int			obd_replayed_requests;
 	int			obd_requests_queued_for_recovery;
+	/* recovery queue scan generation, see check_for_replay_gap() */
+	__u64			obd_replay_scan_gen;
 	wait_queue_head_t	obd_next_transno_waitq;
 	/* protected by obd_recovery_task_lock */
 	struct timer_list	obd_recovery_timer;
@@ -843,6 +845,30 @@ struct md_op_data {
 
 };
 
+/**
+ * One sub-operation of md_batch(). The caller fills mbi_op_data and
+ * mbi_opc; mbi_status and mbi_body are filled in from the reply.
+ *
+ * mbi_op_data uses op_fid1 as the target (or parent for names), op_name and
+ * op_namelen for MBOP_GETATTR_NAME, and op_valid for the wanted OBD_MD_*
+ * bits. For names in striped directories op_mea1 must be set, so that LMV
+ * can route the lookup to the right stripe.
+ *
+ * If mbi_einfo is set on an MBOP_GETATTR_NAME item, the MDT is asked for an
+ * inodebits lock on the child, expected on op_fid2 if that is known. The
+ * server may refuse it; if it is granted, mbi_lockh and mbi_lock_bits are
+ * set and the caller owns a reference of mode ei_mode on the lock.
+ */
+struct md_batch_item {
+	struct md_op_data	*mbi_op_data;
+	__u32			 mbi_opc;	/* enum mdt_batch_opc */
+	int			 mbi_status;
+	struct mdt_body		 mbi_body;
+	struct ldlm_enqueue_info *mbi_einfo;
+	struct lustre_handle	 mbi_lockh;
+	__u64			 mbi_lock_bits;
+};
+
 struct md_callback {
 	int (*md_blocking_ast)(struct ldlm_lock *lock,
 			       struct ldlm_lock_desc *desc,
@@ -1063,7 +1089,9 @@ struct md_ops {
         int (*m_revalidate_lock)(struct obd_export *, struct lookup_intent *,
                                  struct lu_fid *, __u64 *bits);
 
-#define MD_STATS_LAST_OP m_revalidate_lock
+	int (*m_batch)(struct obd_export *, struct md_batch_item *, int);
+
+#define MD_STATS_LAST_OP m_batch
 
 	int (*m_get_root)(struct obd_export *, const char *, struct lu_fid *);
 	int (*m_null_inode)(struct obd_export *, const struct lu_fid *);
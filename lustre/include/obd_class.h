@@ -1610,6 +1610,23 @@ static inline int md_revalidate_lock(struct obd_export *exp,
         RETURN(rc);
 }
 
+/**
+ * Execute \a count independent metadata sub-operations in as few RPCs as
+ * possible. Each item gets its own status in md_batch_item::mbi_status;
+ * the return value only reports failures of the batch as a whole, e.g.
+ * -EOPNOTSUPP when the server does not support MDS_BATCH.
+ */
+static inline int md_batch(struct obd_export *exp,
+			   struct md_batch_item *items, int count)
+{
+	int rc;
+	ENTRY;
+	EXP_CHECK_MD_OP(exp, batch);
+	EXP_MD_COUNTER_INCREMENT(exp, batch);
+	rc = MDP(exp->exp_obd, batch)(exp, items, count);
+	RETURN(rc);
+}
+
 static inline int md_get_fid_from_lsm(struct obd_export *exp,
 				      const struct lmv_stripe_md *lsm,
 				      const char *name, int namelen,
@@ -56,6 +56,25 @@
 
 #include "ldlm_internal.h"
 
+static inline int ldlm_mode_to_index(enum ldlm_mode mode)
+{
+	int index;
+
+	LASSERT(mode != 0);
+	LASSERT(is_power_of_2(mode));
+	for (index = -1; mode != 0; index++, mode >>= 1)
+		/* do nothing */;
+	LASSERT(index < LCK_MODE_NUM);
+	return index;
+}
+
+/** Interval tree of the waiting locks of \a mode on \a res. */
+static inline struct ldlm_interval_tree *
+ldlm_extent_waiting_tree(struct ldlm_resource *res, enum ldlm_mode mode)
+{
+	return &res->lr_itree[LCK_MODE_NUM + ldlm_mode_to_index(mode)];
+}
+
 #ifdef HAVE_SERVER_SUPPORT
 # define LDLM_MAX_GROWN_EXTENT (32 * 1024 * 1024 - 1)
 
@@ -358,6 +377,140 @@ static enum interval_iter ldlm_extent_compat_cb(struct interval_node *n,
         RETURN(INTERVAL_ITER_CONT);
 }
 
+struct ldlm_extent_waiting_args {
+	struct list_head	*ewa_work_list;
+	struct ldlm_lock	*ewa_lock;
+	/** only the locks queued before this position are considered */
+	__u64			 ewa_limit;
+	int			*ewa_locks;
+	int			 ewa_compat;
+};
+
+/* Find the first waiting lock covering a PR request which it does not wait
+ * for, see the linear walk in ldlm_extent_compat_queue(). */
+static enum interval_iter ldlm_extent_waiting_cover_cb(struct interval_node *n,
+						       void *data)
+{
+	struct ldlm_extent_waiting_args *priv = data;
+	struct ldlm_extent *extent = &priv->ewa_lock->l_policy_data.l_extent;
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct ldlm_lock *lock;
+
+	if (interval_low(n) > extent->start || interval_high(n) < extent->end)
+		return INTERVAL_ITER_CONT;
+
+	/* the policy group is sorted by queue position */
+	list_for_each_entry(lock, &node->li_group, l_sl_policy) {
+		if (lock->l_tree_node->li_seq >= priv->ewa_limit)
+			break;
+		if (!ldlm_is_ast_sent(lock)) {
+			priv->ewa_limit = lock->l_tree_node->li_seq;
+			break;
+		}
+	}
+	return INTERVAL_ITER_CONT;
+}
+
+static enum interval_iter
+ldlm_extent_waiting_conflict_cb(struct interval_node *n, void *data)
+{
+	struct ldlm_extent_waiting_args *priv = data;
+	struct ldlm_lock *req = priv->ewa_lock;
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct ldlm_lock *lock;
+	int check_contention;
+
+	list_for_each_entry(lock, &node->li_group, l_sl_policy) {
+		if (lock->l_tree_node->li_seq >= priv->ewa_limit)
+			break;
+
+		priv->ewa_compat = 0;
+		if (priv->ewa_work_list == NULL)
+			return INTERVAL_ITER_STOP;
+
+		/* false contention, the requests doesn't really overlap */
+		check_contention =
+			!(lock->l_req_extent.end < req->l_req_extent.start ||
+			  lock->l_req_extent.start > req->l_req_extent.end);
+
+		/* don't count conflicting glimpse locks */
+		if (lock->l_req_mode == LCK_PR &&
+		    interval_low(n) == 0 && interval_high(n) == OBD_OBJECT_EOF)
+			check_contention = 0;
+
+		*priv->ewa_locks += check_contention;
+
+		if (lock->l_blocking_ast)
+			ldlm_add_ast_work_item(lock, req, priv->ewa_work_list);
+	}
+	return INTERVAL_ITER_CONT;
+}
+
+/**
+ * Check \a req against the waiting queue using the waiting interval trees,
+ * with the same outcome as walking lr_waiting: only the locks queued before
+ * \a req are considered, and a PR request stops at the first compatible
+ * lock covering it which is not being cancelled.
+ *
+ * GROUP locks are reordered in the queue and are not kept in the trees, so
+ * this must not be used when a GROUP lock is requested or waiting.
+ *
+ * \retval true if the walk was stopped by a covering lock, the contention
+ *	   check is skipped then
+ */
+static bool ldlm_extent_compat_waiting(struct ldlm_lock *req,
+				       struct list_head *work_list,
+				       int *contended_locks, int *compat)
+{
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_interval *req_node = req->l_tree_node;
+	struct ldlm_extent_waiting_args data = {
+		.ewa_work_list	= work_list,
+		.ewa_lock	= req,
+		.ewa_limit	= ~0ULL,
+		.ewa_locks	= contended_locks,
+		.ewa_compat	= 1,
+	};
+	struct interval_node_extent ex;
+	struct ldlm_interval_tree *tree;
+	__u64 limit;
+	int idx;
+
+	/* \a req is in the queue already when it is reprocessed */
+	if (req_node != NULL && req_node->li_seq != 0)
+		data.ewa_limit = req_node->li_seq;
+	limit = data.ewa_limit;
+
+	if (req->l_req_mode == LCK_PR) {
+		ex.start = req->l_policy_data.l_extent.start;
+		ex.end = req->l_policy_data.l_extent.end;
+		for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+			tree = &res->lr_itree[LCK_MODE_NUM + idx];
+			if (tree->lit_root == NULL ||
+			    !lockmode_compat(tree->lit_mode, LCK_PR))
+				continue;
+			interval_search(tree->lit_root, &ex,
+					ldlm_extent_waiting_cover_cb, &data);
+		}
+	}
+
+	ex.start = req->l_req_extent.start;
+	ex.end = req->l_req_extent.end;
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		tree = &res->lr_itree[LCK_MODE_NUM + idx];
+		if (tree->lit_root == NULL ||
+		    lockmode_compat(tree->lit_mode, req->l_req_mode))
+			continue;
+		interval_search(tree->lit_root, &ex,
+				ldlm_extent_waiting_conflict_cb, &data);
+		if (data.ewa_compat == 0 && work_list == NULL)
+			break;
+	}
+
+	*compat = data.ewa_compat;
+	return data.ewa_limit < limit;
+}
+
 /**
  * Determine if the lock is compatible with all locks on the queue.
  *
@@ -449,7 +602,14 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
                                         compat = 0;
                         }
                 }
-        } else { /* for waiting queue */
+	} else if (req_mode != LCK_GROUP &&
+		   ldlm_extent_waiting_tree(res, LCK_GROUP)->lit_size == 0) {
+		/* no GROUP lock is involved, use the waiting trees */
+		if (ldlm_extent_compat_waiting(req, work_list, contended_locks,
+					       &compat) ||
+		    (compat == 0 && work_list == NULL))
+			RETURN(compat);
+	} else { /* for waiting queue */
 		list_for_each_entry(lock, queue, l_res_link) {
                         check_contention = 1;
 
@@ -627,7 +787,7 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 
         RETURN(compat);
 destroylock:
-	list_del_init(&req->l_res_link);
+	ldlm_resource_unlink_lock(req);
         ldlm_lock_destroy_nolock(req);
         *err = compat;
         RETURN(compat);
@@ -990,18 +1150,6 @@ struct ldlm_interval *ldlm_interval_detach(struct ldlm_lock *l)
 	return list_empty(&n->li_group) ? n : NULL;
 }
 
-static inline int ldlm_mode_to_index(enum ldlm_mode mode)
-{
-	int index;
-
-	LASSERT(mode != 0);
-	LASSERT(is_power_of_2(mode));
-	for (index = -1; mode != 0; index++, mode >>= 1)
-		/* do nothing */;
-	LASSERT(index < LCK_MODE_NUM);
-	return index;
-}
-
 /** Add newly granted lock into interval tree for the resource. */
 void ldlm_extent_add_lock(struct ldlm_resource *res,
                           struct ldlm_lock *lock)
@@ -1062,6 +1210,85 @@ void ldlm_extent_add_lock(struct ldlm_resource *res,
 	}
 }
 
+/**
+ * Index a lock just queued on lr_waiting of \a res, in order to speed up
+ * ldlm_extent_compat_queue() on long waiting queues.
+ *
+ * The lock is given its position in the queue. Unless it is a GROUP lock,
+ * its own interval node, unused until the lock is granted, is inserted in
+ * the waiting tree of its mode. Locks with the same mode and extent share
+ * the node of the first of them, in queue order.
+ */
+void ldlm_extent_add_waiting_lock(struct ldlm_resource *res,
+				  struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_extent *extent = &lock->l_policy_data.l_extent;
+	struct ldlm_interval_tree *tree;
+	struct interval_node *found;
+	int rc;
+
+	/* a lock moved within the queue keeps its position */
+	if (node == NULL || node->li_seq != 0)
+		return;
+
+	LASSERT(!interval_is_intree(&node->li_node));
+	node->li_seq = ++res->lr_wait_seq;
+
+	tree = ldlm_extent_waiting_tree(res, lock->l_req_mode);
+	tree->lit_size++;
+	if (lock->l_req_mode == LCK_GROUP)
+		return;
+
+	rc = interval_set(&node->li_node, extent->start, extent->end);
+	LASSERT(!rc);
+
+	found = interval_insert(&node->li_node, &tree->lit_root);
+	if (found != NULL)
+		list_move_tail(&lock->l_sl_policy,
+			       &to_ldlm_interval(found)->li_group);
+}
+
+/**
+ * Remove a lock leaving lr_waiting from the waiting tree, and give it back
+ * its own interval node for ldlm_extent_add_lock().
+ */
+static void ldlm_extent_del_waiting_lock(struct ldlm_lock *lock)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_interval_tree *tree;
+	struct ldlm_interval *next;
+
+	node->li_seq = 0;
+	tree = ldlm_extent_waiting_tree(res, lock->l_req_mode);
+	tree->lit_size--;
+	if (lock->l_req_mode == LCK_GROUP)
+		return;
+
+	if (!interval_is_intree(&node->li_node)) {
+		/* it shares the node of an earlier lock */
+		list_move(&lock->l_sl_policy, &node->li_group);
+		return;
+	}
+
+	list_del_init(&lock->l_sl_policy);
+	interval_erase(&node->li_node, &tree->lit_root);
+	if (!list_empty(&node->li_group)) {
+		/* the next lock of the group takes over with its own node,
+		 * the extent is taken from the tree node since the lock
+		 * extent may be expanded already */
+		next = list_entry(node->li_group.next, struct ldlm_lock,
+				  l_sl_policy)->l_tree_node;
+		LASSERT(list_empty(&next->li_group));
+		list_splice_init(&node->li_group, &next->li_group);
+		interval_set(&next->li_node, interval_low(&node->li_node),
+			     interval_high(&node->li_node));
+		interval_insert(&next->li_node, &tree->lit_root);
+	}
+	list_add(&lock->l_sl_policy, &node->li_group);
+}
+
 /** Remove cancelled lock from resource interval tree. */
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 {
@@ -1070,6 +1297,11 @@ void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 	struct ldlm_interval_tree *tree;
 	int idx;
 
+	if (node != NULL && node->li_seq != 0) {
+		ldlm_extent_del_waiting_lock(lock);
+		return;
+	}
+
 	if (!node || !interval_is_intree(&node->li_node)) /* duplicate unlink */
 		return;
 
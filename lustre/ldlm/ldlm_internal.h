@@ -185,6 +185,9 @@ int ldlm_bl_thread_wakeup(void);
 
 void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
                              struct ldlm_lock_desc *ld, struct ldlm_lock *lock);
+#ifdef HAVE_SERVER_SUPPORT
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg);
+#endif
 
 #ifdef HAVE_SERVER_SUPPORT
 /* ldlm_plain.c */
@@ -204,6 +207,8 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 #endif
 void ldlm_extent_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
+void ldlm_extent_add_waiting_lock(struct ldlm_resource *res,
+				  struct ldlm_lock *lock);
 
 /* ldlm_flock.c */
 int ldlm_process_flock_lock(struct ldlm_lock *req, __u64 *flags,
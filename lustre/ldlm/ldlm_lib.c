@@ -1885,6 +1885,48 @@ static inline int exp_finished_or_from_mdt(struct obd_export *exp)
 		exp_finished(exp);
 }
 
+/**
+ * Check whether a gap in the transno sequence may be skipped: every client
+ * still replaying has queued requests, and none of these depends on an
+ * earlier replay of the same client which is still on the wire, as told
+ * by ptlrpc_body::pb_replay_prev of pipelined replays.
+ *
+ * Called with obd_recovery_task_lock held.
+ */
+static bool check_for_replay_gap(struct obd_device *obd)
+{
+	struct ptlrpc_request *req;
+	struct obd_export *exp;
+	__u64 gen = ++obd->obd_replay_scan_gen;
+	__u64 prev;
+	int clients = 0;
+
+	list_for_each_entry(req, &obd->obd_req_replay_queue, rq_list) {
+		exp = req->rq_export;
+		prev = lustre_msg_get_replay_prev(req->rq_reqmsg);
+
+		/* The queue is sorted by transno, so if the replay sent
+		 * before this one is queued, it was the last one seen from
+		 * this export. Lower transnos were already replayed. */
+		if (prev >= obd->obd_next_recovery_transno &&
+		    (exp->exp_replay_scan_gen != gen ||
+		     exp->exp_replay_scan_last != prev)) {
+			DEBUG_REQ(D_HA, req, "waiting for replay t%llu", prev);
+			return false;
+		}
+
+		if (exp->exp_replay_scan_gen != gen) {
+			exp->exp_replay_scan_gen = gen;
+			if (exp->exp_req_replay_needed)
+				clients++;
+		}
+		exp->exp_replay_scan_last =
+			lustre_msg_get_transno(req->rq_reqmsg);
+	}
+
+	return clients == atomic_read(&obd->obd_req_replay_clients);
+}
+
 static int check_for_next_transno(struct lu_target *lut)
 {
 	struct ptlrpc_request *req = NULL;
@@ -1933,8 +1975,7 @@ static int check_for_next_transno(struct lu_target *lut)
 		   (update_transno != 0 && update_transno <= next_transno)) {
 		CDEBUG(D_HA, "waking for next (%lld)\n", next_transno);
 		wake_up = 1;
-	} else if (queue_len > 0 &&
-		   queue_len == atomic_read(&obd->obd_req_replay_clients)) {
+	} else if (queue_len > 0 && check_for_replay_gap(obd)) {
 		/** handle gaps occured due to lost reply or VBR */
 		LASSERTF(req_transno >= next_transno,
 			 "req_transno: %llu, next_transno: %llu\n",
@@ -204,6 +204,8 @@ void ldlm_lock_put(struct ldlm_lock *lock)
                 lprocfs_counter_decr(ldlm_res_to_ns(res)->ns_stats,
                                      LDLM_NSS_LOCKS);
                 lu_ref_del(&res->lr_reference, "lock", lock);
+		if (res->lr_type == LDLM_EXTENT)
+			ldlm_interval_free(ldlm_interval_detach(lock));
                 ldlm_resource_putref(res);
                 lock->l_resource = NULL;
                 if (lock->l_export) {
@@ -214,7 +216,6 @@ void ldlm_lock_put(struct ldlm_lock *lock)
                 if (lock->l_lvb_data != NULL)
                         OBD_FREE_LARGE(lock->l_lvb_data, lock->l_lvb_len);
 
-                ldlm_interval_free(ldlm_interval_detach(lock));
                 lu_ref_fini(&lock->l_reference);
 		OBD_FREE_RCU(lock, sizeof(*lock), &lock->l_handle);
         }
@@ -284,6 +285,7 @@ void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock)
 	LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
 	list_add_tail(&lock->l_lru, &ns->ns_unused_list);
 	ldlm_clear_skipped(lock);
+	lock->l_lru_laps = 0;
 	LASSERT(ns->ns_nr_unused >= 0);
 	ns->ns_nr_unused++;
 }
@@ -469,10 +471,20 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 	INIT_LIST_HEAD(&lock->l_rk_ast);
 	init_waitqueue_head(&lock->l_waitq);
 	lock->l_blocking_lock = NULL;
-	INIT_LIST_HEAD(&lock->l_sl_mode);
+	switch (resource->lr_type) {
+	case LDLM_PLAIN:
+	case LDLM_IBITS:
+		INIT_LIST_HEAD(&lock->l_sl_mode);
+		break;
+	case LDLM_FLOCK:
+		INIT_HLIST_NODE(&lock->l_exp_flock_hash);
+		break;
+	default:
+		/* LDLM_EXTENT: l_tree_node is set by ldlm_interval_alloc() */
+		break;
+	}
 	INIT_LIST_HEAD(&lock->l_sl_policy);
 	INIT_HLIST_NODE(&lock->l_exp_hash);
-	INIT_HLIST_NODE(&lock->l_exp_flock_hash);
 
         lprocfs_counter_incr(ldlm_res_to_ns(resource)->ns_stats,
                              LDLM_NSS_LOCKS);
@@ -729,7 +741,16 @@ EXPORT_SYMBOL(ldlm_lock_addref);
 void ldlm_lock_addref_internal_nolock(struct ldlm_lock *lock,
 				      enum ldlm_mode mode)
 {
-        ldlm_lock_remove_from_lru(lock);
+	if (ldlm_lock_remove_from_lru(lock)) {
+		struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+
+		/* a cached lock is reused, see ldlm_lock_cancel_cost() */
+		if (lock->l_lru_reuse < LDLM_LRU_REUSE_MAX)
+			lock->l_lru_reuse++;
+		lprocfs_counter_incr(ns->ns_lru_stats,
+				     LDLM_LRU_STAT(ns->ns_lru_policy,
+						   LDLM_LRU_HIT_STAT));
+	}
         if (mode & (LCK_NL | LCK_CR | LCK_PR)) {
                 lock->l_readers++;
                 lu_ref_add_atomic(&lock->l_reference, "reader", lock);
@@ -1652,13 +1673,25 @@ struct ldlm_lock *ldlm_lock_create(struct ldlm_namespace *ns,
 	if (IS_ERR(res))
 		RETURN(ERR_CAST(res));
 
+	/* the type-specific fields of the lock are picked by the type of
+	 * its resource, which may already exist with another type */
+	if (unlikely(res->lr_type != type)) {
+		CDEBUG(D_DLMTRACE, "resource "DLDLMRES" is %s, not %s\n",
+		       PLDLMRES(res), ldlm_typename[res->lr_type],
+		       ldlm_typename[type]);
+		ldlm_resource_putref(res);
+		RETURN(ERR_PTR(-EPROTO));
+	}
+
 	lock = ldlm_lock_new(res);
 	if (lock == NULL)
 		RETURN(ERR_PTR(-ENOMEM));
 
 	lock->l_req_mode = mode;
 	lock->l_ast_data = data;
+#if LUSTRE_TRACKS_LOCK_DEBUG
 	lock->l_pid = current_pid();
+#endif
 	if (ns_is_server(ns))
 		ldlm_set_ns_srv(lock);
 	if (cbs) {
@@ -1667,9 +1700,8 @@ struct ldlm_lock *ldlm_lock_create(struct ldlm_namespace *ns,
 		lock->l_glimpse_ast = cbs->lcs_glimpse;
 	}
 
-	lock->l_tree_node = NULL;
 	/* if this is the extent lock, allocate the interval tree node */
-	if (type == LDLM_EXTENT)
+	if (res->lr_type == LDLM_EXTENT)
 		if (ldlm_interval_alloc(lock) == NULL)
 			GOTO(out, rc = -ENOMEM);
 
@@ -1987,7 +2019,9 @@ void ldlm_discard_bl_list(struct list_head *bl_list)
 		list_del_init(&lock->l_bl_ast);
 		LASSERT(ldlm_is_ast_sent(lock));
 		ldlm_clear_ast_sent(lock);
+#if LUSTRE_TRACKS_LOCK_DEBUG
 		LASSERT(lock->l_bl_ast_run == 0);
+#endif
 		LASSERT(lock->l_blocking_lock);
 		LDLM_LOCK_RELEASE(lock->l_blocking_lock);
 		lock->l_blocking_lock = NULL;
@@ -2011,7 +2045,7 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	ENTRY;
 
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_flush(arg));
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_bl_ast);
 
@@ -2020,9 +2054,11 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	list_del_init(&lock->l_bl_ast);
 
 	LASSERT(ldlm_is_ast_sent(lock));
-	LASSERT(lock->l_bl_ast_run == 0);
 	LASSERT(lock->l_blocking_lock);
+#if LUSTRE_TRACKS_LOCK_DEBUG
+	LASSERT(lock->l_bl_ast_run == 0);
 	lock->l_bl_ast_run++;
+#endif
 	unlock_res_and_lock(lock);
 
 	ldlm_lock2desc(lock->l_blocking_lock, &d);
@@ -2093,7 +2129,7 @@ ldlm_work_revoke_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	ENTRY;
 
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_flush(arg));
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_rk_ast);
 	list_del_init(&lock->l_rk_ast);
@@ -2168,10 +2204,12 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	atomic_set(&arg->restart, 0);
 	arg->list = rpc_list;
+	INIT_LIST_HEAD(&arg->bl_batches);
 
 	switch (ast_type) {
 		case LDLM_WORK_BL_AST:
 			arg->type = LDLM_BL_CALLBACK;
+			arg->bl_batch_max = ns->ns_bl_batch_max;
 			work_ast_lock = ldlm_work_bl_ast_lock;
 			break;
 		case LDLM_WORK_CP_AST:
@@ -2180,6 +2218,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 			break;
 		case LDLM_WORK_REVOKE_AST:
 			arg->type = LDLM_BL_CALLBACK;
+			arg->bl_batch_max = ns->ns_bl_batch_max;
 			work_ast_lock = ldlm_work_revoke_ast_lock;
 			break;
 		case LDLM_WORK_GL_AST:
@@ -2201,6 +2240,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	ptlrpc_set_wait(arg->set);
 	ptlrpc_set_destroy(arg->set);
+	LASSERT(list_empty(&arg->bl_batches));
 
 	rc = atomic_read(&arg->restart) ? -ERESTART : 0;
 	GOTO(out, rc);
@@ -2779,7 +2819,8 @@ void _ldlm_lock_debug(struct ldlm_lock *lock,
                        ldlm_lockname[lock->l_req_mode],
                        lock->l_flags, nid, lock->l_remote_handle.cookie,
 		       exp ? atomic_read(&exp->exp_refcount) : -99,
-                       lock->l_pid, lock->l_callback_timeout, lock->l_lvb_type);
+		       ldlm_lock_pid(lock), lock->l_callback_timeout,
+		       lock->l_lvb_type);
                 va_end(args);
                 return;
         }
@@ -2804,7 +2845,7 @@ void _ldlm_lock_debug(struct ldlm_lock *lock,
 			lock->l_req_extent.start, lock->l_req_extent.end,
 			lock->l_flags, nid, lock->l_remote_handle.cookie,
 			exp ? atomic_read(&exp->exp_refcount) : -99,
-			lock->l_pid, lock->l_callback_timeout,
+			ldlm_lock_pid(lock), lock->l_callback_timeout,
 			lock->l_lvb_type);
 		break;
 
@@ -2827,7 +2868,7 @@ void _ldlm_lock_debug(struct ldlm_lock *lock,
 			lock->l_policy_data.l_flock.end,
 			lock->l_flags, nid, lock->l_remote_handle.cookie,
 			exp ? atomic_read(&exp->exp_refcount) : -99,
-			lock->l_pid, lock->l_callback_timeout);
+			ldlm_lock_pid(lock), lock->l_callback_timeout);
 		break;
 
 	case LDLM_IBITS:
@@ -2848,7 +2889,7 @@ void _ldlm_lock_debug(struct ldlm_lock *lock,
 			ldlm_typename[resource->lr_type],
 			lock->l_flags, nid, lock->l_remote_handle.cookie,
 			exp ? atomic_read(&exp->exp_refcount) : -99,
-			lock->l_pid, lock->l_callback_timeout,
+			ldlm_lock_pid(lock), lock->l_callback_timeout,
 			lock->l_lvb_type);
 		break;
 
@@ -2869,7 +2910,7 @@ void _ldlm_lock_debug(struct ldlm_lock *lock,
 			ldlm_typename[resource->lr_type],
 			lock->l_flags, nid, lock->l_remote_handle.cookie,
 			exp ? atomic_read(&exp->exp_refcount) : -99,
-			lock->l_pid, lock->l_callback_timeout,
+			ldlm_lock_pid(lock), lock->l_callback_timeout,
 			lock->l_lvb_type);
 		break;
 	}
@@ -592,6 +592,11 @@ int ldlm_refresh_waiting_lock(struct ldlm_lock *lock, int timeout)
         RETURN(0);
 }
 
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg)
+{
+	return -ENOENT;
+}
+
 #endif /* !HAVE_SERVER_SUPPORT */
 
 #ifdef HAVE_SERVER_SUPPORT
@@ -839,12 +844,264 @@ static void ldlm_lock_reorder_req(struct ldlm_lock *lock)
 	EXIT;
 }
 
+/**
+ * Blocking ASTs for the locks of one export, collected while running an AST
+ * work list and sent as a single LDLM_BL_CALLBACK RPC, see
+ * OBD_CONNECT2_BL_AST_BATCH.
+ */
+struct ldlm_bl_batch {
+	/** link on ldlm_cb_set_arg::bl_batches */
+	struct list_head	 bb_link;
+	struct obd_export	*bb_export;
+	struct ptlrpc_request	*bb_req;
+	/** RMF_DLM_BL_BATCH buffer of bb_req, one item per lock */
+	struct ldlm_request	*bb_items;
+	int			 bb_count;
+	int			 bb_max;
+	/** referenced locks, in the order of bb_items */
+	struct ldlm_lock	*bb_locks[LDLM_BL_BATCH_MAX];
+};
+
+static int ldlm_cb_batch_interpret(const struct lu_env *env,
+				   struct ptlrpc_request *req, void *data,
+				   int rc)
+{
+	struct ldlm_cb_async_args *ca = data;
+	struct ldlm_bl_batch *batch = ca->ca_batch;
+	struct ldlm_cb_set_arg *arg = ca->ca_set_arg;
+	__u32 *status = NULL;
+	int i;
+	ENTRY;
+
+	if (rc == 0) {
+		status = req_capsule_server_sized_get(&req->rq_pill,
+					&RMF_DLM_BL_STATUS,
+					batch->bb_count * sizeof(*status));
+		if (status == NULL)
+			rc = -EPROTO;
+	}
+
+	for (i = 0; i < batch->bb_count; i++) {
+		struct ldlm_lock *lock = batch->bb_locks[i];
+		int lrc = rc;
+
+		if (lrc == 0)
+			lrc = ptlrpc_status_ntoh(status[i]);
+		if (lrc != 0)
+			lrc = ldlm_handle_ast_error(lock, req, lrc, "blocking");
+		if (lrc == -ERESTART)
+			atomic_inc(&arg->restart);
+
+		/* release reference taken in ldlm_bl_batch_add() */
+		LDLM_LOCK_RELEASE(lock);
+	}
+	OBD_FREE_PTR(batch);
+
+	RETURN(0);
+}
+
+static void ldlm_update_batch_resend(struct ptlrpc_request *req, void *data)
+{
+	struct ldlm_cb_async_args *ca = data;
+	struct ldlm_bl_batch *batch = ca->ca_batch;
+	int i;
+
+	for (i = 0; i < batch->bb_count; i++)
+		ldlm_refresh_waiting_lock(batch->bb_locks[i],
+					  ldlm_bl_timeout(batch->bb_locks[i]));
+}
+
+/**
+ * Find the pending batch for \a exp in \a arg, or start a new one.
+ *
+ * The request is allocated for the largest batch upfront, so that adding
+ * a lock never fails once the lock has been marked as CBPENDING, and is
+ * shrunk to the real number of locks when sent.
+ */
+static struct ldlm_bl_batch *ldlm_bl_batch_get(struct ldlm_cb_set_arg *arg,
+					       struct obd_export *exp)
+{
+	struct ldlm_cb_async_args *ca;
+	struct ldlm_bl_batch *batch;
+	struct ptlrpc_request *req;
+	int rc;
+
+	list_for_each_entry(batch, &arg->bl_batches, bb_link)
+		if (batch->bb_export == exp)
+			return batch;
+
+	OBD_ALLOC_PTR(batch);
+	if (batch == NULL)
+		return NULL;
+
+	req = ptlrpc_request_alloc(exp->exp_imp_reverse,
+				   &RQF_LDLM_BL_CALLBACK_BATCH);
+	if (req == NULL) {
+		OBD_FREE_PTR(batch);
+		return NULL;
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_BL_BATCH, RCL_CLIENT,
+			     arg->bl_batch_max * sizeof(struct ldlm_request));
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+	if (rc) {
+		ptlrpc_request_free(req);
+		OBD_FREE_PTR(batch);
+		return NULL;
+	}
+
+	CLASSERT(sizeof(*ca) <= sizeof(req->rq_async_args));
+	ca = ptlrpc_req_async_args(req);
+	ca->ca_set_arg = arg;
+	ca->ca_lock = NULL;
+	ca->ca_batch = batch;
+	req->rq_interpret_reply = ldlm_cb_batch_interpret;
+
+	batch->bb_export = exp;
+	batch->bb_req = req;
+	batch->bb_items = req_capsule_client_get(&req->rq_pill,
+						 &RMF_DLM_BL_BATCH);
+	batch->bb_max = min_t(int, arg->bl_batch_max, LDLM_BL_BATCH_MAX);
+	list_add_tail(&batch->bb_link, &arg->bl_batches);
+
+	return batch;
+}
+
+/**
+ * Send \a batch as one LDLM_BL_CALLBACK RPC in the AST request set.
+ */
+static void ldlm_bl_batch_send(struct ldlm_cb_set_arg *arg,
+			       struct ldlm_bl_batch *batch)
+{
+	struct ptlrpc_request *req = batch->bb_req;
+	struct ldlm_request *body;
+
+	list_del_init(&batch->bb_link);
+	if (batch->bb_count == 0) {
+		/* all locks were cancelled or not granted yet */
+		ptlrpc_req_finished(req);
+		OBD_FREE_PTR(batch);
+		return;
+	}
+
+	/* the first lock also goes into RMF_DLM_REQ, as for a single lock */
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	*body = batch->bb_items[0];
+	req_capsule_shrink(&req->rq_pill, &RMF_DLM_BL_BATCH,
+			   batch->bb_count * sizeof(*body), RCL_CLIENT);
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_BL_STATUS, RCL_SERVER,
+			     batch->bb_count * sizeof(__u32));
+	ptlrpc_request_set_replen(req);
+
+	/* Do not resend after lock callback timeout, which is per export and
+	 * thus the same for all locks of the batch */
+	req->rq_delay_limit = ldlm_bl_timeout(batch->bb_locks[0]);
+	req->rq_resend_cb = ldlm_update_batch_resend;
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	/* ptlrpc_request_pack already set timeout */
+	if (AT_OFF)
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	CDEBUG(D_DLMTRACE, "%s: sending %d blocking ASTs to %s in one RPC\n",
+	       batch->bb_export->exp_obd->obd_name, batch->bb_count,
+	       obd_export_nid2str(batch->bb_export));
+
+	ptlrpc_set_add_req(arg->set, req);
+}
+
+/**
+ * Send one of the pending blocking AST batches, once the AST work list
+ * of \a arg is empty.
+ *
+ * \retval 0		a batch was sent
+ * \retval -ENOENT	no batch left, the AST work is done
+ */
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg)
+{
+	if (arg->bl_batch_max <= 1 || list_empty(&arg->bl_batches))
+		return -ENOENT;
+
+	ldlm_bl_batch_send(arg, list_entry(arg->bl_batches.next,
+					   struct ldlm_bl_batch, bb_link));
+	return 0;
+}
+
+static inline bool ldlm_bl_batch_ok(struct ldlm_lock *lock,
+				    struct ldlm_cb_set_arg *arg)
+{
+	return arg->type == LDLM_BL_CALLBACK && arg->bl_batch_max > 1 &&
+	       !ldlm_is_cancel_on_block(lock) &&
+	       exp_connect_flags2(lock->l_export) & OBD_CONNECT2_BL_AST_BATCH;
+}
+
+/**
+ * Add the blocking AST for \a lock to the pending batch of its export,
+ * instead of sending an RPC for it alone. The batch is sent when it is
+ * full, or when the AST work list has been gone through.
+ */
+static int ldlm_bl_batch_add(struct ldlm_lock *lock,
+			     struct ldlm_lock_desc *desc,
+			     struct ldlm_cb_set_arg *arg)
+{
+	struct obd_export *exp = lock->l_export;
+	struct ldlm_bl_batch *batch;
+	struct ldlm_request *item;
+	ENTRY;
+
+	batch = ldlm_bl_batch_get(arg, exp);
+	if (batch == NULL)
+		RETURN(-ENOMEM);
+
+	lock_res_and_lock(lock);
+	if (ldlm_is_destroyed(lock)) {
+		unlock_res_and_lock(lock);
+		RETURN(0);
+	}
+
+	if (lock->l_granted_mode != lock->l_req_mode) {
+		/* this blocking AST will be communicated as part of the
+		 * completion AST instead */
+		ldlm_add_blocked_lock(lock);
+		ldlm_set_waited(lock);
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
+		RETURN(0);
+	}
+
+	item = &batch->bb_items[batch->bb_count];
+	item->lock_handle[0] = lock->l_remote_handle;
+	item->lock_desc = *desc;
+	item->lock_flags = ldlm_flags_to_wire(lock->l_flags &
+					      LDLM_FL_AST_MASK);
+
+	LDLM_DEBUG(lock, "server adding blocking AST to batch, %d locks",
+		   batch->bb_count + 1);
+
+	ldlm_set_cbpending(lock);
+	ldlm_add_waiting_lock(lock);
+	unlock_res_and_lock(lock);
+
+	lock->l_last_activity = ktime_get_real_seconds();
+
+	if (exp->exp_nid_stats && exp->exp_nid_stats->nid_ldlm_stats)
+		lprocfs_counter_incr(exp->exp_nid_stats->nid_ldlm_stats,
+				     LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
+
+	batch->bb_locks[batch->bb_count++] = LDLM_LOCK_GET(lock);
+	if (batch->bb_count >= batch->bb_max)
+		ldlm_bl_batch_send(arg, batch);
+
+	RETURN(0);
+}
+
 /**
  * ->l_blocking_ast() method for server-side locks. This is invoked when newly
  * enqueued server lock conflicts with given one.
  *
  * Sends blocking AST RPC to the client owning that lock; arms timeout timer
- * to wait for client response.
+ * to wait for client response. If the client supports it, blocking ASTs for
+ * all its locks in the same AST work list are batched into one RPC.
  */
 int ldlm_server_blocking_ast(struct ldlm_lock *lock,
                              struct ldlm_lock_desc *desc,
@@ -874,6 +1131,13 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 
         ldlm_lock_reorder_req(lock);
 
+	if (ldlm_bl_batch_ok(lock, arg)) {
+		rc = ldlm_bl_batch_add(lock, desc, arg);
+		/* fall back to a blocking AST RPC of its own */
+		if (rc != -ENOMEM)
+			RETURN(rc);
+	}
+
         req = ptlrpc_request_alloc_pack(lock->l_export->exp_imp_reverse,
                                         &RQF_LDLM_BL_CALLBACK,
                                         LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
@@ -1359,7 +1623,7 @@ int ldlm_handle_enqueue0(struct ldlm_namespace *ns,
 				     dlm_req->lock_desc.l_resource.lr_type,
 				     &dlm_req->lock_desc.l_policy_data,
 				     &lock->l_policy_data);
-	if (dlm_req->lock_desc.l_resource.lr_type == LDLM_EXTENT)
+	if (lock->l_resource->lr_type == LDLM_EXTENT)
 		lock->l_req_extent = lock->l_policy_data.l_extent;
 
 existing_lock:
@@ -2147,6 +2411,118 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
                 CWARN("Send reply failed, maybe cause bug 21636.\n");
 }
 
+/**
+ * Handle a LDLM_BL_CALLBACK carrying several locks, see
+ * OBD_CONNECT2_BL_AST_BATCH.
+ *
+ * The reply returns one status per lock, -EINVAL if the lock is gone
+ * already. The unused locks are then cancelled together by a blocking
+ * thread, the same way as LRU locks, so that their cancels are packed into
+ * as few LDLM_CANCEL RPCs as possible. Locks still in use go through the
+ * usual blocking callback of their own.
+ */
+static void ldlm_handle_bl_batch(struct ptlrpc_request *req,
+				 struct ldlm_namespace *ns)
+{
+	struct ldlm_lock *locks[LDLM_BL_BATCH_MAX];
+	struct list_head cancels = LIST_HEAD_INIT(cancels);
+	struct ldlm_request *items;
+	struct ldlm_lock *lock;
+	__u32 *status;
+	int count;
+	int ncancel = 0;
+	int rc;
+	int i;
+	ENTRY;
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+	items = req_capsule_client_get(&req->rq_pill, &RMF_DLM_BL_BATCH);
+	count = req_capsule_get_size(&req->rq_pill, &RMF_DLM_BL_BATCH,
+				     RCL_CLIENT) / sizeof(*items);
+	if (items == NULL || count == 0 || count > LDLM_BL_BATCH_MAX) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate on bad batch", rc, NULL);
+		RETURN_EXIT;
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_BL_STATUS, RCL_SERVER,
+			     count * sizeof(*status));
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc) {
+		rc = ldlm_callback_reply(req, rc);
+		ldlm_callback_errmsg(req, "Pack batch reply", rc, NULL);
+		RETURN_EXIT;
+	}
+	status = req_capsule_server_get(&req->rq_pill, &RMF_DLM_BL_STATUS);
+
+	for (i = 0; i < count; i++) {
+		lock = ldlm_handle2lock_long(&items[i].lock_handle[0], 0);
+		locks[i] = lock;
+		status[i] = 0;
+		if (lock == NULL) {
+			CDEBUG(D_DLMTRACE, "callback on lock %#llx - lock "
+			       "disappeared\n", items[i].lock_handle[0].cookie);
+			status[i] = ptlrpc_status_hton(-EINVAL);
+			continue;
+		}
+
+		lock_res_and_lock(lock);
+		lock->l_flags |= ldlm_flags_from_wire(items[i].lock_flags &
+						      LDLM_FL_AST_MASK);
+		/* see ldlm_callback_handler() */
+		if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+		     ldlm_is_failed(lock)) {
+			LDLM_DEBUG(lock, "callback on lock %llx - lock disappeared",
+				   items[i].lock_handle[0].cookie);
+			unlock_res_and_lock(lock);
+			LDLM_LOCK_RELEASE(lock);
+			locks[i] = NULL;
+			status[i] = ptlrpc_status_hton(-EINVAL);
+			continue;
+		}
+		ldlm_lock_remove_from_lru(lock);
+		ldlm_set_bl_ast(lock);
+		unlock_res_and_lock(lock);
+	}
+
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Batch process", rc, NULL);
+
+	for (i = 0; i < count; i++) {
+		lock = locks[i];
+		if (lock == NULL)
+			continue;
+
+		lock_res_and_lock(lock);
+		if (lock->l_readers == 0 && lock->l_writers == 0 &&
+		    !ldlm_is_canceling(lock) && !ldlm_is_atomic_cb(lock)) {
+			/* as in ldlm_prepare_lru_list(), CBPENDING keeps
+			 * new users off the lock */
+			ldlm_clear_cancel_on_block(lock);
+			lock->l_flags |= LDLM_FL_CBPENDING | LDLM_FL_CANCELING;
+			LASSERT(list_empty(&lock->l_bl_ast));
+			list_add(&lock->l_bl_ast, &cancels);
+			unlock_res_and_lock(lock);
+			ncancel++;
+			continue;
+		}
+		unlock_res_and_lock(lock);
+
+		if (ldlm_bl_to_thread_lock(ns, &items[i].lock_desc, lock))
+			ldlm_handle_bl_callback(ns, &items[i].lock_desc, lock);
+	}
+
+	if (ncancel > 0 &&
+	    ldlm_bl_to_thread_list(ns, NULL, &cancels, ncancel, LCF_ASYNC)) {
+		ncancel = ldlm_cli_cancel_list_local(&cancels, ncancel,
+						     LCF_BL_AST);
+		ldlm_cli_cancel_list(&cancels, ncancel, NULL, 0);
+	}
+
+	EXIT;
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
@@ -2255,6 +2631,13 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
                         CERROR("ldlm_cli_cancel: %d\n", rc);
         }
 
+	/* blocking AST for several locks, see OBD_CONNECT2_BL_AST_BATCH */
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK &&
+	    lustre_msg_bufcount(req->rq_reqmsg) > 2) {
+		ldlm_handle_bl_batch(req, ns);
+		RETURN(0);
+	}
+
         lock = ldlm_handle2lock_long(&dlm_req->lock_handle[0], 0);
         if (!lock) {
 		CDEBUG(D_DLMTRACE, "callback on lock %#llx - lock "
@@ -3223,7 +3606,7 @@ int ldlm_init(void)
 		goto out_lock;
 
 	ldlm_interval_tree_slab = kmem_cache_create("interval_tree",
-			sizeof(struct ldlm_interval_tree) * LCK_MODE_NUM,
+			sizeof(struct ldlm_interval_tree) * LDLM_ITREE_NUM,
 			0, SLAB_HWCACHE_ALIGN, NULL);
 	if (ldlm_interval_tree_slab == NULL)
 		goto out_interval;
@@ -3247,6 +3630,8 @@ void ldlm_exit(void)
 {
 	if (ldlm_refcount)
 		CERROR("ldlm_refcount is %d in ldlm_exit!\n", ldlm_refcount);
+	/* ldlm_resource_putref() frees resources after a grace period */
+	rcu_barrier();
 	kmem_cache_destroy(ldlm_resource_slab);
 	/* ldlm_lock_put() use RCU to call ldlm_lock_free, so need call
 	 * synchronize_rcu() to wait a grace period elapsed, so that
@@ -483,7 +483,7 @@ int ldlm_cli_enqueue_local(struct ldlm_namespace *ns,
                 lock->l_policy_data = *policy;
         if (client_cookie != NULL)
                 lock->l_client_cookie = *client_cookie;
-	if (type == LDLM_EXTENT) {
+	if (lock->l_resource->lr_type == LDLM_EXTENT) {
 		/* extent lock without policy is a bug */
 		if (policy == NULL)
 			LBUG();
@@ -737,6 +737,123 @@ cleanup:
 }
 EXPORT_SYMBOL(ldlm_cli_enqueue_fini);
 
+/**
+ * Create the client side of a lock that the server grants as part of another
+ * RPC, e.g. a sub-operation of MDS_BATCH, instead of LDLM_ENQUEUE.
+ *
+ * \a lockh is sent to the server as the remote handle of the lock. The lock
+ * holds a reference of mode einfo::ei_mode, and must be passed to
+ * ldlm_cli_enqueue_grant() once the reply is in, whatever its outcome.
+ */
+int ldlm_cli_enqueue_prep(struct obd_export *exp,
+			  struct ldlm_enqueue_info *einfo,
+			  const struct ldlm_res_id *res_id,
+			  union ldlm_policy_data const *policy,
+			  struct lustre_handle *lockh)
+{
+	const struct ldlm_callback_suite cbs = {
+		.lcs_completion	= einfo->ei_cb_cp,
+		.lcs_blocking	= einfo->ei_cb_bl,
+		.lcs_glimpse	= einfo->ei_cb_gl
+	};
+	struct ldlm_lock *lock;
+	ENTRY;
+
+	lock = ldlm_lock_create(exp->exp_obd->obd_namespace, res_id,
+				einfo->ei_type, einfo->ei_mode, &cbs,
+				einfo->ei_cbdata, 0, LVB_T_NONE);
+	if (IS_ERR(lock))
+		RETURN(PTR_ERR(lock));
+
+	/* for the local lock, add the reference */
+	ldlm_lock_addref_internal(lock, einfo->ei_mode);
+	ldlm_lock2handle(lock, lockh);
+	if (policy != NULL)
+		lock->l_policy_data = *policy;
+
+	lock->l_conn_export = exp;
+	lock->l_export = NULL;
+	lock->l_blocking_ast = einfo->ei_cb_bl;
+	lock->l_last_activity = ktime_get_real_seconds();
+	LDLM_DEBUG(lock, "client-side enqueue START, prepared");
+
+	RETURN(0);
+}
+EXPORT_SYMBOL(ldlm_cli_enqueue_prep);
+
+/**
+ * Finish a lock created by ldlm_cli_enqueue_prep(), like
+ * ldlm_cli_enqueue_fini() does for LDLM_ENQUEUE.
+ *
+ * If \a rc is zero, the server granted the lock as \a remote on resource
+ * \a res_id with policy \a policy, and the lock is granted locally with the
+ * reference taken by ldlm_cli_enqueue_prep() kept for the caller. Otherwise
+ * the lock was never granted and is destroyed without a CANCEL RPC.
+ */
+int ldlm_cli_enqueue_grant(struct obd_export *exp,
+			   const struct lustre_handle *lockh,
+			   enum ldlm_mode mode,
+			   const struct ldlm_res_id *res_id,
+			   union ldlm_policy_data const *policy,
+			   const struct lustre_handle *remote, int rc)
+{
+	struct ldlm_namespace *ns = exp->exp_obd->obd_namespace;
+	struct ldlm_lock *lock;
+	__u64 flags = 0;
+	ENTRY;
+
+	lock = ldlm_handle2lock(lockh);
+	/* ldlm_cli_enqueue_prep() is holding a reference on this lock. */
+	LASSERT(lock != NULL);
+
+	if (rc != 0) {
+		LDLM_DEBUG(lock, "client-side enqueue END (FAILED)");
+		GOTO(cleanup, rc);
+	}
+
+	lock_res_and_lock(lock);
+	if (exp->exp_lock_hash) {
+		/* In the function below, .hs_keycmp resolves to
+		 * ldlm_export_lock_keycmp() */
+		/* coverity[overrun-buffer-val] */
+		cfs_hash_rehash_key(exp->exp_lock_hash,
+				    &lock->l_remote_handle,
+				    (void *)remote, &lock->l_exp_hash);
+	} else {
+		lock->l_remote_handle = *remote;
+	}
+	unlock_res_and_lock(lock);
+
+	if (!ldlm_res_eq(res_id, &lock->l_resource->lr_name)) {
+		rc = ldlm_lock_change_resource(ns, lock, res_id);
+		if (rc || lock->l_resource == NULL)
+			GOTO(cleanup, rc = -ENOMEM);
+		LDLM_DEBUG(lock, "client-side enqueue, new resource");
+	}
+	if (policy != NULL)
+		lock->l_policy_data = *policy;
+
+	rc = ldlm_lock_enqueue(ns, &lock, NULL, &flags);
+	if (lock->l_completion_ast != NULL) {
+		int err = lock->l_completion_ast(lock, flags, NULL);
+
+		if (!rc)
+			rc = err;
+	}
+
+	LDLM_DEBUG(lock, "client-side enqueue END");
+	EXIT;
+cleanup:
+	if (rc)
+		failed_lock_cleanup(ns, lock, mode);
+	/* Put lock 2 times, the second reference is held by
+	 * ldlm_cli_enqueue_prep() */
+	LDLM_LOCK_PUT(lock);
+	LDLM_LOCK_RELEASE(lock);
+	return rc;
+}
+EXPORT_SYMBOL(ldlm_cli_enqueue_grant);
+
 /**
  * Estimate number of lock handles that would fit into request of given
  * size.  PAGE_SIZE-512 is to allow TCP/IP and LNET headers to fit into
@@ -932,7 +1049,7 @@ int ldlm_cli_enqueue(struct obd_export *exp, struct ptlrpc_request **reqp,
 		if (policy != NULL)
 			lock->l_policy_data = *policy;
 
-		if (einfo->ei_type == LDLM_EXTENT) {
+		if (lock->l_resource->lr_type == LDLM_EXTENT) {
 			/* extent lock without policy is a bug */
 			if (policy == NULL)
 				LBUG();
@@ -1661,6 +1778,57 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
 	return ldlm_cancel_default_policy;
 }
 
+/**
+ * Estimated cost of cancelling \a lock: getting it back takes an enqueue RPC,
+ * refetching the data cached under it (as told by ns_weigh) takes more, and
+ * a lock often reused from the LRU is likely to be needed again.
+ */
+static __u64 ldlm_lock_cancel_cost(struct ldlm_namespace *ns,
+				   struct ldlm_lock *lock)
+{
+	__u64 cost = 1;
+
+	if (ns->ns_weigh != NULL)
+		cost += ns->ns_weigh(lock);
+
+	return cost * (1 + lock->l_lru_reuse);
+}
+
+/**
+ * Cost-aware LRU policy: rather than being cancelled, a lock of cost \a cost
+ * is given up to ilog2(\a cost) laps in the LRU, at most LDLM_LRU_LAPS_MAX,
+ * so that cheaper locks behind it go first. Locks unused for ns_max_age are
+ * not kept anyway.
+ */
+static bool ldlm_lru_cost_keep(struct ldlm_namespace *ns,
+			       struct ldlm_lock *lock, __u64 cost)
+{
+	if (ktime_after(ktime_get(),
+			ktime_add(lock->l_last_used, ns->ns_max_age)))
+		return false;
+
+	return lock->l_lru_laps < min_t(__u64, ilog2(cost), LDLM_LRU_LAPS_MAX);
+}
+
+/**
+ * Move \a lock to the LRU tail for another lap, keeping its last use time,
+ * unless it was used since \a last_use.
+ */
+static void ldlm_lock_lru_lap(struct ldlm_namespace *ns,
+			      struct ldlm_lock *lock, ktime_t last_use)
+{
+	spin_lock(&ns->ns_lock);
+	if (!list_empty(&lock->l_lru) &&
+	    !ktime_compare(last_use, lock->l_last_used)) {
+		list_move_tail(&lock->l_lru, &ns->ns_unused_list);
+		lock->l_lru_laps++;
+		lprocfs_counter_incr(ns->ns_lru_stats,
+				     LDLM_LRU_STAT(LDLM_LRU_POLICY_COST,
+						   LDLM_LRU_KEPT_STAT));
+	}
+	spin_unlock(&ns->ns_lock);
+}
+
 /**
  * - Free space in LRU for \a count new locks,
  *   redundant unused locks are canceled locally;
@@ -1697,6 +1865,12 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
  * flags & LDLM_CANCEL_CLEANUP - when cancelling read locks, do not check for
  * 				other read locks covering the same pages, just
  * 				discard those pages.
+ *
+ * With the LDLM_LRU_POLICY_COST namespace policy, the locks picked by the
+ * above policies may still be kept for another lap in the LRU if they are
+ * expensive to cancel, see ldlm_lru_cost_keep(). This is not done for
+ * LDLM_LRU_FLAG_NO_WAIT and LDLM_LRU_FLAG_CLEANUP, which want to cancel as
+ * many locks as possible.
  */
 static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 				 struct list_head *cancels, int count, int max,
@@ -1706,6 +1880,10 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	struct ldlm_lock *lock, *next;
 	int added = 0, unused, remained;
 	int no_wait = lru_flags & LDLM_LRU_FLAG_NO_WAIT;
+	enum ldlm_lru_policy policy = ns->ns_lru_policy;
+	bool laps = policy == LDLM_LRU_POLICY_COST &&
+		    !(lru_flags & (LDLM_LRU_FLAG_NO_WAIT |
+				   LDLM_LRU_FLAG_CLEANUP));
 	ENTRY;
 
 	spin_lock(&ns->ns_lock);
@@ -1721,6 +1899,7 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	while (!list_empty(&ns->ns_unused_list)) {
 		enum ldlm_policy_res result;
 		ktime_t last_use = ktime_set(0, 0);
+		__u64 cost = 1;
 
 		/* all unused locks */
 		if (remained-- <= 0)
@@ -1784,6 +1963,18 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			continue;
 		}
 
+		if (policy == LDLM_LRU_POLICY_COST) {
+			cost = ldlm_lock_cancel_cost(ns, lock);
+			if (laps && ldlm_lru_cost_keep(ns, lock, cost)) {
+				ldlm_lock_lru_lap(ns, lock, last_use);
+				lu_ref_del(&lock->l_reference, __func__,
+					   current);
+				LDLM_LOCK_RELEASE(lock);
+				spin_lock(&ns->ns_lock);
+				continue;
+			}
+		}
+
 		lock_res_and_lock(lock);
 		/* Check flags again under the lock. */
 		if (ldlm_is_canceling(lock) ||
@@ -1833,6 +2024,9 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 		unlock_res_and_lock(lock);
 		lu_ref_del(&lock->l_reference, __FUNCTION__, current);
 		spin_lock(&ns->ns_lock);
+		lprocfs_counter_add(ns->ns_lru_stats,
+				    LDLM_LRU_STAT(policy, LDLM_LRU_CANCEL_STAT),
+				    cost);
 		added++;
 		unused--;
 	}
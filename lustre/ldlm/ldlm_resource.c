@@ -79,6 +79,16 @@ LPROC_SEQ_FOPS_WO_TYPE(ldlm, dump_ns);
 
 LPROC_SEQ_FOPS_RW_TYPE(ldlm_rw, uint);
 
+/* memory used per lock, the interval node is only for extent locks */
+static int ldlm_lock_size_seq_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "ldlm_lock: %zu\n", sizeof(struct ldlm_lock));
+	seq_printf(m, "ldlm_interval: %zu\n", sizeof(struct ldlm_interval));
+	seq_printf(m, "ldlm_resource: %zu\n", sizeof(struct ldlm_resource));
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(ldlm_lock_size);
+
 #ifdef HAVE_SERVER_SUPPORT
 
 static int seq_watermark_show(struct seq_file *m, void *data)
@@ -188,6 +198,8 @@ int ldlm_proc_setup(void)
 		{ .name	=	"dump_granted_max",
 		  .fops	=	&ldlm_rw_uint_fops,
 		  .data	=	&ldlm_dump_granted_max },
+		{ .name	=	"lock_size",
+		  .fops	=	&ldlm_lock_size_fops },
 #ifdef HAVE_SERVER_SUPPORT
 		{ .name =	"lock_reclaim_threshold_mb",
 		  .fops =	&ldlm_watermark_fops,
@@ -432,6 +444,39 @@ static ssize_t lru_max_age_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(lru_max_age);
 
+static const char *ldlm_lru_policy_names[LDLM_LRU_POLICY_NR] = {
+	[LDLM_LRU_POLICY_AGE]	= "age",
+	[LDLM_LRU_POLICY_COST]	= "cost",
+};
+
+static ssize_t lru_cancel_policy_show(struct kobject *kobj,
+				      struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%s\n", ldlm_lru_policy_names[ns->ns_lru_policy]);
+}
+
+static ssize_t lru_cancel_policy_store(struct kobject *kobj,
+				       struct attribute *attr,
+				       const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	int i;
+
+	for (i = 0; i < LDLM_LRU_POLICY_NR; i++) {
+		if (sysfs_streq(buffer, ldlm_lru_policy_names[i])) {
+			ns->ns_lru_policy = i;
+			return count;
+		}
+	}
+
+	return -EINVAL;
+}
+LUSTRE_RW_ATTR(lru_cancel_policy);
+
 static ssize_t early_lock_cancel_show(struct kobject *kobj,
 				      struct attribute *attr,
 				      char *buf)
@@ -615,6 +660,37 @@ static ssize_t max_parallel_ast_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_parallel_ast);
 
+static ssize_t bl_batch_max_show(struct kobject *kobj,
+				 struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_bl_batch_max);
+}
+
+static ssize_t bl_batch_max_store(struct kobject *kobj,
+				  struct attribute *attr,
+				  const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned long tmp;
+	int err;
+
+	err = kstrtoul(buffer, 10, &tmp);
+	if (err != 0)
+		return -EINVAL;
+
+	if (tmp > LDLM_BL_BATCH_MAX)
+		return -ERANGE;
+
+	ns->ns_bl_batch_max = tmp;
+
+	return count;
+}
+LUSTRE_RW_ATTR(bl_batch_max);
+
 #endif /* HAVE_SERVER_SUPPORT */
 
 /* These are for namespaces in /sys/fs/lustre/ldlm/namespaces/ */
@@ -624,6 +700,7 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_lock_unused_count.attr,
 	&lustre_attr_lru_size.attr,
 	&lustre_attr_lru_max_age.attr,
+	&lustre_attr_lru_cancel_policy.attr,
 	&lustre_attr_early_lock_cancel.attr,
 #ifdef HAVE_SERVER_SUPPORT
 	&lustre_attr_ctime_age_limit.attr,
@@ -632,6 +709,7 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_contention_seconds.attr,
 	&lustre_attr_contended_locks.attr,
 	&lustre_attr_max_parallel_ast.attr,
+	&lustre_attr_bl_batch_max.attr,
 #endif
 	NULL,
 };
@@ -659,6 +737,8 @@ static void ldlm_namespace_proc_unregister(struct ldlm_namespace *ns)
 
 	if (ns->ns_stats != NULL)
 		lprocfs_free_stats(&ns->ns_stats);
+	if (ns->ns_lru_stats != NULL)
+		lprocfs_free_stats(&ns->ns_lru_stats);
 }
 
 void ldlm_namespace_sysfs_unregister(struct ldlm_namespace *ns)
@@ -667,9 +747,25 @@ void ldlm_namespace_sysfs_unregister(struct ldlm_namespace *ns)
 	wait_for_completion(&ns->ns_kobj_unregister);
 }
 
+/* counter names of ns_lru_stats, prefixed by the LRU policy name */
+static const char *
+ldlm_lru_stat_names[LDLM_LRU_POLICY_NR][LDLM_LRU_LAST_STAT] = {
+	[LDLM_LRU_POLICY_AGE] = {
+		[LDLM_LRU_HIT_STAT]	= "age_hits",
+		[LDLM_LRU_CANCEL_STAT]	= "age_cancels",
+		[LDLM_LRU_KEPT_STAT]	= "age_kept",
+	},
+	[LDLM_LRU_POLICY_COST] = {
+		[LDLM_LRU_HIT_STAT]	= "cost_hits",
+		[LDLM_LRU_CANCEL_STAT]	= "cost_cancels",
+		[LDLM_LRU_KEPT_STAT]	= "cost_kept",
+	},
+};
+
 int ldlm_namespace_sysfs_register(struct ldlm_namespace *ns)
 {
 	int err;
+	int i;
 
 	ns->ns_kobj.kset = ldlm_ns_kset;
 	init_completion(&ns->ns_kobj_unregister);
@@ -685,6 +781,31 @@ int ldlm_namespace_sysfs_register(struct ldlm_namespace *ns)
 	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LOCKS,
 			     LPROCFS_CNTR_AVGMINMAX, "locks", "locks");
 
+	ns->ns_lru_stats = lprocfs_alloc_stats(LDLM_LRU_POLICY_NR *
+					       LDLM_LRU_LAST_STAT, 0);
+	if (!ns->ns_lru_stats) {
+		lprocfs_free_stats(&ns->ns_stats);
+		kobject_put(&ns->ns_kobj);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < LDLM_LRU_POLICY_NR; i++) {
+		const char **names = ldlm_lru_stat_names[i];
+
+		lprocfs_counter_init(ns->ns_lru_stats,
+				     LDLM_LRU_STAT(i, LDLM_LRU_HIT_STAT), 0,
+				     names[LDLM_LRU_HIT_STAT], "locks");
+		lprocfs_counter_init(ns->ns_lru_stats,
+				     LDLM_LRU_STAT(i, LDLM_LRU_CANCEL_STAT),
+				     LPROCFS_CNTR_AVGMINMAX,
+				     names[LDLM_LRU_CANCEL_STAT],
+				     i == LDLM_LRU_POLICY_COST ? "cost" :
+								 "locks");
+		lprocfs_counter_init(ns->ns_lru_stats,
+				     LDLM_LRU_STAT(i, LDLM_LRU_KEPT_STAT), 0,
+				     names[LDLM_LRU_KEPT_STAT], "laps");
+	}
+
 	return err;
 }
 
@@ -704,7 +825,7 @@ static int ldlm_namespace_proc_register(struct ldlm_namespace *ns)
 		ns->ns_proc_dir_entry = ns_pde;
 	}
 
-	return 0;
+	return lprocfs_register_stats(ns_pde, "lru_stats", ns->ns_lru_stats);
 }
 #undef MAX_STRING_SIZE
 #else /* CONFIG_PROC_FS */
@@ -916,7 +1037,8 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
                                          CFS_HASH_DEPTH |
                                          CFS_HASH_BIGNAME |
                                          CFS_HASH_SPIN_BKTLOCK |
-                                         CFS_HASH_NO_ITEMREF);
+                                         CFS_HASH_NO_ITEMREF |
+                                         CFS_HASH_RCU);
         if (ns->ns_rs_hash == NULL)
                 GOTO(out_ns, NULL);
 
@@ -942,9 +1064,11 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_contended_locks    = NS_DEFAULT_CONTENDED_LOCKS;
 
         ns->ns_max_parallel_ast   = LDLM_DEFAULT_PARALLEL_AST_LIMIT;
+	ns->ns_bl_batch_max       = LDLM_BL_BATCH_MAX;
         ns->ns_nr_unused          = 0;
         ns->ns_max_unused         = LDLM_DEFAULT_LRU_SIZE;
 	ns->ns_max_age            = ktime_set(LDLM_DEFAULT_MAX_ALIVE, 0);
+	ns->ns_lru_policy         = LDLM_LRU_POLICY_AGE;
         ns->ns_ctime_age_limit    = LDLM_CTIME_AGE_LIMIT;
         ns->ns_timeouts           = 0;
         ns->ns_orig_connect_flags = 0;
@@ -1363,15 +1487,15 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 
 	if (ldlm_type == LDLM_EXTENT) {
 		OBD_SLAB_ALLOC(res->lr_itree, ldlm_interval_tree_slab,
-			       sizeof(*res->lr_itree) * LCK_MODE_NUM);
+			       sizeof(*res->lr_itree) * LDLM_ITREE_NUM);
 		if (res->lr_itree == NULL) {
 			OBD_SLAB_FREE_PTR(res, ldlm_resource_slab);
 			return NULL;
 		}
 		/* Initialize interval trees for each lock mode. */
-		for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		for (idx = 0; idx < LDLM_ITREE_NUM; idx++) {
 			res->lr_itree[idx].lit_size = 0;
-			res->lr_itree[idx].lit_mode = 1 << idx;
+			res->lr_itree[idx].lit_mode = 1 << (idx % LCK_MODE_NUM);
 			res->lr_itree[idx].lit_root = NULL;
 		}
 	}
@@ -1392,10 +1516,48 @@ static struct ldlm_resource *ldlm_resource_new(enum ldlm_type ldlm_type)
 	return res;
 }
 
+static void ldlm_resource_free_rcu(struct rcu_head *head)
+{
+	struct ldlm_resource *res = container_of(head, struct ldlm_resource,
+						 lr_rcu);
+
+	OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof(*res));
+}
+
+/**
+ * Lockless lookup of resource \a name in bucket \a bd.
+ *
+ * Frequently used resources (e.g. a shared working directory) are found
+ * without taking the hash bucket lock. A resource whose last reference is
+ * being dropped is skipped, as is one the walk misses because of a
+ * concurrent removal; the caller then falls back to the locked lookup.
+ */
+static struct ldlm_resource *
+ldlm_resource_lookup_rcu(struct ldlm_namespace *ns, struct cfs_hash_bd *bd,
+			 const struct ldlm_res_id *name)
+{
+	struct ldlm_resource *res = NULL;
+	struct hlist_node *hnode;
+
+	rcu_read_lock();
+	hnode = cfs_hash_bd_peek_rcu(ns->ns_rs_hash, bd, (void *)name);
+	if (hnode != NULL) {
+		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
+		/* the final putref drops to 0 and unhashes under the bucket
+		 * lock, so a resource with references is still hashed */
+		if (!atomic_inc_not_zero(&res->lr_refcount))
+			res = NULL;
+	}
+	rcu_read_unlock();
+
+	return res;
+}
+
 /**
  * Return a reference to resource with given name, creating it if necessary.
  * Args: namespace with ns_lock unlocked
- * Locks: takes and releases NS hash-lock and res->lr_lock
+ * Locks: takes and releases NS hash-lock and res->lr_lock, unless the
+ *        resource is found by the lockless lookup
  * Returns: referenced, unlocked ldlm_resource or NULL
  */
 struct ldlm_resource *
@@ -1414,7 +1576,12 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
         LASSERT(ns->ns_rs_hash != NULL);
         LASSERT(name->name[0] != 0);
 
-        cfs_hash_bd_get_and_lock(ns->ns_rs_hash, (void *)name, &bd, 0);
+	cfs_hash_bd_get(ns->ns_rs_hash, (void *)name, &bd);
+	res = ldlm_resource_lookup_rcu(ns, &bd, name);
+	if (res != NULL)
+		return res;
+
+	cfs_hash_bd_lock(ns->ns_rs_hash, &bd, 0);
         hnode = cfs_hash_bd_lookup_locked(ns->ns_rs_hash, &bd, (void *)name);
         if (hnode != NULL) {
                 cfs_hash_bd_unlock(ns->ns_rs_hash, &bd, 0);
@@ -1448,7 +1615,7 @@ ldlm_resource_get(struct ldlm_namespace *ns, struct ldlm_resource *parent,
 		lu_ref_fini(&res->lr_reference);
 		if (res->lr_itree != NULL)
 			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
+				      sizeof(*res->lr_itree) * LDLM_ITREE_NUM);
 		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
 found:
 		res = hlist_entry(hnode, struct ldlm_resource, lr_hash);
@@ -1532,8 +1699,8 @@ int ldlm_resource_putref(struct ldlm_resource *res)
 			ns->ns_lvbo->lvbo_free(res);
 		if (res->lr_itree != NULL)
 			OBD_SLAB_FREE(res->lr_itree, ldlm_interval_tree_slab,
-				      sizeof(*res->lr_itree) * LCK_MODE_NUM);
-		OBD_SLAB_FREE(res, ldlm_resource_slab, sizeof *res);
+				      sizeof(*res->lr_itree) * LDLM_ITREE_NUM);
+		call_rcu(&res->lr_rcu, ldlm_resource_free_rcu);
 		return 1;
 	}
 	return 0;
@@ -1558,6 +1725,9 @@ void ldlm_resource_add_lock(struct ldlm_resource *res, struct list_head *head,
 	LASSERT(list_empty(&lock->l_res_link));
 
 	list_add_tail(&lock->l_res_link, head);
+
+	if (res->lr_type == LDLM_EXTENT && head == &res->lr_waiting)
+		ldlm_extent_add_waiting_lock(res, lock);
 }
 
 /**
@@ -1583,6 +1753,11 @@ void ldlm_resource_insert_lock_after(struct ldlm_lock *original,
 	LASSERT(list_empty(&new->l_res_link));
 
 	list_add(&new->l_res_link, &original->l_res_link);
+
+	/* only waiting extent locks are reordered, see
+	 * ldlm_extent_compat_queue() */
+	if (res->lr_type == LDLM_EXTENT)
+		ldlm_extent_add_waiting_lock(res, new);
  out:;
 }
 
@@ -184,7 +184,7 @@ void ll_release_page(struct inode *inode, struct page *page,
  * IF_* flag shld be converted to particular OS file type in
  * platform llite module.
  */
-static u16 ll_dirent_type_get(struct lu_dirent *ent)
+u16 ll_dirent_type_get(struct lu_dirent *ent)
 {
 	u16 type = 0;
 	struct luda_type *lt;
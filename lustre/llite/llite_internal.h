@@ -523,6 +523,8 @@ struct ll_sb_info {
 
 	/* metadata stat-ahead */
 	unsigned int		  ll_sa_max;     /* max statahead RPCs */
+	unsigned int		  ll_sa_batch_max; /* max lookups per statahead
+						    * MDS_BATCH RPC */
 	atomic_t		  ll_sa_total;   /* statahead thread started
 						  * count */
 	atomic_t		  ll_sa_wrong;   /* statahead thread stopped for
@@ -776,6 +778,7 @@ int ll_get_mdt_idx_by_fid(struct ll_sb_info *sbi, const struct lu_fid *fid);
 struct page *ll_get_dir_page(struct inode *dir, struct md_op_data *op_data,
 			     __u64 offset, struct ll_dir_chain *chain);
 void ll_release_page(struct inode *inode, struct page *page, bool remove);
+u16 ll_dirent_type_get(struct lu_dirent *ent);
 
 /* llite/namei.c */
 extern const struct inode_operations ll_special_inode_operations;
@@ -1159,6 +1162,7 @@ void ll_ra_stats_inc(struct inode *inode, enum ra_stat which);
 #define LL_SA_RPC_MIN           2
 #define LL_SA_RPC_DEF           32
 #define LL_SA_RPC_MAX           8192
+#define LL_SA_BATCH_DEF		16
 
 #define LL_SA_CACHE_BIT         5
 #define LL_SA_CACHE_SIZE        (1 << LL_SA_CACHE_BIT)
@@ -1193,7 +1197,13 @@ struct ll_statahead_info {
 	unsigned int            sai_ls_all:1,   /* "ls -al", do stat-ahead for
 						 * hidden entries */
 				sai_agl_valid:1,/* AGL is valid for the dir */
-				sai_in_readpage:1;/* statahead is in readdir()*/
+				sai_in_readpage:1,/* statahead is in readdir()*/
+				sai_batch_off:1;/* MDT lacks MDS_BATCH */
+	struct sa_entry	      **sai_batch;	/* lookups queued for the next
+						 * MDS_BATCH RPC */
+	struct md_batch_item   *sai_batch_items;/* md_batch() arguments */
+	unsigned int		sai_batch_max;	/* size of sai_batch */
+	unsigned int		sai_batch_count;/* queued in sai_batch */
 	wait_queue_head_t	sai_waitq;	/* stat-ahead wait queue */
 	struct ptlrpc_thread	sai_thread;	/* stat-ahead thread */
 	struct ptlrpc_thread	sai_agl_thread;	/* AGL thread */
@@ -124,6 +124,7 @@ static struct ll_sb_info *ll_init_sbi(void)
 
 	/* metadata statahead is enabled by default */
 	sbi->ll_sa_max = LL_SA_RPC_DEF;
+	sbi->ll_sa_batch_max = LL_SA_BATCH_DEF;
 	atomic_set(&sbi->ll_sa_total, 0);
 	atomic_set(&sbi->ll_sa_wrong, 0);
 	atomic_set(&sbi->ll_sa_running, 0);
@@ -261,6 +262,10 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 #if defined(HAVE_SECURITY_DENTRY_INIT_SECURITY) && defined(CONFIG_SECURITY)
 	data->ocd_connect_flags2 |= OBD_CONNECT2_FILE_SECCTX;
 #endif /* HAVE_SECURITY_DENTRY_INIT_SECURITY */
+	data->ocd_connect_flags2 |= OBD_CONNECT2_BATCH_RPC;
+	data->ocd_connect_flags2 |= OBD_CONNECT2_REPLAY_WINDOW;
+	data->ocd_connect_flags2 |= OBD_CONNECT2_PING_AGGR;
+	data->ocd_connect_flags2 |= OBD_CONNECT2_BL_AST_BATCH;
 
 	data->ocd_brw_size = MD_MAX_BRW_SIZE;
 
@@ -398,9 +403,10 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt,
 				  OBD_CONNECT_JOBSTATS | OBD_CONNECT_LVB_TYPE |
 				  OBD_CONNECT_LAYOUTLOCK |
 				  OBD_CONNECT_PINGLESS | OBD_CONNECT_LFSCK |
-				  OBD_CONNECT_BULK_MBITS;
+				  OBD_CONNECT_BULK_MBITS | OBD_CONNECT_FLAGS2;
 
-	data->ocd_connect_flags2 = 0;
+	data->ocd_connect_flags2 = OBD_CONNECT2_PING_AGGR |
+				   OBD_CONNECT2_BL_AST_BATCH;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -705,6 +705,40 @@ static ssize_t ll_statahead_max_seq_write(struct file *file,
 }
 LPROC_SEQ_FOPS(ll_statahead_max);
 
+static int ll_statahead_batch_max_seq_show(struct seq_file *m, void *v)
+{
+	struct super_block *sb = m->private;
+	struct ll_sb_info *sbi = ll_s2sbi(sb);
+
+	seq_printf(m, "%u\n", sbi->ll_sa_batch_max);
+	return 0;
+}
+
+static ssize_t ll_statahead_batch_max_seq_write(struct file *file,
+						const char __user *buffer,
+						size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ll_sb_info *sbi = ll_s2sbi((struct super_block *)m->private);
+	int rc;
+	__s64 val;
+
+	rc = lprocfs_str_to_s64(buffer, count, &val);
+	if (rc)
+		return rc;
+
+	if (val < 0 || val > MDT_BATCH_MAX_OPS) {
+		CERROR("Bad statahead_batch_max value %lld. Valid values are "
+		       "in the range [0, %d]\n", val, MDT_BATCH_MAX_OPS);
+		return -ERANGE;
+	}
+
+	sbi->ll_sa_batch_max = val;
+
+	return count;
+}
+LPROC_SEQ_FOPS(ll_statahead_batch_max);
+
 static int ll_statahead_agl_seq_show(struct seq_file *m, void *v)
 {
 	struct super_block *sb = m->private;
@@ -1119,6 +1153,8 @@ struct lprocfs_vars lprocfs_llite_obd_vars[] = {
 	  .fops	=	&ll_track_gid_fops			},
 	{ .name	=	"statahead_max",
 	  .fops	=	&ll_statahead_max_fops			},
+	{ .name	=	"statahead_batch_max",
+	  .fops	=	&ll_statahead_batch_max_fops		},
 	{ .name	=	"statahead_agl",
 	  .fops	=	&ll_statahead_agl_fops			},
 	{ .name	=	"statahead_stats",
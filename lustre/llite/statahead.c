@@ -769,8 +769,132 @@ sa_prep_data(struct inode *dir, struct inode *child, struct sa_entry *entry)
 	return minfo;
 }
 
-/* async stat for file not found in dcache */
-static int sa_lookup(struct inode *dir, struct sa_entry *entry)
+/* the scanner is waiting for an entry queued in sai_batch */
+static inline bool sa_batch_waited(struct ll_statahead_info *sai)
+{
+	return sai->sai_batch_count > 0 &&
+	       sai->sai_index_wait >= sai->sai_batch[0]->se_index;
+}
+
+/*
+ * instantiate the inode of a batched lookup that was granted a lock, like
+ * sa_instantiate() does for async stat replies; the child is a directory,
+ * all its attributes are in \a body.
+ */
+static int sa_batch_instantiate(struct ll_statahead_info *sai,
+				struct sa_entry *entry,
+				struct md_batch_item *item)
+{
+	struct inode *dir = sai->sai_dentry->d_inode;
+	struct ll_sb_info *sbi = ll_i2sbi(dir);
+	struct md_enqueue_info *minfo = entry->se_minfo;
+	struct lookup_intent *it = &minfo->mi_it;
+	struct mdt_body *body = &item->mbi_body;
+	struct lustre_md md = { .body = body };
+	struct inode *child;
+	int rc = 0;
+	ENTRY;
+
+	it->it_lock_handle = item->mbi_lockh.cookie;
+	it->it_lock_bits = item->mbi_lock_bits;
+	it->it_lock_mode = minfo->mi_einfo.ei_mode;
+
+	if (!(body->mbo_valid & OBD_MD_FLTYPE) || !S_ISDIR(body->mbo_mode) ||
+	    !fid_is_sane(&body->mbo_fid1))
+		GOTO(out, rc = -EAGAIN);
+
+	child = ll_iget(dir->i_sb, cl_fid_build_ino(&body->mbo_fid1,
+					sbi->ll_flags & LL_SBI_32BIT_API), &md);
+	if (IS_ERR(child))
+		GOTO(out, rc = PTR_ERR(child));
+
+	CDEBUG(D_READA, "%s: setting %.*s"DFID" l_data to inode %p\n",
+	       ll_get_fsname(child->i_sb, NULL, 0),
+	       entry->se_qstr.len, entry->se_qstr.name,
+	       PFID(ll_inode2fid(child)), child);
+	ll_set_lock_data(sbi->ll_md_exp, child, it, NULL);
+
+	entry->se_inode = child;
+	entry->se_handle = it->it_lock_handle;
+	EXIT;
+out:
+	/* keep the lock cached, but drop the reference held by md_batch() */
+	ll_intent_drop_lock(it);
+	return rc;
+}
+
+/*
+ * send the lookups queued in sai_batch as MDS_BATCH RPCs; entries that were
+ * not granted a lock fall back to an async stat RPC each.
+ */
+static void sa_batch_flush(struct ll_statahead_info *sai)
+{
+	struct inode *dir = sai->sai_dentry->d_inode;
+	struct ll_inode_info *lli = ll_i2info(dir);
+	struct md_batch_item *items = sai->sai_batch_items;
+	int count = sai->sai_batch_count;
+	int rc;
+	int i;
+	ENTRY;
+
+	if (count == 0)
+		RETURN_EXIT;
+
+	sai->sai_batch_count = 0;
+	memset(items, 0, count * sizeof(*items));
+	for (i = 0; i < count; i++) {
+		struct sa_entry *entry = sai->sai_batch[i];
+		struct md_op_data *op_data = &entry->se_minfo->mi_data;
+
+		op_data->op_name = entry->se_qstr.name;
+		op_data->op_namelen = entry->se_qstr.len;
+		op_data->op_valid = OBD_MD_FLGETATTR;
+		items[i].mbi_op_data = op_data;
+		items[i].mbi_opc = MBOP_GETATTR_NAME;
+		items[i].mbi_einfo = &entry->se_minfo->mi_einfo;
+	}
+
+	rc = md_batch(ll_i2mdexp(dir), items, count);
+	CDEBUG(D_READA, "statahead batch of %d lookups: rc = %d\n", count, rc);
+	if (rc == -EOPNOTSUPP)
+		sai->sai_batch_off = 1;
+
+	for (i = 0; i < count; i++) {
+		struct sa_entry *entry = sai->sai_batch[i];
+		struct md_enqueue_info *minfo = entry->se_minfo;
+		struct md_op_data *op_data = &minfo->mi_data;
+
+		sai->sai_batch[i] = NULL;
+		if (lustre_handle_is_used(&items[i].mbi_lockh)) {
+			rc = sa_batch_instantiate(sai, entry, &items[i]);
+			if (rc == 0)
+				goto ready;
+		} else if (items[i].mbi_status == -ENOENT) {
+			rc = -ENOENT;
+			goto ready;
+		}
+
+		/* same async stat as sa_lookup() would have sent */
+		op_data->op_name = NULL;
+		op_data->op_namelen = 0;
+		entry->se_minfo = NULL;
+		rc = md_intent_getattr_async(ll_i2mdexp(dir), minfo);
+		if (rc == 0)
+			continue;
+
+		sa_fini_data(minfo);
+ready:
+		sa_make_ready(sai, entry, rc);
+		spin_lock(&lli->lli_sa_lock);
+		sai->sai_replied++;
+		spin_unlock(&lli->lli_sa_lock);
+	}
+
+	EXIT;
+}
+
+/* async stat for file not found in dcache, queued in sai_batch if @batch */
+static int sa_lookup(struct inode *dir, struct sa_entry *entry, bool batch)
 {
 	struct md_enqueue_info   *minfo;
 	int                       rc;
@@ -780,6 +904,14 @@ static int sa_lookup(struct inode *dir, struct sa_entry *entry)
 	if (IS_ERR(minfo))
 		RETURN(PTR_ERR(minfo));
 
+	if (batch) {
+		struct ll_statahead_info *sai = ll_i2info(dir)->lli_sai;
+
+		entry->se_minfo = minfo;
+		sai->sai_batch[sai->sai_batch_count++] = entry;
+		RETURN(0);
+	}
+
 	rc = md_intent_getattr_async(ll_i2mdexp(dir), minfo);
 	if (rc < 0)
 		sa_fini_data(minfo);
@@ -836,9 +968,9 @@ static int sa_revalidate(struct inode *dir, struct sa_entry *entry,
 	RETURN(rc);
 }
 
-/* async stat for file with @name */
+/* async stat for file with @name, of dirent type @type */
 static void sa_statahead(struct dentry *parent, const char *name, int len,
-			 const struct lu_fid *fid)
+			 const struct lu_fid *fid, u16 type)
 {
 	struct inode *dir = parent->d_inode;
 	struct ll_inode_info *lli = ll_i2info(dir);
@@ -854,7 +986,10 @@ static void sa_statahead(struct dentry *parent, const char *name, int len,
 
 	dentry = d_lookup(parent, &entry->se_qstr);
 	if (!dentry) {
-		rc = sa_lookup(dir, entry);
+		/* only directories are batched: their attributes all come
+		 * from the MDT, and they have no layout to fetch */
+		rc = sa_lookup(dir, entry, type == DT_DIR &&
+			       sai->sai_batch_max > 0 && !sai->sai_batch_off);
 	} else {
 		rc = sa_revalidate(dir, entry, dentry);
 		if (rc == 1 && agl_should_run(sai, dentry->d_inode))
@@ -871,6 +1006,10 @@ static void sa_statahead(struct dentry *parent, const char *name, int len,
 
 	sai->sai_index++;
 
+	if (sai->sai_batch_count > 0 &&
+	    sai->sai_batch_count >= sai->sai_batch_max)
+		sa_batch_flush(sai);
+
 	EXIT;
 }
 
@@ -1007,6 +1146,17 @@ static int ll_statahead_thread(void *arg)
 	if (sbi->ll_flags & LL_SBI_AGL_ENABLED)
 		ll_start_agl(parent, sai);
 
+	sai->sai_batch_max = sbi->ll_sa_batch_max;
+	if (sai->sai_batch_max > 0) {
+		OBD_ALLOC(sai->sai_batch,
+			  sai->sai_batch_max * sizeof(*sai->sai_batch));
+		OBD_ALLOC_LARGE(sai->sai_batch_items,
+				sai->sai_batch_max *
+				sizeof(*sai->sai_batch_items));
+		if (sai->sai_batch == NULL || sai->sai_batch_items == NULL)
+			sai->sai_batch_off = 1;
+	}
+
 	atomic_inc(&sbi->ll_sa_total);
 	spin_lock(&lli->lli_sa_lock);
 	if (thread_is_init(sa_thread))
@@ -1087,6 +1237,11 @@ static int ll_statahead_thread(void *arg)
 
 			fid_le_to_cpu(&fid, &ent->lde_fid);
 
+			/* send queued lookups before waiting for the window,
+			 * or if the scanner is already waiting for them */
+			if (sa_sent_full(sai) || sa_batch_waited(sai))
+				sa_batch_flush(sai);
+
 			/* wait for spare statahead window */
 			do {
 				l_wait_event(sa_thread->t_ctl_waitq,
@@ -1116,8 +1271,10 @@ static int ll_statahead_thread(void *arg)
 			} while (sa_sent_full(sai) &&
 				 thread_is_running(sa_thread));
 
-			sa_statahead(parent, name, namelen, &fid);
+			sa_statahead(parent, name, namelen, &fid,
+				     ll_dirent_type_get(ent));
 		}
+		sa_batch_flush(sai);
 
 		pos = le64_to_cpu(dp->ldp_hash_end);
 		ll_release_page(dir, page,
@@ -1175,6 +1332,15 @@ out:
 		thread_set_flags(agl_thread, SVC_STOPPED);
 	}
 
+	LASSERT(sai->sai_batch_count == 0);
+	if (sai->sai_batch != NULL)
+		OBD_FREE(sai->sai_batch,
+			 sai->sai_batch_max * sizeof(*sai->sai_batch));
+	if (sai->sai_batch_items != NULL)
+		OBD_FREE_LARGE(sai->sai_batch_items,
+			       sai->sai_batch_max *
+			       sizeof(*sai->sai_batch_items));
+
 	/* wait for inflight statahead RPCs to finish, and then we can free sai
 	 * safely because statahead RPC will access sai data */
 	while (sai->sai_sent != sai->sai_replied) {
@@ -1765,6 +1765,117 @@ lmv_getattr_name(struct obd_export *exp,struct md_op_data *op_data,
 	RETURN(rc);
 }
 
+/**
+ * Route each item of \a items to its MDT and issue one md_batch() per MDT.
+ *
+ * Items with a name are located like lmv_getattr_name() does, so lookups in
+ * striped directories go to the stripe that holds the name. An entry whose
+ * inode lives on another MDT comes back with OBD_MD_MDS set; such items are
+ * converted to MBOP_GETATTR on the returned FID and sent again in a second
+ * round, the same way lmv_getattr_name() chases remote objects.
+ *
+ * \retval 0		all items were sent, see md_batch_item::mbi_status
+ * \retval -EOPNOTSUPP	some MDT does not support MDS_BATCH, the caller
+ *			should fall back to individual RPCs
+ * \retval negative	first RPC level error
+ */
+static int lmv_batch(struct obd_export *exp, struct md_batch_item *items,
+		     int count)
+{
+	struct lmv_obd		 *lmv = &exp->exp_obd->u.lmv;
+	struct lmv_tgt_desc	**tgts;
+	struct lmv_tgt_desc	 *tgt;
+	struct md_batch_item	 *sub;
+	int			 *map;
+	int			  round;
+	int			  rc = 0;
+	int			  rc2;
+	int			  nr;
+	int			  i;
+	int			  j;
+	ENTRY;
+
+	if (count <= 0)
+		RETURN(0);
+
+	OBD_ALLOC_LARGE(tgts, count * sizeof(*tgts));
+	OBD_ALLOC_LARGE(sub, count * sizeof(*sub));
+	OBD_ALLOC_LARGE(map, count * sizeof(*map));
+	if (tgts == NULL || sub == NULL || map == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (round = 0; round < 2; round++) {
+		bool pending = false;
+
+		for (i = 0; i < count; i++) {
+			struct md_op_data *op_data = items[i].mbi_op_data;
+
+			tgts[i] = NULL;
+			if (round > 0) {
+				if (items[i].mbi_status != 0 ||
+				    !(items[i].mbi_body.mbo_valid &
+				      OBD_MD_MDS))
+					continue;
+
+				op_data->op_fid1 = items[i].mbi_body.mbo_fid1;
+				items[i].mbi_opc = MBOP_GETATTR;
+			}
+
+			if (items[i].mbi_opc == MBOP_GETATTR_NAME)
+				tgt = lmv_locate_mds(lmv, op_data,
+						     &op_data->op_fid1);
+			else
+				tgt = lmv_find_target(lmv, &op_data->op_fid1);
+			if (IS_ERR(tgt)) {
+				items[i].mbi_status = PTR_ERR(tgt);
+				continue;
+			}
+
+			memset(&items[i].mbi_body, 0,
+			       sizeof(items[i].mbi_body));
+			tgts[i] = tgt;
+			pending = true;
+		}
+
+		if (!pending)
+			break;
+
+		for (i = 0; i < count; i++) {
+			tgt = tgts[i];
+			if (tgt == NULL)
+				continue;
+
+			for (nr = 0, j = i; j < count; j++) {
+				if (tgts[j] != tgt)
+					continue;
+				sub[nr] = items[j];
+				map[nr++] = j;
+				tgts[j] = NULL;
+			}
+
+			CDEBUG(D_INODE, "BATCH of %d ops -> mds #%u\n", nr,
+			       tgt->ltd_idx);
+
+			rc2 = md_batch(tgt->ltd_exp, sub, nr);
+			for (j = 0; j < nr; j++)
+				items[map[j]] = sub[j];
+			if (rc2 == -EOPNOTSUPP)
+				GOTO(out, rc = rc2);
+			if (rc == 0)
+				rc = rc2;
+		}
+	}
+	EXIT;
+out:
+	if (map != NULL)
+		OBD_FREE_LARGE(map, count * sizeof(*map));
+	if (sub != NULL)
+		OBD_FREE_LARGE(sub, count * sizeof(*sub));
+	if (tgts != NULL)
+		OBD_FREE_LARGE(tgts, count * sizeof(*tgts));
+	return rc;
+}
+
 #define md_op_data_fid(op_data, fl)                     \
         (fl == MF_MDC_CANCEL_FID1 ? &op_data->op_fid1 : \
          fl == MF_MDC_CANCEL_FID2 ? &op_data->op_fid2 : \
@@ -3170,6 +3281,7 @@ struct md_ops lmv_md_ops = {
         .m_clear_open_replay_data = lmv_clear_open_replay_data,
         .m_intent_getattr_async = lmv_intent_getattr_async,
 	.m_revalidate_lock      = lmv_revalidate_lock,
+	.m_batch		= lmv_batch,
 	.m_get_fid_from_lsm	= lmv_get_fid_from_lsm,
 	.m_unpackmd		= lmv_unpackmd,
 };
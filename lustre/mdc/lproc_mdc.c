@@ -183,6 +183,7 @@ LPROC_SEQ_FOPS_RO_TYPE(mdc, state);
 LPROC_SEQ_FOPS_RW_TYPE(mdc, obd_max_pages_per_rpc);
 LPROC_SEQ_FOPS_RW_TYPE(mdc, import);
 LPROC_SEQ_FOPS_RW_TYPE(mdc, pinger_recov);
+LPROC_SEQ_FOPS_RW_TYPE(mdc, rpc_latency);
 
 struct lprocfs_vars lprocfs_mdc_obd_vars[] = {
 	{ .name	=	"uuid",
@@ -222,6 +223,8 @@ struct lprocfs_vars lprocfs_mdc_obd_vars[] = {
 	  .fops	=	&mdc_state_fops			},
 	{ .name	=	"pinger_recov",
 	  .fops	=	&mdc_pinger_recov_fops		},
+	{ .name	=	"rpc_latency",
+	  .fops	=	&mdc_rpc_latency_fops		},
 	{ .name	=	"rpc_stats",
 	  .fops	=	&mdc_rpc_stats_fops		},
 	{ .name	=	"active",
@@ -277,6 +277,188 @@ static int mdc_getattr_name(struct obd_export *exp, struct md_op_data *op_data,
         RETURN(rc);
 }
 
+/**
+ * Finish the locks prepared for \a items by mdc_batch_rpc(): the ones the
+ * MDT granted, if \a rc is zero, are granted locally and the others are
+ * destroyed.
+ */
+static void mdc_batch_locks_fini(struct obd_export *exp,
+				 struct md_batch_item *items,
+				 struct mdt_batch_rep *reps, int count, int rc)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		struct md_batch_item *item = &items[i];
+		union ldlm_policy_data policy = { { 0 } };
+		struct ldlm_res_id res_id;
+		int rc2 = rc;
+
+		if (!lustre_handle_is_used(&item->mbi_lockh))
+			continue;
+
+		if (rc2 == 0 && (item->mbi_status != 0 ||
+				 !lustre_handle_is_used(&reps[i].mbr_lockh)))
+			rc2 = -ENOLCK;
+
+		fid_build_reg_res_name(&item->mbi_body.mbo_fid1, &res_id);
+		policy.l_inodebits.bits = rc2 == 0 ? reps[i].mbr_lock_bits : 0;
+		rc2 = ldlm_cli_enqueue_grant(exp, &item->mbi_lockh,
+					     item->mbi_einfo->ei_mode, &res_id,
+					     &policy, rc2 == 0 ?
+					     &reps[i].mbr_lockh : NULL, rc2);
+		if (rc2 == 0) {
+			item->mbi_lock_bits = policy.l_inodebits.bits;
+		} else {
+			item->mbi_lockh.cookie = 0;
+			item->mbi_lock_bits = 0;
+		}
+	}
+}
+
+/**
+ * Send one MDS_BATCH RPC for at most MDT_BATCH_MAX_OPS items.
+ */
+static int mdc_batch_rpc(struct obd_export *exp, struct md_batch_item *items,
+			 int count)
+{
+	struct ptlrpc_request	*req;
+	struct req_capsule	*pill;
+	struct mdt_batch_op	*ops;
+	struct mdt_batch_rep	*reps = NULL;
+	char			*names;
+	size_t			 names_len = 0;
+	__u32			 suppgid = -1;
+	int			 i;
+	int			 rc;
+	ENTRY;
+
+	LASSERT(count > 0 && count <= MDT_BATCH_MAX_OPS);
+
+	for (i = 0; i < count; i++) {
+		struct md_op_data *op_data = items[i].mbi_op_data;
+
+		items[i].mbi_lockh.cookie = 0;
+		items[i].mbi_lock_bits = 0;
+		if (items[i].mbi_opc == MBOP_GETATTR_NAME)
+			names_len += op_data->op_namelen + 1;
+		if (suppgid == -1)
+			suppgid = op_data->op_suppgids[0];
+	}
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp), &RQF_MDS_BATCH);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	pill = &req->rq_pill;
+	req_capsule_set_size(pill, &RMF_MDT_BATCH_OPS, RCL_CLIENT,
+			     count * sizeof(*ops));
+	req_capsule_set_size(pill, &RMF_MDT_BATCH_NAMES, RCL_CLIENT,
+			     names_len);
+
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_BATCH);
+	if (rc) {
+		ptlrpc_request_free(req);
+		RETURN(rc);
+	}
+
+	mdc_pack_body(req, NULL, 0, 0, suppgid, 0);
+
+	ops = req_capsule_client_get(pill, &RMF_MDT_BATCH_OPS);
+	names = names_len > 0 ?
+		req_capsule_client_get(pill, &RMF_MDT_BATCH_NAMES) : NULL;
+	names_len = 0;
+	for (i = 0; i < count; i++) {
+		struct md_op_data *op_data = items[i].mbi_op_data;
+		struct ldlm_res_id res_id;
+
+		ops[i].mbop_opc = items[i].mbi_opc;
+		ops[i].mbop_fid = op_data->op_fid1;
+		ops[i].mbop_valid = op_data->op_valid;
+		if (items[i].mbi_opc != MBOP_GETATTR_NAME)
+			continue;
+
+		LASSERT(strnlen(op_data->op_name, op_data->op_namelen) ==
+			op_data->op_namelen);
+		ops[i].mbop_name_off = names_len;
+		ops[i].mbop_name_len = op_data->op_namelen;
+		memcpy(names + names_len, op_data->op_name,
+		       op_data->op_namelen);
+		names[names_len + op_data->op_namelen] = '\0';
+		names_len += op_data->op_namelen + 1;
+
+		if (items[i].mbi_einfo == NULL)
+			continue;
+
+		/* the resource is fixed up on grant if op_fid2 is unknown */
+		fid_build_reg_res_name(fid_is_sane(&op_data->op_fid2) ?
+				       &op_data->op_fid2 : &op_data->op_fid1,
+				       &res_id);
+		if (ldlm_cli_enqueue_prep(exp, items[i].mbi_einfo, &res_id,
+					  NULL, &items[i].mbi_lockh) != 0)
+			continue;
+
+		ops[i].mbop_flags = MBOP_FL_LOCK;
+		ops[i].mbop_lockh = items[i].mbi_lockh;
+	}
+
+	req_capsule_set_size(pill, &RMF_MDT_BATCH_REP, RCL_SERVER,
+			     count * sizeof(*reps));
+	ptlrpc_request_set_replen(req);
+
+	rc = ptlrpc_queue_wait(req);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	reps = req_capsule_server_sized_get(pill, &RMF_MDT_BATCH_REP,
+					    count * sizeof(*reps));
+	if (reps == NULL)
+		GOTO(out, rc = -EPROTO);
+
+	for (i = 0; i < count; i++) {
+		items[i].mbi_status = ptlrpc_status_ntoh(reps[i].mbr_status);
+		items[i].mbi_body = reps[i].mbr_body;
+	}
+	EXIT;
+out:
+	mdc_batch_locks_fini(exp, items, reps, count, rc);
+	ptlrpc_req_finished(req);
+	return rc;
+}
+
+/**
+ * Execute \a count read-only metadata sub-operations on this MDT, packing
+ * up to MDT_BATCH_MAX_OPS of them into each MDS_BATCH RPC.
+ *
+ * \retval 0		all RPCs completed, see md_batch_item::mbi_status
+ * \retval -EOPNOTSUPP	the MDT does not support MDS_BATCH
+ * \retval negative	RPC failure; items of the failed and later RPCs
+ *			have mbi_status set to the same error
+ */
+static int mdc_batch(struct obd_export *exp, struct md_batch_item *items,
+		     int count)
+{
+	int done;
+	int rc = 0;
+	ENTRY;
+
+	if (!(exp_connect_flags2(exp) & OBD_CONNECT2_BATCH_RPC))
+		RETURN(-EOPNOTSUPP);
+
+	for (done = 0; done < count; done += MDT_BATCH_MAX_OPS) {
+		int nr = min_t(int, count - done, MDT_BATCH_MAX_OPS);
+
+		rc = mdc_batch_rpc(exp, items + done, nr);
+		if (rc != 0)
+			break;
+	}
+
+	for (; done < count; done++)
+		items[done].mbi_status = rc;
+
+	RETURN(rc);
+}
+
 static int mdc_xattr_common(struct obd_export *exp,const struct req_format *fmt,
 			    const struct lu_fid *fid, int opcode, u64 valid,
 			    const char *xattr_name, const char *input,
@@ -2432,6 +2614,34 @@ static int mdc_cancel_weight(struct ldlm_lock *lock)
 	RETURN(1);
 }
 
+/**
+ * Cost of cancelling \a lock for the cost-aware LRU policy: each inodebit
+ * takes an RPC to fetch again, and the UPDATE lock of a directory also
+ * covers its cached pages.
+ */
+static unsigned long mdc_cancel_cost(struct ldlm_lock *lock)
+{
+	struct inode *inode;
+	unsigned long cost;
+	__u64 bits;
+
+	if (lock->l_resource->lr_type != LDLM_IBITS)
+		return 0;
+
+	/* lr_lvb_inode is cleared under the resource lock, see
+	 * mdc_null_inode() */
+	lock_res_and_lock(lock);
+	bits = lock->l_policy_data.l_inodebits.bits;
+	cost = hweight64(bits);
+	inode = lock->l_resource->lr_lvb_inode;
+	if (bits & MDS_INODELOCK_UPDATE && inode != NULL &&
+	    S_ISDIR(inode->i_mode))
+		cost += inode->i_mapping->nrpages;
+	unlock_res_and_lock(lock);
+
+	return cost;
+}
+
 static int mdc_resource_inode_free(struct ldlm_resource *res)
 {
 	if (res->lr_lvb_inode)
@@ -2498,6 +2708,7 @@ static int mdc_setup(struct obd_device *obd, struct lustre_cfg *cfg)
 	ptlrpc_lprocfs_register_obd(obd);
 
 	ns_register_cancel(obd->obd_namespace, mdc_cancel_weight);
+	ns_register_weigh(obd->obd_namespace, mdc_cancel_cost);
 
 	obd->obd_namespace->ns_lvbo = &inode_lvbo;
 
@@ -2631,7 +2842,8 @@ static struct md_ops mdc_md_ops = {
         .m_set_open_replay_data = mdc_set_open_replay_data,
         .m_clear_open_replay_data = mdc_clear_open_replay_data,
         .m_intent_getattr_async = mdc_intent_getattr_async,
-        .m_revalidate_lock      = mdc_revalidate_lock
+        .m_revalidate_lock      = mdc_revalidate_lock,
+	.m_batch		= mdc_batch
 };
 
 static int __init mdc_init(void)
@@ -48,6 +48,7 @@
 #include <linux/pagemap.h>
 
 #include <dt_object.h>
+#include <lustre/lustre_errno.h>
 #include <lustre_acl.h>
 #include <lustre_export.h>
 #include <uapi/linux/lustre_ioctl.h>
@@ -1782,6 +1783,330 @@ out_shrink:
 	return rc;
 }
 
+/**
+ * Grant the client lock mdt_batch_op::mbop_lockh on \a obj for a
+ * sub-operation with MBOP_FL_LOCK, if it can be taken without waiting.
+ *
+ * As in mdt_intent_lock_replace(), the lock is first taken as a local lock
+ * and then handed over to the export. No lock is granted on objects whose
+ * state is not all carried in mdt_body, i.e. with an access ACL or a
+ * striped directory layout, so that the client never caches partial
+ * attributes under a lock; it is expected to fall back to an intent getattr.
+ */
+static void mdt_batch_lock_grant(struct mdt_thread_info *info,
+				 struct mdt_object *obj,
+				 const struct mdt_batch_op *op,
+				 struct mdt_batch_rep *rep)
+{
+	struct ptlrpc_request	*req = mdt_info_req(info);
+	struct obd_export	*exp = req->rq_export;
+	struct mdt_lock_handle	*lhc = &info->mti_lh[MDT_LH_CHILD];
+	struct md_object	*next = mdt_object_child(obj);
+	struct ldlm_lock	*lock;
+	int			 rc;
+
+	if (lustre_msg_get_flags(req->rq_reqmsg) & MSG_RESENT) {
+		/* the lock may have been granted before the reply was lost */
+		lock = cfs_hash_lookup(exp->exp_lock_hash,
+				       (void *)&op->mbop_lockh);
+		if (lock != NULL) {
+			ldlm_lock2handle(lock, &rep->mbr_lockh);
+			rep->mbr_lock_bits =
+				lock->l_policy_data.l_inodebits.bits;
+			LDLM_LOCK_PUT(lock);
+			return;
+		}
+	}
+
+	rc = mo_xattr_get(info->mti_env, next, &LU_BUF_NULL,
+			  XATTR_NAME_ACL_ACCESS);
+	if (rc != -ENODATA)
+		return;
+
+	if (S_ISDIR(lu_object_attr(&obj->mot_obj))) {
+		rc = mo_xattr_get(info->mti_env, next, &LU_BUF_NULL,
+				  XATTR_NAME_LMV);
+		if (rc != -ENODATA)
+			return;
+	}
+
+	mdt_lock_reg_init(lhc, LCK_PR);
+	if (!mdt_object_lock_try(info, obj, lhc, MDS_INODELOCK_LOOKUP |
+				 MDS_INODELOCK_UPDATE | MDS_INODELOCK_PERM))
+		return;
+
+	lock = ldlm_handle2lock(&lhc->mlh_reg_lh);
+	LASSERT(lock != NULL);
+
+	lock_res_and_lock(lock);
+	if (exp->exp_disconnected || ldlm_is_cbpending(lock)) {
+		unlock_res_and_lock(lock);
+		LDLM_LOCK_PUT(lock);
+		mdt_object_unlock(info, obj, lhc, 1);
+		return;
+	}
+
+	/* Zero l_readers without triggering a blocking AST. */
+	while (lock->l_readers > 0) {
+		lu_ref_del(&lock->l_reference, "reader", lock);
+		lu_ref_del(&lock->l_reference, "user", lock);
+		lock->l_readers--;
+	}
+
+	lock->l_export = class_export_lock_get(exp, lock);
+	lock->l_blocking_ast = ldlm_server_blocking_ast;
+	lock->l_completion_ast = ldlm_server_completion_ast;
+	lock->l_remote_handle = op->mbop_lockh;
+	lock->l_flags &= ~LDLM_FL_LOCAL;
+	unlock_res_and_lock(lock);
+
+	cfs_hash_add(exp->exp_lock_hash, &lock->l_remote_handle,
+		     &lock->l_exp_hash);
+
+	ldlm_lock2handle(lock, &rep->mbr_lockh);
+	rep->mbr_lock_bits = lock->l_policy_data.l_inodebits.bits;
+	LDLM_DEBUG(lock, "granted by MDS_BATCH");
+
+	/* drop the handle reference and the one of the reader zeroed above */
+	LDLM_LOCK_RELEASE(lock);
+	LDLM_LOCK_RELEASE(lock);
+	lhc->mlh_reg_lh.cookie = 0;
+}
+
+/**
+ * Cancel the lock granted by mdt_batch_lock_grant() to a sub-operation that
+ * failed afterwards, the client does not take it from an error reply.
+ */
+static void mdt_batch_lock_revoke(struct mdt_batch_rep *rep)
+{
+	struct ldlm_lock *lock;
+
+	if (!lustre_handle_is_used(&rep->mbr_lockh))
+		return;
+
+	lock = ldlm_handle2lock(&rep->mbr_lockh);
+	if (lock != NULL) {
+		LDLM_DEBUG(lock, "revoked, MDS_BATCH getattr failed");
+		ldlm_lock_cancel(lock);
+		LDLM_LOCK_PUT(lock);
+	}
+	memset(&rep->mbr_lockh, 0, sizeof(rep->mbr_lockh));
+	rep->mbr_lock_bits = 0;
+}
+
+/**
+ * Execute one read-only sub-operation of an MDS_BATCH request.
+ *
+ * Unless the sub-operation asks for MBOP_FL_LOCK, no DLM lock is granted:
+ * the attributes are a snapshot, and a client that wants to cache them must
+ * still enqueue a lock. With MBOP_FL_LOCK the name is looked up under the
+ * parent's PDO lock, as for an intent getattr, and a lock on the child is
+ * granted if possible, see mdt_batch_lock_grant().
+ *
+ * \param[in] info	thread environment
+ * \param[in] op	sub-operation, already swabbed
+ * \param[in] names	RMF_MDT_BATCH_NAMES buffer, or NULL
+ * \param[in] names_len	size of \a names
+ * \param[out] rep	per-operation reply slot
+ *
+ * \retval		0 on success, negative errno on failure; the caller
+ *			stores it in mdt_batch_rep::mbr_status
+ */
+static int mdt_batch_getattr(struct mdt_thread_info *info,
+			     const struct mdt_batch_op *op,
+			     const char *names, int names_len,
+			     struct mdt_batch_rep *rep)
+{
+	struct mdt_device	*mdt = info->mti_mdt;
+	struct md_attr		*ma = &info->mti_attr;
+	struct lu_fid		*child_fid = &info->mti_tmp_fid1;
+	struct lu_name		*lname = &info->mti_name;
+	struct mdt_body		*body = &rep->mbr_body;
+	struct mdt_lock_handle	*lhp = NULL;
+	struct mdt_object	*parent = NULL;
+	struct mdt_object	*obj;
+	bool			 want_lock = false;
+	int			 rc;
+	ENTRY;
+
+	if (!fid_is_sane(&op->mbop_fid))
+		RETURN(-EINVAL);
+
+	obj = mdt_object_find(info->mti_env, mdt, &op->mbop_fid);
+	if (IS_ERR(obj))
+		RETURN(PTR_ERR(obj));
+
+	if (op->mbop_opc == MBOP_GETATTR_NAME) {
+		parent = obj;
+		obj = NULL;
+
+		if (names == NULL || op->mbop_name_len == 0 ||
+		    op->mbop_name_len > NAME_MAX ||
+		    op->mbop_name_off >= names_len ||
+		    op->mbop_name_len >= names_len - op->mbop_name_off)
+			GOTO(out_put, rc = -EPROTO);
+
+		lname->ln_name = names + op->mbop_name_off;
+		lname->ln_namelen = op->mbop_name_len;
+		if (!lu_name_is_valid(lname))
+			GOTO(out_put, rc = -EPROTO);
+
+		if (!mdt_object_exists(parent))
+			GOTO(out_put, rc = -ENOENT);
+
+		if (mdt_object_remote(parent)) {
+			/* let the client resend this op to the right MDT */
+			body->mbo_fid1 = *mdt_object_fid(parent);
+			body->mbo_valid = OBD_MD_FLID | OBD_MD_MDS;
+			GOTO(out_put, rc = -EREMOTE);
+		}
+
+		if (!S_ISDIR(lu_object_attr(&parent->mot_obj)))
+			GOTO(out_put, rc = -ENOTDIR);
+
+		if (op->mbop_flags & MBOP_FL_LOCK) {
+			lhp = &info->mti_lh[MDT_LH_PARENT];
+			mdt_lock_pdo_init(lhp, LCK_PR, lname);
+			want_lock = mdt_object_lock_try(info, parent, lhp,
+							MDS_INODELOCK_UPDATE);
+			if (!want_lock)
+				lhp = NULL;
+		}
+
+		fid_zero(child_fid);
+		rc = mdo_lookup(info->mti_env, mdt_object_child(parent), lname,
+				child_fid, &info->mti_spec);
+		if (rc != 0)
+			GOTO(out_put, rc);
+
+		obj = mdt_object_find(info->mti_env, mdt, child_fid);
+		if (IS_ERR(obj)) {
+			rc = PTR_ERR(obj);
+			obj = NULL;
+			GOTO(out_put, rc);
+		}
+	}
+
+	if (!mdt_object_exists(obj))
+		GOTO(out_put, rc = -ENOENT);
+
+	if (mdt_object_remote(obj)) {
+		/* same convention as mdt_getattr_internal() */
+		body->mbo_fid1 = *mdt_object_fid(obj);
+		body->mbo_valid = OBD_MD_FLID | OBD_MD_MDS;
+		GOTO(out_put, rc = 0);
+	}
+
+	/* as in mdt_getattr_name_lock(), the attributes are read once the
+	 * child lock is held, so the client never caches stale ones */
+	if (want_lock)
+		mdt_batch_lock_grant(info, obj, op, rep);
+
+	ma->ma_valid = 0;
+	ma->ma_need = MA_INODE;
+	rc = mdt_attr_get_complex(info, obj, ma);
+	if (rc == 0 && !(ma->ma_valid & MA_INODE))
+		rc = -EFAULT;
+	if (rc != 0) {
+		mdt_batch_lock_revoke(rep);
+		GOTO(out_put, rc);
+	}
+
+	mdt_pack_attr2body(info, body, &ma->ma_attr, mdt_object_fid(obj));
+	mdt_counter_incr(mdt_info_req(info), LPROC_MDT_GETATTR);
+	EXIT;
+out_put:
+	if (obj != NULL)
+		mdt_object_put(info->mti_env, obj);
+	if (lhp != NULL)
+		mdt_object_unlock(info, parent, lhp, 1);
+	if (parent != NULL)
+		mdt_object_put(info->mti_env, parent);
+	return rc;
+}
+
+/**
+ * Handler of MDS_BATCH RPC.
+ *
+ * Executes up to MDT_BATCH_MAX_OPS independent sub-operations and returns a
+ * separate status and mdt_body for each of them. A failing sub-operation
+ * does not abort the remaining ones; only malformed requests fail the RPC
+ * as a whole.
+ *
+ * Only read-only sub-operations are accepted: a modifying sub-operation
+ * would need its own transno and last_rcvd slot, which a single RPC cannot
+ * provide for replay. Unknown opcodes get -EOPNOTSUPP in their slot.
+ */
+static int mdt_batch(struct tgt_session_info *tsi)
+{
+	struct mdt_thread_info	*info = tsi2mdt_info(tsi);
+	struct req_capsule	*pill = info->mti_pill;
+	const struct mdt_batch_op *ops;
+	struct mdt_batch_rep	*reps;
+	const char		*names = NULL;
+	int			 names_len = 0;
+	int			 count;
+	int			 op_rc;
+	int			 i;
+	int			 rc;
+	ENTRY;
+
+	if (!(exp_connect_flags2(info->mti_exp) & OBD_CONNECT2_BATCH_RPC))
+		GOTO(out, rc = err_serious(-EOPNOTSUPP));
+
+	ops = req_capsule_client_get(pill, &RMF_MDT_BATCH_OPS);
+	if (ops == NULL)
+		GOTO(out, rc = err_serious(-EPROTO));
+
+	count = req_capsule_get_size(pill, &RMF_MDT_BATCH_OPS, RCL_CLIENT) /
+		sizeof(*ops);
+	if (count == 0 || count > MDT_BATCH_MAX_OPS)
+		GOTO(out, rc = err_serious(-EPROTO));
+
+	if (req_capsule_has_field(pill, &RMF_MDT_BATCH_NAMES, RCL_CLIENT)) {
+		names = req_capsule_client_get(pill, &RMF_MDT_BATCH_NAMES);
+		names_len = req_capsule_get_size(pill, &RMF_MDT_BATCH_NAMES,
+						 RCL_CLIENT);
+	}
+
+	req_capsule_set_size(pill, &RMF_MDT_BATCH_REP, RCL_SERVER,
+			     count * sizeof(*reps));
+	rc = req_capsule_server_pack(pill);
+	if (rc != 0)
+		GOTO(out, rc = err_serious(rc));
+
+	reps = req_capsule_server_get(pill, &RMF_MDT_BATCH_REP);
+	LASSERT(reps != NULL);
+	memset(reps, 0, count * sizeof(*reps));
+
+	rc = mdt_init_ucred(info, (struct mdt_body *)info->mti_body);
+	if (rc != 0)
+		GOTO(out, rc);
+
+	for (i = 0; i < count; i++) {
+		switch (ops[i].mbop_opc) {
+		case MBOP_GETATTR:
+		case MBOP_GETATTR_NAME:
+			op_rc = mdt_batch_getattr(info, &ops[i], names,
+						  names_len, &reps[i]);
+			break;
+		default:
+			op_rc = -EOPNOTSUPP;
+			break;
+		}
+		CDEBUG(D_INODE, "%s: batch op %d/%d opc %u "DFID": rc = %d\n",
+		       mdt_obd_name(info->mti_mdt), i, count, ops[i].mbop_opc,
+		       PFID(&ops[i].mbop_fid), op_rc);
+		reps[i].mbr_status = ptlrpc_status_hton(op_rc);
+	}
+
+	mdt_exit_ucred(info);
+	EXIT;
+out:
+	mdt_thread_info_fini(info);
+	return rc;
+}
+
 static int mdt_iocontrol(unsigned int cmd, struct obd_export *exp, int len,
 			 void *karg, void __user *uarg);
 
@@ -4668,6 +4993,7 @@ TGT_MDT_HDL(HABEO_CORPUS| HABEO_REFERO, MDS_HSM_REQUEST,
 TGT_MDT_HDL(HABEO_CLAVIS | HABEO_CORPUS | HABEO_REFERO | MUTABOR,
 	    MDS_SWAP_LAYOUTS,
 	    mdt_swap_layouts),
+TGT_MDT_HDL(0,				MDS_BATCH,	mdt_batch),
 };
 
 static struct tgt_handler mdt_sec_ctx_ops[] = {
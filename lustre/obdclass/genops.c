@@ -988,6 +988,15 @@ static void class_import_destroy(struct obd_import *imp)
                 OBD_FREE(imp_conn, sizeof(*imp_conn));
         }
 
+	while (!list_empty(&imp->imp_rpc_lat_list)) {
+		struct imp_rpc_latency *irl;
+
+		irl = list_entry(imp->imp_rpc_lat_list.next,
+				 struct imp_rpc_latency, irl_list);
+		list_del(&irl->irl_list);
+		OBD_FREE_PTR(irl);
+	}
+
         LASSERT(imp->imp_sec == NULL);
         class_decref(imp->imp_obd, "import", imp);
         OBD_FREE_RCU(imp, sizeof(*imp), &imp->imp_handle);
@@ -1064,8 +1073,10 @@ struct obd_import *class_new_import(struct obd_device *obd)
 	INIT_LIST_HEAD(&imp->imp_delayed_list);
 	INIT_LIST_HEAD(&imp->imp_committed_list);
 	INIT_LIST_HEAD(&imp->imp_unreplied_list);
+	INIT_LIST_HEAD(&imp->imp_rpc_lat_list);
 	imp->imp_known_replied_xid = 0;
 	imp->imp_replay_cursor = &imp->imp_committed_list;
+	imp->imp_replay_rewind_transno = ~0ULL;
 	spin_lock_init(&imp->imp_lock);
 	imp->imp_last_success_conn = 0;
 	imp->imp_state = LUSTRE_IMP_NEW;
@@ -246,13 +246,23 @@ static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 	if (job == NULL)
 		return NULL;
 
-	job->js_stats = lprocfs_alloc_stats(jobs->ojs_cntr_num, 0);
+	job->js_stats = lprocfs_alloc_stats(jobs->ojs_cntr_num +
+					    LPROC_JOB_RPC_LAST, 0);
 	if (job->js_stats == NULL) {
 		OBD_FREE_PTR(job);
 		return NULL;
 	}
 
 	jobs->ojs_cntr_init_fn(job->js_stats);
+	lprocfs_counter_init(job->js_stats,
+			     jobs->ojs_cntr_num + LPROC_JOB_RPC_REQIN,
+			     LPROCFS_CNTR_AVGMINMAX, "req_reqin", "usec");
+	lprocfs_counter_init(job->js_stats,
+			     jobs->ojs_cntr_num + LPROC_JOB_RPC_NRS,
+			     LPROCFS_CNTR_AVGMINMAX, "req_nrs_wait", "usec");
+	lprocfs_counter_init(job->js_stats,
+			     jobs->ojs_cntr_num + LPROC_JOB_RPC_HANDLE,
+			     LPROCFS_CNTR_AVGMINMAX, "req_handle", "usec");
 
 	memcpy(job->js_jobid, jobid, LUSTRE_JOBID_SIZE);
 	job->js_timestamp = cfs_time_current_sec();
@@ -264,26 +274,27 @@ static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 	return job;
 }
 
-int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
-			  int event, long amount)
+/**
+ * Find the job_stat of \a jobid on this device, creating it if needed.
+ *
+ * \retval	job_stat with a reference held, to be dropped by job_putref()
+ * \retval	ERR_PTR on failure
+ */
+static struct job_stat *job_stats_get(struct obd_job_stats *stats,
+				      char *jobid)
 {
-	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
 	struct job_stat *job, *job2;
-	ENTRY;
 
 	LASSERT(stats != NULL);
 	LASSERT(stats->ojs_hash != NULL);
 
-	if (event >= stats->ojs_cntr_num)
-		RETURN(-EINVAL);
-
 	if (jobid == NULL || strlen(jobid) == 0)
-		RETURN(-EINVAL);
+		return ERR_PTR(-EINVAL);
 
 	if (strlen(jobid) >= LUSTRE_JOBID_SIZE) {
 		CERROR("Invalid jobid size (%lu), expect(%d)\n",
 		       (unsigned long)strlen(jobid) + 1, LUSTRE_JOBID_SIZE);
-		RETURN(-EINVAL);
+		return ERR_PTR(-EINVAL);
 	}
 
 	job = cfs_hash_lookup(stats->ojs_hash, jobid);
@@ -294,7 +305,7 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 
 	job = job_alloc(jobid, stats);
 	if (job == NULL)
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 
 	job2 = cfs_hash_findadd_unique(stats->ojs_hash, job->js_jobid,
 				       &job->js_hash);
@@ -316,6 +327,23 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 found:
 	LASSERT(stats == job->js_jobstats);
 	job->js_timestamp = cfs_time_current_sec();
+	return job;
+}
+
+int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
+			  int event, long amount)
+{
+	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
+	struct job_stat *job;
+	ENTRY;
+
+	if (event >= stats->ojs_cntr_num)
+		RETURN(-EINVAL);
+
+	job = job_stats_get(stats, jobid);
+	if (IS_ERR(job))
+		RETURN(PTR_ERR(job));
+
 	lprocfs_counter_add(job->js_stats, event, amount);
 
 	job_putref(job);
@@ -324,6 +352,41 @@ found:
 }
 EXPORT_SYMBOL(lprocfs_job_stats_log);
 
+/**
+ * Account the server-side latency breakdown of an RPC to \a jobid.
+ *
+ * \param[in] obd		target device handling the RPC
+ * \param[in] jobid		JobID of the RPC
+ * \param[in] reqin_time	usec from arrival until NRS enqueue
+ * \param[in] nrs_time		usec spent waiting in the NRS queue
+ * \param[in] handle_time	usec spent in the request handler
+ */
+int lprocfs_job_stats_log_rpc(struct obd_device *obd, char *jobid,
+			      __u32 reqin_time, __u32 nrs_time,
+			      __u32 handle_time)
+{
+	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
+	int base = stats->ojs_cntr_num;
+	struct job_stat *job;
+	ENTRY;
+
+	job = job_stats_get(stats, jobid);
+	if (IS_ERR(job))
+		RETURN(PTR_ERR(job));
+
+	lprocfs_counter_add(job->js_stats, base + LPROC_JOB_RPC_REQIN,
+			    reqin_time);
+	lprocfs_counter_add(job->js_stats, base + LPROC_JOB_RPC_NRS,
+			    nrs_time);
+	lprocfs_counter_add(job->js_stats, base + LPROC_JOB_RPC_HANDLE,
+			    handle_time);
+
+	job_putref(job);
+
+	RETURN(0);
+}
+EXPORT_SYMBOL(lprocfs_job_stats_log_rpc);
+
 void lprocfs_job_stats_fini(struct obd_device *obd)
 {
 	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
@@ -820,9 +820,20 @@ static const char *obd_connect_names[] = {
 	"second_flags",
 	/* flags2 names */
 	"file_secctx",
-	NULL
+	/* later flags2 bits, indexed by their bit number */
+	[64 + 40] = "batch_rpc",	/* OBD_CONNECT2_BATCH_RPC */
+	[64 + 41] = "replay_window",	/* OBD_CONNECT2_REPLAY_WINDOW */
+	[64 + 42] = "ping_aggr",	/* OBD_CONNECT2_PING_AGGR */
+	[64 + 43] = "bl_ast_batch",	/* OBD_CONNECT2_BL_AST_BATCH */
 };
 
+/* name of bit \a i of obd_connect_names[], or "unknown" for a gap */
+static inline const char *obd_connect_name(int i)
+{
+	return obd_connect_names[i] != NULL ? obd_connect_names[i] :
+					      "unknown";
+}
+
 static void obd_connect_seq_flags2str(struct seq_file *m, __u64 flags,
 				      __u64 flags2, const char *sep)
 {
@@ -847,10 +858,11 @@ static void obd_connect_seq_flags2str(struct seq_file *m, __u64 flags,
 	if (!(flags & OBD_CONNECT_FLAGS2) || flags2 == 0)
 		return;
 
-	for (i = 64, mask = 1; obd_connect_names[i] != NULL; i++, mask <<= 1) {
+	for (i = 64, mask = 1; i < ARRAY_SIZE(obd_connect_names);
+	     i++, mask <<= 1) {
 		if (flags2 & mask) {
 			seq_printf(m, "%s%s",
-				   first ? "" : sep, obd_connect_names[i]);
+				   first ? "" : sep, obd_connect_name(i));
 			first = false;
 		}
 	}
@@ -882,10 +894,11 @@ int obd_connect_flags2str(char *page, int count, __u64 flags, __u64 flags2,
 	if (!(flags & OBD_CONNECT_FLAGS2) || flags2 == 0)
 		return ret;
 
-	for (i = 64, mask = 1; obd_connect_names[i] != NULL; i++, mask <<= 1) {
+	for (i = 64, mask = 1; i < ARRAY_SIZE(obd_connect_names);
+	     i++, mask <<= 1) {
 		if (flags2 & mask)
 			ret += snprintf(page + ret, count - ret, "%s%s",
-					ret ? sep : "", obd_connect_names[i]);
+					ret ? sep : "", obd_connect_name(i));
 	}
 
 	if (flags2 & ~(mask - 1))
@@ -1614,6 +1627,7 @@ void lprocfs_init_mps_stats(int num_private_stats, struct lprocfs_stats *stats)
         LPROCFS_MD_OP_INIT(num_private_stats, stats, cancel_unused);
         LPROCFS_MD_OP_INIT(num_private_stats, stats, intent_getattr_async);
         LPROCFS_MD_OP_INIT(num_private_stats, stats, revalidate_lock);
+	LPROCFS_MD_OP_INIT(num_private_stats, stats, batch);
 }
 
 int lprocfs_alloc_md_stats(struct obd_device *obd,
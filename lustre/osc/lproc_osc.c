@@ -606,6 +606,7 @@ LPROC_SEQ_FOPS_WO_TYPE(osc, ping);
 
 LPROC_SEQ_FOPS_RW_TYPE(osc, import);
 LPROC_SEQ_FOPS_RW_TYPE(osc, pinger_recov);
+LPROC_SEQ_FOPS_RW_TYPE(osc, rpc_latency);
 
 struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	{ .name	=	"uuid",
@@ -673,6 +674,8 @@ struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	  .fops	=	&osc_state_fops			},
 	{ .name	=	"pinger_recov",
 	  .fops	=	&osc_pinger_recov_fops		},
+	{ .name	=	"rpc_latency",
+	  .fops	=	&osc_rpc_latency_fops		},
 	{ .name	=	"unstable_stats",
 	  .fops	=	&osc_unstable_stats_fops	},
 	{ NULL }
@@ -140,6 +140,7 @@ void osc_lru_unreserve(struct client_obd *cli, unsigned long npages);
 extern struct lu_kmem_descr osc_caches[];
 
 unsigned long osc_ldlm_weigh_ast(struct ldlm_lock *dlmlock);
+unsigned long osc_ldlm_cost_ast(struct ldlm_lock *dlmlock);
 
 int osc_cleanup(struct obd_device *obd);
 int osc_setup(struct obd_device *obd, struct lustre_cfg *lcfg);
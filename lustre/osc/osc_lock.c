@@ -744,6 +744,35 @@ out:
 	return weight;
 }
 
+/**
+ * Get the cost of cancelling a dlm lock for the cost-aware LRU policy, that
+ * is the number of pages cached under it. To keep the LRU scan cheap, this
+ * is estimated as the smaller of the object page count and the lock extent
+ * rather than looked up in the page cache.
+ */
+unsigned long osc_ldlm_cost_ast(struct ldlm_lock *dlmlock)
+{
+	struct ldlm_extent *extent = &dlmlock->l_policy_data.l_extent;
+	struct osc_object *obj;
+	unsigned long pages = 0;
+	__u64 span;
+
+	if (dlmlock->l_resource->lr_type != LDLM_EXTENT)
+		return 0;
+
+	span = (extent->end >> PAGE_SHIFT) - (extent->start >> PAGE_SHIFT) + 1;
+
+	/* l_ast_data is cleared under the resource lock when the object
+	 * goes away, see osc_object_prune() */
+	lock_res_and_lock(dlmlock);
+	obj = dlmlock->l_ast_data;
+	if (obj != NULL)
+		pages = min_t(__u64, obj->oo_npages, span);
+	unlock_res_and_lock(dlmlock);
+
+	return pages;
+}
+
 static void osc_lock_build_einfo(const struct lu_env *env,
 				 const struct cl_lock *lock,
 				 struct osc_object *osc,
@@ -473,16 +473,181 @@ __must_hold(&req->rq_lock)
 
 static struct kmem_cache *request_cache;
 
+static int rq_cache_max = 32;
+module_param(rq_cache_max, int, 0644);
+MODULE_PARM_DESC(rq_cache_max, "Max # of cached requests per request format and CPU partition, 0 to disable");
+
+/* bigger request buffers are not cached */
+#define PTLRPC_RQ_CACHE_MAX_SIZE	(4 * PAGE_SIZE)
+
+/**
+ * Per-CPT caches of client requests with their request buffer, one
+ * ptlrpc_request_pool per request format, indexed by
+ * req_capsule_fmt_index().
+ */
+static struct ptlrpc_request_pool **ptlrpc_rq_caches;
+
+/**
+ * Frees up to \a nr requests cached in \a pool, returns the number freed.
+ */
+static unsigned long ptlrpc_rq_cache_release(struct ptlrpc_request_pool *pool,
+					     unsigned long nr)
+{
+	struct ptlrpc_request	*req;
+	struct list_head	 reqs;
+	unsigned long		 count = 0;
+
+	INIT_LIST_HEAD(&reqs);
+	spin_lock(&pool->prp_lock);
+	while (count < nr && !list_empty(&pool->prp_req_list)) {
+		/* the oldest requests are at the tail */
+		req = list_entry(pool->prp_req_list.prev,
+				 struct ptlrpc_request, rq_list);
+		list_move(&req->rq_list, &reqs);
+		pool->prp_nr_free--;
+		count++;
+	}
+	spin_unlock(&pool->prp_lock);
+
+	while (!list_empty(&reqs)) {
+		req = list_entry(reqs.next, struct ptlrpc_request, rq_list);
+		list_del(&req->rq_list);
+		OBD_FREE_LARGE(req->rq_reqbuf, req->rq_reqbuf_len);
+		ptlrpc_request_cache_free(req);
+	}
+	return count;
+}
+
+/*
+ * memory shrinker of the request caches
+ */
+static struct shrinker *ptlrpc_rq_cache_shrinker;
+
+static unsigned long ptlrpc_rq_cache_shrink_count(struct shrinker *s,
+						  struct shrink_control *sc)
+{
+	struct ptlrpc_request_pool	*pools;
+	size_t				 nfmt = req_capsule_fmt_count();
+	unsigned long			 count = 0;
+	size_t				 j;
+	int				 i;
+
+	/* NB: not locking; just looking. */
+	cfs_percpt_for_each(pools, i, ptlrpc_rq_caches) {
+		for (j = 0; j < nfmt; j++)
+			count += pools[j].prp_nr_free;
+	}
+	return count;
+}
+
+static unsigned long ptlrpc_rq_cache_shrink_scan(struct shrinker *s,
+						 struct shrink_control *sc)
+{
+	struct ptlrpc_request_pool	*pools;
+	size_t				 nfmt = req_capsule_fmt_count();
+	unsigned long			 released = 0;
+	size_t				 j;
+	int				 i;
+
+	cfs_percpt_for_each(pools, i, ptlrpc_rq_caches) {
+		for (j = 0; j < nfmt && released < sc->nr_to_scan; j++)
+			released += ptlrpc_rq_cache_release(&pools[j],
+						sc->nr_to_scan - released);
+	}
+	CDEBUG(D_RPCTRACE, "released %lu cached requests\n", released);
+
+	return released;
+}
+
+#ifndef HAVE_SHRINKER_COUNT
+static int ptlrpc_rq_cache_shrink(SHRINKER_ARGS(sc, nr_to_scan, gfp_mask))
+{
+	struct shrink_control scv = {
+		.nr_to_scan = shrink_param(sc, nr_to_scan),
+		.gfp_mask   = shrink_param(sc, gfp_mask)
+	};
+#if !defined(HAVE_SHRINKER_WANT_SHRINK_PTR) && !defined(HAVE_SHRINK_CONTROL)
+	struct shrinker *shrinker = NULL;
+#endif
+
+	ptlrpc_rq_cache_shrink_scan(shrinker, &scv);
+
+	return ptlrpc_rq_cache_shrink_count(shrinker, &scv);
+}
+#endif /* HAVE_SHRINKER_COUNT */
+
+static int ptlrpc_rq_cache_init(void)
+{
+	struct ptlrpc_request_pool	*pools;
+	size_t				 nfmt = req_capsule_fmt_count();
+	size_t				 j;
+	int				 i;
+	DEF_SHRINKER_VAR(shvar, ptlrpc_rq_cache_shrink,
+			 ptlrpc_rq_cache_shrink_count,
+			 ptlrpc_rq_cache_shrink_scan);
+
+	ptlrpc_rq_caches = cfs_percpt_alloc(cfs_cpt_table,
+					    nfmt * sizeof(*pools));
+	if (ptlrpc_rq_caches == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(pools, i, ptlrpc_rq_caches) {
+		for (j = 0; j < nfmt; j++) {
+			spin_lock_init(&pools[j].prp_lock);
+			INIT_LIST_HEAD(&pools[j].prp_req_list);
+			pools[j].prp_cache = 1;
+		}
+	}
+
+	ptlrpc_rq_cache_shrinker = set_shrinker(DEFAULT_SEEKS, &shvar);
+	if (ptlrpc_rq_cache_shrinker == NULL) {
+		cfs_percpt_free(ptlrpc_rq_caches);
+		ptlrpc_rq_caches = NULL;
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+static void ptlrpc_rq_cache_fini(void)
+{
+	struct ptlrpc_request_pool	*pools;
+	size_t				 nfmt = req_capsule_fmt_count();
+	size_t				 j;
+	int				 i;
+
+	if (ptlrpc_rq_caches == NULL)
+		return;
+
+	remove_shrinker(ptlrpc_rq_cache_shrinker);
+	ptlrpc_rq_cache_shrinker = NULL;
+
+	cfs_percpt_for_each(pools, i, ptlrpc_rq_caches) {
+		for (j = 0; j < nfmt; j++)
+			ptlrpc_rq_cache_release(&pools[j], ULONG_MAX);
+	}
+	cfs_percpt_free(ptlrpc_rq_caches);
+	ptlrpc_rq_caches = NULL;
+}
+
 int ptlrpc_request_cache_init(void)
 {
+	int rc;
+
 	request_cache = kmem_cache_create("ptlrpc_cache",
 					  sizeof(struct ptlrpc_request),
 					  0, SLAB_HWCACHE_ALIGN, NULL);
-	return request_cache == NULL ? -ENOMEM : 0;
+	if (request_cache == NULL)
+		return -ENOMEM;
+
+	rc = ptlrpc_rq_cache_init();
+	if (rc != 0)
+		kmem_cache_destroy(request_cache);
+	return rc;
 }
 
 void ptlrpc_request_cache_fini(void)
 {
+	ptlrpc_rq_cache_fini();
 	kmem_cache_destroy(request_cache);
 }
 
@@ -499,6 +664,159 @@ void ptlrpc_request_cache_free(struct ptlrpc_request *req)
 	OBD_SLAB_FREE_PTR(req, request_cache);
 }
 
+/**
+ * Whether requests on \a imp can use a cached request buffer, i.e. whether
+ * the import currently uses the null flavor, which packs the message in
+ * place.
+ */
+static bool ptlrpc_rq_cache_flvr_ok(struct obd_import *imp)
+{
+	struct ptlrpc_sec	*sec;
+	bool			 ok;
+
+	sec = sptlrpc_import_sec_ref(imp);
+	if (sec == NULL)
+		return false;
+
+	ok = SPTLRPC_FLVR_POLICY(sec->ps_flvr.sf_rpc) == SPTLRPC_POLICY_NULL;
+	sptlrpc_sec_put(sec);
+	return ok;
+}
+
+/**
+ * Takes a request with a request buffer sized for \a format from the cache
+ * of the current CPT, or allocates a new one for that cache.
+ *
+ * The buffer starts at the size of a message with the declared field sizes
+ * of \a format, and grows to the biggest message seen for the format, see
+ * ptlrpc_rq_cache_fit().  Returns NULL if caching is disabled, \a imp does
+ * not use the null flavor, or the buffer would be too big to cache.
+ */
+static struct ptlrpc_request *
+ptlrpc_rq_cache_get(struct obd_import *imp, const struct req_format *format)
+{
+	struct ptlrpc_request_pool	*pool;
+	struct ptlrpc_request		*req = NULL;
+	struct lustre_msg		*reqbuf;
+	int				 cpt;
+	int				 size;
+
+	if (rq_cache_max <= 0 || !ptlrpc_rq_cache_flvr_ok(imp))
+		return NULL;
+
+	cpt = cfs_cpt_current(cfs_cpt_table, 1);
+	pool = &ptlrpc_rq_caches[cpt][req_capsule_fmt_index(format)];
+
+	spin_lock(&pool->prp_lock);
+	if (!list_empty(&pool->prp_req_list)) {
+		req = list_entry(pool->prp_req_list.next,
+				 struct ptlrpc_request, rq_list);
+		list_del_init(&req->rq_list);
+		pool->prp_nr_free--;
+	} else if (pool->prp_rq_size == 0) {
+		pool->prp_rq_size = size_roundup_power2(
+			req_capsule_fmt_size(LUSTRE_MSG_MAGIC_V2, format,
+					     RCL_CLIENT));
+	}
+	size = pool->prp_rq_size;
+	spin_unlock(&pool->prp_lock);
+
+	if (req != NULL) {
+		reqbuf = req->rq_reqbuf;
+		size = req->rq_reqbuf_len;
+		memset(req, 0, sizeof(*req));
+	} else {
+		if (size > PTLRPC_RQ_CACHE_MAX_SIZE)
+			return NULL;
+
+		req = ptlrpc_request_cache_alloc(GFP_NOFS);
+		if (req == NULL)
+			return NULL;
+
+		OBD_CPT_ALLOC_LARGE(reqbuf, cfs_cpt_table, cpt, size);
+		if (reqbuf == NULL) {
+			ptlrpc_request_cache_free(req);
+			return NULL;
+		}
+	}
+
+	req->rq_reqbuf = reqbuf;
+	req->rq_reqbuf_len = size;
+	req->rq_pool = pool;
+	return req;
+}
+
+/**
+ * Returns \a req to the request cache it was taken from, unless the cache
+ * is full or the request buffer no longer has the cached size.
+ */
+static void ptlrpc_rq_cache_put(struct ptlrpc_request *req)
+{
+	struct ptlrpc_request_pool *pool = req->rq_pool;
+
+	LASSERT(list_empty(&req->rq_list));
+	LASSERT(!req->rq_receiving_reply);
+
+	spin_lock(&pool->prp_lock);
+	if (pool->prp_nr_free < rq_cache_max &&
+	    req->rq_reqbuf_len == pool->prp_rq_size) {
+		/* LIFO, the last request freed is the most cache-hot */
+		list_add(&req->rq_list, &pool->prp_req_list);
+		pool->prp_nr_free++;
+		spin_unlock(&pool->prp_lock);
+		return;
+	}
+	spin_unlock(&pool->prp_lock);
+
+	OBD_FREE_LARGE(req->rq_reqbuf, req->rq_reqbuf_len);
+	ptlrpc_request_cache_free(req);
+}
+
+/**
+ * Makes sure the request buffer of \a req, taken from a request cache, can
+ * be used for a \a msgsize byte message.
+ *
+ * Cached buffers are only used by the null flavor, which packs the message
+ * in place.  A buffer too small for \a msgsize is replaced by a bigger one,
+ * and later requests of the same format get the bigger size.  If the
+ * flavor of the import changed since ptlrpc_rq_cache_get(), the request
+ * leaves the cache and the security policy allocates its buffers as usual.
+ */
+void ptlrpc_rq_cache_fit(struct ptlrpc_request *req, int msgsize)
+{
+	struct ptlrpc_request_pool	*pool = req->rq_pool;
+	struct lustre_msg		*reqbuf = NULL;
+	bool				 null_flvr;
+	int				 size;
+
+	LASSERT(pool != NULL && pool->prp_cache);
+
+	null_flvr = SPTLRPC_FLVR_POLICY(req->rq_flvr.sf_rpc) ==
+		    SPTLRPC_POLICY_NULL;
+	if (null_flvr && msgsize <= req->rq_reqbuf_len)
+		return;
+
+	size = size_roundup_power2(msgsize);
+	if (null_flvr && size <= PTLRPC_RQ_CACHE_MAX_SIZE) {
+		OBD_ALLOC_LARGE(reqbuf, size);
+		if (reqbuf != NULL) {
+			spin_lock(&pool->prp_lock);
+			if (pool->prp_rq_size < size)
+				pool->prp_rq_size = size;
+			spin_unlock(&pool->prp_lock);
+		}
+	}
+
+	OBD_FREE_LARGE(req->rq_reqbuf, req->rq_reqbuf_len);
+	req->rq_reqbuf = reqbuf;
+	if (reqbuf != NULL) {
+		req->rq_reqbuf_len = size;
+	} else {
+		req->rq_reqbuf_len = 0;
+		req->rq_pool = NULL;
+	}
+}
+
 /**
  * Wind down request pool \a pool.
  * Frees all requests from the pool too
@@ -645,6 +963,11 @@ static void __ptlrpc_free_req_to_pool(struct ptlrpc_request *request)
 {
 	struct ptlrpc_request_pool *pool = request->rq_pool;
 
+	if (pool->prp_cache) {
+		ptlrpc_rq_cache_put(request);
+		return;
+	}
+
 	spin_lock(&pool->prp_lock);
 	LASSERT(list_empty(&request->rq_list));
 	LASSERT(!request->rq_receiving_reply);
@@ -774,7 +1097,7 @@ int ptlrpc_request_bufs_pack(struct ptlrpc_request *request,
 	RETURN(0);
 
 out_ctx:
-	LASSERT(!request->rq_pool);
+	LASSERT(!request->rq_pool || request->rq_pool->prp_cache);
 	sptlrpc_cli_ctx_put(request->rq_cli_ctx, 1);
 out_free:
 	class_import_put(imp);
@@ -820,17 +1143,23 @@ EXPORT_SYMBOL(ptlrpc_request_pack);
 
 /**
  * Helper function to allocate new request on import \a imp
- * and possibly using existing request from pool \a pool if provided.
+ * and possibly using existing request from pool \a pool if provided,
+ * or from the request cache of \a format otherwise.
  * Returns allocated request structure with import field filled or
  * NULL on error.
  */
 static inline
 struct ptlrpc_request *__ptlrpc_request_alloc(struct obd_import *imp,
-					      struct ptlrpc_request_pool *pool)
+					      struct ptlrpc_request_pool *pool,
+					      const struct req_format *format)
 {
 	struct ptlrpc_request *request = NULL;
 
-	request = ptlrpc_request_cache_alloc(GFP_NOFS);
+	/* requests of a pool need their preallocated buffer size */
+	if (pool == NULL && format != NULL)
+		request = ptlrpc_rq_cache_get(imp, format);
+	if (request == NULL)
+		request = ptlrpc_request_cache_alloc(GFP_NOFS);
 
 	if (!request && pool)
 		request = ptlrpc_prep_req_from_pool(pool);
@@ -865,7 +1194,7 @@ ptlrpc_request_alloc_internal(struct obd_import *imp,
 {
         struct ptlrpc_request *request;
 
-        request = __ptlrpc_request_alloc(imp, pool);
+	request = __ptlrpc_request_alloc(imp, pool, format);
         if (request == NULL)
                 return NULL;
 
@@ -1089,6 +1418,7 @@ void ptlrpc_set_add_req(struct ptlrpc_request_set *set,
 	req->rq_set = set;
 	atomic_inc(&set->set_remaining);
 	req->rq_queued_time = cfs_time_current();
+	req->rq_cli.cr_queued_ns = ktime_get_real();
 
 	if (req->rq_reqmsg != NULL)
 		lustre_msg_set_jobid(req->rq_reqmsg, NULL);
@@ -1120,6 +1450,7 @@ void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 	 */
 	req->rq_set = set;
 	req->rq_queued_time = cfs_time_current();
+	req->rq_cli.cr_queued_ns = ktime_get_real();
 	list_add_tail(&req->rq_set_chain, &set->set_new_requests);
 	count = atomic_inc_return(&set->set_new_count);
 	spin_unlock(&set->set_new_req_lock);
@@ -1418,6 +1749,7 @@ static int after_reply(struct ptlrpc_request *req)
 				    timediff);
 		ptlrpc_lprocfs_rpc_sent(req, timediff);
 	}
+	ptlrpc_lprocfs_rpc_latency(req, work_start);
 
         if (lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_REPLY &&
             lustre_msg_get_type(req->rq_repmsg) != PTL_RPC_MSG_ERR) {
@@ -2740,6 +3072,7 @@ void ptlrpc_free_committed(struct obd_import *imp)
                         break;
                 }
 
+		ptlrpc_lprocfs_rpc_commit(req);
 		if (req->rq_replay) {
 			DEBUG_REQ(D_RPCTRACE, req, "keeping (FL_REPLAY)");
 			list_move_tail(&req->rq_replay_list,
@@ -2939,9 +3272,9 @@ static int ptlrpc_replay_interpret(const struct lu_env *env,
 {
 	struct ptlrpc_replay_async_args *aa = data;
 	struct obd_import *imp = req->rq_import;
+	bool reconnect;
 
 	ENTRY;
-	atomic_dec(&imp->imp_replay_inflight);
 
 	/* Note: if it is bulk replay (MDS-MDS replay), then even if
 	 * server got the request, but bulk transfer timeout, let's
@@ -2981,7 +3314,11 @@ static int ptlrpc_replay_interpret(const struct lu_env *env,
 	/** if replays by version then gap occur on server, no trust to locks */
 	if (lustre_msg_get_flags(req->rq_repmsg) & MSG_VERSION_REPLAY)
 		imp->imp_no_lock_replay = 1;
-	imp->imp_last_replay_transno = lustre_msg_get_transno(req->rq_reqmsg);
+	/* replies may come back out of order if replays are pipelined */
+	if (lustre_msg_get_transno(req->rq_reqmsg) >
+	    imp->imp_last_replay_transno)
+		imp->imp_last_replay_transno =
+			lustre_msg_get_transno(req->rq_reqmsg);
 	spin_unlock(&imp->imp_lock);
         LASSERT(imp->imp_last_replay_transno);
 
@@ -3060,16 +3397,38 @@ static int ptlrpc_replay_interpret(const struct lu_env *env,
         if (req->rq_transno == 0)
                 CERROR("Transno is 0 during replay!\n");
 
-        /* continue with recovery */
-        rc = ptlrpc_import_recovery_state_machine(imp);
+	/* continue with recovery */
+	atomic_dec(&imp->imp_replay_inflight);
+	rc = ptlrpc_import_recovery_state_machine(imp);
+	req->rq_send_state = aa->praa_old_state;
+
+	if (rc != 0)
+		ptlrpc_connect_import(imp);
+
+	RETURN(rc);
  out:
-        req->rq_send_state = aa->praa_old_state;
+	req->rq_send_state = aa->praa_old_state;
+
+	/* Later replays of the window may still succeed, so remember where
+	 * to resume from before this one stops counting as in flight. The
+	 * first failure of the window restarts recovery, the others of the
+	 * same window only lower the resume point. */
+	spin_lock(&imp->imp_lock);
+	reconnect = imp->imp_replay_rewind_transno == ~0ULL;
+	if (lustre_msg_get_replay_prev(req->rq_reqmsg) <
+	    imp->imp_replay_rewind_transno)
+		imp->imp_replay_rewind_transno =
+			lustre_msg_get_replay_prev(req->rq_reqmsg);
+	spin_unlock(&imp->imp_lock);
+	atomic_dec(&imp->imp_replay_inflight);
 
-        if (rc != 0)
-                /* this replay failed, so restart recovery */
-                ptlrpc_connect_import(imp);
+	/* this replay failed, so restart recovery */
+	if (reconnect)
+		ptlrpc_connect_import(imp);
+	else
+		DEBUG_REQ(D_HA, req, "replay failed, already reconnecting");
 
-        RETURN(rc);
+	RETURN(rc);
 }
 
 /**
@@ -3106,7 +3465,6 @@ int ptlrpc_replay_req(struct ptlrpc_request *req)
                                     ptlrpc_at_get_net_latency(req));
         DEBUG_REQ(D_HA, req, "REPLAY");
 
-	atomic_inc(&req->rq_import->imp_replay_inflight);
 	spin_lock(&req->rq_lock);
 	req->rq_early_free_repbuf = 0;
 	spin_unlock(&req->rq_lock);
@@ -60,6 +60,7 @@ void request_out_callback(struct lnet_event *ev)
 
 	spin_lock(&req->rq_lock);
 	req->rq_real_sent = ktime_get_real_seconds();
+	req->rq_cli.cr_sent_out_ns = ktime_get_real();
 	req->rq_req_unlinked = 1;
 	/* reply_in_callback happened before request_out_callback? */
 	if (req->rq_reply_unlinked)
@@ -149,6 +150,7 @@ void reply_in_callback(struct lnet_event *ev)
                 /* Real reply */
                 req->rq_rep_swab_mask = 0;
                 req->rq_replied = 1;
+		req->rq_cli.cr_replied_ns = ktime_get_real();
 		/* Got reply, no resend required */
 		req->rq_resend = 0;
                 req->rq_reply_off = ev->offset;
@@ -297,7 +299,7 @@ void request_in_callback(struct lnet_event *ev)
                  ev->type == LNET_EVENT_UNLINK);
         LASSERT ((char *)ev->md.start >= rqbd->rqbd_buffer);
         LASSERT ((char *)ev->md.start + ev->offset + ev->mlength <=
-                 rqbd->rqbd_buffer + service->srv_buf_size);
+                 rqbd->rqbd_buffer + rqbd->rqbd_buffer_size);
 
         CDEBUG((ev->status == 0) ? D_NET : D_ERROR,
                "event type %d, status %d, service %s\n",
@@ -333,8 +335,10 @@ void request_in_callback(struct lnet_event *ev)
 	 * size to non-zero if this was a successful receive. */
 	req->rq_xid = ev->match_bits;
 	req->rq_reqbuf = ev->md.start + ev->offset;
-	if (ev->type == LNET_EVENT_PUT && ev->status == 0)
+	if (ev->type == LNET_EVENT_PUT && ev->status == 0) {
 		req->rq_reqdata_len = ev->mlength;
+		lprocfs_oh_tally_log2(&svcpt->scp_req_size_hist, ev->mlength);
+	}
 	ktime_get_real_ts64(&req->rq_arrival_time);
 	/* Multi-Rail: keep track of both initiator and source NID. */
 	req->rq_peer = ev->initiator;
@@ -353,18 +357,27 @@ void request_in_callback(struct lnet_event *ev)
 
 	ptlrpc_req_add_history(svcpt, req);
 
+	if (ev->type == LNET_EVENT_PUT && ev->status == 0) {
+		svcpt->scp_adapt_nreqs++;
+		svcpt->scp_adapt_bytes += ev->mlength;
+	}
+
 	if (ev->unlinked) {
 		svcpt->scp_nrqbds_posted--;
 		CDEBUG(D_INFO, "Buffer complete: %d buffers still posted\n",
 		       svcpt->scp_nrqbds_posted);
 
 		/* Normally, don't complain about 0 buffers posted; LNET won't
-		 * drop incoming reqs since we set the portal lazy */
-		if (test_req_buffer_pressure &&
-		    ev->type != LNET_EVENT_UNLINK &&
-		    svcpt->scp_nrqbds_posted == 0)
-                        CWARN("All %s request buffers busy\n",
-                              service->srv_name);
+		 * drop incoming reqs since we set the portal lazy, but
+		 * account for it so more buffers get posted */
+		if (ev->type != LNET_EVENT_UNLINK &&
+		    svcpt->scp_nrqbds_posted == 0) {
+			svcpt->scp_rqbd_busy++;
+			svcpt->scp_adapt_busy++;
+			if (test_req_buffer_pressure)
+				CWARN("All %s request buffers busy\n",
+				      service->srv_name);
+		}
 
                 /* req takes over the network's ref on rqbd */
         } else {
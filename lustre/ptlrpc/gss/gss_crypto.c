@@ -48,9 +48,11 @@
 
 #define DEBUG_SUBSYSTEM S_SEC
 
+#include <linux/module.h>
 #include <libcfs/linux/linux-crypto.h>
 #include <obd.h>
 #include <obd_support.h>
+#include <lustre_net.h>
 
 #include "gss_internal.h"
 #include "gss_crypto.h"
@@ -77,6 +79,10 @@ int gss_keyblock_init(struct gss_keyblock *kb, char *alg_name,
 		return rc;
 	}
 
+	/* the crypto API picks the best implementation, e.g. AES-NI */
+	CDEBUG(D_SEC, "%s implemented by %s\n", alg_name,
+	       crypto_tfm_alg_driver_name(crypto_blkcipher_tfm(kb->kb_tfm)));
+
 	return 0;
 }
 
@@ -489,3 +495,383 @@ int gss_crypt_rawobjs(struct crypto_blkcipher *tfm, __u8 *iv,
 	outobj->len = datalen;
 	RETURN(0);
 }
+
+/*
+ * bulk crypto pipeline
+ *
+ * large bulk crypto work is cut into chunks, which are run by the
+ * submitting thread together with the gss_crypt threads of its CPU
+ * partition. the submitter runs whatever the threads haven't picked up
+ * yet, so it never waits on a busy partition.
+ */
+static int bulk_crypt_threads = 2;
+module_param(bulk_crypt_threads, int, 0444);
+MODULE_PARM_DESC(bulk_crypt_threads,
+		 "bulk crypto threads per CPU partition, 0 to disable");
+
+static int bulk_crypt_chunk_pages = 64;
+module_param(bulk_crypt_chunk_pages, int, 0644);
+MODULE_PARM_DESC(bulk_crypt_chunk_pages,
+		 "pages of a bulk handled by one crypto thread at a time");
+
+struct gss_bulk_job {
+	atomic_t		gbj_pending;
+	struct completion	gbj_done;
+};
+
+struct gss_crypt_sched {
+	spinlock_t		gcs_lock;
+	/* chunks waiting for a thread */
+	struct list_head	gcs_queue;
+	wait_queue_head_t	gcs_waitq;
+	int			gcs_cpt;
+	int			gcs_nthreads;
+	int			gcs_stopping;
+};
+
+static struct gss_crypt_sched **gss_crypt_scheds;
+
+static void gss_bulk_chunk_run(struct gss_bulk_chunk *chunk)
+{
+	struct gss_bulk_job *job = chunk->gbc_job;
+
+	chunk->gbc_rc = chunk->gbc_func(chunk);
+	if (atomic_dec_and_test(&job->gbj_pending))
+		complete(&job->gbj_done);
+}
+
+/**
+ * Whether a bulk of \a npages pages is worth being split between threads.
+ */
+int gss_bulk_crypt_enabled(int npages)
+{
+	return gss_crypt_scheds != NULL && bulk_crypt_chunk_pages > 0 &&
+	       npages >= bulk_crypt_chunk_pages;
+}
+
+/**
+ * Run \a nchunks independent chunks of work and wait for all of them.
+ *
+ * \retval the first non-zero gbc_rc of the chunks, or 0
+ */
+int gss_bulk_run(struct gss_bulk_chunk *chunks, int nchunks)
+{
+	struct gss_crypt_sched *sched = NULL;
+	struct gss_bulk_job job;
+	int rc = 0;
+	int i;
+
+	LASSERT(nchunks > 0);
+
+	atomic_set(&job.gbj_pending, nchunks);
+	init_completion(&job.gbj_done);
+
+	for (i = 0; i < nchunks; i++) {
+		INIT_LIST_HEAD(&chunks[i].gbc_list);
+		chunks[i].gbc_job = &job;
+		chunks[i].gbc_rc = 0;
+	}
+
+	if (gss_crypt_scheds != NULL && nchunks > 1) {
+		sched = gss_crypt_scheds[cfs_cpt_current(cfs_cpt_table, 1)];
+
+		spin_lock(&sched->gcs_lock);
+		for (i = 1; i < nchunks; i++)
+			list_add_tail(&chunks[i].gbc_list, &sched->gcs_queue);
+		spin_unlock(&sched->gcs_lock);
+
+		wake_up_all(&sched->gcs_waitq);
+	}
+
+	gss_bulk_chunk_run(&chunks[0]);
+
+	for (i = 1; i < nchunks; i++) {
+		if (sched != NULL) {
+			spin_lock(&sched->gcs_lock);
+			/* already taken by a thread */
+			if (list_empty(&chunks[i].gbc_list)) {
+				spin_unlock(&sched->gcs_lock);
+				continue;
+			}
+			list_del_init(&chunks[i].gbc_list);
+			spin_unlock(&sched->gcs_lock);
+		}
+		gss_bulk_chunk_run(&chunks[i]);
+	}
+
+	wait_for_completion(&job.gbj_done);
+
+	for (i = 0; i < nchunks && rc == 0; i++)
+		rc = chunks[i].gbc_rc;
+
+	return rc;
+}
+
+struct gss_bulk_crypt_args {
+	struct crypto_blkcipher		*gba_tfm;
+	struct ptlrpc_bulk_desc		*gba_desc;
+};
+
+/*
+ * decrypt the cipher text pages of one chunk, chained from gbc_iv.
+ */
+static int gss_decrypt_pages(struct gss_bulk_chunk *chunk)
+{
+	struct gss_bulk_crypt_args *args = chunk->gbc_data;
+	struct ptlrpc_bulk_desc *desc = args->gba_desc;
+	struct blkcipher_desc cdesc = {
+		.tfm = args->gba_tfm,
+		.info = chunk->gbc_iv,
+		.flags = 0,
+	};
+	struct scatterlist ptxt;
+	struct scatterlist ctxt;
+	int blocksize;
+	int i;
+	int rc;
+
+	blocksize = crypto_blkcipher_blocksize(args->gba_tfm);
+
+	for (i = chunk->gbc_start; i < chunk->gbc_start + chunk->gbc_count;
+	     i++) {
+		lnet_kiov_t *piov = &BD_GET_KIOV(desc, i);
+		lnet_kiov_t *ciov = &BD_GET_ENC_KIOV(desc, i);
+
+		if (ciov->kiov_len == 0)
+			continue;
+
+		sg_init_table(&ctxt, 1);
+		sg_set_page(&ctxt, ciov->kiov_page, ciov->kiov_len,
+			    ciov->kiov_offset);
+		ptxt = ctxt;
+
+		/* In the event the plain text size is not a multiple
+		 * of blocksize we decrypt in place and copy the result
+		 * after the decryption */
+		if (piov->kiov_len % blocksize == 0)
+			sg_assign_page(&ptxt, piov->kiov_page);
+
+		rc = crypto_blkcipher_decrypt_iv(&cdesc, &ptxt, &ctxt,
+						 ctxt.length);
+		if (rc) {
+			CERROR("failed to decrypt page %d: rc = %d\n", i, rc);
+			return rc;
+		}
+
+		if (piov->kiov_len % blocksize != 0) {
+			memcpy(page_address(piov->kiov_page) +
+			       piov->kiov_offset,
+			       page_address(ciov->kiov_page) +
+			       ciov->kiov_offset,
+			       piov->kiov_len);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Decrypt the first \a npages cipher text pages of \a desc into its plain
+ * text pages, continuing the CBC chain from \a iv.
+ *
+ * CBC decryption of a page range only needs the last cipher block before
+ * it, so a large bulk is decrypted in chunks of bulk_crypt_chunk_pages in
+ * parallel. On return \a iv holds the chaining value after the last page,
+ * as a serial decryption would leave it.
+ *
+ * The cipher text page lengths must already have been checked to be
+ * multiples of the cipher block size.
+ */
+int gss_decrypt_bulk_pages(struct crypto_blkcipher *tfm, __u8 *iv,
+			   struct ptlrpc_bulk_desc *desc, int npages)
+{
+	struct gss_bulk_crypt_args args = {
+		.gba_tfm = tfm,
+		.gba_desc = desc,
+	};
+	struct gss_bulk_chunk *chunks = NULL;
+	struct gss_bulk_chunk *chunk;
+	struct gss_bulk_chunk single;
+	lnet_kiov_t *ciov;
+	int chunk_pages = bulk_crypt_chunk_pages;
+	int blocksize;
+	int nchunks = 1;
+	int i;
+	int rc;
+
+	blocksize = crypto_blkcipher_blocksize(tfm);
+	LASSERT(blocksize <= GSS_MAX_CIPHER_BLOCK);
+
+	if (gss_bulk_crypt_enabled(npages) && npages > chunk_pages) {
+		nchunks = (npages + chunk_pages - 1) / chunk_pages;
+		OBD_ALLOC(chunks, nchunks * sizeof(*chunks));
+		/* just do it serially then */
+		if (chunks == NULL)
+			nchunks = 1;
+	}
+
+	if (nchunks == 1) {
+		single.gbc_func = gss_decrypt_pages;
+		single.gbc_data = &args;
+		single.gbc_start = 0;
+		single.gbc_count = npages;
+		memcpy(single.gbc_iv, iv, blocksize);
+
+		rc = gss_bulk_run(&single, 1);
+		if (rc == 0)
+			memcpy(iv, single.gbc_iv, blocksize);
+		return rc;
+	}
+
+	/* pick up the chaining values before anything is decrypted, since
+	 * odd sized pages are decrypted in place */
+	for (i = 0; i < npages; i++) {
+		if (i % chunk_pages == 0) {
+			chunk = &chunks[i / chunk_pages];
+			chunk->gbc_func = gss_decrypt_pages;
+			chunk->gbc_data = &args;
+			chunk->gbc_start = i;
+			chunk->gbc_count = min(chunk_pages, npages - i);
+			memcpy(chunk->gbc_iv, iv, blocksize);
+		}
+
+		ciov = &BD_GET_ENC_KIOV(desc, i);
+		if (ciov->kiov_len != 0)
+			memcpy(iv, page_address(ciov->kiov_page) +
+			       ciov->kiov_offset + ciov->kiov_len - blocksize,
+			       blocksize);
+	}
+
+	rc = gss_bulk_run(chunks, nchunks);
+
+	OBD_FREE(chunks, nchunks * sizeof(*chunks));
+	return rc;
+}
+
+static int gss_crypt_sched_ready(struct gss_crypt_sched *sched)
+{
+	return !list_empty(&sched->gcs_queue) || sched->gcs_stopping;
+}
+
+static int gss_crypt_thread(void *arg)
+{
+	struct gss_crypt_sched *sched = arg;
+	struct gss_bulk_chunk *chunk;
+	struct l_wait_info lwi = { 0 };
+	int rc;
+
+	unshare_fs_struct();
+
+	rc = cfs_cpt_bind(cfs_cpt_table, sched->gcs_cpt);
+	if (rc != 0)
+		CWARN("failed to bind %s on CPT %d\n", current_comm(),
+		      sched->gcs_cpt);
+
+	spin_lock(&sched->gcs_lock);
+	while (!sched->gcs_stopping) {
+		if (list_empty(&sched->gcs_queue)) {
+			spin_unlock(&sched->gcs_lock);
+			l_wait_event(sched->gcs_waitq,
+				     gss_crypt_sched_ready(sched), &lwi);
+			spin_lock(&sched->gcs_lock);
+			continue;
+		}
+
+		chunk = list_entry(sched->gcs_queue.next,
+				   struct gss_bulk_chunk, gbc_list);
+		list_del_init(&chunk->gbc_list);
+		spin_unlock(&sched->gcs_lock);
+
+		gss_bulk_chunk_run(chunk);
+
+		spin_lock(&sched->gcs_lock);
+	}
+	sched->gcs_nthreads--;
+	spin_unlock(&sched->gcs_lock);
+
+	wake_up_all(&sched->gcs_waitq);
+	return 0;
+}
+
+static int gss_crypt_sched_stopped(struct gss_crypt_sched *sched)
+{
+	int stopped;
+
+	spin_lock(&sched->gcs_lock);
+	stopped = sched->gcs_nthreads == 0;
+	spin_unlock(&sched->gcs_lock);
+
+	return stopped;
+}
+
+void gss_exit_bulk_crypt(void)
+{
+	struct gss_crypt_sched *sched;
+	struct gss_crypt_sched **scheds = gss_crypt_scheds;
+	struct l_wait_info lwi = { 0 };
+	int i;
+
+	if (scheds == NULL)
+		return;
+
+	/* no new chunks are queued from now on */
+	gss_crypt_scheds = NULL;
+
+	cfs_percpt_for_each(sched, i, scheds) {
+		spin_lock(&sched->gcs_lock);
+		sched->gcs_stopping = 1;
+		spin_unlock(&sched->gcs_lock);
+
+		wake_up_all(&sched->gcs_waitq);
+		l_wait_event(sched->gcs_waitq,
+			     gss_crypt_sched_stopped(sched), &lwi);
+		LASSERT(list_empty(&sched->gcs_queue));
+	}
+
+	cfs_percpt_free(scheds);
+}
+
+int __init gss_init_bulk_crypt(void)
+{
+	struct gss_crypt_sched **scheds;
+	struct gss_crypt_sched *sched;
+	struct task_struct *task;
+	int i, j;
+
+	if (bulk_crypt_threads <= 0)
+		return 0;
+
+	scheds = cfs_percpt_alloc(cfs_cpt_table, sizeof(*sched));
+	if (scheds == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(sched, i, scheds) {
+		spin_lock_init(&sched->gcs_lock);
+		INIT_LIST_HEAD(&sched->gcs_queue);
+		init_waitqueue_head(&sched->gcs_waitq);
+		sched->gcs_cpt = i;
+	}
+	gss_crypt_scheds = scheds;
+
+	cfs_percpt_for_each(sched, i, scheds) {
+		for (j = 0; j < bulk_crypt_threads; j++) {
+			spin_lock(&sched->gcs_lock);
+			sched->gcs_nthreads++;
+			spin_unlock(&sched->gcs_lock);
+
+			task = kthread_run(gss_crypt_thread, sched,
+					   "gss_crypt_%02d_%02d", i, j);
+			if (IS_ERR(task)) {
+				CERROR("can't start crypto thread: rc = %ld\n",
+				       PTR_ERR(task));
+				spin_lock(&sched->gcs_lock);
+				sched->gcs_nthreads--;
+				spin_unlock(&sched->gcs_lock);
+				gss_exit_bulk_crypt();
+				return PTR_ERR(task);
+			}
+		}
+	}
+
+	return 0;
+}
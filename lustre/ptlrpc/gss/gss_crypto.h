@@ -32,4 +32,28 @@ int gss_crypt_rawobjs(struct crypto_blkcipher *tfm, __u8 *iv,
 		      int inobj_cnt, rawobj_t *inobjs, rawobj_t *outobj,
 		      int enc);
 
+struct gss_bulk_job;
+
+/**
+ * A piece of bulk crypto work, run either by the submitting thread or by
+ * one of the gss_crypt threads of its CPU partition.
+ */
+struct gss_bulk_chunk {
+	struct list_head	 gbc_list;
+	struct gss_bulk_job	*gbc_job;
+	int			(*gbc_func)(struct gss_bulk_chunk *chunk);
+	void			*gbc_data;
+	/** page range of the bulk */
+	int			 gbc_start;
+	int			 gbc_count;
+	/** chaining value at gbc_start */
+	__u8			 gbc_iv[GSS_MAX_CIPHER_BLOCK];
+	int			 gbc_rc;
+};
+
+int gss_bulk_crypt_enabled(int npages);
+int gss_bulk_run(struct gss_bulk_chunk *chunks, int nchunks);
+int gss_decrypt_bulk_pages(struct crypto_blkcipher *tfm, __u8 *iv,
+			   struct ptlrpc_bulk_desc *desc, int npages);
+
 #endif /* PTLRPC_GSS_CRYPTO_H */
@@ -511,6 +511,10 @@ void gss_stat_oos_record_svc(int phase, int replay);
 int  __init gss_init_lproc(void);
 void gss_exit_lproc(void);
 
+/* gss_crypto.c */
+int  __init gss_init_bulk_crypt(void);
+void gss_exit_bulk_crypt(void);
+
 /* gss_null_mech.c */
 int __init init_null_module(void);
 void cleanup_null_module(void);
@@ -763,7 +763,7 @@ int krb5_decrypt_bulk(struct crypto_blkcipher *tfm,
         struct scatterlist      src, dst;
 	struct sg_table		sg_src, sg_dst;
         int                     ct_nob = 0, pt_nob = 0;
-        int                     blocksize, i, rc;
+        int                     blocksize, i, npages, rc;
 
 	LASSERT(ptlrpc_is_bulk_desc_kiov(desc->bd_type));
         LASSERT(desc->bd_iov_count);
@@ -839,37 +839,10 @@ int krb5_decrypt_bulk(struct crypto_blkcipher *tfm,
 				BD_GET_ENC_KIOV(desc, i).kiov_len);
 		}
 
-		if (BD_GET_ENC_KIOV(desc, i).kiov_len == 0)
-			continue;
-
-		sg_init_table(&src, 1);
-		sg_set_page(&src, BD_GET_ENC_KIOV(desc, i).kiov_page,
-			    BD_GET_ENC_KIOV(desc, i).kiov_len,
-			    BD_GET_ENC_KIOV(desc, i).kiov_offset);
-		dst = src;
-		if (BD_GET_KIOV(desc, i).kiov_len % blocksize == 0)
-			sg_assign_page(&dst,
-				       BD_GET_KIOV(desc, i).kiov_page);
-
-		rc = crypto_blkcipher_decrypt_iv(&ciph_desc, &dst, &src,
-						 src.length);
-                if (rc) {
-                        CERROR("error to decrypt page: %d\n", rc);
-                        return rc;
-                }
-
-		if (BD_GET_KIOV(desc, i).kiov_len % blocksize != 0) {
-			memcpy(page_address(BD_GET_KIOV(desc, i).kiov_page) +
-			       BD_GET_KIOV(desc, i).kiov_offset,
-			       page_address(BD_GET_ENC_KIOV(desc, i).
-					    kiov_page) +
-			       BD_GET_KIOV(desc, i).kiov_offset,
-			       BD_GET_KIOV(desc, i).kiov_len);
-		}
-
 		ct_nob += BD_GET_ENC_KIOV(desc, i).kiov_len;
 		pt_nob += BD_GET_KIOV(desc, i).kiov_len;
 	}
+	npages = i;
 
         if (unlikely(ct_nob != desc->bd_nob_transferred)) {
                 CERROR("%d cipher text transferred but only %d decrypted\n",
@@ -888,6 +861,13 @@ int krb5_decrypt_bulk(struct crypto_blkcipher *tfm,
 		while (i < desc->bd_iov_count)
 			BD_GET_KIOV(desc, i++).kiov_len = 0;
 
+	/* decrypt pages, the chain continues from the confounder */
+	rc = gss_decrypt_bulk_pages(tfm, local_iv, desc, npages);
+	if (rc) {
+		CERROR("error to decrypt pages: %d\n", rc);
+		return rc;
+	}
+
         /* decrypt tail (krb5 header) */
 	rc = gss_setup_sgtable(&sg_src, &src, cipher->data + blocksize,
 			       sizeof(*khdr));
@@ -1099,6 +1079,41 @@ __u32 gss_prep_bulk_kerberos(struct gss_ctx *gctx,
 	return GSS_S_COMPLETE;
 }
 
+struct krb5_bulk_wrap_args {
+	struct krb5_ctx		*kwa_kctx;
+	struct krb5_header	*kwa_khdr;
+	/* confounder */
+	rawobj_t		*kwa_conf;
+	struct ptlrpc_bulk_desc	*kwa_desc;
+	rawobj_t		*kwa_cipher;
+	rawobj_t		*kwa_cksum;
+	int			 kwa_adj_nob;
+};
+
+static int krb5_wrap_bulk_cksum(struct gss_bulk_chunk *chunk)
+{
+	struct krb5_bulk_wrap_args *args = chunk->gbc_data;
+	struct krb5_ctx *kctx = args->kwa_kctx;
+
+	if (krb5_make_checksum(kctx->kc_enctype, &kctx->kc_keyi,
+			       args->kwa_khdr, 1, args->kwa_conf,
+			       args->kwa_desc->bd_iov_count,
+			       GET_KIOV(args->kwa_desc), args->kwa_cksum))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int krb5_wrap_bulk_encrypt(struct gss_bulk_chunk *chunk)
+{
+	struct krb5_bulk_wrap_args *args = chunk->gbc_data;
+
+	return krb5_encrypt_bulk(args->kwa_kctx->kc_keye.kb_tfm,
+				 args->kwa_khdr, args->kwa_conf->data,
+				 args->kwa_desc, args->kwa_cipher,
+				 args->kwa_adj_nob);
+}
+
 static
 __u32 gss_wrap_bulk_kerberos(struct gss_ctx *gctx,
                              struct ptlrpc_bulk_desc *desc,
@@ -1111,6 +1126,8 @@ __u32 gss_wrap_bulk_kerberos(struct gss_ctx *gctx,
         rawobj_t             cksum = RAWOBJ_EMPTY;
         rawobj_t             data_desc[1], cipher;
         __u8                 conf[GSS_MAX_CIPHER_BLOCK];
+	struct krb5_bulk_wrap_args args;
+	struct gss_bulk_chunk chunks[2];
         int                  rc = 0;
 
 	LASSERT(ptlrpc_is_bulk_desc_kiov(desc->bd_type));
@@ -1160,14 +1177,6 @@ __u32 gss_wrap_bulk_kerberos(struct gss_ctx *gctx,
         data_desc[0].data = conf;
         data_desc[0].len = ke->ke_conf_size;
 
-	/* compute checksum */
-	if (krb5_make_checksum(kctx->kc_enctype, &kctx->kc_keyi,
-			       khdr, 1, data_desc,
-			       desc->bd_iov_count, GET_KIOV(desc),
-			       &cksum))
-		return GSS_S_FAILURE;
-	LASSERT(cksum.len >= ke->ke_hash_size);
-
         /*
          * clear text layout for encryption:
          * ------------------------------------------
@@ -1180,24 +1189,40 @@ __u32 gss_wrap_bulk_kerberos(struct gss_ctx *gctx,
          * | krb5 header | cipher text | cipher text |
          * -------------------------------------------
          */
-        data_desc[0].data = conf;
-        data_desc[0].len = ke->ke_conf_size;
-
 	cipher.data = (__u8 *)(khdr + 1);
         cipher.len = blocksize + sizeof(*khdr);
 
-        if (kctx->kc_enctype == ENCTYPE_ARCFOUR_HMAC) {
-                LBUG();
-                rc = 0;
-        } else {
-                rc = krb5_encrypt_bulk(kctx->kc_keye.kb_tfm, khdr,
-                                       conf, desc, &cipher, adj_nob);
-        }
+	if (kctx->kc_enctype == ENCTYPE_ARCFOUR_HMAC)
+		LBUG();
+
+	args.kwa_kctx = kctx;
+	args.kwa_khdr = khdr;
+	args.kwa_conf = data_desc;
+	args.kwa_desc = desc;
+	args.kwa_cipher = &cipher;
+	args.kwa_cksum = &cksum;
+	args.kwa_adj_nob = adj_nob;
+
+	chunks[0].gbc_func = krb5_wrap_bulk_encrypt;
+	chunks[0].gbc_data = &args;
+	chunks[1].gbc_func = krb5_wrap_bulk_cksum;
+	chunks[1].gbc_data = &args;
+
+	/* both only read the clear pages, so for a large bulk the checksum
+	 * is computed by another thread while this one encrypts */
+	if (gss_bulk_crypt_enabled(desc->bd_iov_count)) {
+		rc = gss_bulk_run(chunks, 2);
+	} else {
+		rc = krb5_wrap_bulk_cksum(&chunks[1]);
+		if (rc == 0)
+			rc = krb5_wrap_bulk_encrypt(&chunks[0]);
+	}
 
-        if (rc != 0) {
-                rawobj_free(&cksum);
-                return GSS_S_FAILURE;
-        }
+	if (rc != 0) {
+		rawobj_free(&cksum);
+		return GSS_S_FAILURE;
+	}
+	LASSERT(cksum.len >= ke->ke_hash_size);
 
         /* fill in checksum */
         LASSERT(token->len >= sizeof(*khdr) + cipher.len + ke->ke_hash_size);
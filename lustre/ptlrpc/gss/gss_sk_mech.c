@@ -693,22 +693,13 @@ static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 			     struct ptlrpc_bulk_desc *desc, rawobj_t *cipher,
 			     int adj_nob)
 {
-	struct blkcipher_desc cdesc = {
-		.tfm = tfm,
-		.info = iv,
-		.flags = 0,
-	};
-	struct scatterlist ptxt;
-	struct scatterlist ctxt;
 	int blocksize;
+	int npages;
 	int i;
 	int rc;
 	int pnob = 0;
 	int cnob = 0;
 
-	sg_init_table(&ptxt, 1);
-	sg_init_table(&ctxt, 1);
-
 	blocksize = crypto_blkcipher_blocksize(tfm);
 	if (desc->bd_nob_transferred % blocksize != 0) {
 		CERROR("Transfer not a multiple of block size: %d\n",
@@ -751,38 +742,10 @@ static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 			}
 		}
 
-		if (ciov->kiov_len == 0)
-			continue;
-
-		sg_init_table(&ctxt, 1);
-		sg_set_page(&ctxt, ciov->kiov_page, ciov->kiov_len,
-			    ciov->kiov_offset);
-		ptxt = ctxt;
-
-		/* In the event the plain text size is not a multiple
-		 * of blocksize we decrypt in place and copy the result
-		 * after the decryption */
-		if (piov->kiov_len % blocksize == 0)
-			sg_assign_page(&ptxt, piov->kiov_page);
-
-		rc = crypto_blkcipher_decrypt_iv(&cdesc, &ptxt, &ctxt,
-						 ctxt.length);
-		if (rc) {
-			CERROR("Decryption failed for page: %d\n", rc);
-			return GSS_S_FAILURE;
-		}
-
-		if (piov->kiov_len % blocksize != 0) {
-			memcpy(page_address(piov->kiov_page) +
-			       piov->kiov_offset,
-			       page_address(ciov->kiov_page) +
-			       ciov->kiov_offset,
-			       piov->kiov_len);
-		}
-
 		cnob += ciov->kiov_len;
 		pnob += piov->kiov_len;
 	}
+	npages = i;
 
 	/* if needed, clear up the rest unused iovs */
 	if (adj_nob)
@@ -801,6 +764,12 @@ static __u32 sk_decrypt_bulk(struct crypto_blkcipher *tfm, __u8 *iv,
 		return GSS_S_FAILURE;
 	}
 
+	rc = gss_decrypt_bulk_pages(tfm, iv, desc, npages);
+	if (rc) {
+		CERROR("Decryption failed for pages: %d\n", rc);
+		return GSS_S_FAILURE;
+	}
+
 	return 0;
 }
 
@@ -2863,10 +2863,14 @@ static int __init sptlrpc_gss_init(void)
         if (rc)
                 goto out_cli_upcall;
 
-	rc = init_null_module();
+	rc = gss_init_bulk_crypt();
 	if (rc)
 		goto out_svc_upcall;
 
+	rc = init_null_module();
+	if (rc)
+		goto out_bulk_crypt;
+
 	rc = init_kerberos_module();
 	if (rc)
 		goto out_null;
@@ -2898,6 +2902,8 @@ out_kerberos:
 	cleanup_kerberos_module();
 out_null:
 	cleanup_null_module();
+out_bulk_crypt:
+	gss_exit_bulk_crypt();
 out_svc_upcall:
 	gss_exit_svc_upcall();
 out_cli_upcall:
@@ -2912,6 +2918,7 @@ static void __exit sptlrpc_gss_exit(void)
         gss_exit_keyring();
         gss_exit_pipefs();
         cleanup_kerberos_module();
+	gss_exit_bulk_crypt();
         gss_exit_svc_upcall();
         gss_exit_cli_upcall();
         gss_exit_lproc();
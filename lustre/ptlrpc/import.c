@@ -1232,6 +1232,9 @@ static int ptlrpc_connect_interpret(const struct lu_env *env,
                 imp->imp_remote_handle =
                                 *lustre_msg_get_handle(request->rq_repmsg);
                 imp->imp_last_replay_transno = 0;
+		imp->imp_replay_sent_transno = 0;
+		imp->imp_replay_resend_transno = 0;
+		imp->imp_replay_rewind_transno = ~0ULL;
 		imp->imp_replay_cursor = &imp->imp_committed_list;
                 IMPORT_SET_STATE(imp, LUSTRE_IMP_REPLAY);
         } else {
@@ -1502,12 +1505,19 @@ int ptlrpc_import_recovery_state_machine(struct obd_import *imp)
 		CDEBUG(D_HA, "replay requested by %s\n",
 		       obd2cli_tgt(imp->imp_obd));
 		rc = ptlrpc_replay_next(imp, &inflight);
-		if (inflight == 0 &&
+		/* With pipelined replay several interpret callbacks may get
+		 * here at once, only one of them moves on to lock replay. */
+		spin_lock(&imp->imp_lock);
+		if (inflight == 0 && imp->imp_state == LUSTRE_IMP_REPLAY &&
+		    !imp->imp_resend_replay &&
 		    atomic_read(&imp->imp_replay_inflight) == 0) {
-			IMPORT_SET_STATE(imp, LUSTRE_IMP_REPLAY_LOCKS);
+			IMPORT_SET_STATE_NOLOCK(imp, LUSTRE_IMP_REPLAY_LOCKS);
+			spin_unlock(&imp->imp_lock);
 			rc = ldlm_replay_locks(imp);
 			if (rc)
 				GOTO(out, rc);
+		} else {
+			spin_unlock(&imp->imp_lock);
 		}
 		rc = 0;
 	}
@@ -319,6 +319,18 @@ static const struct req_msg_field *mds_reint_setxattr_client[] = {
 	&RMF_DLM_REQ
 };
 
+static const struct req_msg_field *mdt_batch_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_MDT_BODY,
+	&RMF_MDT_BATCH_OPS,
+	&RMF_MDT_BATCH_NAMES
+};
+
+static const struct req_msg_field *mdt_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_MDT_BATCH_REP
+};
+
 static const struct req_msg_field *mdt_swap_layouts[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_MDT_BODY,
@@ -380,6 +392,17 @@ static const struct req_msg_field *ldlm_enqueue_lvb_server[] = {
         &RMF_DLM_LVB
 };
 
+static const struct req_msg_field *ldlm_bl_batch_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ,
+	&RMF_DLM_BL_BATCH
+};
+
+static const struct req_msg_field *ldlm_bl_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_BL_STATUS
+};
+
 static const struct req_msg_field *ldlm_cp_callback_client[] = {
         &RMF_PTLRPC_BODY,
         &RMF_DLM_REQ,
@@ -582,6 +605,16 @@ static const struct req_msg_field *llog_origin_handle_next_block_server[] = {
         &RMF_EADATA
 };
 
+static const struct req_msg_field *obd_ping_aggr_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OBD_PING_HANDLES
+};
+
+static const struct req_msg_field *obd_ping_aggr_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_OBD_PING_STATUS
+};
+
 static const struct req_msg_field *obd_idx_read_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_IDX_INFO
@@ -730,6 +763,7 @@ static const struct req_msg_field *obd_lfsck_reply[] = {
 
 static struct req_format *req_formats[] = {
         &RQF_OBD_PING,
+	&RQF_OBD_PING_AGGR,
         &RQF_OBD_SET_INFO,
 	&RQF_OBD_IDX_READ,
         &RQF_SEC_CTX,
@@ -774,6 +808,7 @@ static struct req_format *req_formats[] = {
 	&RQF_MDS_HSM_ACTION,
 	&RQF_MDS_HSM_REQUEST,
 	&RQF_MDS_SWAP_LAYOUTS,
+	&RQF_MDS_BATCH,
 	&RQF_OUT_UPDATE,
         &RQF_OST_CONNECT,
         &RQF_OST_DISCONNECT,
@@ -801,6 +836,7 @@ static struct req_format *req_formats[] = {
 	&RQF_LDLM_CALLBACK,
         &RQF_LDLM_CP_CALLBACK,
         &RQF_LDLM_BL_CALLBACK,
+	&RQF_LDLM_BL_CALLBACK_BATCH,
         &RQF_LDLM_GL_CALLBACK,
 	&RQF_LDLM_GL_DESC_CALLBACK,
         &RQF_LDLM_INTENT,
@@ -1058,6 +1094,18 @@ struct req_msg_field RMF_DLM_REP =
                     sizeof(struct ldlm_reply), lustre_swab_ldlm_reply, NULL);
 EXPORT_SYMBOL(RMF_DLM_REP);
 
+/* one struct ldlm_request per lock of a batched blocking AST */
+struct req_msg_field RMF_DLM_BL_BATCH =
+	DEFINE_MSGF("dlm_bl_batch", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ldlm_request),
+		    lustre_swab_ldlm_request, NULL);
+EXPORT_SYMBOL(RMF_DLM_BL_BATCH);
+
+struct req_msg_field RMF_DLM_BL_STATUS =
+	DEFINE_MSGF("dlm_bl_status", RMF_F_STRUCT_ARRAY,
+		    sizeof(__u32), lustre_swab_generic_32s, NULL);
+EXPORT_SYMBOL(RMF_DLM_BL_STATUS);
+
 struct req_msg_field RMF_LDLM_INTENT =
         DEFINE_MSGF("ldlm_intent", 0,
                     sizeof(struct ldlm_intent), lustre_swab_ldlm_intent, NULL);
@@ -1171,6 +1219,17 @@ struct req_msg_field RMF_IDX_INFO =
 	DEFINE_MSGF("idx_info", 0, sizeof(struct idx_info),
 		    lustre_swab_idx_info, NULL);
 EXPORT_SYMBOL(RMF_IDX_INFO);
+
+/* export handles are opaque to the client and need no swabbing */
+struct req_msg_field RMF_OBD_PING_HANDLES =
+	DEFINE_MSGF("obd_ping_handles", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct lustre_handle), NULL, NULL);
+EXPORT_SYMBOL(RMF_OBD_PING_HANDLES);
+
+struct req_msg_field RMF_OBD_PING_STATUS =
+	DEFINE_MSGF("obd_ping_status", RMF_F_STRUCT_ARRAY,
+		    sizeof(__u32), lustre_swab_generic_32s, NULL);
+EXPORT_SYMBOL(RMF_OBD_PING_STATUS);
 struct req_msg_field RMF_HSM_USER_STATE =
 	DEFINE_MSGF("hsm_user_state", 0, sizeof(struct hsm_user_state),
 		    lustre_swab_hsm_user_state, NULL);
@@ -1221,6 +1280,22 @@ struct req_msg_field RMF_SWAP_LAYOUTS =
 		    lustre_swab_swap_layouts, NULL);
 EXPORT_SYMBOL(RMF_SWAP_LAYOUTS);
 
+struct req_msg_field RMF_MDT_BATCH_OPS =
+	DEFINE_MSGF("mdt_batch_ops", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct mdt_batch_op),
+		    lustre_swab_mdt_batch_op, NULL);
+EXPORT_SYMBOL(RMF_MDT_BATCH_OPS);
+
+struct req_msg_field RMF_MDT_BATCH_NAMES =
+	DEFINE_MSGF("mdt_batch_names", 0, -1, NULL, NULL);
+EXPORT_SYMBOL(RMF_MDT_BATCH_NAMES);
+
+struct req_msg_field RMF_MDT_BATCH_REP =
+	DEFINE_MSGF("mdt_batch_rep", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct mdt_batch_rep),
+		    lustre_swab_mdt_batch_rep, NULL);
+EXPORT_SYMBOL(RMF_MDT_BATCH_REP);
+
 struct req_msg_field RMF_LFSCK_REQUEST =
 	DEFINE_MSGF("lfsck_request", 0, sizeof(struct lfsck_request),
 		    lustre_swab_lfsck_request, NULL);
@@ -1259,6 +1334,11 @@ EXPORT_SYMBOL(RMF_OUT_UPDATE_BUF);
 struct req_format {
 	const char *rf_name;
 	size_t	    rf_idx;
+	/**
+	 * Size of a lustre_msg_v2 packed with the declared field sizes,
+	 * computed once by req_layout_init(), see req_capsule_fmt_size().
+	 */
+	__u32	    rf_msg_size[RCL_NR];
 	struct {
 		size_t			     nr;
 		const struct req_msg_field **d;
@@ -1286,6 +1366,12 @@ struct req_format RQF_OBD_PING =
         DEFINE_REQ_FMT0("OBD_PING", empty, empty);
 EXPORT_SYMBOL(RQF_OBD_PING);
 
+/* OBD_PING carrying the export handles of other targets on the same node */
+struct req_format RQF_OBD_PING_AGGR =
+	DEFINE_REQ_FMT0("OBD_PING_AGGR",
+			obd_ping_aggr_client, obd_ping_aggr_server);
+EXPORT_SYMBOL(RQF_OBD_PING_AGGR);
+
 struct req_format RQF_OBD_SET_INFO =
         DEFINE_REQ_FMT0("OBD_SET_INFO", obd_set_info_client, empty);
 EXPORT_SYMBOL(RQF_OBD_SET_INFO);
@@ -1501,6 +1587,12 @@ struct req_format RQF_LDLM_BL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client, empty);
 EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK);
 
+/* LDLM_BL_CALLBACK for several locks, see OBD_CONNECT2_BL_AST_BATCH */
+struct req_format RQF_LDLM_BL_CALLBACK_BATCH =
+	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK_BATCH",
+			ldlm_bl_batch_client, ldlm_bl_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK_BATCH);
+
 struct req_format RQF_LDLM_GL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_GL_CALLBACK", ldlm_enqueue_client,
                         ldlm_gl_callback_server);
@@ -1601,6 +1693,10 @@ struct req_format RQF_MDS_SWAP_LAYOUTS =
 			mdt_swap_layouts, empty);
 EXPORT_SYMBOL(RQF_MDS_SWAP_LAYOUTS);
 
+struct req_format RQF_MDS_BATCH =
+	DEFINE_REQ_FMT0("MDS_BATCH", mdt_batch_client, mdt_batch_server);
+EXPORT_SYMBOL(RQF_MDS_BATCH);
+
 struct req_format RQF_LLOG_ORIGIN_HANDLE_CREATE =
         DEFINE_REQ_FMT0("LLOG_ORIGIN_HANDLE_CREATE",
                         llog_origin_handle_create_client, llogd_body_only);
@@ -1755,6 +1851,18 @@ int req_layout_init(void)
                         }
                 }
         }
+
+	/* rf_msg_size is used by req_capsule_fmt_size(), so compute it
+	 * only once all formats are set up */
+	for (i = 0; i < ARRAY_SIZE(req_formats); ++i) {
+		rf = req_formats[i];
+		for (j = 0; j < RCL_NR; ++j) {
+			rf->rf_msg_size[j] = 0;
+			rf->rf_msg_size[j] =
+				req_capsule_fmt_size(LUSTRE_MSG_MAGIC_V2,
+						     rf, j);
+		}
+	}
         return 0;
 }
 EXPORT_SYMBOL(req_layout_init);
@@ -1830,6 +1938,26 @@ static int __req_format_is_sane(const struct req_format *fmt)
 		req_formats[fmt->rf_idx] == fmt;
 }
 
+/**
+ * Returns the number of request formats, for arrays indexed by
+ * req_capsule_fmt_index().
+ */
+size_t req_capsule_fmt_count(void)
+{
+	return ARRAY_SIZE(req_formats);
+}
+EXPORT_SYMBOL(req_capsule_fmt_count);
+
+/**
+ * Returns the index of \a fmt, between 0 and req_capsule_fmt_count() - 1.
+ */
+size_t req_capsule_fmt_index(const struct req_format *fmt)
+{
+	LASSERT(__req_format_is_sane(fmt));
+	return fmt->rf_idx;
+}
+EXPORT_SYMBOL(req_capsule_fmt_index);
+
 static struct lustre_msg *__req_msg(const struct req_capsule *pill,
                                     enum req_location loc)
 {
@@ -2329,6 +2457,10 @@ __u32 req_capsule_fmt_size(__u32 magic, const struct req_format *fmt,
 	__u32 size;
 	size_t i = 0;
 
+	/* precomputed by req_layout_init() */
+	if (magic == LUSTRE_MSG_MAGIC_V2 && fmt->rf_msg_size[loc] != 0)
+		return fmt->rf_msg_size[loc];
+
         /*
          * This function should probably LASSERT() that fmt has no fields with
          * RMF_F_STRUCT_ARRAY in rmf_flags, since we can't know here how many
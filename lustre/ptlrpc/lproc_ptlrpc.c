@@ -96,6 +96,7 @@ static struct ll_rpc_opcode {
 	{ MDS_HSM_CT_REGISTER, "mds_hsm_ct_register" },
 	{ MDS_HSM_CT_UNREGISTER, "mds_hsm_ct_unregister" },
 	{ MDS_SWAP_LAYOUTS,	"mds_swap_layouts" },
+	{ MDS_BATCH,		"mds_batch" },
         { LDLM_ENQUEUE,     "ldlm_enqueue" },
         { LDLM_CONVERT,     "ldlm_convert" },
         { LDLM_CANCEL,      "ldlm_cancel" },
@@ -1068,6 +1069,70 @@ static int ptlrpc_lprocfs_timeouts_seq_show(struct seq_file *m, void *n)
 }
 LPROC_SEQ_FOPS_RO(ptlrpc_lprocfs_timeouts);
 
+#define pct(a, b) (b ? a * 100 / b : 0)
+
+static int ptlrpc_lprocfs_req_buffer_stats_seq_show(struct seq_file *m,
+						    void *v)
+{
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	unsigned long			 tot;
+	unsigned long			 cum;
+	int				 i;
+	int				 j;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		struct obd_histogram *hist = &svcpt->scp_req_size_hist;
+
+		spin_lock(&svcpt->scp_lock);
+		seq_printf(m, "cpt %d: buffer size %d (base %d max req %d) "
+			   "buffers %d (base %d) posted %d total %d "
+			   "busy %llu\n", svcpt->scp_cpt, svcpt->scp_buf_size,
+			   svc->srv_buf_size, svc->srv_max_req_size,
+			   svcpt->scp_nbuf_per_group, svc->srv_nbuf_per_group,
+			   svcpt->scp_nrqbds_posted, svcpt->scp_nrqbds_total,
+			   svcpt->scp_rqbd_busy);
+		spin_unlock(&svcpt->scp_lock);
+
+		seq_printf(m, "request size          reqs   %% cum %%\n");
+		tot = lprocfs_oh_sum(hist);
+		cum = 0;
+		for (j = 0; j < OBD_HIST_MAX && tot > 0; j++) {
+			unsigned long r = hist->oh_buckets[j];
+
+			cum += r;
+			seq_printf(m, "%d:\t\t%10lu %3lu %3lu\n",
+				   1 << j, r, pct(r, tot), pct(cum, tot));
+			if (cum == tot)
+				break;
+		}
+		seq_printf(m, "\n");
+	}
+
+	return 0;
+}
+
+static ssize_t
+ptlrpc_lprocfs_req_buffer_stats_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file			*m = file->private_data;
+	struct ptlrpc_service		*svc = m->private;
+	struct ptlrpc_service_part	*svcpt;
+	int				 i;
+
+	ptlrpc_service_for_each_part(svcpt, i, svc) {
+		lprocfs_oh_clear(&svcpt->scp_req_size_hist);
+		spin_lock(&svcpt->scp_lock);
+		svcpt->scp_rqbd_busy = 0;
+		spin_unlock(&svcpt->scp_lock);
+	}
+
+	return count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_req_buffer_stats);
+
 static int ptlrpc_lprocfs_hp_ratio_seq_show(struct seq_file *m, void *v)
 {
 	struct ptlrpc_service *svc = m->private;
@@ -1112,6 +1177,9 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *entry,
 		{ .name = "req_buffer_history_max",
 		  .fops	= &ptlrpc_lprocfs_req_history_max_fops,
 		  .data	= svc },
+		{ .name = "req_buffer_stats",
+		  .fops	= &ptlrpc_lprocfs_req_buffer_stats_fops,
+		  .data	= svc },
 		{ .name = "threads_min",
 		  .fops = &ptlrpc_lprocfs_threads_min_fops,
 		  .data = svc },
@@ -1175,6 +1243,126 @@ void ptlrpc_lprocfs_rpc_sent(struct ptlrpc_request *req, long amount)
                 lprocfs_counter_add(svc_stats, opc + EXTRA_MAX_OPCODES, amount);
 }
 
+/* caller must hold imp->imp_lock */
+static struct imp_rpc_latency *
+ptlrpc_rpc_latency_find(struct obd_import *imp, __u32 opc)
+{
+	struct imp_rpc_latency *irl;
+
+	assert_spin_locked(&imp->imp_lock);
+	list_for_each_entry(irl, &imp->imp_rpc_lat_list, irl_list) {
+		if (irl->irl_opc == opc)
+			return irl;
+	}
+	return NULL;
+}
+
+static struct imp_rpc_latency *
+ptlrpc_rpc_latency_get(struct obd_import *imp, __u32 opc)
+{
+	struct imp_rpc_latency *irl;
+	struct imp_rpc_latency *new;
+	int i;
+
+	spin_lock(&imp->imp_lock);
+	irl = ptlrpc_rpc_latency_find(imp, opc);
+	spin_unlock(&imp->imp_lock);
+	if (irl != NULL)
+		return irl;
+
+	OBD_ALLOC_PTR(new);
+	if (new == NULL)
+		return NULL;
+
+	new->irl_opc = opc;
+	for (i = 0; i < IMP_LAT_MAX; i++)
+		spin_lock_init(&new->irl_hist[i].oh_lock);
+
+	spin_lock(&imp->imp_lock);
+	irl = ptlrpc_rpc_latency_find(imp, opc);
+	if (irl == NULL) {
+		list_add_tail(&new->irl_list, &imp->imp_rpc_lat_list);
+		irl = new;
+		new = NULL;
+	}
+	spin_unlock(&imp->imp_lock);
+
+	if (new != NULL)
+		OBD_FREE_PTR(new);
+	return irl;
+}
+
+/**
+ * Account the latency breakdown of a replied request \a req, whose reply was
+ * processed at \a now, to the per-opcode histograms of its import.
+ */
+void ptlrpc_lprocfs_rpc_latency(struct ptlrpc_request *req, ktime_t now)
+{
+	struct ptlrpc_cli_req	*cr = &req->rq_cli;
+	struct imp_rpc_latency	*irl;
+	__u32			 lat[IMP_LAT_MAX] = { 0 };
+	__u32			 server;
+	__u32			 rtt;
+	int			 i;
+
+	if (req->rq_import == NULL || req->rq_repmsg == NULL ||
+	    ktime_to_ns(cr->cr_queued_ns) == 0 ||
+	    ktime_to_ns(cr->cr_replied_ns) == 0)
+		return;
+
+	irl = ptlrpc_rpc_latency_get(req->rq_import,
+				     lustre_msg_get_opc(req->rq_reqmsg));
+	if (irl == NULL)
+		return;
+
+	lustre_msg_get_server_times(req->rq_repmsg, &lat[IMP_LAT_REQIN],
+				    &lat[IMP_LAT_NRS], &lat[IMP_LAT_HANDLE]);
+	lat[IMP_LAT_QUEUE] = ptlrpc_us_delta(cr->cr_sent_ns, cr->cr_queued_ns);
+	lat[IMP_LAT_SEND] = ptlrpc_us_delta(cr->cr_sent_out_ns,
+					     cr->cr_sent_ns);
+	lat[IMP_LAT_TOTAL] = ptlrpc_us_delta(now, cr->cr_queued_ns);
+
+	/* The clocks of client and server are not synchronized, so whatever
+	 * the server did not account for is attributed to the network. */
+	server = lat[IMP_LAT_REQIN] + lat[IMP_LAT_NRS] + lat[IMP_LAT_HANDLE];
+	rtt = ptlrpc_us_delta(cr->cr_replied_ns, cr->cr_sent_ns);
+	if (rtt > server + lat[IMP_LAT_SEND])
+		lat[IMP_LAT_REPLY] = rtt - server - lat[IMP_LAT_SEND];
+
+	for (i = 0; i < IMP_LAT_MAX; i++) {
+		if (i == IMP_LAT_COMMIT)
+			continue;
+		/* server does not report its part of the breakdown */
+		if (lat[IMP_LAT_HANDLE] == 0 &&
+		    (i == IMP_LAT_REQIN || i == IMP_LAT_NRS ||
+		     i == IMP_LAT_HANDLE || i == IMP_LAT_REPLY))
+			continue;
+		lprocfs_oh_tally_log2(&irl->irl_hist[i], lat[i]);
+	}
+}
+
+/**
+ * Account the time \a req waited for its transaction to be committed.
+ *
+ * Caller must hold imp->imp_lock.
+ */
+void ptlrpc_lprocfs_rpc_commit(struct ptlrpc_request *req)
+{
+	struct imp_rpc_latency *irl;
+	__u32 lat;
+
+	if (ktime_to_ns(req->rq_cli.cr_replied_ns) == 0)
+		return;
+
+	irl = ptlrpc_rpc_latency_find(req->rq_import,
+				      lustre_msg_get_opc(req->rq_reqmsg));
+	if (irl == NULL)
+		return;
+
+	lat = ptlrpc_us_delta(ktime_get_real(), req->rq_cli.cr_replied_ns);
+	lprocfs_oh_tally_log2(&irl->irl_hist[IMP_LAT_COMMIT], lat);
+}
+
 void ptlrpc_lprocfs_brw(struct ptlrpc_request *req, int bytes)
 {
         struct lprocfs_stats *svc_stats;
@@ -1356,4 +1544,101 @@ lprocfs_pinger_recov_seq_write(struct file *file, const char __user *buffer,
 }
 EXPORT_SYMBOL(lprocfs_pinger_recov_seq_write);
 
+static const char * const imp_rpc_lat_names[] = {
+	[IMP_LAT_QUEUE]		= "queue",
+	[IMP_LAT_SEND]		= "send",
+	[IMP_LAT_REQIN]		= "reqin",
+	[IMP_LAT_NRS]		= "nrs",
+	[IMP_LAT_HANDLE]	= "handle",
+	[IMP_LAT_REPLY]		= "reply",
+	[IMP_LAT_COMMIT]	= "commit",
+	[IMP_LAT_TOTAL]		= "total",
+};
+
+/**
+ * Dump the per-opcode RPC latency breakdown of a client import.
+ *
+ * Each row counts the RPCs whose phase took at most the given number of
+ * microseconds, and more than the previous row.
+ */
+int lprocfs_rpc_latency_seq_show(struct seq_file *m, void *data)
+{
+	struct obd_device	*obd = data;
+	struct obd_import	*imp;
+	struct imp_rpc_latency	*irl;
+	struct timespec64	 now;
+	int			 first;
+	int			 last;
+	int			 i;
+	int			 j;
+
+	CLASSERT(ARRAY_SIZE(imp_rpc_lat_names) == IMP_LAT_MAX);
+
+	LPROCFS_CLIMP_CHECK(obd);
+	imp = obd->u.cli.cl_import;
+
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "snapshot_time:         %lld.%09lu (secs.nsecs)\n",
+		   (s64)now.tv_sec, now.tv_nsec);
+
+	spin_lock(&imp->imp_lock);
+	list_for_each_entry(irl, &imp->imp_rpc_lat_list, irl_list) {
+		first = OBD_HIST_MAX;
+		last = -1;
+		for (i = 0; i < OBD_HIST_MAX; i++) {
+			for (j = 0; j < IMP_LAT_MAX; j++) {
+				if (irl->irl_hist[j].oh_buckets[i] == 0)
+					continue;
+				first = min(first, i);
+				last = i;
+			}
+		}
+		if (last < 0)
+			continue;
+
+		seq_printf(m, "\n%s\nusec      ", ll_opcode2str(irl->irl_opc));
+		for (j = 0; j < IMP_LAT_MAX; j++)
+			seq_printf(m, " %8s", imp_rpc_lat_names[j]);
+		seq_putc(m, '\n');
+
+		for (i = first; i <= last; i++) {
+			seq_printf(m, "%-10lu", 1UL << i);
+			for (j = 0; j < IMP_LAT_MAX; j++)
+				seq_printf(m, " %8lu",
+					   irl->irl_hist[j].oh_buckets[i]);
+			seq_putc(m, '\n');
+		}
+	}
+	spin_unlock(&imp->imp_lock);
+
+	LPROCFS_CLIMP_EXIT(obd);
+	return 0;
+}
+EXPORT_SYMBOL(lprocfs_rpc_latency_seq_show);
+
+/* Writing anything to this file clears the latency histograms. */
+ssize_t
+lprocfs_rpc_latency_seq_write(struct file *file, const char __user *buffer,
+			      size_t count, loff_t *off)
+{
+	struct seq_file		*m = file->private_data;
+	struct obd_device	*obd = m->private;
+	struct obd_import	*imp;
+	struct imp_rpc_latency	*irl;
+	int			 i;
+
+	LPROCFS_CLIMP_CHECK(obd);
+	imp = obd->u.cli.cl_import;
+	spin_lock(&imp->imp_lock);
+	list_for_each_entry(irl, &imp->imp_rpc_lat_list, irl_list) {
+		for (i = 0; i < IMP_LAT_MAX; i++)
+			lprocfs_oh_clear(&irl->irl_hist[i]);
+	}
+	spin_unlock(&imp->imp_lock);
+	LPROCFS_CLIMP_EXIT(obd);
+
+	return count;
+}
+EXPORT_SYMBOL(lprocfs_rpc_latency_seq_write);
+
 #endif /* CONFIG_PROC_FS */
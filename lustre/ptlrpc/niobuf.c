@@ -514,6 +514,14 @@ static void ptlrpc_at_set_reply(struct ptlrpc_request *req, int flags)
         }
         /* Report actual service time for client latency calc */
         lustre_msg_set_service_time(req->rq_repmsg, service_time);
+	/* Report where the time was spent, for client latency breakdown */
+	if (!(flags & PTLRPC_REPLY_EARLY)) {
+		__u32 reqin_time, nrs_time, handle_time;
+
+		ptlrpc_server_times(req, &reqin_time, &nrs_time, &handle_time);
+		lustre_msg_set_server_times(req->rq_repmsg, reqin_time,
+					    nrs_time, handle_time);
+	}
 	/* Report service time estimate for future client reqs, but report 0
 	 * (to be ignored by client) if it's an error reply during recovery.
 	 * b=15815
@@ -971,7 +979,7 @@ int ptlrpc_register_rqbd(struct ptlrpc_request_buffer_desc *rqbd)
         rqbd->rqbd_refcount = 1;
 
         md.start     = rqbd->rqbd_buffer;
-        md.length    = service->srv_buf_size;
+        md.length    = rqbd->rqbd_buffer_size;
         md.max_size  = service->srv_max_req_size;
         md.threshold = LNET_MD_THRESH_INF;
         md.options   = PTLRPC_MD_OPTIONS | LNET_MD_OP_PUT | LNET_MD_MAX_SIZE;
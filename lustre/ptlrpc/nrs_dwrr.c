@@ -0,0 +1,1295 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_dwrr.c
+ *
+ * Network Request Scheduler (NRS) Deficit Weighted Round Robin policy
+ *
+ * Request ordering in a batched Round-Robin manner over client NIDs or JobIDs,
+ * where each class is charged by the bytes it moves rather than by the
+ * number of RPCs it sends.
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+#ifdef HAVE_SERVER_SUPPORT
+
+#define DEBUG_SUBSYSTEM S_RPC
+#include <linux/math64.h>
+#include <obd_support.h>
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lprocfs_status.h>
+#include <lustre_req_layout.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name DWRR policy
+ *
+ * Deficit Weighted Round Robin scheduling over client NIDs or JobIDs
+ *
+ * CRR-N balances the number of RPCs each client gets served, so a client
+ * issuing 16MB bulk RPCs receives far more bandwidth than one issuing 4KB
+ * RPCs. DWRR uses the same round/sequence ordering as CRR-N, but each class
+ * has a per-round deficit counter in bytes of nrs_dwrr_head::dh_quantum times
+ * the class weight; every request is charged its bulk size plus the fixed
+ * nrs_dwrr_head::dh_rpc_cost, and a class that overdraws its deficit is
+ * pushed back by as many rounds as it takes to pay the overdraft back.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_DWRR	"dwrr"
+
+/**
+ * Binary heap predicate.
+ *
+ * Uses ptlrpc_nrs_request::nr_u::dwrr::dr_round and
+ * ptlrpc_nrs_request::nr_u::dwrr::dr_sequence to compare two binheap nodes
+ * and produce a binary predicate that shows their relative priority, so that
+ * the binary heap can perform the necessary sorting operations.
+ *
+ * \param[in] e1 the first binheap node to compare
+ * \param[in] e2 the second binheap node to compare
+ *
+ * \retval 0 e1 > e2
+ * \retval 1 e1 <= e2
+ */
+static int
+dwrr_req_compare(struct cfs_binheap_node *e1, struct cfs_binheap_node *e2)
+{
+	struct ptlrpc_nrs_request *nrq1;
+	struct ptlrpc_nrs_request *nrq2;
+
+	nrq1 = container_of(e1, struct ptlrpc_nrs_request, nr_node);
+	nrq2 = container_of(e2, struct ptlrpc_nrs_request, nr_node);
+
+	if (nrq1->nr_u.dwrr.dr_round < nrq2->nr_u.dwrr.dr_round)
+		return 1;
+	else if (nrq1->nr_u.dwrr.dr_round > nrq2->nr_u.dwrr.dr_round)
+		return 0;
+
+	return nrq1->nr_u.dwrr.dr_sequence < nrq2->nr_u.dwrr.dr_sequence;
+}
+
+static struct cfs_binheap_ops nrs_dwrr_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= dwrr_req_compare,
+};
+
+/**
+ * libcfs_hash operations for nrs_dwrr_head::dh_cli_hash
+ *
+ * This uses struct nrs_dwrr_key as its key, in order to hash
+ * nrs_dwrr_client objects.
+ */
+#define NRS_DWRR_BKT_BITS	8
+#define NRS_DWRR_BITS		16
+
+static unsigned nrs_dwrr_hop_hash(struct cfs_hash *hs, const void *key,
+				  unsigned mask)
+{
+	return cfs_hash_djb2_hash(key, sizeof(struct nrs_dwrr_key), mask);
+}
+
+static int nrs_dwrr_hop_keycmp(const void *key, struct hlist_node *hnode)
+{
+	struct nrs_dwrr_client	*cli = hlist_entry(hnode,
+						   struct nrs_dwrr_client,
+						   dc_hnode);
+
+	return memcmp(key, &cli->dc_key, sizeof(cli->dc_key)) == 0;
+}
+
+static void *nrs_dwrr_hop_key(struct hlist_node *hnode)
+{
+	struct nrs_dwrr_client	*cli = hlist_entry(hnode,
+						   struct nrs_dwrr_client,
+						   dc_hnode);
+	return &cli->dc_key;
+}
+
+static void *nrs_dwrr_hop_object(struct hlist_node *hnode)
+{
+	return hlist_entry(hnode, struct nrs_dwrr_client, dc_hnode);
+}
+
+static void nrs_dwrr_hop_get(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	struct nrs_dwrr_client *cli = hlist_entry(hnode,
+						  struct nrs_dwrr_client,
+						  dc_hnode);
+	atomic_inc(&cli->dc_ref);
+}
+
+static void nrs_dwrr_hop_put(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	struct nrs_dwrr_client	*cli = hlist_entry(hnode,
+						   struct nrs_dwrr_client,
+						   dc_hnode);
+	atomic_dec(&cli->dc_ref);
+}
+
+static void nrs_dwrr_hop_exit(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	struct nrs_dwrr_client	*cli = hlist_entry(hnode,
+						   struct nrs_dwrr_client,
+						   dc_hnode);
+	LASSERTF(atomic_read(&cli->dc_ref) == 0,
+		 "Busy DWRR object for %s/%s, with %d refs\n",
+		 libcfs_nid2str(cli->dc_key.dk_nid), cli->dc_key.dk_jobid,
+		 atomic_read(&cli->dc_ref));
+
+	OBD_FREE_PTR(cli);
+}
+
+static struct cfs_hash_ops nrs_dwrr_hash_ops = {
+	.hs_hash	= nrs_dwrr_hop_hash,
+	.hs_keycmp	= nrs_dwrr_hop_keycmp,
+	.hs_key		= nrs_dwrr_hop_key,
+	.hs_object	= nrs_dwrr_hop_object,
+	.hs_get		= nrs_dwrr_hop_get,
+	.hs_put		= nrs_dwrr_hop_put,
+	.hs_put_locked	= nrs_dwrr_hop_put,
+	.hs_exit	= nrs_dwrr_hop_exit,
+};
+
+/**
+ * Drops a reference on a weight rule, freeing it with the last reference.
+ *
+ * Only kfree()-backed memory is released here, so this may be called while
+ * holding ptlrpc_nrs::nrs_lock.
+ */
+static void nrs_dwrr_rule_put(struct nrs_dwrr_rule *rule)
+{
+	if (!atomic_dec_and_test(&rule->dr_ref))
+		return;
+
+	if (!list_empty(&rule->dr_match)) {
+		if (rule->dr_type == NRS_DWRR_TYPE_NID)
+			cfs_free_nidlist(&rule->dr_match);
+		else
+			nrs_tbf_jobid_list_free(&rule->dr_match);
+	}
+	if (rule->dr_match_str != NULL)
+		OBD_FREE(rule->dr_match_str, strlen(rule->dr_match_str) + 1);
+	OBD_FREE_PTR(rule);
+}
+
+static bool nrs_dwrr_rule_match(struct nrs_dwrr_rule *rule,
+				struct nrs_dwrr_client *cli)
+{
+	if (rule->dr_type == NRS_DWRR_TYPE_NID)
+		return cfs_match_nid(cli->dc_key.dk_nid, &rule->dr_match);
+
+	return nrs_tbf_jobid_list_match(&rule->dr_match,
+					cli->dc_key.dk_jobid);
+}
+
+/**
+ * (Re)computes the weight of class \a cli if the rule set of \a head has
+ * changed since it was last computed; the first matching rule wins, and
+ * classes matched by no rule have a weight of 1.
+ */
+static void nrs_dwrr_cli_weight_update(struct nrs_dwrr_head *head,
+				       struct nrs_dwrr_client *cli)
+{
+	__u32	weight = 1;
+	int	i;
+
+	if (likely(cli->dc_rule_gen == head->dh_rule_gen))
+		return;
+
+	for (i = 0; i < NRS_DWRR_RULES_MAX && head->dh_rules[i] != NULL; i++) {
+		if (nrs_dwrr_rule_match(head->dh_rules[i], cli)) {
+			weight = head->dh_rules[i]->dr_weight;
+			break;
+		}
+	}
+
+	cli->dc_weight = weight;
+	cli->dc_rule_gen = head->dh_rule_gen;
+}
+
+/**
+ * Calculates the number of bytes request \a nrq is charged; the fixed
+ * per-RPC cost, plus the size of the bulk transfer for OST_READ and OST_WRITE
+ * RPCs.
+ *
+ * The request pill for OST_READ and OST_WRITE requests is initialized in the
+ * ost_io service's ptlrpc_service_ops::so_hpreq_handler, so it can be used
+ * here; other services get their requests charged the fixed cost only.
+ */
+static __u64 nrs_dwrr_req_cost(struct nrs_dwrr_head *head,
+			       struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request	*req = container_of(nrq, struct ptlrpc_request,
+						    rq_nrq);
+	struct obd_ioobj	*ioo;
+	struct niobuf_remote	*nb;
+	__u64			 cost = head->dh_rpc_cost;
+	__u32			 opc;
+	int			 i;
+
+	opc = lustre_msg_get_opc(req->rq_reqmsg);
+	if ((opc != OST_READ && opc != OST_WRITE) ||
+	    req->rq_pill.rc_fmt == NULL ||
+	    !req_capsule_has_field(&req->rq_pill, &RMF_OBD_IOOBJ, RCL_CLIENT) ||
+	    !req_capsule_has_field(&req->rq_pill, &RMF_NIOBUF_REMOTE,
+				   RCL_CLIENT))
+		return cost;
+
+	ioo = req_capsule_client_get(&req->rq_pill, &RMF_OBD_IOOBJ);
+	nb = req_capsule_client_get(&req->rq_pill, &RMF_NIOBUF_REMOTE);
+	if (ioo == NULL || nb == NULL)
+		return cost;
+
+	for (i = 0; i < ioo->ioo_bufcnt; i++)
+		cost += nb[i].rnb_len;
+
+	return cost;
+}
+
+/**
+ * Called when a DWRR policy instance is started.
+ *
+ * \param[in] policy the policy
+ * \param[in] arg    "nid" (default) or "jobid", selecting how requests are
+ *		     classified
+ *
+ * \retval -ENOMEM OOM error
+ * \retval -EINVAL invalid classification type
+ * \retval 0	   success
+ */
+static int nrs_dwrr_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_dwrr_head	*head;
+	enum nrs_dwrr_type	 type;
+	int			 rc = 0;
+	ENTRY;
+
+	if (arg == NULL || strcmp(arg, "nid") == 0)
+		type = NRS_DWRR_TYPE_NID;
+	else if (strcmp(arg, "jobid") == 0)
+		type = NRS_DWRR_TYPE_JOBID;
+	else
+		RETURN(-EINVAL);
+
+	OBD_CPT_ALLOC_PTR(head, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (head == NULL)
+		RETURN(-ENOMEM);
+
+	head->dh_binheap = cfs_binheap_create(&nrs_dwrr_heap_ops,
+					      CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					      nrs_pol2cptab(policy),
+					      nrs_pol2cptid(policy));
+	if (head->dh_binheap == NULL)
+		GOTO(out_head, rc = -ENOMEM);
+
+	head->dh_cli_hash = cfs_hash_create("nrs_dwrr_hash",
+					    NRS_DWRR_BITS, NRS_DWRR_BITS,
+					    NRS_DWRR_BKT_BITS, 0,
+					    CFS_HASH_MIN_THETA,
+					    CFS_HASH_MAX_THETA,
+					    &nrs_dwrr_hash_ops,
+					    CFS_HASH_RW_BKTLOCK);
+	if (head->dh_cli_hash == NULL)
+		GOTO(out_binheap, rc = -ENOMEM);
+
+	head->dh_type = type;
+	head->dh_quantum = NRS_DWRR_QUANTUM_DEFAULT;
+	head->dh_rpc_cost = NRS_DWRR_RPC_COST_DEFAULT;
+	/**
+	 * Set to 1 so that the test inside nrs_dwrr_req_add() can evaluate to
+	 * true, and new classes (with a zero generation) compute their weight.
+	 */
+	head->dh_sequence = 1;
+	head->dh_rule_gen = 1;
+
+	policy->pol_private = head;
+
+	RETURN(rc);
+
+out_binheap:
+	cfs_binheap_destroy(head->dh_binheap);
+out_head:
+	OBD_FREE_PTR(head);
+
+	RETURN(rc);
+}
+
+/**
+ * Called when a DWRR policy instance is stopped.
+ *
+ * Called when the policy has been instructed to transition to the
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state and has no more pending
+ * requests to serve.
+ *
+ * \param[in] policy the policy
+ */
+static void nrs_dwrr_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_dwrr_head	*head = policy->pol_private;
+	int			 i;
+	ENTRY;
+
+	LASSERT(head != NULL);
+	LASSERT(head->dh_binheap != NULL);
+	LASSERT(head->dh_cli_hash != NULL);
+	LASSERT(cfs_binheap_is_empty(head->dh_binheap));
+
+	cfs_binheap_destroy(head->dh_binheap);
+	cfs_hash_putref(head->dh_cli_hash);
+
+	for (i = 0; i < NRS_DWRR_RULES_MAX && head->dh_rules[i] != NULL; i++)
+		nrs_dwrr_rule_put(head->dh_rules[i]);
+
+	OBD_FREE_PTR(head);
+}
+
+static int nrs_dwrr_rule_find(struct nrs_dwrr_head *head, const char *name)
+{
+	int i;
+
+	for (i = 0; i < NRS_DWRR_RULES_MAX && head->dh_rules[i] != NULL; i++)
+		if (strcmp(head->dh_rules[i]->dr_name, name) == 0)
+			return i;
+
+	return -ENOENT;
+}
+
+static void nrs_dwrr_rule_dump(struct nrs_dwrr_head *head,
+			       struct seq_file *m)
+{
+	struct nrs_dwrr_rule	*rule;
+	int			 i;
+
+	for (i = 0; i < NRS_DWRR_RULES_MAX && head->dh_rules[i] != NULL; i++) {
+		rule = head->dh_rules[i];
+		seq_printf(m, "%s %s={%s} weight=%u\n", rule->dr_name,
+			   rule->dr_type == NRS_DWRR_TYPE_NID ? "nid" : "jobid",
+			   rule->dr_match_str, rule->dr_weight);
+	}
+	seq_printf(m, "default weight=1\n");
+}
+
+/**
+ * Performs a policy-specific ctl function on DWRR policy instances; similar
+ * to ioctl.
+ *
+ * \param[in]	  policy the policy instance
+ * \param[in]	  opc	 the opcode
+ * \param[in,out] arg	 used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_dwrr_ctl(struct ptlrpc_nrs_policy *policy,
+			enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_dwrr_head	*head = policy->pol_private;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_dwrr)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_DWRR_RD_QUANTUM:
+		*(__u32 *)arg = head->dh_quantum;
+		break;
+
+	case NRS_CTL_DWRR_WR_QUANTUM:
+		head->dh_quantum = *(unsigned long *)arg;
+		LASSERT(head->dh_quantum != 0);
+		break;
+
+	case NRS_CTL_DWRR_RD_RPC_COST:
+		*(__u32 *)arg = head->dh_rpc_cost;
+		break;
+
+	case NRS_CTL_DWRR_WR_RPC_COST:
+		head->dh_rpc_cost = *(unsigned long *)arg;
+		break;
+
+	case NRS_CTL_DWRR_RD_RULE: {
+		struct seq_file *m = arg;
+
+		seq_printf(m, "CPT %d:\n", policy->pol_nrs->nrs_svcpt->scp_cpt);
+		nrs_dwrr_rule_dump(head, m);
+		}
+		break;
+
+	case NRS_CTL_DWRR_ADD_RULE: {
+		struct nrs_dwrr_rule	*rule = arg;
+		int			 i;
+
+		if (rule->dr_type != head->dh_type)
+			RETURN(-EINVAL);
+
+		if (nrs_dwrr_rule_find(head, rule->dr_name) >= 0)
+			RETURN(-EEXIST);
+
+		for (i = 0; i < NRS_DWRR_RULES_MAX; i++)
+			if (head->dh_rules[i] == NULL)
+				break;
+		if (i == NRS_DWRR_RULES_MAX)
+			RETURN(-ENOSPC);
+
+		atomic_inc(&rule->dr_ref);
+		head->dh_rules[i] = rule;
+		head->dh_rule_gen++;
+		}
+		break;
+
+	case NRS_CTL_DWRR_DEL_RULE: {
+		int i = nrs_dwrr_rule_find(head, (char *)arg);
+
+		if (i < 0)
+			RETURN(i);
+
+		nrs_dwrr_rule_put(head->dh_rules[i]);
+		/* Keep the rules packed, so that their order is preserved */
+		for (; i < NRS_DWRR_RULES_MAX - 1; i++)
+			head->dh_rules[i] = head->dh_rules[i + 1];
+		head->dh_rules[NRS_DWRR_RULES_MAX - 1] = NULL;
+		head->dh_rule_gen++;
+		}
+		break;
+	}
+
+	RETURN(0);
+}
+
+/**
+ * Obtains resources from DWRR policy instances. The top-level resource lives
+ * inside \e nrs_dwrr_head and the second-level resource inside
+ * \e nrs_dwrr_client object instances.
+ *
+ * \param[in]  policy	  the policy for which resources are being taken for
+ *			  request \a nrq
+ * \param[in]  nrq	  the request for which resources are being taken
+ * \param[in]  parent	  parent resource, embedded in nrs_dwrr_head for the
+ *			  DWRR policy
+ * \param[out] resp	  resources references are placed in this array
+ * \param[in]  moving_req signifies limited caller context; used to perform
+ *			  memory allocations in an atomic context in this
+ *			  policy
+ *
+ * \retval 0   we are returning a top-level, parent resource, one that is
+ *	       embedded in an nrs_dwrr_head object
+ * \retval 1   we are returning a bottom-level resource, one that is embedded
+ *	       in an nrs_dwrr_client object
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_dwrr_res_get(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq,
+			    const struct ptlrpc_nrs_resource *parent,
+			    struct ptlrpc_nrs_resource **resp, bool moving_req)
+{
+	struct nrs_dwrr_head	*head;
+	struct nrs_dwrr_client	*cli;
+	struct nrs_dwrr_client	*tmp;
+	struct ptlrpc_request	*req;
+	struct nrs_dwrr_key	 key;
+
+	if (parent == NULL) {
+		*resp = &((struct nrs_dwrr_head *)policy->pol_private)->dh_res;
+		return 0;
+	}
+
+	head = container_of(parent, struct nrs_dwrr_head, dh_res);
+	req = container_of(nrq, struct ptlrpc_request, rq_nrq);
+
+	memset(&key, 0, sizeof(key));
+	if (head->dh_type == NRS_DWRR_TYPE_NID) {
+		key.dk_nid = req->rq_peer.nid;
+	} else {
+		char *jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+
+		if (jobid != NULL)
+			strlcpy(key.dk_jobid, jobid, sizeof(key.dk_jobid));
+	}
+
+	cli = cfs_hash_lookup(head->dh_cli_hash, &key);
+	if (cli != NULL)
+		goto out;
+
+	OBD_CPT_ALLOC_GFP(cli, nrs_pol2cptab(policy), nrs_pol2cptid(policy),
+			  sizeof(*cli), moving_req ? GFP_ATOMIC : GFP_NOFS);
+	if (cli == NULL)
+		return -ENOMEM;
+
+	cli->dc_key = key;
+
+	atomic_set(&cli->dc_ref, 1);
+	tmp = cfs_hash_findadd_unique(head->dh_cli_hash, &cli->dc_key,
+				      &cli->dc_hnode);
+	if (tmp != cli) {
+		OBD_FREE_PTR(cli);
+		cli = tmp;
+	}
+out:
+	*resp = &cli->dc_res;
+
+	return 1;
+}
+
+/**
+ * Called when releasing references to the resource hierachy obtained for a
+ * request for scheduling using the DWRR policy.
+ *
+ * \param[in] policy   the policy the resource belongs to
+ * \param[in] res      the resource to be released
+ */
+static void nrs_dwrr_res_put(struct ptlrpc_nrs_policy *policy,
+			     const struct ptlrpc_nrs_resource *res)
+{
+	struct nrs_dwrr_head	*head;
+	struct nrs_dwrr_client	*cli;
+
+	/**
+	 * Do nothing for freeing parent, nrs_dwrr_head resources
+	 */
+	if (res->res_parent == NULL)
+		return;
+
+	cli = container_of(res, struct nrs_dwrr_client, dc_res);
+	head = container_of(res->res_parent, struct nrs_dwrr_head, dh_res);
+
+	cfs_hash_put(head->dh_cli_hash, &cli->dc_hnode);
+}
+
+/**
+ * Advances the current round of \a head once request \a nrq has left the
+ * binary heap; the round is never behind the round of the last request
+ * served, so that classes which were pushed into later rounds by an overdraft
+ * are not left behind once they are the only ones with pending requests.
+ */
+static void nrs_dwrr_round_update(struct nrs_dwrr_head *head,
+				  struct ptlrpc_nrs_request *nrq)
+{
+	struct cfs_binheap_node *node;
+
+	if (head->dh_round < nrq->nr_u.dwrr.dr_round)
+		head->dh_round = nrq->nr_u.dwrr.dr_round;
+
+	/** Peek at the next request to be served */
+	node = cfs_binheap_root(head->dh_binheap);
+
+	/** No more requests */
+	if (unlikely(node == NULL)) {
+		head->dh_round++;
+	} else {
+		struct ptlrpc_nrs_request *next;
+
+		next = container_of(node, struct ptlrpc_nrs_request, nr_node);
+
+		if (head->dh_round < next->nr_u.dwrr.dr_round)
+			head->dh_round = next->nr_u.dwrr.dr_round;
+	}
+}
+
+/**
+ * Called when getting a request from the DWRR policy for handling so that it
+ * can be served
+ *
+ * \param[in] policy the policy being polled
+ * \param[in] peek   when set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  force the policy to return a request; unused in this policy
+ *
+ * \retval the request to be handled
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_dwrr_req_get(struct ptlrpc_nrs_policy *policy,
+					    bool peek, bool force)
+{
+	struct nrs_dwrr_head	  *head = policy->pol_private;
+	struct cfs_binheap_node	  *node = cfs_binheap_root(head->dh_binheap);
+	struct ptlrpc_nrs_request *nrq;
+
+	nrq = unlikely(node == NULL) ? NULL :
+	      container_of(node, struct ptlrpc_nrs_request, nr_node);
+
+	if (likely(!peek && nrq != NULL)) {
+		struct nrs_dwrr_client *cli;
+		struct ptlrpc_request *req = container_of(nrq,
+							  struct ptlrpc_request,
+							  rq_nrq);
+
+		cli = container_of(nrs_request_resource(nrq),
+				   struct nrs_dwrr_client, dc_res);
+
+		LASSERT(nrq->nr_u.dwrr.dr_round <= cli->dc_round);
+
+		cfs_binheap_remove(head->dh_binheap, &nrq->nr_node);
+		cli->dc_active--;
+
+		CDEBUG(D_RPCTRACE,
+		       "NRS: starting to handle %s request from %s, with round "
+		       "%llu\n", NRS_POL_NAME_DWRR,
+		       libcfs_id2str(req->rq_peer), nrq->nr_u.dwrr.dr_round);
+
+		nrs_dwrr_round_update(head, nrq);
+	}
+
+	return nrq;
+}
+
+/**
+ * Adds request \a nrq to a DWRR \a policy instance's set of queued requests
+ *
+ * As with CRR-N, a scheduling round is a stream of requests sorted in
+ * batches according to the class that they originate from, with one batch
+ * per class in each round. Instead of limiting the number of requests in a
+ * batch, each class may be served up to nrs_dwrr_head::dh_quantum times its
+ * weight bytes per round; a request is admitted to the current batch as long
+ * as the class has some deficit left, and is then charged its full cost. A
+ * request that overdraws the deficit moves the class on by as many rounds as
+ * its overdraft amounts to, so that e.g. a 16MB RPC with a 1MB quantum makes
+ * its class sit out the next 15 rounds, during which other classes can each
+ * be served up to their own share.
+ *
+ * A class that has no pending requests loses any credit left over from the
+ * round it last participated in, but keeps its overdraft.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to add
+ *
+ * \retval 0	request successfully added
+ * \retval != 0 error
+ */
+static int nrs_dwrr_req_add(struct ptlrpc_nrs_policy *policy,
+			    struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_dwrr_head	*head;
+	struct nrs_dwrr_client	*cli;
+	__u64			 quantum;
+	__u64			 cost;
+	int			 rc;
+
+	cli = container_of(nrs_request_resource(nrq),
+			   struct nrs_dwrr_client, dc_res);
+	head = container_of(nrs_request_resource(nrq)->res_parent,
+			    struct nrs_dwrr_head, dh_res);
+
+	nrs_dwrr_cli_weight_update(head, cli);
+	quantum = (__u64)head->dh_quantum * cli->dc_weight;
+	cost = nrs_dwrr_req_cost(head, nrq);
+
+	if (cli->dc_active == 0 && cli->dc_round <= head->dh_round) {
+		/** A new scheduling round has commenced for this class */
+		cli->dc_round = head->dh_round;
+		cli->dc_deficit = quantum;
+
+		/** I was not the last class through here */
+		if (cli->dc_sequence < head->dh_sequence)
+			cli->dc_sequence = ++head->dh_sequence;
+	}
+
+	nrq->nr_u.dwrr.dr_round = cli->dc_round;
+	nrq->nr_u.dwrr.dr_sequence = cli->dc_sequence;
+
+	rc = cfs_binheap_insert(head->dh_binheap, &nrq->nr_node);
+	if (rc != 0)
+		return rc;
+
+	cli->dc_active++;
+	cli->dc_deficit -= cost;
+	if (cli->dc_deficit <= 0) {
+		__u64 rounds = div64_u64(-cli->dc_deficit, quantum) + 1;
+
+		cli->dc_round += rounds;
+		cli->dc_deficit += rounds * quantum;
+		cli->dc_sequence = ++head->dh_sequence;
+	}
+
+	return 0;
+}
+
+/**
+ * Removes request \a nrq from a DWRR \a policy instance's set of queued
+ * requests.
+ *
+ * \param[in] policy the policy
+ * \param[in] nrq    the request to remove
+ */
+static void nrs_dwrr_req_del(struct ptlrpc_nrs_policy *policy,
+			     struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_dwrr_head	*head;
+	struct nrs_dwrr_client	*cli;
+	bool			 is_root;
+
+	cli = container_of(nrs_request_resource(nrq),
+			   struct nrs_dwrr_client, dc_res);
+	head = container_of(nrs_request_resource(nrq)->res_parent,
+			    struct nrs_dwrr_head, dh_res);
+
+	LASSERT(nrq->nr_u.dwrr.dr_round <= cli->dc_round);
+
+	is_root = &nrq->nr_node == cfs_binheap_root(head->dh_binheap);
+
+	cfs_binheap_remove(head->dh_binheap, &nrq->nr_node);
+	cli->dc_active--;
+
+	/**
+	 * If we just deleted the node at the root of the binheap, we may have
+	 * to adjust round numbers.
+	 */
+	if (unlikely(is_root))
+		nrs_dwrr_round_update(head, nrq);
+}
+
+/**
+ * Called right after the request \a nrq finishes being handled by DWRR policy
+ * instance \a policy.
+ *
+ * \param[in] policy the policy that handled the request
+ * \param[in] nrq    the request that was handled
+ */
+static void nrs_dwrr_req_stop(struct ptlrpc_nrs_policy *policy,
+			      struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	CDEBUG(D_RPCTRACE,
+	       "NRS: finished handling %s request from %s, with round %llu"
+	       "\n", NRS_POL_NAME_DWRR,
+	       libcfs_id2str(req->rq_peer), nrq->nr_u.dwrr.dr_round);
+}
+
+#ifdef CONFIG_PROC_FS
+
+/**
+ * lprocfs interface
+ */
+
+#define LPROCFS_NRS_DWRR_QUANTUM_NAME		"quantum:"
+#define LPROCFS_NRS_DWRR_QUANTUM_NAME_REG	"reg_quantum:"
+#define LPROCFS_NRS_DWRR_QUANTUM_NAME_HP	"hp_quantum:"
+#define LPROCFS_NRS_DWRR_COST_NAME		"rpc_cost:"
+#define LPROCFS_NRS_DWRR_COST_NAME_REG		"reg_rpc_cost:"
+#define LPROCFS_NRS_DWRR_COST_NAME_HP		"hp_rpc_cost:"
+
+/** 1GiB, the maximum number of bytes in a quantum or per-RPC cost */
+#define LPROCFS_NRS_DWRR_VAL_MAX		(1UL << 30)
+#define LPROCFS_NRS_DWRR_WR_MAX_CMD		128
+#define LPROCFS_NRS_DWRR_RULE_MAX_CMD		4096
+
+/**
+ * Helper for DWRR's single-value seq_show functions; prints the value for
+ * the regular and, if present, the high-priority NRS head.
+ */
+static int
+lprocfs_nrs_dwrr_seq_show_common(struct seq_file *m, const char *name_reg,
+				 const char *name_hp, enum ptlrpc_nrs_ctl opc)
+{
+	struct ptlrpc_service	*svc = m->private;
+	__u32			 val;
+	int			 rc;
+
+	/**
+	 * Perform two separate calls to this as only one of the NRS heads'
+	 * policies may be in the ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED or
+	 * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPING state.
+	 */
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_DWRR, opc, true, &val);
+	if (rc == 0)
+		seq_printf(m, "%s%u\n", name_reg, val);
+		/**
+		 * Ignore -ENODEV as the regular NRS head's policy may be in
+		 * the ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+		 */
+	else if (rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_DWRR, opc, true, &val);
+	if (rc == 0)
+		seq_printf(m, "%s%u\n", name_hp, val);
+	else if (rc == -ENODEV)
+		rc = 0;
+
+	return rc;
+}
+
+/**
+ * Helper for DWRR's single-value seq_write functions; accepts
+ * "reg_<name>N", "hp_<name>N" or a plain number applying to both heads.
+ */
+static ssize_t
+lprocfs_nrs_dwrr_seq_write_common(struct ptlrpc_service *svc,
+				  const char __user *buffer, size_t count,
+				  const char *name_reg, const char *name_hp,
+				  unsigned long min_val,
+				  enum ptlrpc_nrs_ctl opc)
+{
+	enum ptlrpc_nrs_queue_type	queue = 0;
+	char				kernbuf[LPROCFS_NRS_DWRR_WR_MAX_CMD];
+	char			       *val;
+	unsigned long			val_reg = 0;
+	unsigned long			val_hp = 0;
+	size_t				count_copy;
+	int				rc = 0;
+	int				rc2 = 0;
+
+	if (count > sizeof(kernbuf) - 1)
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+
+	kernbuf[count] = '\0';
+
+	count_copy = count;
+	val = lprocfs_find_named_value(kernbuf, name_reg, &count_copy);
+	if (val != kernbuf) {
+		val_reg = simple_strtoul(val, NULL, 10);
+		queue |= PTLRPC_NRS_QUEUE_REG;
+	}
+
+	count_copy = count;
+	val = lprocfs_find_named_value(kernbuf, name_hp, &count_copy);
+	if (val != kernbuf) {
+		if (!nrs_svc_has_hp(svc))
+			return -ENODEV;
+
+		val_hp = simple_strtoul(val, NULL, 10);
+		queue |= PTLRPC_NRS_QUEUE_HP;
+	}
+
+	if (queue == 0) {
+		if (!isdigit(kernbuf[0]))
+			return -EINVAL;
+
+		val_reg = simple_strtoul(kernbuf, NULL, 10);
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+		if (nrs_svc_has_hp(svc)) {
+			queue |= PTLRPC_NRS_QUEUE_HP;
+			val_hp = val_reg;
+		}
+	}
+
+	if (((queue & PTLRPC_NRS_QUEUE_REG) &&
+	     (val_reg < min_val || val_reg > LPROCFS_NRS_DWRR_VAL_MAX)) ||
+	    ((queue & PTLRPC_NRS_QUEUE_HP) &&
+	     (val_hp < min_val || val_hp > LPROCFS_NRS_DWRR_VAL_MAX)))
+		return -EINVAL;
+
+	if (queue & PTLRPC_NRS_QUEUE_REG) {
+		rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+					       NRS_POL_NAME_DWRR, opc, false,
+					       &val_reg);
+		if ((rc < 0 && rc != -ENODEV) ||
+		    (rc == -ENODEV && queue == PTLRPC_NRS_QUEUE_REG))
+			return rc;
+	}
+
+	if (queue & PTLRPC_NRS_QUEUE_HP) {
+		rc2 = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+						NRS_POL_NAME_DWRR, opc, false,
+						&val_hp);
+		if ((rc2 < 0 && rc2 != -ENODEV) ||
+		    (rc2 == -ENODEV && queue == PTLRPC_NRS_QUEUE_HP))
+			return rc2;
+	}
+
+	return rc == -ENODEV && rc2 == -ENODEV ? -ENODEV : count;
+}
+
+/**
+ * Retrieves the number of bytes a weight-1 class may be served per round,
+ * for DWRR policy instances on both the regular and high-priority NRS head
+ * of a service.
+ *
+ * For example:
+ *
+ *	reg_quantum:1048576
+ *	hp_quantum:1048576
+ */
+static int
+ptlrpc_lprocfs_nrs_dwrr_quantum_seq_show(struct seq_file *m, void *data)
+{
+	return lprocfs_nrs_dwrr_seq_show_common(m,
+					LPROCFS_NRS_DWRR_QUANTUM_NAME_REG,
+					LPROCFS_NRS_DWRR_QUANTUM_NAME_HP,
+					NRS_CTL_DWRR_RD_QUANTUM);
+}
+
+/**
+ * Sets the per-round byte quantum of DWRR policy instances of a service.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_dwrr_quantum=4194304, to let each
+ * weight-1 class be served 4MB per round on both NRS heads, or
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_dwrr_quantum=reg_quantum:4194304 to only
+ * change it on the regular NRS head.
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_dwrr_quantum_seq_write(struct file *file,
+					  const char __user *buffer,
+					  size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+
+	return lprocfs_nrs_dwrr_seq_write_common(m->private, buffer, count,
+					LPROCFS_NRS_DWRR_QUANTUM_NAME_REG,
+					LPROCFS_NRS_DWRR_QUANTUM_NAME_HP, 1,
+					NRS_CTL_DWRR_WR_QUANTUM);
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_dwrr_quantum);
+
+/**
+ * Retrieves the fixed number of bytes every RPC is charged by DWRR policy
+ * instances, on top of its bulk size.
+ */
+static int
+ptlrpc_lprocfs_nrs_dwrr_rpc_cost_seq_show(struct seq_file *m, void *data)
+{
+	return lprocfs_nrs_dwrr_seq_show_common(m,
+					LPROCFS_NRS_DWRR_COST_NAME_REG,
+					LPROCFS_NRS_DWRR_COST_NAME_HP,
+					NRS_CTL_DWRR_RD_RPC_COST);
+}
+
+/**
+ * Sets the fixed per-RPC cost of DWRR policy instances of a service; this
+ * models the per-request overhead, so that a flood of small RPCs is not
+ * served for free.
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_dwrr_rpc_cost=65536
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_dwrr_rpc_cost_seq_write(struct file *file,
+					   const char __user *buffer,
+					   size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+
+	return lprocfs_nrs_dwrr_seq_write_common(m->private, buffer, count,
+					LPROCFS_NRS_DWRR_COST_NAME_REG,
+					LPROCFS_NRS_DWRR_COST_NAME_HP, 0,
+					NRS_CTL_DWRR_WR_RPC_COST);
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_dwrr_rpc_cost);
+
+static int
+ptlrpc_lprocfs_nrs_dwrr_rules_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service	*svc = m->private;
+	int			 rc;
+
+	seq_printf(m, "regular_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_DWRR,
+				       NRS_CTL_DWRR_RD_RULE,
+				       false, m);
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	seq_printf(m, "high_priority_requests:\n");
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_DWRR,
+				       NRS_CTL_DWRR_RD_RULE,
+				       false, m);
+	if (rc == -ENODEV)
+		rc = 0;
+
+	return rc;
+}
+
+static bool nrs_dwrr_name_is_valid(const char *name)
+{
+	int i;
+
+	if (strlen(name) == 0 || strlen(name) >= NRS_DWRR_NAME_LEN)
+		return false;
+
+	for (i = 0; name[i] != '\0'; i++) {
+		if (!isalnum(name[i]) && name[i] != '_')
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Parses "nid={<nidlist>} weight=<N>" or "jobid={<jobids>} weight=<N>" into
+ * a newly allocated rule, holding one reference.
+ */
+static struct nrs_dwrr_rule *nrs_dwrr_rule_parse(char *name, char *buf)
+{
+	struct nrs_dwrr_rule	*rule;
+	char			*match;
+	char			*end;
+	unsigned long		 weight = 0;
+	int			 rc = 0;
+
+	OBD_ALLOC_PTR(rule);
+	if (rule == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	strlcpy(rule->dr_name, name, sizeof(rule->dr_name));
+	INIT_LIST_HEAD(&rule->dr_match);
+	atomic_set(&rule->dr_ref, 1);
+
+	if (strncmp(buf, "nid={", 5) == 0) {
+		rule->dr_type = NRS_DWRR_TYPE_NID;
+		match = buf + 5;
+	} else if (strncmp(buf, "jobid={", 7) == 0) {
+		rule->dr_type = NRS_DWRR_TYPE_JOBID;
+		match = buf + 7;
+	} else {
+		GOTO(out, rc = -EINVAL);
+	}
+
+	end = strchr(match, '}');
+	if (end == NULL || end == match)
+		GOTO(out, rc = -EINVAL);
+	*end++ = '\0';
+
+	OBD_ALLOC(rule->dr_match_str, strlen(match) + 1);
+	if (rule->dr_match_str == NULL)
+		GOTO(out, rc = -ENOMEM);
+	strcpy(rule->dr_match_str, match);
+
+	if (rule->dr_type == NRS_DWRR_TYPE_NID) {
+		if (cfs_parse_nidlist(match, strlen(match),
+				      &rule->dr_match) <= 0)
+			GOTO(out, rc = -EINVAL);
+	} else {
+		rc = nrs_tbf_jobid_list_parse(match, strlen(match),
+					      &rule->dr_match);
+		if (rc != 0)
+			GOTO(out, rc);
+	}
+
+	end = skip_spaces(end);
+	if (strncmp(end, "weight=", 7) != 0)
+		GOTO(out, rc = -EINVAL);
+	rc = kstrtoul(strim(end + 7), 10, &weight);
+	if (rc != 0 || weight == 0 || weight > NRS_DWRR_WEIGHT_MAX)
+		GOTO(out, rc = -EINVAL);
+	rule->dr_weight = weight;
+out:
+	if (rc != 0) {
+		nrs_dwrr_rule_put(rule);
+		return ERR_PTR(rc);
+	}
+	return rule;
+}
+
+/**
+ * Adds or removes DWRR weight rules.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_dwrr_rules=\
+ *	"start big nid={192.168.1.[1-16]@tcp} weight=4"
+ * lctl set_param ost.OSS.ost_io.nrs_dwrr_rules="hp stop big"
+ *
+ * Rules are matched in the order they were added; the rule type must match
+ * the classification the policy was started with, i.e. "jobid={...}" rules
+ * require nrs_policies="dwrr jobid".
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_dwrr_rules_seq_write(struct file *file,
+					const char __user *buffer,
+					size_t count, loff_t *off)
+{
+	struct seq_file			*m = file->private_data;
+	struct ptlrpc_service		*svc = m->private;
+	enum ptlrpc_nrs_queue_type	 queue = PTLRPC_NRS_QUEUE_BOTH;
+	struct nrs_dwrr_rule		*rule;
+	char				*kernbuf;
+	char				*val;
+	char				*cmd;
+	char				*name;
+	int				 rc;
+
+	if (count > LPROCFS_NRS_DWRR_RULE_MAX_CMD - 1)
+		return -EINVAL;
+
+	OBD_ALLOC(kernbuf, LPROCFS_NRS_DWRR_RULE_MAX_CMD);
+	if (kernbuf == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out, rc = -EFAULT);
+
+	val = strim(kernbuf);
+	cmd = strsep(&val, " ");
+	if (strcmp(cmd, "reg") == 0) {
+		queue = PTLRPC_NRS_QUEUE_REG;
+		cmd = strsep(&val, " ");
+	} else if (strcmp(cmd, "hp") == 0) {
+		queue = PTLRPC_NRS_QUEUE_HP;
+		cmd = strsep(&val, " ");
+	}
+
+	if (queue == PTLRPC_NRS_QUEUE_HP && !nrs_svc_has_hp(svc))
+		GOTO(out, rc = -ENODEV);
+	else if (queue == PTLRPC_NRS_QUEUE_BOTH && !nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_REG;
+
+	if (cmd == NULL || val == NULL)
+		GOTO(out, rc = -EINVAL);
+
+	name = strsep(&val, " ");
+	if (!nrs_dwrr_name_is_valid(name))
+		GOTO(out, rc = -EINVAL);
+
+	/**
+	 * Serialize NRS core lprocfs operations with policy registration/
+	 * unregistration.
+	 */
+	if (strcmp(cmd, "start") == 0) {
+		if (val == NULL)
+			GOTO(out, rc = -EINVAL);
+
+		rule = nrs_dwrr_rule_parse(name, val);
+		if (IS_ERR(rule))
+			GOTO(out, rc = PTR_ERR(rule));
+
+		mutex_lock(&nrs_core.nrs_mutex);
+		rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_DWRR,
+					       NRS_CTL_DWRR_ADD_RULE, false,
+					       rule);
+		mutex_unlock(&nrs_core.nrs_mutex);
+		nrs_dwrr_rule_put(rule);
+	} else if (strcmp(cmd, "stop") == 0) {
+		mutex_lock(&nrs_core.nrs_mutex);
+		rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_DWRR,
+					       NRS_CTL_DWRR_DEL_RULE, false,
+					       name);
+		mutex_unlock(&nrs_core.nrs_mutex);
+	} else {
+		rc = -EINVAL;
+	}
+out:
+	OBD_FREE(kernbuf, LPROCFS_NRS_DWRR_RULE_MAX_CMD);
+
+	return rc ? rc : count;
+}
+LPROC_SEQ_FOPS(ptlrpc_lprocfs_nrs_dwrr_rules);
+
+/**
+ * Initializes a DWRR policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ *
+ * \retval 0	success
+ * \retval != 0	error
+ */
+static int nrs_dwrr_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_vars nrs_dwrr_lprocfs_vars[] = {
+		{ .name		= "nrs_dwrr_quantum",
+		  .fops		= &ptlrpc_lprocfs_nrs_dwrr_quantum_fops,
+		  .data		= svc },
+		{ .name		= "nrs_dwrr_rpc_cost",
+		  .fops		= &ptlrpc_lprocfs_nrs_dwrr_rpc_cost_fops,
+		  .data		= svc },
+		{ .name		= "nrs_dwrr_rules",
+		  .fops		= &ptlrpc_lprocfs_nrs_dwrr_rules_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (svc->srv_procroot == NULL)
+		return 0;
+
+	return lprocfs_add_vars(svc->srv_procroot, nrs_dwrr_lprocfs_vars, NULL);
+}
+
+/**
+ * Cleans up a DWRR policy's lprocfs interface for service \a svc
+ *
+ * \param[in] svc the service
+ */
+static void nrs_dwrr_lprocfs_fini(struct ptlrpc_service *svc)
+{
+	if (svc->srv_procroot == NULL)
+		return;
+
+	lprocfs_remove_proc_entry("nrs_dwrr_quantum", svc->srv_procroot);
+	lprocfs_remove_proc_entry("nrs_dwrr_rpc_cost", svc->srv_procroot);
+	lprocfs_remove_proc_entry("nrs_dwrr_rules", svc->srv_procroot);
+}
+
+#endif /* CONFIG_PROC_FS */
+
+/**
+ * DWRR policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_dwrr_ops = {
+	.op_policy_start	= nrs_dwrr_start,
+	.op_policy_stop		= nrs_dwrr_stop,
+	.op_policy_ctl		= nrs_dwrr_ctl,
+	.op_res_get		= nrs_dwrr_res_get,
+	.op_res_put		= nrs_dwrr_res_put,
+	.op_req_get		= nrs_dwrr_req_get,
+	.op_req_enqueue		= nrs_dwrr_req_add,
+	.op_req_dequeue		= nrs_dwrr_req_del,
+	.op_req_stop		= nrs_dwrr_req_stop,
+#ifdef CONFIG_PROC_FS
+	.op_lprocfs_init	= nrs_dwrr_lprocfs_init,
+	.op_lprocfs_fini	= nrs_dwrr_lprocfs_fini,
+#endif
+};
+
+/**
+ * DWRR policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_dwrr = {
+	.nc_name		= NRS_POL_NAME_DWRR,
+	.nc_ops			= &nrs_dwrr_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} DWRR policy */
+
+/** @} nrs */
+
+#endif /* HAVE_SERVER_SUPPORT */
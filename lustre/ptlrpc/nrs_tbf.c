@@ -799,7 +799,7 @@ nrs_tbf_jobid_startup(struct ptlrpc_nrs_policy *policy,
  * Frees jobid of \a list.
  *
  */
-static void
+void
 nrs_tbf_jobid_list_free(struct list_head *jobid_list)
 {
 	struct nrs_tbf_jobid *jobid, *n;
@@ -878,7 +878,7 @@ nrs_tbf_jobid_match(const struct nrs_tbf_jobid *jobid, const char *id)
 	return false;
 }
 
-static int
+int
 nrs_tbf_jobid_list_match(struct list_head *jobid_list, char *id)
 {
 	struct nrs_tbf_jobid *jobid;
@@ -890,7 +890,7 @@ nrs_tbf_jobid_list_match(struct list_head *jobid_list, char *id)
 	return 0;
 }
 
-static int
+int
 nrs_tbf_jobid_list_parse(char *str, int len, struct list_head *jobid_list)
 {
 	struct cfs_lstr src;
@@ -1095,6 +1095,24 @@ __u64 lustre_msg_get_transno(struct lustre_msg *msg)
 }
 EXPORT_SYMBOL(lustre_msg_get_transno);
 
+__u64 lustre_msg_get_replay_prev(struct lustre_msg *msg)
+{
+	switch (msg->lm_magic) {
+	case LUSTRE_MSG_MAGIC_V2: {
+		struct ptlrpc_body *pb = lustre_msg_ptlrpc_body(msg);
+		if (pb == NULL) {
+			CERROR("invalid msg %p: no ptlrpc body!\n", msg);
+			return 0;
+		}
+		return pb->pb_replay_prev;
+	}
+	default:
+		CERROR("incorrect message magic: %08x\n", msg->lm_magic);
+		return 0;
+	}
+}
+EXPORT_SYMBOL(lustre_msg_get_replay_prev);
+
 int lustre_msg_get_status(struct lustre_msg *msg)
 {
 	switch (msg->lm_magic) {
@@ -1248,6 +1266,28 @@ __u32 lustre_msg_get_service_time(struct lustre_msg *msg)
 	}
 }
 
+void lustre_msg_get_server_times(struct lustre_msg *msg, __u32 *reqin_time,
+				 __u32 *nrs_time, __u32 *handle_time)
+{
+	switch (msg->lm_magic) {
+	case LUSTRE_MSG_MAGIC_V2: {
+		struct ptlrpc_body *pb = lustre_msg_ptlrpc_body(msg);
+		if (pb == NULL) {
+			CERROR("invalid msg %p: no ptlrpc body!\n", msg);
+			break;
+		}
+		*reqin_time = pb->pb_reqin_time;
+		*nrs_time = pb->pb_nrs_time;
+		*handle_time = pb->pb_handle_time;
+		return;
+	}
+	default:
+		CERROR("incorrect message magic: %08x\n", msg->lm_magic);
+		break;
+	}
+	*reqin_time = *nrs_time = *handle_time = 0;
+}
+
 char *lustre_msg_get_jobid(struct lustre_msg *msg)
 {
 	switch (msg->lm_magic) {
@@ -1436,6 +1476,21 @@ void lustre_msg_set_transno(struct lustre_msg *msg, __u64 transno)
 }
 EXPORT_SYMBOL(lustre_msg_set_transno);
 
+void lustre_msg_set_replay_prev(struct lustre_msg *msg, __u64 transno)
+{
+	switch (msg->lm_magic) {
+	case LUSTRE_MSG_MAGIC_V2: {
+		struct ptlrpc_body *pb = lustre_msg_ptlrpc_body(msg);
+		LASSERTF(pb != NULL, "invalid msg %p: no ptlrpc body!\n", msg);
+		pb->pb_replay_prev = transno;
+		return;
+	}
+	default:
+		LASSERTF(0, "incorrect message magic: %08x\n", msg->lm_magic);
+	}
+}
+EXPORT_SYMBOL(lustre_msg_set_replay_prev);
+
 void lustre_msg_set_status(struct lustre_msg *msg, __u32 status)
 {
 	switch (msg->lm_magic) {
@@ -1493,6 +1548,23 @@ void lustre_msg_set_service_time(struct lustre_msg *msg, __u32 service_time)
 	}
 }
 
+void lustre_msg_set_server_times(struct lustre_msg *msg, __u32 reqin_time,
+				 __u32 nrs_time, __u32 handle_time)
+{
+	switch (msg->lm_magic) {
+	case LUSTRE_MSG_MAGIC_V2: {
+		struct ptlrpc_body *pb = lustre_msg_ptlrpc_body(msg);
+		LASSERTF(pb, "invalid msg %p: no ptlrpc body!\n", msg);
+		pb->pb_reqin_time = reqin_time;
+		pb->pb_nrs_time = nrs_time;
+		pb->pb_handle_time = handle_time;
+		return;
+	}
+	default:
+		LASSERTF(0, "incorrect message magic: %08x\n", msg->lm_magic);
+	}
+}
+
 void lustre_msg_set_jobid(struct lustre_msg *msg, char *jobid)
 {
 	switch (msg->lm_magic) {
@@ -1640,11 +1712,13 @@ void lustre_swab_ptlrpc_body(struct ptlrpc_body *b)
         __swab64s (&b->pb_pre_versions[2]);
         __swab64s (&b->pb_pre_versions[3]);
 	__swab64s(&b->pb_mbits);
+	__swab32s(&b->pb_reqin_time);
+	__swab32s(&b->pb_nrs_time);
+	__swab32s(&b->pb_handle_time);
 	CLASSERT(offsetof(typeof(*b), pb_padding0) != 0);
 	CLASSERT(offsetof(typeof(*b), pb_padding1) != 0);
-	CLASSERT(offsetof(typeof(*b), pb_padding64_0) != 0);
-	CLASSERT(offsetof(typeof(*b), pb_padding64_1) != 0);
-	CLASSERT(offsetof(typeof(*b), pb_padding64_2) != 0);
+	CLASSERT(offsetof(typeof(*b), pb_padding2) != 0);
+	__swab64s(&b->pb_replay_prev);
 	/* While we need to maintain compatibility between
 	 * clients and servers without ptlrpc_body_v2 (< 2.3)
 	 * do not swab any fields beyond pb_jobid, as we are
@@ -2746,6 +2820,24 @@ void lustre_swab_close_data(struct close_data *cd)
 	__swab64s(&cd->cd_data_version);
 }
 
+void lustre_swab_mdt_batch_op(struct mdt_batch_op *op)
+{
+	__swab32s(&op->mbop_opc);
+	__swab32s(&op->mbop_flags);
+	lustre_swab_lu_fid(&op->mbop_fid);
+	__swab64s(&op->mbop_valid);
+	__swab32s(&op->mbop_name_off);
+	__swab32s(&op->mbop_name_len);
+}
+
+void lustre_swab_mdt_batch_rep(struct mdt_batch_rep *rep)
+{
+	__swab32s(&rep->mbr_status);
+	CLASSERT(offsetof(typeof(*rep), mbr_padding) != 0);
+	__swab64s(&rep->mbr_lock_bits);
+	lustre_swab_mdt_body(&rep->mbr_body);
+}
+
 void lustre_swab_lfsck_request(struct lfsck_request *lr)
 {
 	__swab32s(&lr->lr_event);
@@ -45,6 +45,10 @@ static int suppress_pings;
 module_param(suppress_pings, int, 0644);
 MODULE_PARM_DESC(suppress_pings, "Suppress pings");
 
+static int ping_aggr = 1;
+module_param(ping_aggr, int, 0644);
+MODULE_PARM_DESC(ping_aggr, "Ping all targets of a server with one OBD_PING");
+
 struct mutex pinger_mutex;
 static struct list_head pinger_imports =
 		LIST_HEAD_INIT(pinger_imports);
@@ -111,6 +115,191 @@ static int ptlrpc_ping(struct obd_import *imp)
 	RETURN(0);
 }
 
+/**
+ * Imports pinged by a single OBD_PING because their targets live on the same
+ * server node, see OBD_CONNECT2_PING_AGGR. The request is sent on the first
+ * import and carries the export handles of the others.
+ */
+struct ptlrpc_ping_batch {
+	struct list_head	 ppb_list;
+	lnet_nid_t		 ppb_nid;
+	int			 ppb_count;
+	struct obd_import	*ppb_imps[OBD_PING_AGGR_MAX + 1];
+	/* imp_conn_cnt of each import when the ping was sent */
+	__u32			 ppb_conn_cnt[OBD_PING_AGGR_MAX + 1];
+};
+
+struct ptlrpc_ping_aggr_args {
+	struct ptlrpc_ping_batch	*ppa_batch;
+};
+
+static int ptlrpc_ping_aggr_interpret(const struct lu_env *env,
+				      struct ptlrpc_request *req,
+				      void *data, int rc)
+{
+	struct ptlrpc_ping_aggr_args *ppa = data;
+	struct ptlrpc_ping_batch *ppb = ppa->ppa_batch;
+	struct obd_import *imp;
+	__u32 *status = NULL;
+	int i;
+	ENTRY;
+
+	if (rc == 0)
+		status = req_capsule_server_sized_get(&req->rq_pill,
+						      &RMF_OBD_PING_STATUS,
+						      (ppb->ppb_count - 1) *
+						      sizeof(*status));
+
+	for (i = 1; i < ppb->ppb_count; i++) {
+		imp = ppb->ppb_imps[i];
+
+		/* Without a reply the other targets are as unreachable as
+		 * the one pinged; any other error concerns the latter only
+		 * and the others are just pinged again next time. */
+		if (status != NULL)
+			rc = ptlrpc_status_ntoh(status[i - 1]);
+		else if (!req->rq_timedout)
+			rc = 0;
+
+		if (rc == 0 && status != NULL) {
+			spin_lock(&imp->imp_lock);
+			imp->imp_last_reply_time = ktime_get_real_seconds();
+			spin_unlock(&imp->imp_lock);
+		} else if (rc != 0) {
+			CDEBUG(D_HA, "%s->%s: aggregated ping failed: rc = "
+			       "%d\n", imp->imp_obd->obd_uuid.uuid,
+			       obd2cli_tgt(imp->imp_obd), rc);
+			ptlrpc_fail_import(imp, ppb->ppb_conn_cnt[i]);
+		}
+		class_import_put(imp);
+	}
+	OBD_FREE_PTR(ppb);
+
+	RETURN(0);
+}
+
+/**
+ * Send one OBD_PING for all imports of \a ppb.
+ *
+ * \retval 0 if the ping was sent, \a ppb is then freed when the reply
+ *	     comes back
+ * \retval negative errno otherwise, \a ppb is left to the caller
+ */
+static int ptlrpc_ping_aggr(struct ptlrpc_ping_batch *ppb)
+{
+	struct obd_import *imp = ppb->ppb_imps[0];
+	struct ptlrpc_ping_aggr_args *ppa;
+	struct ptlrpc_request *req;
+	struct lustre_handle *handles;
+	int count = ppb->ppb_count - 1;
+	int rc;
+	int i;
+	ENTRY;
+
+	req = ptlrpc_request_alloc(imp, &RQF_OBD_PING_AGGR);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	req_capsule_set_size(&req->rq_pill, &RMF_OBD_PING_HANDLES, RCL_CLIENT,
+			     count * sizeof(*handles));
+	rc = ptlrpc_request_pack(req, LUSTRE_OBD_VERSION, OBD_PING);
+	if (rc) {
+		ptlrpc_request_free(req);
+		RETURN(rc);
+	}
+
+	handles = req_capsule_client_get(&req->rq_pill, &RMF_OBD_PING_HANDLES);
+	for (i = 1; i < ppb->ppb_count; i++) {
+		struct obd_import *member = ppb->ppb_imps[i];
+
+		spin_lock(&member->imp_lock);
+		handles[i - 1] = member->imp_remote_handle;
+		ppb->ppb_conn_cnt[i] = member->imp_conn_cnt;
+		spin_unlock(&member->imp_lock);
+
+		class_import_get(member);
+		ptlrpc_pinger_sending_on_import(member);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_OBD_PING_STATUS, RCL_SERVER,
+			     count * sizeof(__u32));
+	ptlrpc_request_set_replen(req);
+	req->rq_no_resend = req->rq_no_delay = 1;
+
+	CLASSERT(sizeof(*ppa) <= sizeof(req->rq_async_args));
+	ppa = ptlrpc_req_async_args(req);
+	ppa->ppa_batch = ppb;
+	req->rq_interpret_reply = ptlrpc_ping_aggr_interpret;
+
+	DEBUG_REQ(D_INFO, req, "pinging %s->%s and %d more targets at %s",
+		  imp->imp_obd->obd_uuid.uuid, obd2cli_tgt(imp->imp_obd),
+		  count, libcfs_nid2str(ppb->ppb_nid));
+	ptlrpcd_add_req(req);
+
+	RETURN(0);
+}
+
+/**
+ * Queue a routine ping of \a imp on the batch of its server node.
+ *
+ * \retval 0 if queued
+ * \retval negative errno if \a imp has to be pinged on its own
+ */
+static int ptlrpc_pinger_batch_add(struct list_head *batches,
+				   struct obd_import *imp)
+{
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
+	struct ptlrpc_ping_batch *ppb;
+	lnet_nid_t nid;
+
+	if (!ping_aggr || !(ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2) ||
+	    !(ocd->ocd_connect_flags2 & OBD_CONNECT2_PING_AGGR))
+		return -EOPNOTSUPP;
+
+	spin_lock(&imp->imp_lock);
+	if (imp->imp_connection == NULL) {
+		spin_unlock(&imp->imp_lock);
+		return -ENOTCONN;
+	}
+	nid = imp->imp_connection->c_peer.nid;
+	spin_unlock(&imp->imp_lock);
+
+	list_for_each_entry(ppb, batches, ppb_list) {
+		if (ppb->ppb_nid == nid &&
+		    ppb->ppb_count < ARRAY_SIZE(ppb->ppb_imps)) {
+			ppb->ppb_imps[ppb->ppb_count++] = imp;
+			return 0;
+		}
+	}
+
+	OBD_ALLOC_PTR(ppb);
+	if (ppb == NULL)
+		return -ENOMEM;
+
+	ppb->ppb_nid = nid;
+	ppb->ppb_imps[ppb->ppb_count++] = imp;
+	list_add_tail(&ppb->ppb_list, batches);
+
+	return 0;
+}
+
+static void ptlrpc_pinger_send_batches(struct list_head *batches)
+{
+	struct ptlrpc_ping_batch *ppb;
+	struct ptlrpc_ping_batch *tmp;
+	int i;
+
+	list_for_each_entry_safe(ppb, tmp, batches, ppb_list) {
+		list_del_init(&ppb->ppb_list);
+		if (ppb->ppb_count > 1 && ptlrpc_ping_aggr(ppb) == 0)
+			continue;
+
+		for (i = 0; i < ppb->ppb_count; i++)
+			ptlrpc_ping(ppb->ppb_imps[i]);
+		OBD_FREE_PTR(ppb);
+	}
+}
+
 static void ptlrpc_update_next_ping(struct obd_import *imp, int soon)
 {
 #ifdef ENABLE_PINGER
@@ -181,7 +370,8 @@ void ptlrpc_pinger_ir_down(void)
 EXPORT_SYMBOL(ptlrpc_pinger_ir_down);
 
 static void ptlrpc_pinger_process_import(struct obd_import *imp,
-                                         unsigned long this_ping)
+					 unsigned long this_ping,
+					 struct list_head *batches)
 {
 	int level;
 	int force;
@@ -234,7 +424,11 @@ static void ptlrpc_pinger_process_import(struct obd_import *imp,
 			spin_unlock(&imp->imp_lock);
 		}
 	} else if ((imp->imp_pingable && !suppress) || force_next || force) {
-		ptlrpc_ping(imp);
+		/* forced pings are to learn the last committed transno of
+		 * this very target, which an aggregated ping does not tell */
+		if (force_next || force ||
+		    ptlrpc_pinger_batch_add(batches, imp) != 0)
+			ptlrpc_ping(imp);
 	}
 }
 
@@ -254,7 +448,9 @@ static int ptlrpc_pinger_main(void *arg)
 		cfs_duration_t time_to_next_wake;
 		struct timeout_item *item;
 		struct list_head *iter;
+		struct list_head batches;
 
+		INIT_LIST_HEAD(&batches);
 		mutex_lock(&pinger_mutex);
 		list_for_each_entry(item, &timeout_list, ti_chain)
                         item->ti_cb(item, item->ti_cb_data);
@@ -264,7 +460,7 @@ static int ptlrpc_pinger_main(void *arg)
 							    struct obd_import,
 							    imp_pinger_chain);
 
-                        ptlrpc_pinger_process_import(imp, this_ping);
+			ptlrpc_pinger_process_import(imp, this_ping, &batches);
                         /* obd_timeout might have changed */
                         if (imp->imp_pingable && imp->imp_next_ping &&
                             cfs_time_after(imp->imp_next_ping,
@@ -272,6 +468,7 @@ static int ptlrpc_pinger_main(void *arg)
                                                         cfs_time_seconds(PING_INTERVAL))))
                                 ptlrpc_update_next_ping(imp, 0);
                 }
+		ptlrpc_pinger_send_batches(&batches);
 		mutex_unlock(&pinger_mutex);
                 /* update memory usage info */
                 obd_update_maxusage();
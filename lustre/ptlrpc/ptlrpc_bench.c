@@ -0,0 +1,1066 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ * Lustre is a trademark of Sun Microsystems, Inc.
+ *
+ * lustre/ptlrpc/ptlrpc_bench.c
+ *
+ * In-kernel microbenchmarks for the ptlrpc and ldlm fast paths.
+ *
+ * The module registers the "ptlrpc_bench" obd type. Setting up a device of
+ * that type runs the selected benchmarks, much like llog_test does:
+ *
+ *   lctl attach ptlrpc_bench pb_name pb_uuid
+ *   lctl --device pb_name setup [tests] [threads] [iterations] [items]
+ *   lctl get_param ptlrpc_bench.pb_name.results
+ *
+ * \a tests is a comma separated list of benchmark names, or "all". Each
+ * benchmark is run with 1, 2, 4, ... up to \a threads threads, every thread
+ * doing \a iterations operations; \a items sizes the data set (granted
+ * locks, hash entries, cached objects). Results are reported as ns/op and
+ * aggregate ops/s together with the scaling relative to a single thread.
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <linux/module.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+
+#include <obd_class.h>
+#include <lustre_net.h>
+#include <lustre_dlm.h>
+#include <lustre_sec.h>
+#include <lu_object.h>
+#include <lprocfs_status.h>
+
+#define PB_THREADS_MAX		64
+#define PB_THREADS_DEFAULT	4
+#define PB_ITERS_DEFAULT	100000
+#define PB_ITEMS_DEFAULT	1024
+#define PB_ITEMS_MAX		(1 << 20)
+/* 1, 2, 4, ..., 64 and possibly a final non power of two count */
+#define PB_RUNS_MAX		8
+
+#define PB_HASH_BITS		10
+#define PB_HASH_BKT_BITS	6
+#define PB_HASH_MAX_BITS	20
+
+enum pb_test_id {
+	PB_TEST_PACK = 0,
+	PB_TEST_RPC_GETATTR,
+	PB_TEST_RPC_BRW,
+	PB_TEST_LDLM,
+	PB_TEST_EXTENT,
+	PB_TEST_HASH,
+	PB_TEST_LU_OBJECT,
+	PB_TEST_NR,
+};
+
+struct pb_result {
+	int			pr_threads;
+	__u64			pr_ops;
+	__u64			pr_ns_per_op;
+	__u64			pr_ops_per_sec;
+};
+
+struct pb_hash_item {
+	struct hlist_node	phi_hnode;
+	__u64			phi_key;
+	atomic_t		phi_ref;
+};
+
+struct pb_object {
+	struct lu_object_header	po_header;
+	struct lu_object	po_obj;
+};
+
+struct pb_device {
+	/** top device of the private lu_site used by the lu_object test */
+	struct lu_device	 pd_lu_dev;
+	struct lu_site		 pd_site;
+	struct obd_device	*pd_obd;
+
+	unsigned long		 pd_tests;
+	int			 pd_threads;
+	int			 pd_iters;
+	int			 pd_items;
+
+	/* per benchmark state, set up by pbt_setup */
+	struct obd_import	*pd_imp;
+	struct ldlm_namespace	*pd_ns;
+	struct ldlm_res_id	 pd_ext_res_id;
+	struct lustre_handle	*pd_ext_locks;
+	int			 pd_ext_nr;
+	struct cfs_hash		*pd_hash;
+
+	/* thread start gate and completion */
+	wait_queue_head_t	 pd_waitq;
+	atomic_t		 pd_ready;
+	atomic_t		 pd_running;
+	int			 pd_go;
+
+	struct pb_result	 pd_results[PB_TEST_NR][PB_RUNS_MAX];
+	int			 pd_nruns[PB_TEST_NR];
+	int			 pd_rc[PB_TEST_NR];
+};
+
+struct pb_thread {
+	struct pb_device	*pt_dev;
+	const struct pb_test	*pt_test;
+	int			 pt_index;
+	struct lu_env		 pt_env;
+	struct ldlm_res_id	 pt_res_id;
+	struct ldlm_resource	*pt_res;
+	struct lustre_msg	*pt_msg;
+	__u32			 pt_msg_len;
+	__u64			 pt_ops;
+	__u64			 pt_ns;
+	int			 pt_rc;
+};
+
+struct pb_test {
+	const char	*pbt_name;
+	int		(*pbt_setup)(struct pb_device *pd);
+	void		(*pbt_cleanup)(struct pb_device *pd);
+	int		(*pbt_thread_init)(struct pb_thread *pt);
+	void		(*pbt_thread_fini)(struct pb_thread *pt);
+	int		(*pbt_op)(struct pb_thread *pt, int i);
+};
+
+static inline struct pb_device *obd2pb_dev(struct obd_device *obd)
+{
+	return container_of0(obd->obd_lu_dev, struct pb_device, pd_lu_dev);
+}
+
+/*
+ * Message packing: lustre_init_msg_v2() + lustre_unpack_msg() on a typical
+ * two buffer request, without any allocation in the loop.
+ */
+static __u32 pb_pack_lens[] = { sizeof(struct ptlrpc_body),
+				sizeof(struct mdt_body) };
+
+static int pb_pack_thread_init(struct pb_thread *pt)
+{
+	pt->pt_msg_len = lustre_msg_size_v2(ARRAY_SIZE(pb_pack_lens),
+					    pb_pack_lens);
+	OBD_ALLOC_LARGE(pt->pt_msg, pt->pt_msg_len);
+	if (pt->pt_msg == NULL)
+		return -ENOMEM;
+	return 0;
+}
+
+static void pb_pack_thread_fini(struct pb_thread *pt)
+{
+	if (pt->pt_msg != NULL)
+		OBD_FREE_LARGE(pt->pt_msg, pt->pt_msg_len);
+}
+
+static int pb_pack_op(struct pb_thread *pt, int i)
+{
+	struct lustre_msg *msg = pt->pt_msg;
+	int rc;
+
+	lustre_init_msg_v2(msg, ARRAY_SIZE(pb_pack_lens), pb_pack_lens, NULL);
+	lustre_msg_set_opc(msg, MDS_GETATTR);
+
+	rc = __lustre_unpack_msg(msg, pt->pt_msg_len);
+	if (rc < 0)
+		return rc;
+	if (lustre_msg_get_opc(msg) != MDS_GETATTR)
+		return -EPROTO;
+	return 0;
+}
+
+/*
+ * Client request preparation: ptlrpc_request_alloc() + ptlrpc_request_pack()
+ * + ptlrpc_req_finished() against a loopback import that is never connected,
+ * so that only the allocation, layout and security (null flavor) code runs.
+ */
+static int pb_rpc_setup(struct pb_device *pd)
+{
+	struct obd_device *obd = pd->pd_obd;
+	struct client_obd *cli = &obd->u.cli;
+	struct lnet_process_id peer;
+	struct obd_import *imp;
+	int rc;
+
+	ptlrpc_init_client(MDS_REQUEST_PORTAL, MDC_REPLY_PORTAL,
+			   "ptlrpc_bench", &obd->obd_ldlm_client);
+	cli->cl_sp_me = LUSTRE_SP_CLI;
+	cli->cl_sp_to = LUSTRE_SP_ANY;
+	cli->cl_target_uuid = obd->obd_uuid;
+
+	imp = class_new_import(obd);
+	if (imp == NULL)
+		return -ENOMEM;
+
+	peer.nid = LNET_MKNID(LNET_MKNET(LOLND, 0), 0);
+	peer.pid = LNET_PID_LUSTRE;
+	imp->imp_connection = ptlrpc_connection_get(peer, peer.nid,
+						    &obd->obd_uuid);
+	if (imp->imp_connection == NULL)
+		GOTO(out_imp, rc = -ENOMEM);
+	imp->imp_client = &obd->obd_ldlm_client;
+
+	rc = sptlrpc_import_sec_adapt(imp, NULL, NULL);
+	if (rc)
+		GOTO(out_imp, rc);
+
+	pd->pd_imp = imp;
+	return 0;
+
+out_imp:
+	class_destroy_import(imp);
+	obd_zombie_barrier();
+	return rc;
+}
+
+static void pb_rpc_cleanup(struct pb_device *pd)
+{
+	sptlrpc_import_sec_put(pd->pd_imp);
+	class_destroy_import(pd->pd_imp);
+	pd->pd_imp = NULL;
+	obd_zombie_barrier();
+}
+
+static int pb_rpc_getattr_op(struct pb_thread *pt, int i)
+{
+	struct ptlrpc_request *req;
+	struct mdt_body *body;
+	int rc;
+
+	req = ptlrpc_request_alloc(pt->pt_dev->pd_imp, &RQF_MDS_GETATTR);
+	if (req == NULL)
+		return -ENOMEM;
+
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_GETATTR);
+	if (rc) {
+		ptlrpc_request_free(req);
+		return rc;
+	}
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_MDT_BODY);
+	body->mbo_fid1.f_seq = FID_SEQ_NORMAL;
+	body->mbo_fid1.f_oid = i + 1;
+	body->mbo_valid = OBD_MD_FLGETATTR;
+
+	req_capsule_set_size(&req->rq_pill, &RMF_MDT_MD, RCL_SERVER, 0);
+	req_capsule_set_size(&req->rq_pill, &RMF_ACL, RCL_SERVER, 0);
+	ptlrpc_request_set_replen(req);
+	ptlrpc_req_finished(req);
+	return 0;
+}
+
+static int pb_rpc_brw_op(struct pb_thread *pt, int i)
+{
+	struct ptlrpc_request *req;
+	struct req_capsule *pill;
+	struct ost_body *body;
+	int rc;
+
+	req = ptlrpc_request_alloc(pt->pt_dev->pd_imp, &RQF_OST_BRW_WRITE);
+	if (req == NULL)
+		return -ENOMEM;
+
+	pill = &req->rq_pill;
+	req_capsule_set_size(pill, &RMF_OBD_IOOBJ, RCL_CLIENT,
+			     sizeof(struct obd_ioobj));
+	req_capsule_set_size(pill, &RMF_NIOBUF_REMOTE, RCL_CLIENT,
+			     sizeof(struct niobuf_remote));
+	rc = ptlrpc_request_pack(req, LUSTRE_OST_VERSION, OST_WRITE);
+	if (rc) {
+		ptlrpc_request_free(req);
+		return rc;
+	}
+
+	body = req_capsule_client_get(pill, &RMF_OST_BODY);
+	body->oa.o_oi.oi.oi_id = i + 1;
+	body->oa.o_valid = OBD_MD_FLID;
+
+	req_capsule_set_size(pill, &RMF_RCS, RCL_SERVER, sizeof(__u32));
+	ptlrpc_request_set_replen(req);
+	ptlrpc_req_finished(req);
+	return 0;
+}
+
+/*
+ * LDLM: local enqueue and cancel of an uncontended inodebits lock on a
+ * private server namespace. Each thread uses its own resource.
+ */
+static int pb_ldlm_setup(struct pb_device *pd)
+{
+	char name[MAX_OBD_NAME + 8];
+
+	snprintf(name, sizeof(name), "%s-ns", pd->pd_obd->obd_name);
+	pd->pd_ns = ldlm_namespace_new(pd->pd_obd, name,
+				       LDLM_NAMESPACE_SERVER,
+				       LDLM_NAMESPACE_MODEST,
+				       LDLM_NS_TYPE_MDT);
+	if (pd->pd_ns == NULL)
+		return -ENOMEM;
+	return 0;
+}
+
+static void pb_ldlm_cleanup(struct pb_device *pd)
+{
+	ldlm_namespace_free(pd->pd_ns, NULL, 1);
+	pd->pd_ns = NULL;
+}
+
+static int pb_ldlm_thread_init(struct pb_thread *pt)
+{
+	struct ldlm_resource *res;
+
+	pt->pt_res_id.name[0] = FID_SEQ_NORMAL;
+	pt->pt_res_id.name[1] = pt->pt_index + 1;
+
+	/* keep the resource cached across enqueue/cancel cycles */
+	res = ldlm_resource_get(pt->pt_dev->pd_ns, NULL, &pt->pt_res_id,
+				LDLM_IBITS, 1);
+	if (IS_ERR(res))
+		return PTR_ERR(res);
+	pt->pt_res = res;
+	return 0;
+}
+
+static void pb_ldlm_thread_fini(struct pb_thread *pt)
+{
+	if (pt->pt_res != NULL)
+		ldlm_resource_putref(pt->pt_res);
+}
+
+static int pb_ldlm_enqueue(struct pb_thread *pt, struct ldlm_res_id *res_id,
+			   enum ldlm_type type, union ldlm_policy_data *policy,
+			   enum ldlm_mode mode, struct lustre_handle *lockh)
+{
+	__u64 flags = LDLM_FL_ATOMIC_CB;
+
+	return ldlm_cli_enqueue_local(pt->pt_dev->pd_ns, res_id, type, policy,
+				      mode, &flags, ldlm_blocking_ast,
+				      ldlm_completion_ast, NULL, NULL, 0,
+				      LVB_T_NONE, NULL, lockh);
+}
+
+static int pb_ldlm_op(struct pb_thread *pt, int i)
+{
+	union ldlm_policy_data policy = {
+		.l_inodebits = { .bits = MDS_INODELOCK_UPDATE } };
+	struct lustre_handle lockh;
+	int rc;
+
+	rc = pb_ldlm_enqueue(pt, &pt->pt_res_id, LDLM_IBITS, &policy, LCK_PR,
+			     &lockh);
+	if (rc != ELDLM_OK)
+		return rc;
+
+	/* last reference on a local lock cancels it synchronously */
+	ldlm_lock_decref(&lockh, LCK_PR);
+	return 0;
+}
+
+/*
+ * Extent compatibility: pd_items PW locks are granted on a shared resource,
+ * then every thread enqueues and cancels PW locks on ranges disjoint from
+ * all of them, so each enqueue walks the granted interval trees.
+ */
+static int pb_extent_setup(struct pb_device *pd)
+{
+	union ldlm_policy_data policy;
+	struct pb_thread pt = { .pt_dev = pd };
+	int rc;
+	int i;
+
+	rc = pb_ldlm_setup(pd);
+	if (rc)
+		return rc;
+
+	pd->pd_ext_res_id.name[0] = FID_SEQ_NORMAL;
+	pd->pd_ext_res_id.name[1] = PB_THREADS_MAX + 1;
+
+	OBD_ALLOC_LARGE(pd->pd_ext_locks,
+			pd->pd_items * sizeof(*pd->pd_ext_locks));
+	if (pd->pd_ext_locks == NULL)
+		GOTO(out_ns, rc = -ENOMEM);
+
+	for (i = 0; i < pd->pd_items; i++) {
+		policy.l_extent.start = (__u64)i << PAGE_SHIFT;
+		policy.l_extent.end = policy.l_extent.start + PAGE_SIZE - 1;
+		rc = pb_ldlm_enqueue(&pt, &pd->pd_ext_res_id, LDLM_EXTENT,
+				     &policy, LCK_PW, &pd->pd_ext_locks[i]);
+		if (rc != ELDLM_OK)
+			break;
+		pd->pd_ext_nr++;
+	}
+	if (rc == ELDLM_OK)
+		return 0;
+
+	while (pd->pd_ext_nr > 0)
+		ldlm_lock_decref(&pd->pd_ext_locks[--pd->pd_ext_nr], LCK_PW);
+	OBD_FREE_LARGE(pd->pd_ext_locks,
+		       pd->pd_items * sizeof(*pd->pd_ext_locks));
+	pd->pd_ext_locks = NULL;
+out_ns:
+	pb_ldlm_cleanup(pd);
+	return rc;
+}
+
+static void pb_extent_cleanup(struct pb_device *pd)
+{
+	while (pd->pd_ext_nr > 0)
+		ldlm_lock_decref(&pd->pd_ext_locks[--pd->pd_ext_nr], LCK_PW);
+	OBD_FREE_LARGE(pd->pd_ext_locks,
+		       pd->pd_items * sizeof(*pd->pd_ext_locks));
+	pd->pd_ext_locks = NULL;
+	pb_ldlm_cleanup(pd);
+}
+
+static int pb_extent_op(struct pb_thread *pt, int i)
+{
+	struct pb_device *pd = pt->pt_dev;
+	union ldlm_policy_data policy;
+	struct lustre_handle lockh;
+	int rc;
+
+	policy.l_extent.start = ((__u64)pd->pd_items +
+				 pt->pt_index * pd->pd_iters + i) << PAGE_SHIFT;
+	policy.l_extent.end = policy.l_extent.start + PAGE_SIZE - 1;
+
+	rc = pb_ldlm_enqueue(pt, &pd->pd_ext_res_id, LDLM_EXTENT, &policy,
+			     LCK_PW, &lockh);
+	if (rc != ELDLM_OK)
+		return rc;
+
+	ldlm_lock_decref(&lockh, LCK_PW);
+	return 0;
+}
+
+/*
+ * cfs_hash: lookup + put of existing keys in a hash with pd_items entries,
+ * using the same bucket locking as the ldlm resource hash.
+ */
+static unsigned pb_hop_hash(struct cfs_hash *hs, const void *key,
+			    unsigned mask)
+{
+	return cfs_hash_u64_hash(*(__u64 *)key, mask);
+}
+
+static int pb_hop_keycmp(const void *key, struct hlist_node *hnode)
+{
+	struct pb_hash_item *phi = hlist_entry(hnode, struct pb_hash_item,
+					       phi_hnode);
+
+	return phi->phi_key == *(__u64 *)key;
+}
+
+static void *pb_hop_key(struct hlist_node *hnode)
+{
+	struct pb_hash_item *phi = hlist_entry(hnode, struct pb_hash_item,
+					       phi_hnode);
+
+	return &phi->phi_key;
+}
+
+static void *pb_hop_object(struct hlist_node *hnode)
+{
+	return hlist_entry(hnode, struct pb_hash_item, phi_hnode);
+}
+
+static void pb_hop_get(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	struct pb_hash_item *phi = hlist_entry(hnode, struct pb_hash_item,
+					       phi_hnode);
+
+	atomic_inc(&phi->phi_ref);
+}
+
+static void pb_hop_put(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	struct pb_hash_item *phi = hlist_entry(hnode, struct pb_hash_item,
+					       phi_hnode);
+
+	atomic_dec(&phi->phi_ref);
+}
+
+static void pb_hop_exit(struct cfs_hash *hs, struct hlist_node *hnode)
+{
+	struct pb_hash_item *phi = hlist_entry(hnode, struct pb_hash_item,
+					       phi_hnode);
+
+	LASSERTF(atomic_read(&phi->phi_ref) == 0,
+		 "Busy hash item %llu: %d\n", phi->phi_key,
+		 atomic_read(&phi->phi_ref));
+	OBD_FREE_PTR(phi);
+}
+
+static struct cfs_hash_ops pb_hash_ops = {
+	.hs_hash	= pb_hop_hash,
+	.hs_keycmp	= pb_hop_keycmp,
+	.hs_key		= pb_hop_key,
+	.hs_object	= pb_hop_object,
+	.hs_get		= pb_hop_get,
+	.hs_put		= pb_hop_put,
+	.hs_put_locked	= pb_hop_put,
+	.hs_exit	= pb_hop_exit,
+};
+
+static int pb_hash_setup(struct pb_device *pd)
+{
+	struct pb_hash_item *phi;
+	int i;
+
+	pd->pd_hash = cfs_hash_create("ptlrpc_bench", PB_HASH_BITS,
+				      PB_HASH_MAX_BITS, PB_HASH_BKT_BITS, 0,
+				      CFS_HASH_MIN_THETA, CFS_HASH_MAX_THETA,
+				      &pb_hash_ops, CFS_HASH_DEFAULT);
+	if (pd->pd_hash == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < pd->pd_items; i++) {
+		OBD_ALLOC_PTR(phi);
+		if (phi == NULL) {
+			cfs_hash_putref(pd->pd_hash);
+			pd->pd_hash = NULL;
+			return -ENOMEM;
+		}
+		phi->phi_key = i;
+		cfs_hash_add(pd->pd_hash, &phi->phi_key, &phi->phi_hnode);
+	}
+	return 0;
+}
+
+static void pb_hash_cleanup(struct pb_device *pd)
+{
+	cfs_hash_putref(pd->pd_hash);
+	pd->pd_hash = NULL;
+}
+
+static int pb_hash_op(struct pb_thread *pt, int i)
+{
+	struct pb_device *pd = pt->pt_dev;
+	struct pb_hash_item *phi;
+	__u64 key = (pt->pt_index * pd->pd_iters + i) % pd->pd_items;
+
+	phi = cfs_hash_lookup(pd->pd_hash, &key);
+	if (phi == NULL)
+		return -ENOENT;
+	cfs_hash_put(pd->pd_hash, &phi->phi_hnode);
+	return 0;
+}
+
+/*
+ * lu_object: lu_object_find_at() + lu_object_put() of objects cached in a
+ * private single layer lu_site holding pd_items objects.
+ */
+static int pb_object_init(const struct lu_env *env, struct lu_object *o,
+			  const struct lu_object_conf *conf)
+{
+	/* keep the object cached after the last put */
+	o->lo_header->loh_attr |= LOHA_EXISTS;
+	return 0;
+}
+
+static void pb_object_free(const struct lu_env *env, struct lu_object *o)
+{
+	struct pb_object *po = container_of0(o, struct pb_object, po_obj);
+
+	lu_object_fini(o);
+	lu_object_header_fini(&po->po_header);
+	OBD_FREE_PTR(po);
+}
+
+static const struct lu_object_operations pb_lu_obj_ops = {
+	.loo_object_init	= pb_object_init,
+	.loo_object_free	= pb_object_free,
+};
+
+static struct lu_object *pb_object_alloc(const struct lu_env *env,
+					 const struct lu_object_header *hdr,
+					 struct lu_device *d)
+{
+	struct pb_object *po;
+
+	OBD_ALLOC_PTR(po);
+	if (po == NULL)
+		return NULL;
+
+	lu_object_header_init(&po->po_header);
+	lu_object_init(&po->po_obj, &po->po_header, d);
+	lu_object_add_top(&po->po_header, &po->po_obj);
+	po->po_obj.lo_ops = &pb_lu_obj_ops;
+	return &po->po_obj;
+}
+
+static const struct lu_device_operations pb_lu_ops = {
+	.ldo_object_alloc	= pb_object_alloc,
+};
+
+static struct lu_device_type_operations pb_device_type_ops;
+
+static struct lu_device_type pb_device_type = {
+	.ldt_tags	= LU_DEVICE_DT,
+	.ldt_name	= "ptlrpc_bench",
+	.ldt_ops	= &pb_device_type_ops,
+	.ldt_ctx_tags	= LCT_LOCAL,
+};
+
+static void pb_lu_fid(struct lu_fid *fid, __u64 i)
+{
+	fid->f_seq = FID_SEQ_NORMAL;
+	fid->f_oid = i + 1;
+	fid->f_ver = 0;
+}
+
+static int pb_lu_setup(struct pb_device *pd)
+{
+	struct lu_device *d = &pd->pd_lu_dev;
+	struct lu_object *o;
+	struct lu_fid fid;
+	struct lu_env env;
+	int rc;
+	int i;
+
+	rc = lu_env_init(&env, LCT_LOCAL);
+	if (rc)
+		return rc;
+
+	rc = lu_site_init(&pd->pd_site, d);
+	if (rc)
+		GOTO(out_env, rc);
+
+	for (i = 0; i < pd->pd_items; i++) {
+		pb_lu_fid(&fid, i);
+		o = lu_object_find_at(&env, d, &fid, NULL);
+		if (IS_ERR(o)) {
+			lu_site_purge(&env, &pd->pd_site, ~0);
+			lu_site_fini(&pd->pd_site);
+			GOTO(out_env, rc = PTR_ERR(o));
+		}
+		lu_object_put(&env, o);
+	}
+out_env:
+	lu_env_fini(&env);
+	return rc;
+}
+
+static void pb_lu_cleanup(struct pb_device *pd)
+{
+	struct lu_env env;
+
+	if (lu_env_init(&env, LCT_LOCAL) == 0) {
+		lu_site_purge(&env, &pd->pd_site, ~0);
+		lu_env_fini(&env);
+	}
+	lu_site_fini(&pd->pd_site);
+}
+
+static int pb_lu_op(struct pb_thread *pt, int i)
+{
+	struct pb_device *pd = pt->pt_dev;
+	struct lu_object *o;
+	struct lu_fid fid;
+
+	pb_lu_fid(&fid, (pt->pt_index * pd->pd_iters + i) % pd->pd_items);
+	o = lu_object_find_at(&pt->pt_env, &pd->pd_lu_dev, &fid, NULL);
+	if (IS_ERR(o))
+		return PTR_ERR(o);
+	lu_object_put(&pt->pt_env, o);
+	return 0;
+}
+
+static const struct pb_test pb_tests[PB_TEST_NR] = {
+	[PB_TEST_PACK] = {
+		.pbt_name	 = "pack",
+		.pbt_thread_init = pb_pack_thread_init,
+		.pbt_thread_fini = pb_pack_thread_fini,
+		.pbt_op		 = pb_pack_op,
+	},
+	[PB_TEST_RPC_GETATTR] = {
+		.pbt_name	 = "rpc_getattr",
+		.pbt_setup	 = pb_rpc_setup,
+		.pbt_cleanup	 = pb_rpc_cleanup,
+		.pbt_op		 = pb_rpc_getattr_op,
+	},
+	[PB_TEST_RPC_BRW] = {
+		.pbt_name	 = "rpc_brw",
+		.pbt_setup	 = pb_rpc_setup,
+		.pbt_cleanup	 = pb_rpc_cleanup,
+		.pbt_op		 = pb_rpc_brw_op,
+	},
+	[PB_TEST_LDLM] = {
+		.pbt_name	 = "ldlm",
+		.pbt_setup	 = pb_ldlm_setup,
+		.pbt_cleanup	 = pb_ldlm_cleanup,
+		.pbt_thread_init = pb_ldlm_thread_init,
+		.pbt_thread_fini = pb_ldlm_thread_fini,
+		.pbt_op		 = pb_ldlm_op,
+	},
+	[PB_TEST_EXTENT] = {
+		.pbt_name	 = "extent",
+		.pbt_setup	 = pb_extent_setup,
+		.pbt_cleanup	 = pb_extent_cleanup,
+		.pbt_op		 = pb_extent_op,
+	},
+	[PB_TEST_HASH] = {
+		.pbt_name	 = "hash",
+		.pbt_setup	 = pb_hash_setup,
+		.pbt_cleanup	 = pb_hash_cleanup,
+		.pbt_op		 = pb_hash_op,
+	},
+	[PB_TEST_LU_OBJECT] = {
+		.pbt_name	 = "lu_object",
+		.pbt_setup	 = pb_lu_setup,
+		.pbt_cleanup	 = pb_lu_cleanup,
+		.pbt_op		 = pb_lu_op,
+	},
+};
+
+static int pb_thread_main(void *arg)
+{
+	struct pb_thread *pt = arg;
+	struct pb_device *pd = pt->pt_dev;
+	const struct pb_test *test = pt->pt_test;
+	ktime_t start;
+	int i;
+
+	pt->pt_rc = lu_env_init(&pt->pt_env, LCT_LOCAL);
+	if (pt->pt_rc == 0 && test->pbt_thread_init != NULL) {
+		pt->pt_rc = test->pbt_thread_init(pt);
+		if (pt->pt_rc)
+			lu_env_fini(&pt->pt_env);
+	}
+
+	atomic_inc(&pd->pd_ready);
+	wake_up_all(&pd->pd_waitq);
+	wait_event(pd->pd_waitq, pd->pd_go);
+
+	if (pt->pt_rc == 0) {
+		start = ktime_get();
+		for (i = 0; i < pd->pd_iters; i++) {
+			pt->pt_rc = test->pbt_op(pt, i);
+			if (pt->pt_rc)
+				break;
+		}
+		pt->pt_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+		pt->pt_ops = i;
+
+		if (test->pbt_thread_fini != NULL)
+			test->pbt_thread_fini(pt);
+		lu_env_fini(&pt->pt_env);
+	}
+
+	/* \a pt must not be touched once pd_running drops */
+	if (atomic_dec_and_test(&pd->pd_running))
+		wake_up_all(&pd->pd_waitq);
+	return 0;
+}
+
+/**
+ * Run \a test with \a nthreads threads released at the same time, and
+ * record ns/op (sum of thread time over total ops) and aggregate ops/s
+ * (total ops over the time of the slowest thread) into \a res.
+ */
+static int pb_run_one(struct pb_device *pd, const struct pb_test *test,
+		      int nthreads, struct pb_result *res)
+{
+	struct task_struct *task;
+	struct pb_thread *threads;
+	__u64 total_ns = 0;
+	__u64 max_ns = 0;
+	__u64 ops = 0;
+	int started;
+	int rc = 0;
+	int i;
+
+	OBD_ALLOC_LARGE(threads, nthreads * sizeof(*threads));
+	if (threads == NULL)
+		return -ENOMEM;
+
+	atomic_set(&pd->pd_ready, 0);
+	atomic_set(&pd->pd_running, 0);
+	pd->pd_go = 0;
+
+	for (started = 0; started < nthreads; started++) {
+		threads[started].pt_dev = pd;
+		threads[started].pt_test = test;
+		threads[started].pt_index = started;
+
+		atomic_inc(&pd->pd_running);
+		task = kthread_run(pb_thread_main, &threads[started],
+				   "pb_%s_%02d", test->pbt_name, started);
+		if (IS_ERR(task)) {
+			atomic_dec(&pd->pd_running);
+			rc = PTR_ERR(task);
+			CERROR("%s: cannot start %s thread %d: rc = %d\n",
+			       pd->pd_obd->obd_name, test->pbt_name, started,
+			       rc);
+			break;
+		}
+	}
+
+	wait_event(pd->pd_waitq, atomic_read(&pd->pd_ready) == started);
+	pd->pd_go = 1;
+	wake_up_all(&pd->pd_waitq);
+	wait_event(pd->pd_waitq, atomic_read(&pd->pd_running) == 0);
+
+	for (i = 0; i < started; i++) {
+		if (threads[i].pt_rc && rc == 0)
+			rc = threads[i].pt_rc;
+		total_ns += threads[i].pt_ns;
+		max_ns = max(max_ns, threads[i].pt_ns);
+		ops += threads[i].pt_ops;
+	}
+	OBD_FREE_LARGE(threads, nthreads * sizeof(*threads));
+
+	res->pr_threads = started;
+	res->pr_ops = ops;
+	res->pr_ns_per_op = ops ? div64_u64(total_ns, ops) : 0;
+	res->pr_ops_per_sec = max_ns ? div64_u64(ops * NSEC_PER_SEC, max_ns) :
+				       0;
+	return rc;
+}
+
+static void pb_run_test(struct pb_device *pd, enum pb_test_id id)
+{
+	const struct pb_test *test = &pb_tests[id];
+	struct pb_result *res;
+	int nthreads;
+	int rc = 0;
+
+	if (test->pbt_setup != NULL) {
+		rc = test->pbt_setup(pd);
+		if (rc) {
+			CERROR("%s: cannot set up %s benchmark: rc = %d\n",
+			       pd->pd_obd->obd_name, test->pbt_name, rc);
+			pd->pd_rc[id] = rc;
+			return;
+		}
+	}
+
+	for (nthreads = 1; pd->pd_nruns[id] < PB_RUNS_MAX;
+	     nthreads = min(nthreads * 2, pd->pd_threads)) {
+		res = &pd->pd_results[id][pd->pd_nruns[id]];
+		rc = pb_run_one(pd, test, nthreads, res);
+		pd->pd_nruns[id]++;
+
+		LCONSOLE_INFO("%s: %s threads %d ops %llu: %llu ns/op, "
+			      "%llu ops/s\n", pd->pd_obd->obd_name,
+			      test->pbt_name,
+			      res->pr_threads, res->pr_ops, res->pr_ns_per_op,
+			      res->pr_ops_per_sec);
+		if (rc) {
+			CERROR("%s: %s benchmark failed with %d threads: "
+			       "rc = %d\n", pd->pd_obd->obd_name,
+			       test->pbt_name, nthreads, rc);
+			break;
+		}
+		if (nthreads == pd->pd_threads)
+			break;
+	}
+	pd->pd_rc[id] = rc;
+
+	if (test->pbt_cleanup != NULL)
+		test->pbt_cleanup(pd);
+}
+
+static int pb_parse_tests(struct pb_device *pd, char *list)
+{
+	char *name;
+	int i;
+
+	if (strcmp(list, "all") == 0) {
+		pd->pd_tests = (1UL << PB_TEST_NR) - 1;
+		return 0;
+	}
+
+	while ((name = strsep(&list, ",")) != NULL) {
+		if (*name == '\0')
+			continue;
+		for (i = 0; i < PB_TEST_NR; i++) {
+			if (strcmp(name, pb_tests[i].pbt_name) == 0)
+				break;
+		}
+		if (i == PB_TEST_NR) {
+			CERROR("%s: unknown benchmark '%s'\n",
+			       pd->pd_obd->obd_name, name);
+			return -EINVAL;
+		}
+		pd->pd_tests |= 1UL << i;
+	}
+	return pd->pd_tests ? 0 : -EINVAL;
+}
+
+static int pb_parse_int(struct lustre_cfg *lcfg, int index, int *val,
+			int min, int max)
+{
+	int rc;
+
+	if (lcfg->lcfg_bufcount <= index || LUSTRE_CFG_BUFLEN(lcfg, index) < 1)
+		return 0;
+
+	rc = kstrtoint(lustre_cfg_string(lcfg, index), 0, val);
+	if (rc)
+		return rc;
+	if (*val < min || *val > max)
+		return -ERANGE;
+	return 0;
+}
+
+static int pb_results_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+	struct pb_device *pd = obd2pb_dev(obd);
+	struct pb_result *res;
+	__u64 base;
+	int i;
+	int j;
+
+	seq_printf(m, "threads: %d\niterations: %d\nitems: %d\n",
+		   pd->pd_threads, pd->pd_iters, pd->pd_items);
+	seq_printf(m, "%-12s %8s %12s %10s %14s %8s\n", "test", "threads",
+		   "ops", "ns/op", "ops/s", "scaling");
+
+	for (i = 0; i < PB_TEST_NR; i++) {
+		if (!(pd->pd_tests & (1UL << i)))
+			continue;
+		base = pd->pd_results[i][0].pr_ops_per_sec;
+		for (j = 0; j < pd->pd_nruns[i]; j++) {
+			res = &pd->pd_results[i][j];
+			seq_printf(m, "%-12s %8d %12llu %10llu %14llu %7llu%%\n",
+				   pb_tests[i].pbt_name, res->pr_threads,
+				   res->pr_ops, res->pr_ns_per_op,
+				   res->pr_ops_per_sec, base ?
+				   div64_u64(res->pr_ops_per_sec * 100, base) :
+				   0);
+		}
+		if (pd->pd_rc[i])
+			seq_printf(m, "%-12s failed: rc = %d\n",
+				   pb_tests[i].pbt_name, pd->pd_rc[i]);
+	}
+	return 0;
+}
+LPROC_SEQ_FOPS_RO(pb_results);
+
+static struct lprocfs_vars pb_lprocfs_vars[] = {
+	{ .name	=	"results",
+	  .fops	=	&pb_results_fops	},
+	{ NULL }
+};
+
+static int pb_cleanup(struct obd_device *obd)
+{
+	struct pb_device *pd = obd2pb_dev(obd);
+
+	ENTRY;
+
+	lprocfs_obd_cleanup(obd);
+	obd->obd_lu_dev = NULL;
+	lu_device_fini(&pd->pd_lu_dev);
+	OBD_FREE_PTR(pd);
+	RETURN(0);
+}
+
+/**
+ * Run the benchmarks selected by the setup arguments, see the top of the
+ * file for their meaning. A failing benchmark is reported in "results" but
+ * does not fail the setup, so the remaining numbers stay available.
+ */
+static int pb_setup(struct obd_device *obd, struct lustre_cfg *lcfg)
+{
+	struct pb_device *pd;
+	char tests[64] = "all";
+	int i;
+	int rc;
+
+	ENTRY;
+
+	OBD_ALLOC_PTR(pd);
+	if (pd == NULL)
+		RETURN(-ENOMEM);
+
+	pd->pd_obd = obd;
+	pd->pd_threads = PB_THREADS_DEFAULT;
+	pd->pd_iters = PB_ITERS_DEFAULT;
+	pd->pd_items = PB_ITEMS_DEFAULT;
+	init_waitqueue_head(&pd->pd_waitq);
+
+	if (lcfg->lcfg_bufcount > 1 && LUSTRE_CFG_BUFLEN(lcfg, 1) > 0)
+		strlcpy(tests, lustre_cfg_string(lcfg, 1), sizeof(tests));
+	rc = pb_parse_tests(pd, tests);
+	if (rc == 0)
+		rc = pb_parse_int(lcfg, 2, &pd->pd_threads, 1, PB_THREADS_MAX);
+	if (rc == 0)
+		rc = pb_parse_int(lcfg, 3, &pd->pd_iters, 1, INT_MAX);
+	if (rc == 0)
+		rc = pb_parse_int(lcfg, 4, &pd->pd_items, 1, PB_ITEMS_MAX);
+	if (rc) {
+		CERROR("%s: usage: setup [test[,test...]|all] [threads] "
+		       "[iterations] [items]: rc = %d\n", obd->obd_name, rc);
+		OBD_FREE_PTR(pd);
+		RETURN(rc);
+	}
+
+	lu_device_init(&pd->pd_lu_dev, &pb_device_type);
+	pd->pd_lu_dev.ld_ops = &pb_lu_ops;
+	obd->obd_lu_dev = &pd->pd_lu_dev;
+
+	CWARN("%s: running benchmarks with %d threads, %d iterations, "
+	      "%d items\n", obd->obd_name, pd->pd_threads, pd->pd_iters,
+	      pd->pd_items);
+
+	for (i = 0; i < PB_TEST_NR; i++) {
+		if (pd->pd_tests & (1UL << i))
+			pb_run_test(pd, i);
+	}
+
+#ifdef CONFIG_PROC_FS
+	obd->obd_vars = pb_lprocfs_vars;
+	lprocfs_obd_setup(obd);
+#endif
+	RETURN(0);
+}
+
+static struct obd_ops pb_obd_ops = {
+	.o_owner	= THIS_MODULE,
+	.o_setup	= pb_setup,
+	.o_cleanup	= pb_cleanup,
+};
+
+static int __init ptlrpc_bench_init(void)
+{
+	return class_register_type(&pb_obd_ops, NULL, true, NULL,
+				   "ptlrpc_bench", NULL);
+}
+
+static void __exit ptlrpc_bench_exit(void)
+{
+	class_unregister_type("ptlrpc_bench");
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("Lustre PtlRPC/LDLM microbenchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(ptlrpc_bench_init);
+module_exit(ptlrpc_bench_exit);
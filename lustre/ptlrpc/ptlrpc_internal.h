@@ -52,6 +52,12 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_dwrr;
+
+/* nrs_tbf.c, shared with the DWRR policy */
+void nrs_tbf_jobid_list_free(struct list_head *jobid_list);
+int nrs_tbf_jobid_list_match(struct list_head *jobid_list, char *id);
+int nrs_tbf_jobid_list_parse(char *str, int len, struct list_head *jobid_list);
 #endif /* HAVE_SERVER_SUPPORT */
 
 /**
@@ -79,6 +85,7 @@ int ptlrpc_request_cache_init(void);
 void ptlrpc_request_cache_fini(void);
 struct ptlrpc_request *ptlrpc_request_cache_alloc(gfp_t flags);
 void ptlrpc_request_cache_free(struct ptlrpc_request *req);
+void ptlrpc_rq_cache_fit(struct ptlrpc_request *req, int msgsize);
 void ptlrpc_init_xid(void);
 void ptlrpc_set_add_new_req(struct ptlrpcd_ctl *pc,
 			    struct ptlrpc_request *req);
@@ -102,6 +109,14 @@ void ptlrpc_handle_failed_import(struct obd_import *imp);
 int ptlrpc_replay_next(struct obd_import *imp, int *inflight);
 void ptlrpc_initiate_recovery(struct obd_import *imp);
 
+/* microseconds from \a earlier to \a later, clamped to [0, UINT_MAX] */
+static inline __u32 ptlrpc_us_delta(ktime_t later, ktime_t earlier)
+{
+	s64 delta = ktime_us_delta(later, earlier);
+
+	return delta <= 0 ? 0 : (__u32)min_t(s64, delta, UINT_MAX);
+}
+
 int lustre_unpack_req_ptlrpc_body(struct ptlrpc_request *req, int offset);
 int lustre_unpack_rep_ptlrpc_body(struct ptlrpc_request *req, int offset);
 
@@ -110,12 +125,16 @@ void ptlrpc_lprocfs_register_service(struct proc_dir_entry *proc_entry,
                                      struct ptlrpc_service *svc);
 void ptlrpc_lprocfs_unregister_service(struct ptlrpc_service *svc);
 void ptlrpc_lprocfs_rpc_sent(struct ptlrpc_request *req, long amount);
+void ptlrpc_lprocfs_rpc_latency(struct ptlrpc_request *req, ktime_t now);
+void ptlrpc_lprocfs_rpc_commit(struct ptlrpc_request *req);
 void ptlrpc_lprocfs_do_request_stat (struct ptlrpc_request *req,
                                      long q_usec, long work_usec);
 #else
 #define ptlrpc_lprocfs_register_service(params...) do{}while(0)
 #define ptlrpc_lprocfs_unregister_service(params...) do{}while(0)
 #define ptlrpc_lprocfs_rpc_sent(params...) do{}while(0)
+#define ptlrpc_lprocfs_rpc_latency(params...) do{}while(0)
+#define ptlrpc_lprocfs_rpc_commit(params...) do{}while(0)
 #define ptlrpc_lprocfs_do_request_stat(params...) do{}while(0)
 #endif /* CONFIG_PROC_FS */
 
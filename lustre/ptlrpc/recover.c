@@ -61,31 +61,41 @@ void ptlrpc_initiate_recovery(struct obd_import *imp)
         EXIT;
 }
 
+static int replay_window = 8;
+module_param(replay_window, int, 0644);
+MODULE_PARM_DESC(replay_window, "Max replay requests in flight per import");
+
 /**
- * Identify what request from replay list needs to be replayed next
- * (based on what we have already replayed) and send it to server.
+ * Number of replay requests that may be in flight at once on \a imp.
+ *
+ * Pipelining is only used if the server orders replays by
+ * ptlrpc_body::pb_replay_prev, and if it keeps reply data for multiple
+ * modifying RPCs so that any replay of the window can be resent and
+ * reconstructed after a reconnect.
  */
-int ptlrpc_replay_next(struct obd_import *imp, int *inflight)
+static int ptlrpc_replay_window(struct obd_import *imp)
 {
-        int rc = 0;
-	struct list_head *tmp, *pos;
-        struct ptlrpc_request *req = NULL;
-        __u64 last_transno;
-        ENTRY;
+	struct obd_connect_data *ocd = &imp->imp_connect_data;
 
-        *inflight = 0;
+	if (replay_window > 1 &&
+	    ocd->ocd_connect_flags & OBD_CONNECT_MULTIMODRPCS &&
+	    ocd->ocd_connect_flags & OBD_CONNECT_FLAGS2 &&
+	    ocd->ocd_connect_flags2 & OBD_CONNECT2_REPLAY_WINDOW)
+		return replay_window;
 
-        /* It might have committed some after we last spoke, so make sure we
-         * get rid of them now.
-         */
-	spin_lock(&imp->imp_lock);
-	imp->imp_last_transno_checked = 0;
-	ptlrpc_free_committed(imp);
-	last_transno = imp->imp_last_replay_transno;
+	return 1;
+}
 
-	CDEBUG(D_HA, "import %p from %s committed %llu last %llu\n",
-	       imp, obd2cli_tgt(imp->imp_obd),
-	       imp->imp_peer_committed_transno, last_transno);
+/**
+ * Find the first request on the replay lists with a transno above
+ * \a last_transno, advancing imp_replay_cursor over the committed list.
+ * Called with imp_lock held.
+ */
+static struct ptlrpc_request *
+ptlrpc_replay_find_next(struct obd_import *imp, __u64 last_transno)
+{
+	struct ptlrpc_request *req = NULL;
+	struct list_head *tmp;
 
 	/* Replay all the committed open requests on committed_list first */
 	if (!list_empty(&imp->imp_committed_list)) {
@@ -95,8 +105,7 @@ int ptlrpc_replay_next(struct obd_import *imp, int *inflight)
 
 		/* The last request on committed_list hasn't been replayed */
 		if (req->rq_transno > last_transno) {
-			if (!imp->imp_resend_replay ||
-			    imp->imp_replay_cursor == &imp->imp_committed_list)
+			if (imp->imp_replay_cursor == &imp->imp_committed_list)
 				imp->imp_replay_cursor =
 					imp->imp_replay_cursor->next;
 
@@ -123,48 +132,117 @@ int ptlrpc_replay_next(struct obd_import *imp, int *inflight)
 	/* All the requests in committed list have been replayed, let's replay
 	 * the imp_replay_list */
 	if (req == NULL) {
-		list_for_each_safe(tmp, pos, &imp->imp_replay_list) {
-			req = list_entry(tmp, struct ptlrpc_request,
-					     rq_replay_list);
-
+		list_for_each_entry(req, &imp->imp_replay_list,
+				    rq_replay_list) {
 			if (req->rq_transno > last_transno)
-				break;
-			req = NULL;
+				return req;
 		}
+		req = NULL;
 	}
 
-	/* If need to resend the last sent transno (because a reconnect
-	 * has occurred), then stop on the matching req and send it again.
-	 * If, however, the last sent transno has been committed then we
-	 * continue replay from the next request. */
-	if (req != NULL && imp->imp_resend_replay)
-		lustre_msg_add_flags(req->rq_reqmsg, MSG_RESENT);
-
-	/* ptlrpc_prepare_replay() may fail to add the reqeust into unreplied
-	 * list if the request hasn't been added to replay list then. Another
-	 * exception is that resend replay could have been removed from the
-	 * unreplied list. */
-	if (req != NULL && list_empty(&req->rq_unreplied_list)) {
-		DEBUG_REQ(D_HA, req, "resend_replay: %d, last_transno: %llu\n",
-			  imp->imp_resend_replay, last_transno);
-		ptlrpc_add_unreplied(req);
-		imp->imp_known_replied_xid = ptlrpc_known_replied_xid(imp);
+	return req;
+}
+
+/**
+ * Identify what requests from replay list need to be replayed next
+ * (based on what we have already sent) and send them to server, keeping
+ * up to ptlrpc_replay_window() replays in flight.
+ *
+ * Every replay carries the transno of the replay sent just before it, so
+ * that the server does not take a replay still on the wire for a gap in
+ * the transno sequence.
+ */
+int ptlrpc_replay_next(struct obd_import *imp, int *inflight)
+{
+	struct ptlrpc_request *req;
+	int window;
+	int rc = 0;
+	ENTRY;
+
+	*inflight = 0;
+
+	/* It might have committed some after we last spoke, so make sure we
+	 * get rid of them now.
+	 */
+	spin_lock(&imp->imp_lock);
+	imp->imp_last_transno_checked = 0;
+	ptlrpc_free_committed(imp);
+
+	CDEBUG(D_HA, "import %p from %s committed %llu last %llu sent %llu\n",
+	       imp, obd2cli_tgt(imp->imp_obd),
+	       imp->imp_peer_committed_transno, imp->imp_last_replay_transno,
+	       imp->imp_replay_sent_transno);
+
+	/* If a reconnect has occurred, resend from the first replay that
+	 * failed. Wait until the replays sent over the previous connection
+	 * are finished first, so that all failures are known and none of
+	 * them is reused while ptlrpcd still owns it. */
+	if (imp->imp_resend_replay) {
+		if (atomic_read(&imp->imp_replay_inflight) > 0) {
+			spin_unlock(&imp->imp_lock);
+			RETURN(0);
+		}
+		imp->imp_replay_resend_transno =
+			max(imp->imp_replay_resend_transno,
+			    imp->imp_replay_sent_transno);
+		if (imp->imp_replay_rewind_transno <
+		    imp->imp_replay_sent_transno)
+			imp->imp_replay_sent_transno =
+				imp->imp_replay_rewind_transno;
+		imp->imp_replay_rewind_transno = ~0ULL;
+		imp->imp_replay_cursor = &imp->imp_committed_list;
+		imp->imp_resend_replay = 0;
 	}
 
-	imp->imp_resend_replay = 0;
-	spin_unlock(&imp->imp_lock);
+	window = ptlrpc_replay_window(imp);
+	while (atomic_read(&imp->imp_replay_inflight) < window) {
+		req = ptlrpc_replay_find_next(imp,
+					      imp->imp_replay_sent_transno);
+		if (req == NULL)
+			break;
+
+		/* This request may have been sent before the last reconnect
+		 * and reached the server, so ask it to be reconstructed. */
+		if (req->rq_transno <= imp->imp_replay_resend_transno)
+			lustre_msg_add_flags(req->rq_reqmsg, MSG_RESENT);
+		lustre_msg_set_replay_prev(req->rq_reqmsg,
+					   imp->imp_replay_sent_transno);
+		imp->imp_replay_sent_transno = req->rq_transno;
+
+		/* ptlrpc_prepare_replay() may fail to add the reqeust into
+		 * unreplied list if the request hasn't been added to replay
+		 * list then. Another exception is that resend replay could
+		 * have been removed from the unreplied list. */
+		if (list_empty(&req->rq_unreplied_list)) {
+			DEBUG_REQ(D_HA, req, "resend_replay: %llu, "
+				  "last_transno: %llu\n",
+				  imp->imp_replay_resend_transno,
+				  imp->imp_last_replay_transno);
+			ptlrpc_add_unreplied(req);
+			imp->imp_known_replied_xid =
+				ptlrpc_known_replied_xid(imp);
+		}
+
+		/* Account for it before dropping imp_lock, so that a
+		 * concurrent caller cannot see replay finished meanwhile. */
+		atomic_inc(&imp->imp_replay_inflight);
+		spin_unlock(&imp->imp_lock);
 
-	if (req != NULL) {
 		LASSERT(!list_empty(&req->rq_unreplied_list));
 
 		rc = ptlrpc_replay_req(req);
 		if (rc) {
 			CERROR("recovery replay error %d for req "
 			       "%llu\n", rc, req->rq_xid);
+			atomic_dec(&imp->imp_replay_inflight);
 			RETURN(rc);
 		}
-		*inflight = 1;
+		(*inflight)++;
+
+		spin_lock(&imp->imp_lock);
 	}
+	spin_unlock(&imp->imp_lock);
+
 	RETURN(rc);
 }
 
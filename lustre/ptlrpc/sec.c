@@ -1567,6 +1567,10 @@ int sptlrpc_cli_alloc_reqbuf(struct ptlrpc_request *req, int msgsize)
         LASSERT(req->rq_reqmsg == NULL);
         LASSERT_ATOMIC_POS(&ctx->cc_refcount);
 
+	/* the flavor is known only now, see ptlrpc_rq_cache_get() */
+	if (req->rq_pool != NULL && req->rq_pool->prp_cache)
+		ptlrpc_rq_cache_fit(req, msgsize);
+
         policy = ctx->cc_sec->ps_policy;
         rc = policy->sp_cops->alloc_reqbuf(ctx->cc_sec, req, msgsize);
         if (!rc) {
@@ -240,8 +240,10 @@ int null_enlarge_reqbuf(struct ptlrpc_sec *sec,
         newmsg_size = lustre_packed_msg_size(oldbuf);
         req->rq_reqbuf->lm_buflens[segment] = oldsize;
 
-        /* request from pool should always have enough buffer */
-        LASSERT(!req->rq_pool || req->rq_reqbuf_len >= newmsg_size);
+	/* request from pool should always have enough buffer, but the
+	 * buffer of a cached request may be replaced */
+	LASSERT(!req->rq_pool || req->rq_pool->prp_cache ||
+		req->rq_reqbuf_len >= newmsg_size);
 
 	if (req->rq_reqbuf_len < newmsg_size) {
 		alloc_size = size_roundup_power2(newmsg_size);
@@ -55,6 +55,21 @@ MODULE_PARM_DESC(at_early_margin, "How soon before an RPC deadline to send an ea
 module_param(at_extra, int, 0644);
 MODULE_PARM_DESC(at_extra, "How much extra time to give with each early reply");
 
+static int req_buffer_adapt = 1;
+module_param(req_buffer_adapt, int, 0644);
+MODULE_PARM_DESC(req_buffer_adapt, "set non-zero to adapt request buffer size and count to the load");
+
+/* seconds between two adaptions of the request buffers of a partition */
+#define RQBD_ADAPT_INTERVAL	10
+/* a request buffer should hold this many requests of average size on top
+ * of the room kept for one request of the maximum size */
+#define RQBD_ADAPT_NREQS	32
+/* adapted buffer size and count stay within this factor of the service's
+ * configured values */
+#define RQBD_ADAPT_FACTOR	4
+/* # quiet intervals before the number of buffers is decreased */
+#define RQBD_ADAPT_IDLE		6
+
 /* forward ref */
 static int ptlrpc_server_post_idle_rqbds(struct ptlrpc_service_part *svcpt);
 static void ptlrpc_server_hpreq_fini(struct ptlrpc_request *req);
@@ -70,6 +85,7 @@ ptlrpc_alloc_rqbd(struct ptlrpc_service_part *svcpt)
 {
 	struct ptlrpc_service		  *svc = svcpt->scp_service;
 	struct ptlrpc_request_buffer_desc *rqbd;
+	int				   size = svcpt->scp_buf_size;
 
 	OBD_CPT_ALLOC_PTR(rqbd, svc->srv_cptable, svcpt->scp_cpt);
 	if (rqbd == NULL)
@@ -81,11 +97,12 @@ ptlrpc_alloc_rqbd(struct ptlrpc_service_part *svcpt)
 	rqbd->rqbd_cbid.cbid_arg = rqbd;
 	INIT_LIST_HEAD(&rqbd->rqbd_reqs);
 	OBD_CPT_ALLOC_LARGE(rqbd->rqbd_buffer, svc->srv_cptable,
-			    svcpt->scp_cpt, svc->srv_buf_size);
+			    svcpt->scp_cpt, size);
 	if (rqbd->rqbd_buffer == NULL) {
 		OBD_FREE_PTR(rqbd);
 		return NULL;
 	}
+	rqbd->rqbd_buffer_size = size;
 
 	spin_lock(&svcpt->scp_lock);
 	list_add(&rqbd->rqbd_list, &svcpt->scp_rqbd_idle);
@@ -108,7 +125,7 @@ ptlrpc_free_rqbd(struct ptlrpc_request_buffer_desc *rqbd)
 	svcpt->scp_nrqbds_total--;
 	spin_unlock(&svcpt->scp_lock);
 
-	OBD_FREE_LARGE(rqbd->rqbd_buffer, svcpt->scp_service->srv_buf_size);
+	OBD_FREE_LARGE(rqbd->rqbd_buffer, rqbd->rqbd_buffer_size);
 	OBD_FREE_PTR(rqbd);
 }
 
@@ -136,10 +153,10 @@ ptlrpc_grow_req_bufs(struct ptlrpc_service_part *svcpt, int post)
 	spin_unlock(&svcpt->scp_lock);
 
 
-        for (i = 0; i < svc->srv_nbuf_per_group; i++) {
+	for (i = 0; i < svcpt->scp_nbuf_per_group; i++) {
                 /* NB: another thread might have recycled enough rqbds, we
 		 * need to make sure it wouldn't over-allocate, see LU-1212. */
-		if (svcpt->scp_nrqbds_posted >= svc->srv_nbuf_per_group)
+		if (svcpt->scp_nrqbds_posted >= svcpt->scp_nbuf_per_group)
 			break;
 
 		rqbd = ptlrpc_alloc_rqbd(svcpt);
@@ -161,7 +178,7 @@ ptlrpc_grow_req_bufs(struct ptlrpc_service_part *svcpt, int post)
 
 	CDEBUG(D_RPCTRACE,
 	       "%s: allocate %d new %d-byte reqbufs (%d/%d left), rc = %d\n",
-	       svc->srv_name, i, svc->srv_buf_size, svcpt->scp_nrqbds_posted,
+	       svc->srv_name, i, svcpt->scp_buf_size, svcpt->scp_nrqbds_posted,
 	       svcpt->scp_nrqbds_total, rc);
 
  try_post:
@@ -606,6 +623,10 @@ ptlrpc_service_part_init(struct ptlrpc_service *svc,
 	INIT_LIST_HEAD(&svcpt->scp_rqbd_posted);
 	INIT_LIST_HEAD(&svcpt->scp_req_incoming);
 	init_waitqueue_head(&svcpt->scp_waitq);
+	svcpt->scp_buf_size = svc->srv_buf_size;
+	svcpt->scp_nbuf_per_group = svc->srv_nbuf_per_group;
+	svcpt->scp_adapt_time = ktime_get_real_seconds();
+	spin_lock_init(&svcpt->scp_req_size_hist.oh_lock);
 	/* history request & rqbd list */
 	INIT_LIST_HEAD(&svcpt->scp_hist_reqs);
 	INIT_LIST_HEAD(&svcpt->scp_hist_rqbds);
@@ -935,16 +956,18 @@ void ptlrpc_server_drop_request(struct ptlrpc_request *req)
 			/*
 			 * now all reqs including the embedded req has been
 			 * disposed, schedule request buffer for re-use
-			 * or free it to drain some in excess.
+			 * or free it to drain some in excess, or if its
+			 * size no longer matches the adapted one.
 			 */
 			LASSERT(atomic_read(&rqbd->rqbd_req.rq_refcount) == 0);
-			if (svcpt->scp_nrqbds_posted >=
-			    svc->srv_nbuf_per_group &&
+			if ((svcpt->scp_nrqbds_posted >=
+			     svcpt->scp_nbuf_per_group ||
+			     rqbd->rqbd_buffer_size != svcpt->scp_buf_size) &&
 			    !test_req_buffer_pressure) {
 				/* like in ptlrpc_free_rqbd() */
 				svcpt->scp_nrqbds_total--;
 				OBD_FREE_LARGE(rqbd->rqbd_buffer,
-					       svc->srv_buf_size);
+					       rqbd->rqbd_buffer_size);
 				OBD_FREE_PTR(rqbd);
 			} else {
 				list_add_tail(&rqbd->rqbd_list,
@@ -1995,6 +2018,7 @@ ptlrpc_server_handle_req_in(struct ptlrpc_service_part *svcpt,
 	ptlrpc_at_add_timed(req);
 
 	/* Move it over to the request processing queue */
+	req->rq_srv.sr_enqueued_ns = ktime_get_real();
 	rc = ptlrpc_server_request_add(svcpt, req);
 	if (rc)
 		GOTO(err_req, rc);
@@ -2008,6 +2032,39 @@ err_req:
 	RETURN(1);
 }
 
+/**
+ * Break down the time spent by \a req on this server so far.
+ *
+ * \param[in] req		request being handled
+ * \param[out] reqin_time	usec from arrival until NRS enqueue
+ * \param[out] nrs_time	usec spent waiting in the NRS queue
+ * \param[out] handle_time	usec since a service thread picked it up
+ *
+ * \retval true	if the request went through the NRS and a service thread
+ * \retval false	otherwise, all times are set to 0
+ */
+bool ptlrpc_server_times(struct ptlrpc_request *req, __u32 *reqin_time,
+			 __u32 *nrs_time, __u32 *handle_time)
+{
+	struct ptlrpc_srv_req *srv = &req->rq_srv;
+	ktime_t arrived;
+
+	if (!req->rq_reqmsg || ktime_to_ns(srv->sr_started_ns) == 0 ||
+	    ktime_to_ns(srv->sr_enqueued_ns) == 0) {
+		*reqin_time = *nrs_time = *handle_time = 0;
+		return false;
+	}
+
+	arrived = timespec64_to_ktime(srv->sr_arrival_time);
+	*reqin_time = ptlrpc_us_delta(srv->sr_enqueued_ns, arrived);
+	*nrs_time = ptlrpc_us_delta(srv->sr_started_ns, srv->sr_enqueued_ns);
+	/* never report 0 so the client can tell the fields are valid */
+	*handle_time = max_t(__u32, ptlrpc_us_delta(ktime_get_real(),
+						    srv->sr_started_ns), 1);
+	return true;
+}
+EXPORT_SYMBOL(ptlrpc_server_times);
+
 /**
  * Main incoming request handling logic.
  * Calls handler function from service to do actual processing.
@@ -2095,6 +2152,7 @@ ptlrpc_server_handle_request(struct ptlrpc_service_part *svcpt,
 
 	/* re-assign request and sesson thread to the current one */
 	request->rq_svc_thread = thread;
+	request->rq_srv.sr_started_ns = work_start;
 	if (thread != NULL) {
 		LASSERT(request->rq_session.lc_thread == NULL);
 		request->rq_session.lc_thread = thread;
@@ -2307,13 +2365,104 @@ ptlrpc_handle_rs(struct ptlrpc_reply_state *rs)
 	RETURN(1);
 }
 
+/**
+ * Adapt the size and number of request buffers of \a svcpt to the requests
+ * received during the last RQBD_ADAPT_INTERVAL seconds.
+ *
+ * Buffers are sized to keep room for a request of the maximum size plus
+ * RQBD_ADAPT_NREQS requests of the average size, so that a buffer is not
+ * unlinked after a handful of large requests, nor mostly wasted by small
+ * ones.  The number of buffers is doubled whenever all buffers were in use,
+ * and slowly decreased after RQBD_ADAPT_IDLE quiet intervals.  Buffers of a
+ * stale size are freed instead of being reposted, see
+ * ptlrpc_server_drop_request().
+ */
+static void
+ptlrpc_rqbd_adapt(struct ptlrpc_service_part *svcpt)
+{
+	struct ptlrpc_service	*svc = svcpt->scp_service;
+	time64_t		 now = ktime_get_real_seconds();
+	__u64			 bytes;
+	int			 nreqs;
+	int			 busy;
+	int			 size;
+	int			 nbuf;
+	int			 min_nbuf;
+
+	if (!req_buffer_adapt || test_req_buffer_pressure)
+		return;
+
+	/* NB: not locking; just looking. */
+	if (now < svcpt->scp_adapt_time + RQBD_ADAPT_INTERVAL)
+		return;
+
+	spin_lock(&svcpt->scp_lock);
+	if (now < svcpt->scp_adapt_time + RQBD_ADAPT_INTERVAL) {
+		spin_unlock(&svcpt->scp_lock);
+		return;
+	}
+	svcpt->scp_adapt_time = now;
+	nreqs = svcpt->scp_adapt_nreqs;
+	bytes = svcpt->scp_adapt_bytes;
+	busy = svcpt->scp_adapt_busy;
+	svcpt->scp_adapt_nreqs = 0;
+	svcpt->scp_adapt_bytes = 0;
+	svcpt->scp_adapt_busy = 0;
+
+	size = svcpt->scp_buf_size;
+	nbuf = svcpt->scp_nbuf_per_group;
+
+	if (nreqs > 0) {
+		do_div(bytes, nreqs);
+		size = svc->srv_max_req_size + RQBD_ADAPT_NREQS * (int)bytes;
+		size = clamp(size, svc->srv_buf_size,
+			     RQBD_ADAPT_FACTOR * svc->srv_buf_size);
+		/* ignore small changes, resizing drops whole buffers */
+		if (abs(size - svcpt->scp_buf_size) * 4 < svcpt->scp_buf_size)
+			size = svcpt->scp_buf_size;
+	}
+
+	min_nbuf = max(svc->srv_nbuf_per_group / RQBD_ADAPT_FACTOR, 1);
+	if (busy > 0) {
+		nbuf = min(nbuf * 2,
+			   RQBD_ADAPT_FACTOR * svc->srv_nbuf_per_group);
+		svcpt->scp_adapt_idle = 0;
+	} else {
+		/* keep the memory posted about the same on a resize */
+		if (size != svcpt->scp_buf_size)
+			nbuf = div_u64((__u64)nbuf * svcpt->scp_buf_size,
+				       size);
+		if (++svcpt->scp_adapt_idle >= RQBD_ADAPT_IDLE) {
+			nbuf = nbuf * 3 / 4;
+			svcpt->scp_adapt_idle = 0;
+		}
+		nbuf = clamp(nbuf, min_nbuf,
+			     RQBD_ADAPT_FACTOR * svc->srv_nbuf_per_group);
+	}
+
+	if (size == svcpt->scp_buf_size && nbuf == svcpt->scp_nbuf_per_group) {
+		spin_unlock(&svcpt->scp_lock);
+		return;
+	}
+
+	CDEBUG(D_RPCTRACE, "%s: cpt %d: %d x %d-byte reqbufs -> %d x %d-byte, "
+	       "%d reqs, %d busy\n", svc->srv_name, svcpt->scp_cpt,
+	       svcpt->scp_nbuf_per_group, svcpt->scp_buf_size, nbuf, size,
+	       nreqs, busy);
+	svcpt->scp_buf_size = size;
+	svcpt->scp_nbuf_per_group = nbuf;
+	spin_unlock(&svcpt->scp_lock);
+}
 
 static void
 ptlrpc_check_rqbd_pool(struct ptlrpc_service_part *svcpt)
 {
 	int avail = svcpt->scp_nrqbds_posted;
-	int low_water = test_req_buffer_pressure ? 0 :
-			svcpt->scp_service->srv_nbuf_per_group / 2;
+	int low_water;
+
+	ptlrpc_rqbd_adapt(svcpt);
+	low_water = test_req_buffer_pressure ? 0 :
+		    svcpt->scp_nbuf_per_group / 2;
 
         /* NB I'm not locking; just looking. */
 
@@ -174,7 +174,9 @@ void lustre_assert_wire_constants(void)
 		 (long long)MDS_HSM_CT_UNREGISTER);
 	LASSERTF(MDS_SWAP_LAYOUTS == 61, "found %lld\n",
 		 (long long)MDS_SWAP_LAYOUTS);
-	LASSERTF(MDS_LAST_OPC == 62, "found %lld\n",
+	LASSERTF(MDS_BATCH == 62, "found %lld\n",
+		 (long long)MDS_BATCH);
+	LASSERTF(MDS_LAST_OPC == 63, "found %lld\n",
 		 (long long)MDS_LAST_OPC);
 	LASSERTF(REINT_SETATTR == 1, "found %lld\n",
 		 (long long)REINT_SETATTR);
@@ -792,18 +794,26 @@ void lustre_assert_wire_constants(void)
 		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_mbits));
 	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_mbits) == 8, "found %lld\n",
 		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_mbits));
-	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding64_0) == 128, "found %lld\n",
-		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_padding64_0));
-	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_0) == 8, "found %lld\n",
-		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_0));
-	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding64_1) == 136, "found %lld\n",
-		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_padding64_1));
-	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_1) == 8, "found %lld\n",
-		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_1));
-	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding64_2) == 144, "found %lld\n",
-		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_padding64_2));
-	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_2) == 8, "found %lld\n",
-		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_2));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_reqin_time) == 128, "found %lld\n",
+		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_reqin_time));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_reqin_time) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_reqin_time));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_nrs_time) == 132, "found %lld\n",
+		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_nrs_time));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_nrs_time) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_nrs_time));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_handle_time) == 136, "found %lld\n",
+		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_handle_time));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_handle_time) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_handle_time));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding2) == 140, "found %lld\n",
+		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_padding2));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding2) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding2));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_replay_prev) == 144, "found %lld\n",
+		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_replay_prev));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_replay_prev) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_replay_prev));
 	CLASSERT(LUSTRE_JOBID_SIZE == 32);
 	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_jobid) == 152, "found %lld\n",
 		 (long long)(int)offsetof(struct ptlrpc_body_v3, pb_jobid));
@@ -889,18 +899,26 @@ void lustre_assert_wire_constants(void)
 		 (int)offsetof(struct ptlrpc_body_v3, pb_mbits), (int)offsetof(struct ptlrpc_body_v2, pb_mbits));
 	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_mbits) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_mbits), "%d != %d\n",
 		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_mbits), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_mbits));
-	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding64_0) == (int)offsetof(struct ptlrpc_body_v2, pb_padding64_0), "%d != %d\n",
-		 (int)offsetof(struct ptlrpc_body_v3, pb_padding64_0), (int)offsetof(struct ptlrpc_body_v2, pb_padding64_0));
-	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_0) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding64_0), "%d != %d\n",
-		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_0), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding64_0));
-	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding64_1) == (int)offsetof(struct ptlrpc_body_v2, pb_padding64_1), "%d != %d\n",
-		 (int)offsetof(struct ptlrpc_body_v3, pb_padding64_1), (int)offsetof(struct ptlrpc_body_v2, pb_padding64_1));
-	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_1) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding64_1), "%d != %d\n",
-		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_1), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding64_1));
-	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding64_2) == (int)offsetof(struct ptlrpc_body_v2, pb_padding64_2), "%d != %d\n",
-		 (int)offsetof(struct ptlrpc_body_v3, pb_padding64_2), (int)offsetof(struct ptlrpc_body_v2, pb_padding64_2));
-	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_2) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding64_2), "%d != %d\n",
-		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding64_2), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding64_2));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_reqin_time) == (int)offsetof(struct ptlrpc_body_v2, pb_reqin_time), "%d != %d\n",
+		 (int)offsetof(struct ptlrpc_body_v3, pb_reqin_time), (int)offsetof(struct ptlrpc_body_v2, pb_reqin_time));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_reqin_time) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_reqin_time), "%d != %d\n",
+		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_reqin_time), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_reqin_time));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_nrs_time) == (int)offsetof(struct ptlrpc_body_v2, pb_nrs_time), "%d != %d\n",
+		 (int)offsetof(struct ptlrpc_body_v3, pb_nrs_time), (int)offsetof(struct ptlrpc_body_v2, pb_nrs_time));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_nrs_time) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_nrs_time), "%d != %d\n",
+		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_nrs_time), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_nrs_time));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_handle_time) == (int)offsetof(struct ptlrpc_body_v2, pb_handle_time), "%d != %d\n",
+		 (int)offsetof(struct ptlrpc_body_v3, pb_handle_time), (int)offsetof(struct ptlrpc_body_v2, pb_handle_time));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_handle_time) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_handle_time), "%d != %d\n",
+		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_handle_time), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_handle_time));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_padding2) == (int)offsetof(struct ptlrpc_body_v2, pb_padding2), "%d != %d\n",
+		 (int)offsetof(struct ptlrpc_body_v3, pb_padding2), (int)offsetof(struct ptlrpc_body_v2, pb_padding2));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding2) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding2), "%d != %d\n",
+		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_padding2), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_padding2));
+	LASSERTF((int)offsetof(struct ptlrpc_body_v3, pb_replay_prev) == (int)offsetof(struct ptlrpc_body_v2, pb_replay_prev), "%d != %d\n",
+		 (int)offsetof(struct ptlrpc_body_v3, pb_replay_prev), (int)offsetof(struct ptlrpc_body_v2, pb_replay_prev));
+	LASSERTF((int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_replay_prev) == (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_replay_prev), "%d != %d\n",
+		 (int)sizeof(((struct ptlrpc_body_v3 *)0)->pb_replay_prev), (int)sizeof(((struct ptlrpc_body_v2 *)0)->pb_replay_prev));
 	LASSERTF(MSG_PTLRPC_BODY_OFF == 0, "found %lld\n",
 		 (long long)MSG_PTLRPC_BODY_OFF);
 	LASSERTF(REQ_REC_OFF == 1, "found %lld\n",
@@ -1239,6 +1257,14 @@ void lustre_assert_wire_constants(void)
 		 OBD_CONNECT_FLAGS2);
 	LASSERTF(OBD_CONNECT2_FILE_SECCTX == 0x1ULL, "found 0x%.16llxULL\n",
 		 OBD_CONNECT2_FILE_SECCTX);
+	LASSERTF(OBD_CONNECT2_BATCH_RPC == 0x10000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BATCH_RPC);
+	LASSERTF(OBD_CONNECT2_REPLAY_WINDOW == 0x20000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_REPLAY_WINDOW);
+	LASSERTF(OBD_CONNECT2_PING_AGGR == 0x40000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_PING_AGGR);
+	LASSERTF(OBD_CONNECT2_BL_AST_BATCH == 0x80000000000ULL, "found 0x%.16llxULL\n",
+		 OBD_CONNECT2_BL_AST_BATCH);
 	LASSERTF(OBD_CKSUM_CRC32 == 0x00000001UL, "found 0x%.8xUL\n",
 		(unsigned)OBD_CKSUM_CRC32);
 	LASSERTF(OBD_CKSUM_ADLER == 0x00000002UL, "found 0x%.8xUL\n",
@@ -2353,6 +2379,62 @@ void lustre_assert_wire_constants(void)
 	LASSERTF((int)sizeof(((struct mdt_ioepoch *)0)->mio_padding) == 4, "found %lld\n",
 		 (long long)(int)sizeof(((struct mdt_ioepoch *)0)->mio_padding));
 
+	/* Checks for struct mdt_batch_op */
+	LASSERTF((int)sizeof(struct mdt_batch_op) == 48, "found %lld\n",
+		 (long long)(int)sizeof(struct mdt_batch_op));
+	LASSERTF((int)offsetof(struct mdt_batch_op, mbop_opc) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_op, mbop_opc));
+	LASSERTF((int)sizeof(((struct mdt_batch_op *)0)->mbop_opc) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_op *)0)->mbop_opc));
+	LASSERTF((int)offsetof(struct mdt_batch_op, mbop_flags) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_op, mbop_flags));
+	LASSERTF((int)sizeof(((struct mdt_batch_op *)0)->mbop_flags) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_op *)0)->mbop_flags));
+	LASSERTF((int)offsetof(struct mdt_batch_op, mbop_fid) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_op, mbop_fid));
+	LASSERTF((int)sizeof(((struct mdt_batch_op *)0)->mbop_fid) == 16, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_op *)0)->mbop_fid));
+	LASSERTF((int)offsetof(struct mdt_batch_op, mbop_valid) == 24, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_op, mbop_valid));
+	LASSERTF((int)sizeof(((struct mdt_batch_op *)0)->mbop_valid) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_op *)0)->mbop_valid));
+	LASSERTF((int)offsetof(struct mdt_batch_op, mbop_name_off) == 32, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_op, mbop_name_off));
+	LASSERTF((int)sizeof(((struct mdt_batch_op *)0)->mbop_name_off) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_op *)0)->mbop_name_off));
+	LASSERTF((int)offsetof(struct mdt_batch_op, mbop_name_len) == 36, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_op, mbop_name_len));
+	LASSERTF((int)sizeof(((struct mdt_batch_op *)0)->mbop_name_len) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_op *)0)->mbop_name_len));
+	LASSERTF((int)offsetof(struct mdt_batch_op, mbop_lockh) == 40, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_op, mbop_lockh));
+	LASSERTF((int)sizeof(((struct mdt_batch_op *)0)->mbop_lockh) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_op *)0)->mbop_lockh));
+
+	/* Checks for struct mdt_batch_rep */
+	LASSERTF((int)sizeof(struct mdt_batch_rep) == 240, "found %lld\n",
+		 (long long)(int)sizeof(struct mdt_batch_rep));
+	LASSERTF((int)offsetof(struct mdt_batch_rep, mbr_status) == 0, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_rep, mbr_status));
+	LASSERTF((int)sizeof(((struct mdt_batch_rep *)0)->mbr_status) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_rep *)0)->mbr_status));
+	LASSERTF((int)offsetof(struct mdt_batch_rep, mbr_padding) == 4, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_rep, mbr_padding));
+	LASSERTF((int)sizeof(((struct mdt_batch_rep *)0)->mbr_padding) == 4, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_rep *)0)->mbr_padding));
+	LASSERTF((int)offsetof(struct mdt_batch_rep, mbr_lockh) == 8, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_rep, mbr_lockh));
+	LASSERTF((int)sizeof(((struct mdt_batch_rep *)0)->mbr_lockh) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_rep *)0)->mbr_lockh));
+	LASSERTF((int)offsetof(struct mdt_batch_rep, mbr_lock_bits) == 16, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_rep, mbr_lock_bits));
+	LASSERTF((int)sizeof(((struct mdt_batch_rep *)0)->mbr_lock_bits) == 8, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_rep *)0)->mbr_lock_bits));
+	LASSERTF((int)offsetof(struct mdt_batch_rep, mbr_body) == 24, "found %lld\n",
+		 (long long)(int)offsetof(struct mdt_batch_rep, mbr_body));
+	LASSERTF((int)sizeof(((struct mdt_batch_rep *)0)->mbr_body) == 216, "found %lld\n",
+		 (long long)(int)sizeof(((struct mdt_batch_rep *)0)->mbr_body));
+
 	/* Checks for struct mdt_rec_setattr */
 	LASSERTF((int)sizeof(struct mdt_rec_setattr) == 136, "found %lld\n",
 		 (long long)(int)sizeof(struct mdt_rec_setattr));
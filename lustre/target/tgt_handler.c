@@ -657,6 +657,26 @@ static int process_req_last_xid(struct ptlrpc_request *req)
 	RETURN(0);
 }
 
+/**
+ * Account the server-side latency breakdown of \a req to its JobID.
+ */
+static void tgt_rpc_jobstats(struct tgt_session_info *tsi,
+			     struct ptlrpc_request *req)
+{
+	struct obd_device	*obd = tsi->tsi_exp->exp_obd;
+	__u32			 reqin_time;
+	__u32			 nrs_time;
+	__u32			 handle_time;
+
+	if (tsi->tsi_jobid == NULL || tsi->tsi_jobid[0] == '\0' ||
+	    obd->u.obt.obt_jobstats.ojs_hash == NULL)
+		return;
+
+	if (ptlrpc_server_times(req, &reqin_time, &nrs_time, &handle_time))
+		lprocfs_job_stats_log_rpc(obd, tsi->tsi_jobid, reqin_time,
+					  nrs_time, handle_time);
+}
+
 int tgt_request_handle(struct ptlrpc_request *req)
 {
 	struct tgt_session_info	*tsi = tgt_ses_info(req->rq_svc_thread->t_env);
@@ -774,6 +794,9 @@ handle_recov:
 	rc = tgt_handle_recovery(req, tsi->tsi_reply_fail_id);
 	if (likely(rc == 1)) {
 		rc = tgt_handle_request0(tsi, h, req);
+		/* tsi_exp and tsi_jobid are not set for sec context RPCs */
+		if (h != NULL)
+			tgt_rpc_jobstats(tsi, req);
 		if (rc)
 			GOTO(out, rc);
 	}
@@ -976,13 +999,80 @@ EXPORT_SYMBOL(tgt_disconnect);
 /*
  * Unified target OBD handlers
  */
+
+/**
+ * Handle an OBD_PING which also carries the export handles of other targets
+ * on this node, see OBD_CONNECT2_PING_AGGR.
+ *
+ * Every export of the same client is refreshed as if it had been pinged
+ * itself, and one status per handle is returned, -ENOTCONN if the export
+ * is unknown so that the client reconnects that import.
+ */
+static int tgt_obd_ping_aggr(struct tgt_session_info *tsi)
+{
+	struct ptlrpc_request	*req = tgt_ses_req(tsi);
+	struct lustre_handle	*handles;
+	struct obd_export	*exp;
+	__u32			*status;
+	int			 count;
+	int			 rc;
+	int			 i;
+
+	ENTRY;
+
+	req_capsule_extend(tsi->tsi_pill, &RQF_OBD_PING_AGGR);
+	handles = req_capsule_client_get(tsi->tsi_pill, &RMF_OBD_PING_HANDLES);
+	if (handles == NULL)
+		RETURN(-EPROTO);
+
+	count = req_capsule_get_size(tsi->tsi_pill, &RMF_OBD_PING_HANDLES,
+				     RCL_CLIENT) / sizeof(*handles);
+	if (count > OBD_PING_AGGR_MAX)
+		RETURN(-EPROTO);
+
+	req_capsule_set_size(tsi->tsi_pill, &RMF_OBD_PING_STATUS, RCL_SERVER,
+			     count * sizeof(*status));
+	obd_ping(req->rq_svc_thread->t_env, req->rq_export);
+	rc = req_capsule_server_pack(tsi->tsi_pill);
+	if (rc)
+		RETURN(rc);
+
+	status = req_capsule_server_get(tsi->tsi_pill, &RMF_OBD_PING_STATUS);
+	for (i = 0; i < count; i++) {
+		exp = class_conn2export(&handles[i]);
+
+		/* a client may only refresh its own exports */
+		if (exp == NULL || exp->exp_failed ||
+		    exp->exp_connection == NULL ||
+		    exp->exp_connection->c_peer.nid != req->rq_peer.nid ||
+		    !obd_uuid_equals(&exp->exp_client_uuid,
+				     &req->rq_export->exp_client_uuid)) {
+			status[i] = ptlrpc_status_hton(-ENOTCONN);
+		} else {
+			ptlrpc_update_export_timer(exp, 0);
+			obd_ping(req->rq_svc_thread->t_env, exp);
+			status[i] = 0;
+		}
+
+		if (exp != NULL)
+			class_export_put(exp);
+	}
+
+	RETURN(0);
+}
+
 int tgt_obd_ping(struct tgt_session_info *tsi)
 {
+	struct ptlrpc_request *req = tgt_ses_req(tsi);
 	int rc;
 
 	ENTRY;
 
-	rc = target_handle_ping(tgt_ses_req(tsi));
+	if (lustre_msg_bufcount(req->rq_reqmsg) > 1 &&
+	    exp_connect_flags2(req->rq_export) & OBD_CONNECT2_PING_AGGR)
+		rc = tgt_obd_ping_aggr(tsi);
+	else
+		rc = target_handle_ping(req);
 	if (rc)
 		RETURN(err_serious(rc));
 
@@ -0,0 +1,295 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/* Check how LNet matches PUTs against MEs with ignore-bits. MEs sharing
+ * a mask are hashed on a mask group, true wildcards are scanned, and
+ * LNetMEInsert() keeps the new ME next to the current one, or puts it on
+ * the scan list if it hashes elsewhere.
+ * PUTs are sent to this node over the loopback NI, on a portal nothing
+ * else uses, and the MD that gets each of them is checked. */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/completion.h>
+#include <linux/hash.h>
+#include <lnet/api.h>
+#include <lnet/lib-lnet.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+#define PREFIX "lnet_kmematch_%u:"
+
+/* not used by LNet, Lustre or selftest */
+#define KMEMATCH_PORTAL		62
+#define KMEMATCH_NONE		(-1)
+#define KMEMATCH_MAX		8
+
+static struct lnet_handle_eq	kmm_eqh;
+static struct lnet_handle_me	kmm_mes[KMEMATCH_MAX];
+static char			kmm_bufs[KMEMATCH_MAX][64];
+static char			kmm_src[64];
+static struct completion	kmm_put;
+static int			kmm_got;
+
+static void kmm_event(struct lnet_event *ev)
+{
+	if (ev->type != LNET_EVENT_PUT)
+		return;
+
+	kmm_got = (long)ev->md.user_ptr;
+	complete(&kmm_put);
+}
+
+/* post a single use MD for index @idx, attached or inserted next to
+ * @current_idx unless it's KMEMATCH_NONE */
+static int kmm_post(int idx, int current_idx, __u64 mbits, __u64 ignore)
+{
+	struct lnet_process_id	any = { .nid = LNET_NID_ANY,
+					.pid = LNET_PID_ANY };
+	struct lnet_handle_md	mdh;
+	struct lnet_md		md = {
+		.start		= kmm_bufs[idx],
+		.length		= sizeof(kmm_bufs[idx]),
+		.threshold	= 1,
+		.options	= LNET_MD_OP_PUT,
+		.user_ptr	= (void *)(long)idx,
+		.eq_handle	= kmm_eqh,
+	};
+	int rc;
+
+	if (current_idx == KMEMATCH_NONE)
+		rc = LNetMEAttach(KMEMATCH_PORTAL, any, mbits, ignore,
+				  LNET_UNLINK, LNET_INS_AFTER, &kmm_mes[idx]);
+	else
+		rc = LNetMEInsert(kmm_mes[current_idx], any, mbits, ignore,
+				  LNET_UNLINK, LNET_INS_BEFORE, &kmm_mes[idx]);
+	if (rc != 0)
+		return rc;
+
+	rc = LNetMDAttach(kmm_mes[idx], md, LNET_UNLINK, &mdh);
+	if (rc != 0)
+		LNetMEUnlink(kmm_mes[idx]);
+	return rc;
+}
+
+/* send a PUT with @mbits to ourselves, and check it lands in MD @want */
+static int kmm_send(struct lnet_process_id self, __u64 mbits, int want)
+{
+	struct lnet_handle_md	mdh;
+	struct lnet_md		md = {
+		.start		= kmm_src,
+		.length		= sizeof(kmm_src),
+		.threshold	= 1,
+		.options	= 0,
+	};
+	int rc;
+
+	LNetInvalidateEQHandle(&md.eq_handle);
+	rc = LNetMDBind(md, LNET_UNLINK, &mdh);
+	if (rc != 0)
+		return rc;
+
+	reinit_completion(&kmm_put);
+	kmm_got = KMEMATCH_NONE;
+	rc = LNetPut(self.nid, mdh, LNET_NOACK_REQ, self, KMEMATCH_PORTAL,
+		     mbits, 0, 0);
+	if (rc != 0) {
+		LNetMDUnlink(mdh);
+		return rc;
+	}
+
+	wait_for_completion_timeout(&kmm_put,
+			msecs_to_jiffies(want == KMEMATCH_NONE ? 1000 : 5000));
+	if (kmm_got != want) {
+		pr_err(PREFIX " bits %#llx went to ME %d, not %d\n",
+		       run_id, mbits, kmm_got, want);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+struct kmm_me {
+	int	km_idx;
+	int	km_current;	/* insert next to this, or KMEMATCH_NONE */
+	__u64	km_mbits;
+	__u64	km_ignore;
+};
+
+struct kmm_msg {
+	__u64	km_mbits;
+	int	km_want;	/* MD the PUT should land in */
+};
+
+/* 0, 1 and 4 on one mask group, 2 on another, 3 exact */
+static const struct kmm_me kmm_hashed_mes[] = {
+	{ 0, KMEMATCH_NONE,	0x1200,		0xff },
+	{ 1, KMEMATCH_NONE,	0x3400,		0xff },
+	{ 2, KMEMATCH_NONE,	0x50000,	0xffff },
+	{ 3, KMEMATCH_NONE,	0x42,		0 },
+	{ 4, 0,			0x1200,		0xff },
+};
+
+/* 4 was inserted before 0, each MD takes a single PUT */
+static const struct kmm_msg kmm_hashed_msgs[] = {
+	{ 0x12ab,	4 },
+	{ 0x12cd,	0 },
+	{ 0x34cd,	1 },
+	{ 0x5abcd,	2 },
+	{ 0x42,		3 },
+	{ 0x12ef,	KMEMATCH_NONE },
+};
+
+/* a true wildcard goes on the scan list, and so does anything inserted
+ * next to it whatever its bits */
+static const struct kmm_me kmm_scan_mes[] = {
+	{ 5, KMEMATCH_NONE,	0,		~0ULL },
+	{ 6, 5,			0x42,		0 },
+};
+
+static const struct kmm_msg kmm_scan_msgs[] = {
+	{ 0x42,		6 },
+	{ 0x7777,	5 },
+};
+
+static int kmm_check(struct lnet_process_id self,
+		     const struct kmm_me *mes, int nmes,
+		     const struct kmm_msg *msgs, int nmsgs)
+{
+	int	rc;
+	int	i;
+
+	for (i = 0; i < nmes; i++) {
+		rc = kmm_post(mes[i].km_idx, mes[i].km_current,
+			      mes[i].km_mbits, mes[i].km_ignore);
+		if (rc != 0) {
+			pr_err(PREFIX " posting ME %d failed: %d\n",
+			       run_id, mes[i].km_idx, rc);
+			return rc;
+		}
+	}
+
+	for (i = 0; i < nmsgs; i++) {
+		rc = kmm_send(self, msgs[i].km_mbits, msgs[i].km_want);
+		if (rc != 0)
+			return rc;
+	}
+	return 0;
+}
+
+static int kmm_run(struct lnet_process_id self)
+{
+	__u64	other;
+	int	rc;
+
+	rc = kmm_check(self, kmm_hashed_mes, ARRAY_SIZE(kmm_hashed_mes),
+		       NULL, 0);
+	if (rc != 0)
+		return rc;
+
+	/* an ME that hashes elsewhere than ME 0 goes on the scan list when
+	 * inserted next to it, and still matches its own bits */
+	for (other = 0x100; other < 0x10000; other += 0x100) {
+		if (hash_64(other, LNET_MT_HASH_BITS) !=
+		    hash_64(0x1200, LNET_MT_HASH_BITS))
+			break;
+	}
+	rc = kmm_post(7, 0, other, 0xff);
+	if (rc != 0) {
+		pr_err(PREFIX " inserting %#llx next to ME 0: %d\n",
+		       run_id, other, rc);
+		return rc;
+	}
+
+	rc = kmm_check(self, NULL, 0,
+		       kmm_hashed_msgs, ARRAY_SIZE(kmm_hashed_msgs));
+	if (rc != 0)
+		return rc;
+
+	rc = kmm_send(self, other | 0xab, 7);
+	if (rc != 0)
+		return rc;
+
+	return kmm_check(self, kmm_scan_mes, ARRAY_SIZE(kmm_scan_mes),
+			 kmm_scan_msgs, ARRAY_SIZE(kmm_scan_msgs));
+}
+
+static int __init kmematch_init(void)
+{
+	struct lnet_process_id	self;
+	int			rc;
+	int			i;
+
+	init_completion(&kmm_put);
+	for (i = 0; i < KMEMATCH_MAX; i++)
+		kmm_mes[i].cookie = LNET_WIRE_HANDLE_COOKIE_NONE;
+
+	rc = LNetNIInit(LNET_PID_LUSTRE);
+	if (rc < 0) {
+		pr_err(PREFIX " LNetNIInit failed: %d\n", run_id, rc);
+		goto out;
+	}
+
+	/* index 0 is the loopback NI */
+	rc = LNetGetId(0, &self);
+	if (rc != 0) {
+		pr_err(PREFIX " LNetGetId failed: %d\n", run_id, rc);
+		goto out_ni;
+	}
+
+	rc = LNetEQAlloc(0, kmm_event, &kmm_eqh);
+	if (rc != 0) {
+		pr_err(PREFIX " LNetEQAlloc failed: %d\n", run_id, rc);
+		goto out_ni;
+	}
+
+	rc = kmm_run(self);
+	if (rc == 0)
+		pr_err(PREFIX " all PUTs matched the expected MEs\n", run_id);
+
+	/* MEs are gone once their MD took a PUT, this drops the rest */
+	for (i = 0; i < KMEMATCH_MAX; i++) {
+		if (kmm_mes[i].cookie != LNET_WIRE_HANDLE_COOKIE_NONE)
+			LNetMEUnlink(kmm_mes[i]);
+	}
+	LNetEQFree(kmm_eqh);
+out_ni:
+	LNetNIFini();
+out:
+	/* Don't load. */
+	return -EINVAL;
+}
+
+static void __exit kmematch_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("LNet ME matching test module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kmematch_init);
+module_exit(kmematch_exit);
@@ -181,6 +181,117 @@ test_smoke () {
 }
 run_test smoke "lst regression test"
 
+# Mean round trip of a single outstanding ping RPC, derived from the
+# client's LNet receive rate. On socklnd it is measured for each
+# ksocklnd busy_poll value in lst_BUSY_POLL.
+lst_BUSY_POLL=${lst_BUSY_POLL:-"0 50"}
+latency_DURATION=${latency_DURATION:-30}
+[ "$SLOW" = no ] && latency_DURATION=10
+
+test_latency () {
+	local server=${lst_SERVERS%%,*}
+	local client=${lst_CLIENTS%%,*}
+	local log=$TMP/$tfile.log
+	local hosts=$(comma_list $nodes $CLIENTS)
+	local param=/sys/module/ksocklnd/parameters/busy_poll
+	local polls=0
+	local restore=""
+	local host
+	local lat
+	local bp
+
+	if [[ "$NETTYPE" = tcp* ]]; then
+		polls=$lst_BUSY_POLL
+		# nodes may not share a setting, put back each one's own
+		for host in ${hosts//,/ }; do
+			bp=$(do_node $host "cat $param") ||
+				error "cannot read busy_poll on $host"
+			restore="$restore do_node $host 'echo $bp > $param';"
+		done
+		trap "$restore" EXIT
+	fi
+
+	lst_prepare
+	export LST_SESSION=$$
+
+	for bp in $polls; do
+		[[ "$NETTYPE" = tcp* ]] && do_nodes $hosts "echo $bp > $param"
+
+		$LST new_session --timeo 100000 lat || error "new_session failed"
+		$LST add_group c $(nids_list $client)
+		$LST add_group s $(nids_list $server)
+		$LST add_batch b
+		$LST add_test --batch b --concurrency 1 --from c --to s ping ||
+			error "add_test failed"
+		$LST run b
+		sleep 2
+		$LST stat --delay $latency_DURATION --count 2 c | tee $log
+		$LST stop b
+		$LST end_session
+
+		lat=$(awk '/^\[Ping latency of c\]/ { getline; p50 = $2;
+							 p99 = $4 }
+			   END { if (p50 != "") print p50, p99 }' $log)
+		[ -n "$lat" ] || error "no ping latency in $log"
+		echo "busy_poll=$bp: round trip p50 ${lat% *} usec," \
+		     "p99 ${lat#* } usec"
+	done
+
+	if [ -n "$restore" ]; then
+		eval "$restore"
+		trap 0
+	fi
+	lst_cleanup_all
+}
+run_test latency "lst ping round-trip latency"
+
+# Bandwidth and latency percentiles of brw writes for each message size in
+# lst_SWEEP_SIZES, one batch per size.
+lst_SWEEP_SIZES=${lst_SWEEP_SIZES:-"4k 16k 64k 256k 1M"}
+lst_SWEEP_CONCR=${lst_SWEEP_CONCR:-8}
+sweep_DURATION=${sweep_DURATION:-20}
+[ "$SLOW" = no ] && sweep_DURATION=10
+
+test_sweep () {
+	local server=${lst_SERVERS%%,*}
+	local client=${lst_CLIENTS%%,*}
+	local log=$TMP/$tfile.log
+	local s
+
+	lst_prepare
+	export LST_SESSION=$$
+
+	$LST new_session --timeo 100000 sweep || error "new_session failed"
+	$LST add_group c $(nids_list $client)
+	$LST add_group s $(nids_list $server)
+
+	printf "%-8s %12s %10s %10s %10s\n" size "MiB/s" p50 p99 p99.9
+	for s in $lst_SWEEP_SIZES; do
+		$LST add_batch b$s
+		$LST add_test --batch b$s --concurrency $lst_SWEEP_CONCR \
+			--from c --to s brw write size=$s ||
+			error "add_test size=$s failed"
+		$LST run b$s
+		sleep 2
+		$LST stat --bw --write --avg --delay $sweep_DURATION --count 2 c \
+			> $log
+		$LST stop b$s
+
+		awk -v size=$s '
+			/^\[LNet Bandwidth of c\]/ { getline; bw = $3 }
+			/^\[BRW latency of c\]/ { getline; p[0] = $2;
+						   p[1] = $4; p[2] = $6 }
+			END { if (bw == "" || p[0] == "") exit 1
+			      printf "%-8s %12s %10s %10s %10s\n",
+				     size, bw, p[0], p[1], p[2] }' $log ||
+			{ cat $log; error "no stats for size=$s"; }
+	done
+
+	$LST end_session
+	lst_cleanup_all
+}
+run_test sweep "lst brw bandwidth and latency by message size"
+
 complete $SECONDS
 _restore_mount
 exit_status
@@ -4599,6 +4599,51 @@ test_120() {
 }
 run_test 120 "DNE fail abort should stop both normal and DNE replay"
 
+test_121() {
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.connect_flags |
+		grep -q replay_window ||
+		{ skip "MDS does not support replay_window" && return 0; }
+
+	local clients=${CLIENTS:-$HOSTNAME}
+	local nr=200
+	local reconnects
+
+	mkdir -p $DIR/$tdir
+	replay_barrier mds1
+	createmany -o $DIR/$tdir/f- $nr || error "createmany failed"
+
+	stop mds1
+	change_active mds1
+	wait_for_facet mds1
+
+	local saved_debug=$($LCTL get_param -n debug)
+
+	$LCTL set_param debug=+ha
+	trap "$LCTL set_param debug='$saved_debug'" EXIT
+	$LCTL clear
+	# drop one replay of a window, so that the replays sent after it
+	# fail as well; only one reconnect should be started for them
+	#define OBD_FAIL_TGT_REPLAY_DROP	0x707
+	do_facet mds1 $LCTL set_param fail_loc=0x80000707
+	mount_facet mds1
+
+	wait_clients_import_state "$clients" mds1 FULL
+	clients_up || error "post-failover stat: $?"
+	do_facet mds1 $LCTL set_param fail_loc=0
+
+	reconnects=$($LCTL dk | grep -c "reconnected to .* during replay")
+	$LCTL set_param debug="$saved_debug"
+	trap 0
+	echo "reconnects during replay: $reconnects"
+	[ $reconnects -le 2 ] ||
+		error "$reconnects reconnects for one dropped replay"
+
+	[ $(ls $DIR/$tdir | wc -l) -eq $nr ] ||
+		error "not all $nr creates were replayed"
+	unlinkmany $DIR/$tdir/f- $nr || error "unlinkmany failed"
+}
+run_test 121 "failed replays of one window reconnect only once"
+
 complete $SECONDS
 check_and_cleanup_lustre
 exit_status
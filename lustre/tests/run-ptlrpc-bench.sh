@@ -0,0 +1,40 @@
+#!/bin/bash
+#
+# Run the ptlrpc/ldlm microbenchmarks from the ptlrpc_bench kernel module.
+#
+# Usage: run-ptlrpc-bench.sh [tests] [threads] [iterations] [items]
+#   tests is a comma separated list of pack, rpc_getattr, rpc_brw, ldlm,
+#   extent, hash, lu_object, or "all" (default).
+
+LUSTRE=${LUSTRE:-$(cd $(dirname $0)/..; echo $PWD)}
+. $LUSTRE/tests/test-framework.sh
+init_test_env $@
+. ${CONFIG:=$LUSTRE/tests/cfg/$NAME.sh}
+
+PATH=$(dirname $0):$LUSTRE/utils:$PATH
+
+PB_TESTS=${1:-${PB_TESTS:-all}}
+PB_THREADS=${2:-${PB_THREADS:-$(nproc)}}
+PB_ITERS=${3:-${PB_ITERS:-100000}}
+PB_ITEMS=${4:-${PB_ITEMS:-1024}}
+
+load_module ptlrpc/ptlrpc_bench || exit 0
+
+RC=0
+# Using ignore_errors will allow lctl to cleanup even if the test fails.
+eval "$LCTL <<-EOF || RC=2
+	attach ptlrpc_bench pb_name pb_uuid
+	ignore_errors
+	setup $PB_TESTS $PB_THREADS $PB_ITERS $PB_ITEMS
+EOF"
+$LCTL get_param -n ptlrpc_bench.pb_name.results || RC=2
+$LCTL get_param -n ptlrpc_bench.pb_name.results | grep -q failed && RC=1
+eval "$LCTL <<-EOF
+	device pb_name
+	cleanup
+	detach
+EOF"
+rmmod -v ptlrpc_bench || RC2=3
+[ $RC -eq 0 -a "$RC2" ] && RC=$RC2
+
+exit $RC
@@ -0,0 +1,430 @@
+#!/bin/bash
+# -*- mode: Bash; tab-width: 4; indent-tabs-mode: t; -*-
+# vim:shiftwidth=4:softtabstop=4:tabstop=4:
+#
+# Tests of LNet behaviour seen from lctl and lnetctl: health, resends,
+# discovery, configuration import/export and fault injection.
+
+LUSTRE=${LUSTRE:-$(cd $(dirname $0)/..; echo $PWD)}
+. $LUSTRE/tests/test-framework.sh
+init_test_env $@
+. ${CONFIG:=$LUSTRE/tests/cfg/$NAME.sh}
+init_logging
+
+#
+ALWAYS_EXCEPT="$ALWAYS_EXCEPT $SANITY_LNET_EXCEPT"
+
+[ x$LNETCTL = x ] && { skip_env "lnetctl not found LNETCTL=$LNETCTL" &&
+	exit 0; }
+
+build_test_filter
+
+# sum the counter named $1 over the YAML output of "lnetctl $2..."
+lnet_counter() {
+	local name=$1
+
+	shift
+	$LNETCTL "$@" | awk -v name="$name:" '
+		$1 == name { sum += $2 }
+		END { print sum + 0 }'
+}
+
+test_100() {
+	local nid=$($LCTL list_nids | head -n1)
+	local srv=$(do_facet mgs $LCTL list_nids | head -n1)
+	local retry=$(cat /sys/module/lnet/parameters/lnet_retry_count)
+
+	[ -n "$srv" -a "$srv" != "$nid" ] ||
+		{ skip "need a remote server NID" && return 0; }
+	[ $retry -gt 0 ] || { skip "lnet_retry_count is 0" && return 0; }
+
+	local fail0=$(lnet_counter fail_count net show -v)
+	local resend0=$(lnet_counter resend_count net show -v)
+	local pfail0=$(lnet_counter fail_count peer show -v --nid $srv)
+	local presend0=$(lnet_counter resend_count peer show -v --nid $srv)
+
+	$LCTL net_drop_add -s $nid -d $srv -r 1 -m GET -e ||
+		error "cannot add send error rule"
+	trap "$LCTL net_drop_del -a" EXIT
+	$LCTL ping $srv && error "ping $srv passed a failing send rule"
+	$LCTL net_drop_del -a
+	trap 0
+
+	local fail1=$(lnet_counter fail_count net show -v)
+	local resend1=$(lnet_counter resend_count net show -v)
+	local pfail1=$(lnet_counter fail_count peer show -v --nid $srv)
+	local presend1=$(lnet_counter resend_count peer show -v --nid $srv)
+
+	echo "local NI fail_count $fail0 -> $fail1," \
+	     "resend_count $resend0 -> $resend1"
+	echo "peer NI fail_count $pfail0 -> $pfail1," \
+	     "resend_count $presend0 -> $presend1"
+
+	# every try fails, so the GET is sent 1 + lnet_retry_count times
+	[ $((fail1 - fail0)) -ge $((retry + 1)) ] ||
+		error "local NI fail_count grew by $((fail1 - fail0))"
+	[ $((resend1 - resend0)) -eq $retry ] ||
+		error "local NI resend_count grew by $((resend1 - resend0))"
+	[ $((pfail1 - pfail0)) -ge $((retry + 1)) ] ||
+		error "peer NI fail_count grew by $((pfail1 - pfail0))"
+	[ $((presend1 - presend0)) -eq $retry ] ||
+		error "peer NI resend_count grew by $((presend1 - presend0))"
+
+	$LCTL ping $srv || error "ping $srv failed after removing the rule"
+}
+run_test 100 "failed sends are resent and charged to NI health"
+
+# LNET_PEER_* bits of "peer state" in "lnetctl peer show -v"
+LNET_PEER_CONFIGURED=0x1
+LNET_PEER_DISCOVERING=0x2
+LNET_PEER_DISCOVERED=0x4
+
+peer_state() {
+	$LNETCTL peer show -v --nid $1 |
+		awk '$1 == "peer" && $2 == "state:" { print $3; exit }'
+}
+
+test_101() {
+	local srv=$(do_facet mgs $LCTL list_nids | head -n1)
+	local param=/sys/module/lnet/parameters/lnet_peer_discovery_disabled
+	local state
+
+	[ -n "$srv" -a "$srv" != "$($LCTL list_nids | head -n1)" ] ||
+		{ skip "need a remote server NID" && return 0; }
+	[ $(cat $param) -eq 0 ] ||
+		{ skip "peer discovery is disabled" && return 0; }
+
+	$LCTL ping $srv || error "cannot ping $srv"
+	state=$(peer_state $srv)
+	[ -n "$state" ] || error "no peer state for $srv"
+	[ $((state & LNET_PEER_CONFIGURED)) -eq 0 ] ||
+		{ skip "$srv is configured through DLC" && return 0; }
+
+	# discovery runs in the background, wait for its ping to complete
+	local i
+
+	for ((i = 0; i < 30; i++)); do
+		state=$(peer_state $srv)
+		[ $((state & LNET_PEER_DISCOVERING)) -eq 0 -a \
+		  $((state & LNET_PEER_DISCOVERED)) -ne 0 ] && break
+		sleep 1
+	done
+	[ $i -lt 30 ] || error "$srv not discovered, state $state"
+
+	$LNETCTL peer show -v --nid $srv | grep -q "Multi-Rail: True" ||
+		error "$srv not seen as Multi-Rail"
+
+	local want=$(do_facet mgs $LCTL list_nids | sort | xargs)
+	local got=$($LNETCTL peer show --nid $srv |
+		    awk '$1 == "-" && $2 == "nid:" { print $3 }' | sort | xargs)
+
+	echo "server NIDs: $want, discovered: $got"
+	[ "$got" == "$want" ] || error "discovered $got, expected $want"
+}
+run_test 101 "discovery learns every NID of a Multi-Rail peer"
+
+test_102() {
+	local nid=$($LCTL list_nids | head -n1)
+	local net=${nid#*@}
+	local saved=$TMP/$tfile.saved
+	local conf=$TMP/$tfile.yaml
+
+	[ -n "$nid" ] || { skip "LNet is not configured" && return 0; }
+
+	$LNETCTL selection show > $saved || error "cannot show rules"
+	trap "$LNETCTL selection del; $LNETCTL import $saved; rm -f $saved" EXIT
+	$LNETCTL selection del || error "cannot delete rules"
+
+	$LNETCTL selection add --type local_ni --nid $nid --priority 3 ||
+		error "cannot add local_ni rule"
+	$LNETCTL selection add --type peer_ni --nid "*@$net" --priority 5 ||
+		error "cannot add peer_ni rule"
+	$LNETCTL selection add --type net --nid "*" --net $net --priority 7 ||
+		error "cannot add net rule"
+	$LNETCTL selection add --type peer_ni --nid "*" --priority 4294967295 &&
+		error "priority 4294967295 accepted"
+	$LNETCTL selection add --type peer_ni --nid "*" --priority -1 &&
+		error "priority -1 accepted"
+
+	local before=$($LNETCTL selection show)
+
+	echo "$before"
+	# keep only the selection section of the export
+	$LNETCTL export | awk '/^[^ -]/ { p = ($1 == "selection:") } p' > $conf
+	grep -c "priority:" $conf | grep -qx 3 ||
+		{ cat $conf; error "export does not hold 3 rules"; }
+
+	$LNETCTL selection del || error "cannot delete rules"
+	[ -z "$($LNETCTL selection show | grep priority:)" ] ||
+		error "rules left after delete"
+	$LNETCTL import $conf || error "cannot import $conf"
+
+	local after=$($LNETCTL selection show)
+
+	[ "$after" == "$before" ] ||
+		error "rules after import differ: $after"
+
+	$LNETCTL selection del
+	$LNETCTL import $saved
+	rm -f $saved $conf
+	trap 0
+}
+run_test 102 "selection rules survive an lnetctl export/import"
+
+# count the conns of type $2 (C, I or O) that "lctl conn_list" shows to $1
+conns_of_type() {
+	$LCTL --net ${1#*@} conn_list |
+		awk -v nid="$1" -v type="$2[" '
+			$1 ~ "-"nid"$" && index($2, type) == 1 { n++ }
+			END { print n + 0 }'
+}
+
+test_103() {
+	local srv=$(do_facet mgs $LCTL list_nids | head -n1)
+	local param=/sys/module/ksocklnd/parameters/conns_per_peer
+	local stripes=4
+	local old
+	local i
+
+	[[ "$srv" == *@tcp* ]] || { skip "need a socklnd server" && return 0; }
+	[ -f $param ] || { skip "no conns_per_peer in ksocklnd" && return 0; }
+	[ "$srv" != "$($LCTL list_nids | head -n1)" ] ||
+		{ skip "need a remote server NID" && return 0; }
+
+	old=$(cat $param)
+	trap "echo $old > $param; $LCTL --net ${srv#*@} disconnect $srv" EXIT
+	echo $stripes > $param
+	$LCTL --net ${srv#*@} disconnect $srv || error "cannot disconnect $srv"
+
+	# the route connects every stripe once a message needs it
+	for ((i = 0; i < 30; i++)); do
+		$LCTL ping $srv > /dev/null
+		[ $(conns_of_type $srv I) -ge $stripes -a \
+		  $(conns_of_type $srv O) -ge $stripes ] && break
+		sleep 1
+	done
+	$LCTL --net ${srv#*@} conn_list
+
+	[ $(conns_of_type $srv C) -eq 1 ] ||
+		error "$(conns_of_type $srv C) CONTROL conns to $srv"
+	[ $(conns_of_type $srv I) -eq $stripes ] ||
+		error "$(conns_of_type $srv I) BULK_IN conns to $srv"
+	[ $(conns_of_type $srv O) -eq $stripes ] ||
+		error "$(conns_of_type $srv O) BULK_OUT conns to $srv"
+
+	echo $old > $param
+	$LCTL --net ${srv#*@} disconnect $srv
+	trap 0
+}
+run_test 103 "conns_per_peer stripes bulk conns of each direction"
+
+test_104() {
+	local module=$LUSTRE/tests/kernel/kmematch.ko
+	local run_id=$RANDOM
+
+	[ -f $module ] || { skip_env "no $module" && return 0; }
+
+	# Try to insert the module. This will always fail as the
+	# module is designed to not be inserted.
+	insmod $module run_id=$run_id &> /dev/null
+
+	dmesg | grep "lnet_kmematch_$run_id:"
+	dmesg | grep -q \
+	    "lnet_kmematch_$run_id: all PUTs matched the expected MEs" ||
+		error "ME matching failed"
+}
+run_test 104 "PUTs match MEs hashed by ignore-bits mask"
+
+# sum column $2 (cached, allocs, hits or frees) of descriptor type $1
+desc_stat() {
+	awk -v type=$1 -v col=$2 '
+		NR == 1 { for (i = 1; i <= NF; i++) if ($i == col) c = i }
+		NR > 1 && $2 == type { sum += $c }
+		END { print sum + 0 }' /proc/sys/lnet/descriptors
+}
+
+test_105() {
+	local max=$(cat /sys/module/lnet/parameters/lnet_desc_cache_max)
+	local file=$DIR/$tfile
+	local type
+	local stat
+	local -A before
+
+	[ -f /proc/sys/lnet/descriptors ] ||
+		{ skip "no LNet descriptor caches" && return 0; }
+	is_mounted $MOUNT || { skip_env "$MOUNT is not mounted" && return 0; }
+
+	for type in msg md me; do
+		for stat in hits frees; do
+			before[$type.$stat]=$(desc_stat $type $stat)
+		done
+	done
+
+	dd if=/dev/zero of=$file bs=1M count=32 conv=fsync ||
+		error "cannot write $file"
+	cancel_lru_locks osc
+	dd if=$file of=/dev/null bs=1M || error "cannot read $file"
+	rm -f $file
+
+	cat /proc/sys/lnet/descriptors
+	for type in msg md me; do
+		for stat in hits frees; do
+			[ $(desc_stat $type $stat) -gt ${before[$type.$stat]} ] ||
+				error "$type $stat did not move under traffic"
+		done
+	done
+
+	awk -v max=$max 'NR > 1 && $3 > max { bad = 1 } END { exit bad }' \
+		/proc/sys/lnet/descriptors ||
+		error "a cache holds more than lnet_desc_cache_max=$max"
+}
+run_test 105 "descriptor caches are used and stay within their limit"
+
+# router between this client and the servers, for the routing tests
+RTR=${RTR:-}
+rtr_CONCR=${rtr_CONCR:-512}
+rtr_DURATION=${rtr_DURATION:-20}
+
+# sum column $1 of /proc/sys/lnet/buffers on $RTR, or print the whole
+# column with --each
+rtr_buffers() {
+	local each=false
+
+	[ "$1" == "--each" ] && { each=true; shift; }
+	do_node $RTR cat /proc/sys/lnet/buffers |
+		awk -v col=$1 -v each=$each '
+			NR == 1 { for (i = 1; i <= NF; i++) if ($i == col) c = i }
+			NR > 1 { sum += $c; if (each == "true") print $c }
+			END { if (each != "true") print sum + 0 }'
+}
+
+# run $rtr_DURATION seconds of 1MB brw writes from $1 to $2, through $RTR
+rtr_brw() {
+	lst_setup_all
+	export LST_SESSION=$$
+	$LST new_session --timeo 100000 rtr || error "new_session failed"
+	$LST add_group c $1
+	$LST add_group s $2
+	$LST add_batch b
+	$LST add_test --batch b --concurrency $rtr_CONCR --from c --to s \
+		brw write size=1M || error "add_test failed"
+	$LST run b
+	sleep $rtr_DURATION
+	$LST stop b
+	$LST end_session
+}
+
+test_106() {
+	local param=/sys/module/lnet/parameters/router_buffers_auto
+	local nid=$($LCTL list_nids | head -n1)
+	local srv=$(do_facet mgs $LCTL list_nids | head -n1)
+	local blocked
+	local grown
+	local count
+	local i
+
+	[ -n "$RTR" ] || { skip_env "set RTR to a router to the servers" &&
+		return 0; }
+	[ x$LST != x ] || { skip_env "lst not found LST=$LST" && return 0; }
+	[ $(do_node $RTR cat $param) -eq 1 ] ||
+		{ skip "router_buffers_auto is off on $RTR" && return 0; }
+
+	# an idle pool halves every pass, let it get down to its minimum
+	count=$(rtr_buffers count)
+	for ((i = 0; i < 12; i++)); do
+		sleep 10
+		[ $(rtr_buffers count) -eq $count ] && break
+		count=$(rtr_buffers count)
+	done
+	do_node $RTR cat /proc/sys/lnet/buffers
+
+	# delaying the PUTs on the server holds the router buffers they are
+	# forwarded from, so more of them arrive than the pools can hold
+	do_facet mgs $LCTL net_delay_add -s $nid -d $srv -r 1 -l 2 -m PUT ||
+		error "cannot add delay rule"
+	trap "do_facet mgs $LCTL net_delay_del -a; lst_cleanup_all" EXIT
+
+	blocked=$(rtr_buffers blocked)
+	grown=$(rtr_buffers grown)
+	rtr_brw $nid $srv
+	sleep 10
+	do_node $RTR cat /proc/sys/lnet/buffers
+
+	[ $(rtr_buffers blocked) -gt $blocked ] ||
+		error "no message waited for a router buffer"
+	[ $(rtr_buffers grown) -gt $grown ] ||
+		error "router buffer pools did not grow"
+
+	# with autosizing off, the same load leaves the pools alone
+	do_node $RTR "echo 0 > $param"
+	trap "do_node $RTR 'echo 1 > $param'; \
+	      do_facet mgs $LCTL net_delay_del -a; lst_cleanup_all" EXIT
+
+	count=$(rtr_buffers --each count)
+	grown=$(rtr_buffers grown)
+	local shrunk=$(rtr_buffers shrunk)
+
+	rtr_brw $nid $srv
+	sleep 10
+	do_node $RTR cat /proc/sys/lnet/buffers
+
+	[ "$(rtr_buffers --each count)" == "$count" ] ||
+		error "pools were resized with router_buffers_auto=0"
+	[ $(rtr_buffers grown) -eq $grown -a \
+	  $(rtr_buffers shrunk) -eq $shrunk ] ||
+		error "grown/shrunk moved with router_buffers_auto=0"
+
+	do_node $RTR "echo 1 > $param"
+	do_facet mgs $LCTL net_delay_del -a
+	lst_cleanup_all
+	trap 0
+}
+run_test 106 "router buffer pools grow on demand, unless autosizing is off"
+
+# "throttled" count of the only delay rule
+delay_throttled() {
+	$LCTL net_delay_list | sed -n 's/.*, throttled \([0-9]*\),.*/\1/p'
+}
+
+test_107() {
+	local nid=$($LCTL list_nids | head -n1)
+	local srv=$(do_facet mgs $LCTL list_nids | head -n1)
+
+	[ -n "$srv" -a "$srv" != "$nid" ] ||
+		{ skip "need a remote server NID" && return 0; }
+
+	$LCTL net_delay_add -s $srv -d $nid -r 1 -j abc &&
+		error "jitter abc accepted"
+	$LCTL net_delay_add -s $srv -d $nid -r 1 -j 60001 &&
+		error "jitter above 60s accepted"
+	$LCTL net_delay_del -a
+
+	# 1000 bytes/s, no suffix, is rounded up to 1 KiB/s
+	$LCTL net_delay_add -s $srv -d $nid -r 1 -b 1000 -B 1000 -j 5ms ||
+		error "cannot add a 1000 bytes/s delay rule"
+	trap "$LCTL net_delay_del -a" EXIT
+	$LCTL net_delay_list
+
+	local throttled0=$(delay_throttled)
+	local i
+
+	# ping replies are matched on this node, a few of them are above
+	# the 1 KiB burst
+	for i in $(seq 5); do
+		$LCTL ping $srv > /dev/null || error "cannot ping $srv"
+	done
+
+	local throttled1=$(delay_throttled)
+
+	$LCTL net_delay_list
+	$LCTL net_delay_del -a
+	trap 0
+
+	echo "throttled $throttled0 -> $throttled1"
+	[ -n "$throttled1" ] && [ $throttled1 -gt $throttled0 ] ||
+		error "no ping reply was throttled"
+}
+run_test 107 "delay rules throttle messages above their bandwidth"
+
+complete $SECONDS
+exit_status
@@ -2013,6 +2013,52 @@ test_30() {
 }
 run_test 30 "check for invalid shared key"
 
+test_31() {
+	if ! $SHARED_KEY; then
+		skip "need shared key feature for this test" && return
+	fi
+	if [ $SK_FLAVOR != "skpi" ]; then
+		skip "test only valid if privacy is active" && return
+	fi
+
+	local params=/sys/module/ptlrpc_gss/parameters
+	local threads=$(cat $params/bulk_crypt_threads)
+	local chunk=$(cat $params/bulk_crypt_chunk_pages)
+	local file=$DIR/$tdir/$tfile
+	local tmp=$TMP/$tfile
+	local sum
+
+	[ $threads -ge 2 ] ||
+		{ skip "needs bulk_crypt_threads >= 2, got $threads" &&
+		  return; }
+	[ $(ps -e -o comm= | grep -c "^gss_crypt_") -ge $threads ] ||
+		error "fewer than $threads gss_crypt threads running"
+
+	mkdir -p $DIR/$tdir || error "mkdir failed"
+	dd if=/dev/urandom of=$tmp bs=1M count=64 || error "dd $tmp failed"
+	sum=$(md5sum < $tmp)
+
+	# small chunks, so that every bulk is split over the threads
+	trap "echo $chunk > $params/bulk_crypt_chunk_pages; \
+	      do_facet ost1 \"echo $chunk > $params/bulk_crypt_chunk_pages\"" \
+		EXIT
+	echo 4 > $params/bulk_crypt_chunk_pages
+	do_facet ost1 "echo 4 > $params/bulk_crypt_chunk_pages"
+
+	$LFS setstripe -c 1 -i 0 $file || error "setstripe $file failed"
+	dd if=$tmp of=$file bs=4M oflag=direct ||
+		error "encrypted write failed"
+	cancel_lru_locks osc
+	[ "$(md5sum < $file)" == "$sum" ] ||
+		error "data corrupted by parallel bulk crypto"
+
+	echo $chunk > $params/bulk_crypt_chunk_pages
+	do_facet ost1 "echo $chunk > $params/bulk_crypt_chunk_pages"
+	trap 0
+	rm -f $tmp $file
+}
+run_test 31 "privacy flavor bulk with several crypto threads"
+
 log "cleanup: ======================================================"
 
 sec_unsetup() {
@@ -8828,6 +8828,47 @@ test_123b () { # statahead(bug 15027)
 }
 run_test 123b "not panic with network error in statahead enqueue (bug 15027)"
 
+statahead_rpcs_123c() {
+	local batch=$1
+
+	$LCTL set_param llite.*.statahead_batch_max=$batch > /dev/null
+	cancel_lru_locks mdc
+	$LCTL set_param mdc.*.stats=clear > /dev/null
+	ls -l $DIR/$tdir > /dev/null || error "ls -l $DIR/$tdir failed"
+	calc_stats mdc.*.stats req_waittime
+}
+
+test_123c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	$LCTL get_param -n mdc.*.connect_flags | grep -q batch_rpc ||
+		{ skip "MDS does not support batch_rpc" && return; }
+
+	local nr=64
+	local batch_max=$($LCTL get_param -n llite.*.statahead_batch_max |
+			  head -n 1)
+	local sa_max=$($LCTL get_param -n llite.*.statahead_max | head -n 1)
+
+	[ $sa_max -eq 0 ] && skip "statahead is disabled" && return
+
+	test_mkdir $DIR/$tdir
+	createmany -d $DIR/$tdir/d $nr || error "createmany -d failed"
+	trap "$LCTL set_param llite.*.statahead_batch_max=$batch_max" EXIT
+
+	local unbatched=$(statahead_rpcs_123c 0)
+	local batched=$(statahead_rpcs_123c 16)
+
+	$LCTL get_param -n llite.*.statahead_stats
+	echo "MDC RPCs for 'ls -l' of $nr dirs: $unbatched without batch," \
+	     "$batched with batch of 16"
+	[ $batched -lt $unbatched ] ||
+		error "batched statahead sent $batched RPCs, not < $unbatched"
+
+	$LCTL set_param llite.*.statahead_batch_max=$batch_max
+	trap 0
+	rm -rf $DIR/$tdir
+}
+run_test 123c "statahead batches directory lookups into MDS_BATCH RPCs"
+
 test_124a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
 	[ -z "$($LCTL get_param -n mdc.*.connect_flags | grep lru_resize)" ] &&
@@ -9039,6 +9080,72 @@ test_124c() {
 }
 run_test 124c "LRUR cancel very aged locks"
 
+lru_stat_124d() {
+	$LCTL get_param -n ldlm.namespaces.*-MDT0000-mdc-*.lru_stats |
+		awk '/^'$1' / { print $2 }'
+}
+
+test_124d() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	local policy=$($LCTL get_param -n $nsdir.lru_cancel_policy)
+	local nr=100
+	local hits
+	local kept
+	local cancels
+
+	[ -z "$policy" ] && skip "no lru_cancel_policy on client" && return
+
+	$LCTL set_param $nsdir.lru_cancel_policy=foo &&
+		error "invalid LRU policy accepted"
+
+	test_mkdir $DIR/$tdir || error "failed to create $DIR/$tdir"
+	createmany -o $DIR/$tdir/f $nr ||
+		error "failed to create $nr files in $DIR/$tdir"
+	trap "$LCTL set_param $nsdir.lru_cancel_policy=$policy; \
+	      lru_resize_enable mdc" EXIT
+
+	for p in cost age; do
+		$LCTL set_param $nsdir.lru_cancel_policy=$p ||
+			error "failed to set the $p LRU policy"
+		lru_resize_enable mdc
+		cancel_lru_locks mdc
+		$LCTL set_param $nsdir.lru_stats=clear
+
+		ls -l $DIR/$tdir > /dev/null
+		# take the cached locks again, so that they cost more
+		ls -l $DIR/$tdir > /dev/null
+		# shrink the LRU, the locks just reused are kept for a lap
+		# by the cost policy
+		$LCTL set_param $nsdir.lru_size=$((nr / 4))
+		sleep 2
+		$LCTL set_param $nsdir.lru_size=$((nr / 4))
+		sleep 2
+
+		$LCTL get_param $nsdir.lru_stats
+		hits=$(lru_stat_124d ${p}_hits)
+		[ ${hits:-0} -gt 0 ] || error "no LRU hits counted for $p"
+		cancels=$(lru_stat_124d ${p}_cancels)
+		[ ${cancels:-0} -gt 0 ] ||
+			error "no LRU cancels counted for $p"
+		kept=$(lru_stat_124d ${p}_kept)
+		if [ $p == cost ]; then
+			[ ${kept:-0} -gt 0 ] ||
+				error "cost policy kept no reused lock"
+		else
+			[ ${kept:-0} -eq 0 ] ||
+				error "age policy kept $kept locks"
+		fi
+	done
+
+	$LCTL set_param $nsdir.lru_cancel_policy=$policy
+	lru_resize_enable mdc
+	trap 0
+	unlinkmany $DIR/$tdir/f $nr
+}
+run_test 124d "cost-aware LRU cancel policy stats"
+
 test_125() { # 13358
 	[ -z "$(lctl get_param -n llite.*.client_type | grep local)" ] && skip "must run as local client" && return
 	[ -z "$(lctl get_param -n mdc.*-mdc-*.connect_flags | grep acl)" ] && skip "must have acl enabled" && return
@@ -9144,6 +9251,37 @@ test_127b() { # bug LU-333
 }
 run_test 127b "verify the llite client stats are sane"
 
+test_127c() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	local osc=$($LCTL list_param osc.*OST0000-osc-[^mM]* | head -n1)
+	local lat="$osc.rpc_latency"
+
+	$SETSTRIPE -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+	$LCTL set_param $lat=clear
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 conv=fsync ||
+		error "dd failed"
+	cancel_lru_locks osc
+	$LCTL get_param $lat
+
+	# columns: usec queue send reqin nrs handle reply commit total
+	local counts=$($LCTL get_param -n $lat |
+		awk '/^ost_write$/ { w = 1; next } /^$/ { w = 0 }
+		     w && $1 ~ /^[0-9]+$/ { h += $6; t += $9 }
+		     END { print h + 0, t + 0 }')
+	local handle=${counts% *}
+	local total=${counts#* }
+
+	[ $total -gt 0 ] || error "no ost_write latency recorded"
+	[ $handle -eq $total ] ||
+		error "server reported $handle of $total ost_write RPCs"
+
+	$LCTL set_param $lat=clear
+	[ -z "$($LCTL get_param -n $lat | grep ost_write)" ] ||
+		error "rpc_latency not cleared"
+	rm -f $DIR/$tfile
+}
+run_test 127c "verify the client RPC latency breakdown"
+
 test_128() { # bug 15212
 	touch $DIR/$tfile
 	$LFS 2>&1 <<-EOF | tee $TMP/$tfile.log
@@ -12780,10 +12918,11 @@ test_215() { # for bugs 18102, 21079, 21517
 	remove_lnet_proc_files "peers"
 
 	# lnet.buffers  should look like this:
-	# pages count credits min
-	# where pages >=0, count >=0, credits and min are numeric (0 or >0 or <0)
-	L1="^pages +count +credits +min$"
-	BR="^ +$N +$N +$I +$I$"
+	# pages count credits min blocked grown shrunk
+	# where pages >=0, count >=0, credits and min are numeric (0 or >0 or <0),
+	# blocked, grown and shrunk >= 0
+	L1="^pages +count +credits +min +blocked +grown +shrunk$"
+	BR="^ +$N +$N +$I +$I +$N +$N +$N$"
 	create_lnet_proc_files "buffers"
 	check_lnet_proc_entry "buffers.sys" "lnet.buffers" "$BR" "$L1"
 	remove_lnet_proc_files "buffers"
@@ -15905,6 +16044,140 @@ test_313() {
 }
 run_test 313 "io should fail after last_rcvd update fail"
 
+# sum of OBD_PING RPCs sent by the OST imports during $1 seconds
+osc_pings_314() {
+	local secs=$1
+	local before
+	local after
+
+	before=$(calc_stats osc.*-osc-[^mM]*.stats obd_ping)
+	sleep $secs
+	after=$(calc_stats osc.*-osc-[^mM]*.stats obd_ping)
+	echo $((after - before))
+}
+
+test_314() {
+	[ $OSTCOUNT -lt 2 ] && skip "needs >= 2 OSTs" && return
+	$LCTL get_param -n osc.*OST0000-osc-[^mM]*.import |
+		grep -q ping_aggr ||
+		{ skip "server does not support aggregated pings"; return; }
+	[ "$(facet_active_host ost1)" == "$(facet_active_host ost2)" ] ||
+		{ skip "OST0000 and OST0001 are on different servers"; return; }
+
+	local param=/sys/module/ptlrpc/parameters/ping_aggr
+	local saved=$(cat $param)
+	# let the client idle for two ping intervals
+	local interval=$(($($LCTL get_param -n timeout) / 4))
+	local pings_off
+	local pings_on
+	local osc
+	local age
+
+	trap "echo $saved > $param" EXIT
+	echo 0 > $param
+	pings_off=$(osc_pings_314 $((interval * 2 + 2)))
+	echo 1 > $param
+	pings_on=$(osc_pings_314 $((interval * 2 + 2)))
+	echo $saved > $param
+	trap 0
+
+	echo "OBD_PING RPCs: $pings_off without, $pings_on with aggregation"
+	[ $pings_off -gt 0 ] || error "no pings sent without aggregation"
+	[ $pings_on -lt $pings_off ] ||
+		error "aggregation sent $pings_on pings, not < $pings_off"
+
+	for osc in $($LCTL list_param osc.*-osc-[^mM]*); do
+		$LCTL get_param -n $osc.import | grep -q "state: FULL" ||
+			error "$osc import is not FULL"
+		age=$($LCTL get_param -n $osc.timeouts |
+		      awk '/last reply/ { print $5 }' | tr -d s)
+		echo "$osc: last reply ${age}s ago"
+		[ $age -le $((interval + 2)) ] ||
+			error "$osc not pinged for ${age}s, interval $interval"
+	done
+}
+run_test 314 "aggregated pings keep all OST imports alive"
+
+# print "cpt size base" for each partition of the MDT service
+buf_size_315() {
+	do_facet mds1 $LCTL get_param -n mds.MDS.mdt.req_buffer_stats |
+		awk '/^cpt/ { print $2, $5, $7 }'
+}
+
+test_315() {
+	local param="mds.MDS.mdt.req_buffer_stats"
+	local stats
+	local nreqs
+	local grown
+	local cpt
+	local size
+	local base
+
+	do_facet mds1 $LCTL get_param -n $param > /dev/null 2>&1 ||
+		{ skip "MDS does not have $param"; return; }
+
+	test_mkdir $DIR/$tdir || error "mkdir $tdir failed"
+	do_facet mds1 $LCTL set_param $param=clear
+	createmany -o $DIR/$tdir/f 100 || error "createmany failed"
+	cancel_lru_locks mdc
+	ls -l $DIR/$tdir > /dev/null || error "ls failed"
+	setfattr -n user.big -v $(printf "%04000d" 0) $DIR/$tdir/f0 ||
+		error "setfattr failed"
+
+	stats=$(do_facet mds1 $LCTL get_param -n $param)
+	echo "$stats"
+	nreqs=$(echo "$stats" |
+		awk '/^[0-9]+:/ { sum += $2 } END { print sum }')
+	[ ${nreqs:-0} -ge 200 ] ||
+		error "only ${nreqs:-0} requests in size histogram"
+	echo "$stats" | awk '/^cpt/ { if ($5 < $7) exit 1 }' ||
+		error "buffer size below the configured size"
+
+	[ $(do_facet mds1 cat /sys/module/ptlrpc/parameters/req_buffer_adapt) \
+	  -eq 1 ] || { skip "req_buffer_adapt is disabled"; return; }
+
+	# ~60KB setxattr requests for one adaption interval: one maximum
+	# request plus 32 average ones is more than the 4x base size cap
+	local value=$(printf "%060000d" 0)
+	local end=$((SECONDS + 12))
+
+	while [ $SECONDS -lt $end ]; do
+		setfattr -n user.big -v $value $DIR/$tdir/f1 ||
+			error "setfattr failed"
+	done
+	setfattr -n user.big -v $value $DIR/$tdir/f1 || error "setfattr failed"
+	buf_size_315
+	grown=$(buf_size_315 | awk '$2 == 4 * $3 { print $1 }')
+	[ -n "$grown" ] || error "buffer size not raised to 4x base"
+
+	# small getattr requests only: buffers shrink back to the base size
+	end=$((SECONDS + 12))
+	while [ $SECONDS -lt $end ]; do
+		cancel_lru_locks mdc
+		stat $DIR/$tdir/f1 > /dev/null || error "stat failed"
+	done
+	cancel_lru_locks mdc
+	stat $DIR/$tdir/f1 > /dev/null || error "stat failed"
+	buf_size_315
+	for cpt in $grown; do
+		read size base < <(buf_size_315 | grep "^$cpt " | cut -d" " -f2-)
+		[ $size -eq $base ] ||
+			error "cpt $cpt buffer size $size, not back to $base"
+	done
+}
+run_test 315 "request buffer size histogram and adaption to load"
+
+test_316() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run" && return
+	which run-ptlrpc-bench.sh &> /dev/null ||
+		ls $LUSTRE/tests/run-ptlrpc-bench.sh &> /dev/null ||
+		{ skip_env "missing subtest run-ptlrpc-bench.sh" && return; }
+
+	sh $LUSTRE/tests/run-ptlrpc-bench.sh all 2 1000 256 ||
+		error "ptlrpc_bench failed"
+}
+run_test 316 "ptlrpc/ldlm microbenchmarks run from kernel module"
+
 test_fake_rw() {
 	local read_write=$1
 	if [ "$read_write" = "write" ]; then
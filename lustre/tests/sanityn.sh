@@ -3564,6 +3564,136 @@ test_77l() {
 }
 run_test 77l "check NRS Delay slows write RPC processing"
 
+# Keeps twice as many 64KB O_DIRECT writes in flight to ost1 as there are
+# ost_io threads ($1) from each of the jobids dd.0 (through $DIR1) and
+# dd.$RUNAS_ID (through $DIR2) for 20 seconds, and prints the number of
+# OST_WRITE RPCs served to dd.$RUNAS_ID per 100 served to dd.0
+dwrr_77m_share() {
+	local bs=$(($1 * 2 * 64))k
+	local stats=obdfilter.$FSNAME-OST0000.job_stats
+	local pid0
+	local pid1
+
+	rm -f $DIR1/$tdir/$tfile.0 $DIR1/$tdir/$tfile.1
+	do_facet ost1 $LCTL set_param -n $stats=clear
+
+	dd if=/dev/zero of=$DIR1/$tdir/$tfile.0 bs=$bs count=1000 \
+		oflag=direct 2> /dev/null &
+	pid0=$!
+	$RUNAS dd if=/dev/zero of=$DIR2/$tdir/$tfile.1 bs=$bs count=1000 \
+		oflag=direct 2> /dev/null &
+	pid1=$!
+	sleep 20
+	kill $pid0 $pid1
+	wait $pid0 $pid1 2> /dev/null
+
+	do_facet ost1 $LCTL get_param -n $stats |
+		awk -v runas=dd.$RUNAS_ID '
+			/job_id:/ { id = $2 }
+			/write_bytes:/ { n[id] = $4 + 0 }
+			END { printf "%d\n",
+			      n[runas] * 100 / (n["dd.0"] > 0 ? n["dd.0"] : 1) }'
+}
+
+# Checks that DWRR shares ost1 between two backlogged jobids according to
+# their weights; the ost_io threads are held for 1s on each OST_WRITE so
+# that both jobids always have requests queued.
+dwrr_77m_fairness() {
+	local threads=$(do_facet ost1 $LCTL get_param -n \
+			ost.OSS.ost_io.threads_started)
+	local osc=osc.$FSNAME-OST0000-osc-*
+	local saved_jobid_var=$($LCTL get_param -n jobid_var)
+	local saved_pages=$($LCTL get_param -n $osc.max_pages_per_rpc |
+			    head -n 1)
+	local saved_rif=$($LCTL get_param -n $osc.max_rpcs_in_flight |
+			  head -n 1)
+	local share
+
+	if [ $threads -gt 128 ]; then
+		echo "$threads ost_io threads on ost1, skip fairness check"
+		return 0
+	fi
+
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" procname_uid
+	fi
+
+	mkdir -p $DIR1/$tdir || error "mkdir $DIR1/$tdir failed"
+	$LFS setstripe -c 1 -i 0 $DIR1/$tdir || error "setstripe failed"
+	chmod 777 $DIR1/$tdir
+	$LCTL set_param $osc.max_pages_per_rpc=16 \
+		$osc.max_rpcs_in_flight=$((threads * 2))
+	#define OBD_FAIL_OST_BRW_PAUSE_BULK	0x214
+	do_facet ost1 $LCTL set_param fail_val=1 fail_loc=0x214
+	trap "do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0" EXIT
+
+	share=$(dwrr_77m_share $threads)
+	echo "dd.$RUNAS_ID served $share per 100 dd.0 RPCs, equal weights"
+	[ $share -ge 50 -a $share -le 200 ] ||
+		error "equal weights served dd.$RUNAS_ID $share per 100 RPCs"
+
+	do_facet ost1 $LCTL set_param ost.OSS.ost_io.nrs_dwrr_rules="start dwrr_77m jobid={dd.$RUNAS_ID} weight=4" ||
+		error "failed to add dwrr jobid rule"
+	share=$(dwrr_77m_share $threads)
+	echo "dd.$RUNAS_ID served $share per 100 dd.0 RPCs, weight 4"
+	[ $share -ge 200 ] ||
+		error "weight 4 served dd.$RUNAS_ID only $share per 100 RPCs"
+
+	do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0
+	trap 0
+	do_facet ost1 $LCTL set_param \
+		ost.OSS.ost_io.nrs_dwrr_rules="stop dwrr_77m"
+	$LCTL set_param $osc.max_pages_per_rpc=$saved_pages \
+		$osc.max_rpcs_in_flight=$saved_rif
+	rm -rf $DIR1/$tdir
+
+	if [ $saved_jobid_var != procname_uid ]; then
+		set_conf_param_and_check client			\
+			"$LCTL get_param -n jobid_var"		\
+			"$FSNAME.sys.jobid_var" $saved_jobid_var
+	fi
+}
+
+test_77m() {
+	local nid=$(lctl list_nids | head -n 1)
+
+	oss=$(comma_list $(osts_nodes))
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="dwrr" \
+			   ost.OSS.ost_io.nrs_dwrr_quantum=65536 ||
+		error "failed to set dwrr policy"
+
+	echo "policy: dwrr nid, dwrr_quantum 64K"
+	nrs_write_read
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_dwrr_rules="start dwrr_77m nid={$nid} weight=4" ||
+		error "failed to add dwrr rule"
+	do_nodes $oss lctl get_param -n ost.OSS.ost_io.nrs_dwrr_rules |
+		grep -q dwrr_77m || error "dwrr rule not listed"
+
+	echo "policy: dwrr nid, rule for $nid with weight 4"
+	nrs_write_read
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_dwrr_rules="stop dwrr_77m"
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="dwrr\ jobid"
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_dwrr_rules="start dwrr_77m jobid={dd.$RUNAS_ID} weight=2" ||
+		error "failed to add dwrr jobid rule"
+
+	echo "policy: dwrr jobid, rule for dd.$RUNAS_ID with weight 2"
+	nrs_write_read
+
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_dwrr_rules="stop dwrr_77m"
+	dwrr_77m_fairness
+
+	# cleanup
+	do_nodes $oss lctl set_param ost.OSS.ost_io.nrs_policies="fifo"
+	return 0
+}
+run_test 77m "check DWRR NRS policy"
+
 test_78() { #LU-6673
 	local server_version=$(lustre_version_code ost1)
 	[[ $server_version -ge $(version_code 2.7.58) ]] ||
@@ -4001,6 +4131,46 @@ test_93() {
 }
 run_test 93 "alloc_rr should not allocate on same ost"
 
+test_94() {
+	remote_mds_nodsh && skip "remote MDS with nodsh" && return
+	$LCTL get_param -n mdc.$FSNAME-MDT0000-mdc-*.connect_flags |
+		grep -q bl_ast_batch ||
+		{ skip "MDS does not batch blocking ASTs" && return; }
+
+	local inst=$($LFS getname $MOUNT1 | cut -d' ' -f1 | sed 's/.*-//')
+	local ns=ldlm.namespaces.$FSNAME-MDT0000-mdc-$inst
+	local locks1
+	local locks2
+	local blk1
+	local blk2
+
+	touch $DIR1/$tfile || error "touch $DIR1/$tfile failed"
+	setfattr -n user.$tfile -v yes $DIR1/$tfile 2>/dev/null
+	cancel_lru_locks mdc
+
+	# take separate LOOKUP/UPDATE, LAYOUT and XATTR locks on mount 1
+	stat $DIR1/$tfile > /dev/null || error "stat $DIR1/$tfile failed"
+	cat $DIR1/$tfile > /dev/null || error "cat $DIR1/$tfile failed"
+	getfattr -n user.$tfile $DIR1/$tfile > /dev/null 2>&1
+	locks1=$($LCTL get_param -n $ns.lock_count)
+	blk1=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+	       awk '/ldlm_bl_callback/ {print $2}')
+
+	rm -f $DIR2/$tfile || error "rm $DIR2/$tfile failed"
+	sleep 1
+	locks2=$($LCTL get_param -n $ns.lock_count)
+	blk2=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+	       awk '/ldlm_bl_callback/ {print $2}')
+	echo "cancelled $((locks1 - locks2)) locks with" \
+	     "$((blk2 - blk1)) blocking AST RPCs"
+
+	[ $((locks1 - locks2)) -ge 2 ] ||
+		{ skip "only $((locks1 - locks2)) locks revoked" && return; }
+	[ $((blk2 - blk1)) -lt $((locks1 - locks2)) ] ||
+		error "blocking ASTs were not batched"
+}
+run_test 94 "batch blocking ASTs for several locks of one client"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
@@ -116,7 +116,10 @@ command_t cmdlist[] = {
 	 "		      <<-r | --rate DROP_RATE> |\n"
 	 "		       <-i | --interval SECONDS>>\n"
 	 "		      [<-p | --portal> PORTAL...]\n"
-	 "		      [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"},
+	 "		      [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"
+	 "		      [-e | --error]\n"
+	 "	-e fails the matched sends of this node with a network\n"
+	 "	error, instead of dropping the messages when received\n"},
 	{"net_drop_del", jt_ptl_drop_del, 0, "remove LNet drop rule\n"
 	 "usage: net_drop_del <[-a | --all] |\n"
 	 "		      <-s | --source NID>\n"
@@ -130,9 +133,15 @@ command_t cmdlist[] = {
 	 "		       <-d | --dest NID>\n"
 	 "		       <<-r | --rate DROP_RATE> |\n"
 	 "			<-i | --interval SECONDS>>\n"
-	 "		       <-l | --latency SECONDS>\n"
+	 "		       [<-l | --latency SECONDS | MILLISECONDSms>]\n"
+	 "		       [<-j | --jitter MILLISECONDS>]\n"
+	 "		       [<-t | --jitter_type uniform|normal|pareto>]\n"
+	 "		       [<-b | --bandwidth BYTES_PER_SEC[KMG]>]\n"
+	 "		       [<-B | --burst BYTES[KMG]>]\n"
 	 "		       [<-p | --portal> PORTAL...]\n"
-	 "		       [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"},
+	 "		       [<-m | --message> <PUT|ACK|GET|REPLY>...]\n"
+	 "	at least one of latency, jitter or bandwidth is needed,\n"
+	 "	use '-r 1' to shape all the matched messages\n"},
 	{"net_delay_del", jt_ptl_delay_del, 0, "remove LNet delay rule\n"
 	 "usage: net_delay_del <[-a | --all] |\n"
 	 "		       <-s | --source NID>\n"
@@ -409,9 +409,11 @@ check_ptlrpc_body(void)
 	CHECK_CVALUE(PTLRPC_NUM_VERSIONS);
 	CHECK_MEMBER(ptlrpc_body, pb_pre_versions);
 	CHECK_MEMBER(ptlrpc_body, pb_mbits);
-	CHECK_MEMBER(ptlrpc_body, pb_padding64_0);
-	CHECK_MEMBER(ptlrpc_body, pb_padding64_1);
-	CHECK_MEMBER(ptlrpc_body, pb_padding64_2);
+	CHECK_MEMBER(ptlrpc_body, pb_reqin_time);
+	CHECK_MEMBER(ptlrpc_body, pb_nrs_time);
+	CHECK_MEMBER(ptlrpc_body, pb_handle_time);
+	CHECK_MEMBER(ptlrpc_body, pb_padding2);
+	CHECK_MEMBER(ptlrpc_body, pb_replay_prev);
 	CHECK_CVALUE(LUSTRE_JOBID_SIZE);
 	CHECK_MEMBER(ptlrpc_body, pb_jobid);
 
@@ -435,9 +437,11 @@ check_ptlrpc_body(void)
 	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_slv);
 	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_pre_versions);
 	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_mbits);
-	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_padding64_0);
-	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_padding64_1);
-	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_padding64_2);
+	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_reqin_time);
+	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_nrs_time);
+	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_handle_time);
+	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_padding2);
+	CHECK_MEMBER_SAME(ptlrpc_body_v3, ptlrpc_body_v2, pb_replay_prev);
 
 	CHECK_VALUE(MSG_PTLRPC_BODY_OFF);
 	CHECK_VALUE(REQ_REC_OFF);
@@ -594,6 +598,10 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT_OBDOPACK);
 	CHECK_DEFINE_64X(OBD_CONNECT_FLAGS2);
 	CHECK_DEFINE_64X(OBD_CONNECT2_FILE_SECCTX);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_RPC);
+	CHECK_DEFINE_64X(OBD_CONNECT2_REPLAY_WINDOW);
+	CHECK_DEFINE_64X(OBD_CONNECT2_PING_AGGR);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BL_AST_BATCH);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -1097,6 +1105,32 @@ check_mdt_ioepoch(void)
 	CHECK_MEMBER(mdt_ioepoch, mio_padding);
 }
 
+static void
+check_mdt_batch_op(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(mdt_batch_op);
+	CHECK_MEMBER(mdt_batch_op, mbop_opc);
+	CHECK_MEMBER(mdt_batch_op, mbop_flags);
+	CHECK_MEMBER(mdt_batch_op, mbop_fid);
+	CHECK_MEMBER(mdt_batch_op, mbop_valid);
+	CHECK_MEMBER(mdt_batch_op, mbop_name_off);
+	CHECK_MEMBER(mdt_batch_op, mbop_name_len);
+	CHECK_MEMBER(mdt_batch_op, mbop_lockh);
+}
+
+static void
+check_mdt_batch_rep(void)
+{
+	BLANK_LINE();
+	CHECK_STRUCT(mdt_batch_rep);
+	CHECK_MEMBER(mdt_batch_rep, mbr_status);
+	CHECK_MEMBER(mdt_batch_rep, mbr_padding);
+	CHECK_MEMBER(mdt_batch_rep, mbr_lockh);
+	CHECK_MEMBER(mdt_batch_rep, mbr_lock_bits);
+	CHECK_MEMBER(mdt_batch_rep, mbr_body);
+}
+
 static void
 check_mdt_rec_setattr(void)
 {
@@ -2590,6 +2624,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(MDS_HSM_CT_REGISTER);
 	CHECK_VALUE(MDS_HSM_CT_UNREGISTER);
 	CHECK_VALUE(MDS_SWAP_LAYOUTS);
+	CHECK_VALUE(MDS_BATCH);
 	CHECK_VALUE(MDS_LAST_OPC);
 
 	CHECK_VALUE(REINT_SETATTR);
@@ -2770,6 +2805,8 @@ main(int argc, char **argv)
 	check_ll_fid();
 	check_mdt_body();
 	check_mdt_ioepoch();
+	check_mdt_batch_op();
+	check_mdt_batch_rep();
 	check_mdt_rec_setattr();
 	check_mdt_rec_create();
 	check_mdt_rec_link();